@@ -0,0 +1,97 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <tinyutf8/arena.h>
+
+namespace
+{
+	std::size_t num_allocations = 0;
+}
+
+//! Count all heap allocations of the process
+void* operator new( std::size_t size )
+{
+	++num_allocations;
+	if( void* ptr = std::malloc( size ? size : 1 ) )
+		return ptr;
+	throw std::bad_alloc();
+}
+void operator delete( void* ptr ) noexcept { std::free( ptr ); }
+void operator delete( void* ptr , std::size_t ) noexcept { std::free( ptr ); }
+
+namespace
+{
+	//! Splits a request into its lines (i.e. header fields) and returns the number of codepoints
+	template<typename String, typename Allocator>
+	std::size_t parse_request( const std::string& request , std::vector<String>& fields , const Allocator& alloc )
+	{
+		std::size_t result = 0;
+		for( std::size_t begin = 0 , end ; begin < request.size() ; begin = end + 1 ){
+			end = request.find( '\n' , begin );
+			fields.emplace_back( request.data() + begin , end - begin , tiny_utf8::strict , alloc );
+			result += fields.back().length();
+		}
+		fields.clear();
+		return result;
+	}
+
+	//! Parses 'requests' repeatedly for about half a second and prints the throughput and the number of heap allocations per request
+	template<typename Func>
+	void measure( const char* name , const std::vector<std::string>& requests , Func func )
+	{
+		using clock = std::chrono::steady_clock;
+		std::size_t			iterations = 0;
+		std::size_t			bytes = 0;
+		volatile std::size_t	sink = 0;
+		for( const std::string& request : requests )
+			bytes += request.size();
+		std::size_t			allocations = num_allocations;
+		clock::time_point	start = clock::now();
+		clock::duration		elapsed;
+		do{
+			for( const std::string& request : requests )
+				sink = sink + func( request );
+			++iterations;
+		}while( ( elapsed = clock::now() - start ) < std::chrono::milliseconds( 500 ) );
+		double seconds = std::chrono::duration<double>( elapsed ).count();
+		std::printf(
+			"%-28s %10.1f MB/s %8.2f allocations per request\n"
+			, name
+			, bytes * iterations / seconds / 1e6
+			, double( num_allocations - allocations ) / ( iterations * requests.size() )
+		);
+	}
+}
+
+int main()
+{
+	// Requests consisting of header fields that are too long for small string optimization
+	std::vector<std::string> requests;
+	for( int i = 0 ; i < 1000 ; ++i ){
+		std::string request;
+		for( int field = 0 ; field < 20 ; ++field )
+			request += "X-Field-" + std::to_string( field ) + ": Löwen, Bären, Vögel und Käfer sind Tiere " + std::to_string( i ) + "\n";
+		requests.push_back( request );
+	}
+	
+	std::vector<tiny_utf8::string> heap_fields;
+	heap_fields.reserve( 20 );
+	measure( "std::allocator" , requests , [&]( const std::string& request ){
+		return parse_request( request , heap_fields , tiny_utf8::string::allocator_type() );
+	} );
+	
+	tiny_utf8::arena arena;
+	std::vector<tiny_utf8::arena_string> arena_fields;
+	arena_fields.reserve( 20 );
+	measure( "arena (reset per request)" , requests , [&]( const std::string& request ){
+		std::size_t result = parse_request( request , arena_fields , tiny_utf8::arena_allocator<char>( arena ) );
+		arena.reset();
+		return result;
+	} );
+	
+	return 0;
+}
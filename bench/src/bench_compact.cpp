@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <tinyutf8/tinyutf8.h>
+
+namespace
+{
+	//! Generates words and short phrases (mostly 4 to 30 bytes, some up to 60 bytes, some non-ascii), as found in e.g. tokenized text or column stores
+	std::vector<std::string> generate_records( std::size_t count )
+	{
+		static const char* const	syllables[] = { "ka" , "lo" , "min" , "dé" , "stra" , "ü" , "ber" , "to" , "x" , "nor" , "ſe" , "qui" };
+		std::mt19937				rng( 42 );
+		std::vector<std::string>	result;
+		result.reserve( count );
+		for( std::size_t i = 0 ; i < count ; ++i ){
+			std::size_t	num_syllables = 2 + rng() % 6;
+			if( rng() % 8 == 0 )
+				num_syllables += 8 + rng() % 12;
+			std::string record;
+			while( num_syllables-- > 0 ){
+				record += syllables[rng() % 12];
+				if( rng() % 7 == 0 )
+					record += ' ';
+			}
+			result.push_back( record );
+		}
+		return result;
+	}
+
+	//! Builds a table of strings from 'records', sorts it and hashes it in random order, printing the time per record and the memory used
+	template<typename String>
+	void measure( const char* name , const std::vector<std::string>& records , const std::vector<std::size_t>& order )
+	{
+		using clock = std::chrono::steady_clock;
+		
+		clock::time_point	start = clock::now();
+		std::vector<String>	table;
+		table.reserve( records.size() );
+		for( const std::string& record : records )
+			table.emplace_back( record.data() , record.size() );
+		double build_seconds = std::chrono::duration<double>( clock::now() - start ).count();
+		
+		tiny_utf8::memory_usage_info usage = tiny_utf8::total_memory_usage( table );
+		
+		// Hash all strings in random order (every heap buffer is a potential cache miss)
+		volatile std::size_t	sink = 0;
+		std::hash<String>		hasher;
+		start = clock::now();
+		for( int round = 0 ; round < 10 ; ++round )
+			for( std::size_t index : order )
+				sink = sink + hasher( table[index] );
+		double hash_seconds = std::chrono::duration<double>( clock::now() - start ).count();
+		
+		// Sort them (moves the objects around, comparing mostly short prefixes)
+		start = clock::now();
+		std::sort( table.begin() , table.end() );
+		double sort_seconds = std::chrono::duration<double>( clock::now() - start ).count();
+		
+		std::printf(
+			"%-16s (sizeof %2zu): %6.1f ns/record build %6.1f ns/record hash %6.1f ns/record sort %5.1f%% on heap %6.1f bytes/record total\n"
+			, name
+			, sizeof(String)
+			, build_seconds * 1e9 / records.size()
+			, hash_seconds * 1e9 / ( 10 * records.size() )
+			, sort_seconds * 1e9 / records.size()
+			, 100.0 * usage.num_heap_strings / records.size()
+			, double( usage.object_bytes + usage.heap_bytes ) / records.size()
+		);
+	}
+}
+
+int main()
+{
+	std::vector<std::string>	records = generate_records( 1 << 21 );
+	std::vector<std::size_t>	order( records.size() );
+	std::size_t					total_bytes = 0;
+	for( std::size_t i = 0 ; i < records.size() ; ++i ){
+		order[i] = i;
+		total_bytes += records[i].size();
+	}
+	std::shuffle( order.begin() , order.end() , std::mt19937( 7 ) );
+	std::printf( "%zu records, %.1f bytes on average\n" , records.size() , double( total_bytes ) / records.size() );
+	
+	measure<tiny_utf8::string>( "string" , records , order );
+	measure<tiny_utf8::compact_string>( "compact_string" , records , order );
+	
+	return 0;
+}
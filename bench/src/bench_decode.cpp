@@ -0,0 +1,90 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#include <tinyutf8/tinyutf8.h>
+
+namespace
+{
+	//! Runs 'func' repeatedly for about half a second and prints the throughput in MB/s (relative to 'bytes')
+	template<typename Func>
+	void measure( const char* name , std::size_t bytes , Func func )
+	{
+		using clock = std::chrono::steady_clock;
+		std::size_t			iterations = 0;
+		volatile char32_t	sink = 0;
+		clock::time_point	start = clock::now();
+		clock::duration		elapsed;
+		do{
+			sink = sink + func();
+			++iterations;
+		}while( ( elapsed = clock::now() - start ) < std::chrono::milliseconds( 500 ) );
+		double seconds = std::chrono::duration<double>( elapsed ).count();
+		std::printf( "%-28s %10.1f MB/s\n" , name , bytes * iterations / seconds / 1e6 );
+	}
+}
+
+int main()
+{
+	std::printf( "TINY_UTF8_STRICT_4BYTE: %s\n" , TINY_UTF8_STRICT_4BYTE ? "on" : "off" );
+	std::printf( "simd level: %d (set TINY_UTF8_SIMD_LEVEL to lower it)\n" , (int)tiny_utf8::get_simd_level() );
+	
+	// Mixed text with 1 to 4 byte codepoints
+	std::u32string codepoints;
+	for( int i = 0 ; i < 20000 ; ++i )
+		codepoints += U"Löwen, Bären, Vögel und Käfer sind Tiere. ツ♫ 🌍 ";
+	tiny_utf8::string str( codepoints.c_str() );
+	
+	measure( "forward iteration" , str.size() , [&]{
+		char32_t sum = 0;
+		for( auto it = str.raw_begin() , end = str.raw_end() ; it != end ; ++it )
+			sum += *it;
+		return sum;
+	} );
+	measure( "reverse iteration" , str.size() , [&]{
+		char32_t sum = 0;
+		for( auto it = str.raw_rbegin() , end = str.raw_rend() ; it != end ; ++it )
+			sum += *it;
+		return sum;
+	} );
+	measure( "construct from utf-32" , str.size() , [&]{
+		return (char32_t)tiny_utf8::string( codepoints.c_str() ).size();
+	} );
+	std::u32string ascii( codepoints.size() , U'x' );
+	measure( "construct from ascii utf-32" , ascii.size() , [&]{
+		return (char32_t)tiny_utf8::string( ascii.c_str() , ascii.size() ).size();
+	} );
+	std::u32string wide( str.length() + 1 , U'\0' );
+	measure( "to utf-32" , str.size() , [&]{
+		str.to_wide_literal( &wide[0] );
+		return wide[0];
+	} );
+	std::u16string units = str.to_u16string();
+	measure( "construct from utf-16" , str.size() , [&]{
+		return (char32_t)tiny_utf8::string( units.data() , units.size() ).size();
+	} );
+	measure( "to utf-16" , str.size() , [&]{
+		return (char32_t)str.to_u16string()[0];
+	} );
+	std::string latin1 = str.to_latin1();
+	measure( "construct from latin-1" , latin1.size() , [&]{
+		return (char32_t)tiny_utf8::string( latin1.data() , latin1.size() , tiny_utf8::latin1 ).size();
+	} );
+	tiny_utf8::string ascii_str( ascii.c_str() , ascii.size() );
+	std::string ascii_bytes = ascii_str.cpp_str();
+	measure( "construct from ascii utf-8" , ascii_bytes.size() , [&]{
+		return (char32_t)tiny_utf8::string( ascii_bytes ).length();
+	} );
+	measure( "validate ascii" , ascii_bytes.size() , [&]{
+		return (char32_t)tiny_utf8::validate( ascii_bytes.data() , ascii_bytes.size() );
+	} );
+	tiny_utf8::string needle( U"Käfer sind Nashörner" );
+	measure( "find" , str.size() , [&]{
+		return (char32_t)str.parallel_find( needle , 0 , tiny_utf8::parallel_t( 1 ) );
+	} );
+	measure( "ascii to utf-32" , ascii_str.size() , [&]{
+		return ascii_str.to_u32string()[0];
+	} );
+	
+	return 0;
+}
@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+
+#include <tinyutf8/tinyutf8.h>
+
+namespace
+{
+	//! Generates 'num_bytes' of mostly ascii text with some 2-, 3- and 4-byte codepoints (like e.g. a large log or a corpus dump)
+	std::string generate_text( std::size_t num_bytes )
+	{
+		static const char* const	words[] = { "the " , "käfer " , "straße " , "über " , "data " , "ツ " , "log " , "♫ " , "🌍 " , "entry\n" , "löwe " , "value " };
+		std::mt19937				rng( 42 );
+		std::string					result;
+		result.reserve( num_bytes + 16 );
+		while( result.size() < num_bytes )
+			result += words[rng() % 12];
+		return result;
+	}
+
+	//! Constructs a string from 'text' several times using 'num_threads' threads and returns the best throughput in GB/s
+	double measure( const std::string& text , unsigned int num_threads )
+	{
+		using clock = std::chrono::steady_clock;
+		
+		double best_seconds = 0;
+		for( int round = 0 ; round < 5 ; ++round ){
+			clock::time_point	start = clock::now();
+			tiny_utf8::string	str( text.data() , text.size() , tiny_utf8::parallel_t( num_threads ) );
+			double				seconds = std::chrono::duration<double>( clock::now() - start ).count();
+			if( !round || seconds < best_seconds )
+				best_seconds = seconds;
+			if( str.size() != text.size() )
+				std::printf( "size mismatch!\n" );
+		}
+		return text.size() / best_seconds * 1e-9;
+	}
+}
+
+int main( int argc , char** argv )
+{
+	std::string		text = generate_text( std::size_t(256) << 20 );
+	unsigned int	max_threads = std::max( 1u , argc > 1 ? (unsigned int)std::atoi( argv[1] ) : std::thread::hardware_concurrency() );
+	std::printf( "%zu MB of utf8, up to %u threads\n" , text.size() >> 20 , max_threads );
+	
+	// Double the number of threads up to the number of hardware threads
+	double single = measure( text , 1 );
+	for( unsigned int num_threads = 1 ; ; num_threads = std::min( 2 * num_threads , max_threads ) ){
+		double throughput = num_threads == 1 ? single : measure( text , num_threads );
+		std::printf( "%2u threads: %6.2f GB/s (speedup %4.2fx)\n" , num_threads , throughput , throughput / single );
+		if( num_threads == max_threads )
+			break;
+	}
+	
+	return 0;
+}
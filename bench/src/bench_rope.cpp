@@ -0,0 +1,50 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+
+#include <tinyutf8/gap_string.h>
+#include <tinyutf8/rope.h>
+
+namespace
+{
+	//! Performs 'num_edits' keystrokes (insert or erase a codepoint at a random position resp. around a moving cursor) and prints the time per keystroke
+	template<typename Document>
+	void measure( const char* name , Document document , int num_edits , bool at_cursor = false )
+	{
+		using clock = std::chrono::steady_clock;
+		std::mt19937			rng( 42 );
+		volatile std::size_t	sink = 0;
+		std::size_t				cursor = document.length() / 2;
+		clock::time_point		start = clock::now();
+		for( int i = 0 ; i < num_edits ; ++i ){
+			std::size_t pos = at_cursor ? ( cursor += rng() % 3 ) : rng() % document.length();
+			if( i % 2 )
+				document.erase( pos , 1 );
+			else
+				document.insert( pos , U'ä' );
+			sink = sink + document.length();
+		}
+		double seconds = std::chrono::duration<double>( clock::now() - start ).count();
+		std::printf( "%-24s %-8s %12.3f us/keystroke\n" , name , at_cursor ? "cursor" : "random" , seconds * 1e6 / num_edits );
+	}
+}
+
+int main()
+{
+	// A document of about 16 MB, mostly ascii
+	std::string text;
+	while( text.size() < ( 16u << 20 ) )
+		text += u8"Löwen, Bären, Vögel und Käfer sind Tiere. Ein Haus hat Zimmer, Türen und Fenster.\n";
+	tiny_utf8::string document( text );
+	std::printf( "%zu bytes, %zu codepoints\n" , document.size() , document.length() );
+	
+	measure( "tiny_utf8::string" , document , 200 );
+	measure( "tiny_utf8::string" , document , 200 , true );
+	measure( "tiny_utf8::rope" , tiny_utf8::rope( document ) , 200000 );
+	measure( "tiny_utf8::rope" , tiny_utf8::rope( document ) , 200000 , true );
+	measure( "tiny_utf8::gap_string" , tiny_utf8::gap_string( document ) , 200 );
+	measure( "tiny_utf8::gap_string" , tiny_utf8::gap_string( document ) , 200000 , true );
+	
+	return 0;
+}
@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <tinyutf8/tinyutf8.h>
+
+namespace
+{
+	std::size_t num_allocations = 0;
+	std::size_t num_allocated_bytes = 0;
+}
+
+//! Count all heap allocations of the process
+void* operator new( std::size_t size )
+{
+	++num_allocations;
+	num_allocated_bytes += size;
+	if( void* ptr = std::malloc( size ? size : 1 ) )
+		return ptr;
+	throw std::bad_alloc();
+}
+void operator delete( void* ptr ) noexcept { std::free( ptr ); }
+void operator delete( void* ptr , std::size_t ) noexcept { std::free( ptr ); }
+
+namespace
+{
+	//! Generates identifiers like "eu-west-1.checkout.instance-004711.latency_p99" (mostly 20 to 70 bytes, some non-ascii)
+	std::vector<std::string> generate_keys( std::size_t count )
+	{
+		static const char* const	regions[] = { "eu-west-1" , "us-east-2" , "ap-south-1" , "zürich" };
+		static const char* const	services[] = { "auth" , "checkout" , "search-indexer" , "recommendation-engine" , "db" };
+		static const char* const	metrics[] = { "cpu" , "latency_p99" , "requests_per_second" , "heap_bytes.young_generation" , "errors" };
+		std::mt19937				rng( 42 );
+		std::vector<std::string>	result;
+		result.reserve( count );
+		for( std::size_t i = 0 ; i < count ; ++i ){
+			std::string key = regions[rng() % 4];
+			key += '.';
+			key += services[rng() % 5];
+			if( rng() % 2 )
+				key += ".instance-" + std::to_string( 100000 + rng() % 900000 );
+			key += '.';
+			key += metrics[rng() % 5];
+			result.push_back( key );
+		}
+		return result;
+	}
+
+	//! Builds a table of strings from 'keys' and visits it in random order, printing the time per key and the heap allocations
+	template<std::size_t Capacity>
+	void measure( const char* name , const std::vector<std::string>& keys , const std::vector<std::size_t>& order )
+	{
+		using string = tiny_utf8::basic_string<char32_t, char, std::allocator<char>, Capacity>;
+		using clock = std::chrono::steady_clock;
+		
+		std::size_t			allocations = num_allocations;
+		std::size_t			allocated_bytes = num_allocated_bytes;
+		clock::time_point	start = clock::now();
+		std::vector<string>	table;
+		table.reserve( keys.size() );
+		for( const std::string& key : keys )
+			table.emplace_back( key.data() , key.size() , tiny_utf8::strict );
+		double build_seconds = std::chrono::duration<double>( clock::now() - start ).count();
+		allocations = num_allocations - allocations - 1; // Don't count the table itself
+		allocated_bytes = num_allocated_bytes - allocated_bytes - keys.size() * sizeof(string);
+		
+		// Visit all strings in random order (every heap buffer is a potential cache miss)
+		volatile std::size_t	sink = 0;
+		std::hash<string>		hasher;
+		start = clock::now();
+		for( int round = 0 ; round < 10 ; ++round )
+			for( std::size_t index : order )
+				sink = sink + hasher( table[index] ) + table[index].length();
+		double visit_seconds = std::chrono::duration<double>( clock::now() - start ).count();
+		
+		std::printf(
+			"%-22s (sizeof %3zu): %6.1f ns/key build %6.1f ns/key visit %5.1f%% keys on heap %8.1f bytes/key total\n"
+			, name
+			, sizeof(string)
+			, build_seconds * 1e9 / keys.size()
+			, visit_seconds * 1e9 / ( 10 * keys.size() )
+			, 100.0 * allocations / keys.size()
+			, double( sizeof(string) + allocated_bytes / double( keys.size() ) )
+		);
+	}
+}
+
+int main()
+{
+	std::vector<std::string>	keys = generate_keys( 1 << 18 );
+	std::vector<std::size_t>	order( keys.size() );
+	std::size_t					total_bytes = 0;
+	for( std::size_t i = 0 ; i < keys.size() ; ++i ){
+		order[i] = i;
+		total_bytes += keys[i].size();
+	}
+	std::shuffle( order.begin() , order.end() , std::mt19937( 7 ) );
+	std::printf( "%zu keys, %.1f bytes on average\n" , keys.size() , double( total_bytes ) / keys.size() );
+	
+	measure<0>( "sso capacity default" , keys , order );
+	measure<47>( "sso capacity 47" , keys , order );
+	measure<63>( "sso capacity 63" , keys , order );
+	measure<127>( "sso capacity 127" , keys , order );
+	
+	return 0;
+}
@@ -0,0 +1,252 @@
+/**
+ * Copyright (c) 2015-2021 Jakob Riedle (DuffsDevice)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR 'AS IS' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _TINY_UTF8_ARENA_H_
+#define _TINY_UTF8_ARENA_H_
+
+// Includes
+#include <tinyutf8/tinyutf8.h> // for tiny_utf8::basic_string, TINY_UTF8_NOEXCEPT
+#include <new> // for ::operator new, std::nothrow
+#include <cstddef> // for std::size_t, std::max_align_t
+#include <cstdint> // for std::uintptr_t
+#include <algorithm> // for std::max
+
+//! Determine, whether std::pmr is available
+#if TINY_UTF8_CPLUSPLUS >= 201703L && defined(__has_include)
+	#if __has_include(<memory_resource>)
+		#include <memory_resource> // for std::pmr::memory_resource, std::pmr::polymorphic_allocator
+		#define TINY_UTF8_HAS_PMR true
+	#endif
+#endif
+#if !defined(TINY_UTF8_HAS_PMR)
+	#define TINY_UTF8_HAS_PMR false
+#endif
+
+//! Want global declarations?
+#ifdef TINY_UTF8_GLOBAL_NAMESPACE
+inline
+#endif
+namespace tiny_utf8
+{
+	/**
+	 * Monotonic arena: Memory is handed out from consecutive blocks and only returned as a whole,
+	 * i.e. when the arena is released, reset or destructed. Useful for strings with a common lifetime (e.g. per request).
+	 *
+	 * @note	The arena is not thread-safe
+	 */
+	class arena
+	{
+		//! Header of every block (followed by its data)
+		struct block
+		{
+			block*		next;
+			std::size_t	size;
+		};
+
+		block*		t_blocks;			// Most recently allocated block first
+		char*		t_iter;				// Next free byte in the current block
+		char*		t_end;				// End of the current block
+		std::size_t	t_next_block_size;	// Size of the next block (grows geometrically)
+		std::size_t	t_bytes_used;		// Number of bytes handed out since the last release/reset
+
+		//! Allocates a new block capable of holding at least 'size' bytes at the given alignment
+		bool add_block( std::size_t size , std::size_t alignment ) noexcept(TINY_UTF8_NOEXCEPT) {
+			std::size_t block_size = std::max( t_next_block_size , size + alignment );
+			#if TINY_UTF8_NOEXCEPT
+				void* memory = ::operator new( sizeof(block) + block_size , std::nothrow );
+				if( !memory )
+					return false;
+			#else
+				void* memory = ::operator new( sizeof(block) + block_size );
+			#endif
+			t_blocks = new( memory ) block{ t_blocks , block_size };
+			t_iter = reinterpret_cast<char*>( t_blocks + 1 );
+			t_end = t_iter + block_size;
+			t_next_block_size = block_size * 2;
+			return true;
+		}
+
+	public:
+
+		/**
+		 * Constructor
+		 *
+		 * @param	initial_block_size	The size of the first block (allocated upon first use)
+		 */
+		explicit arena( std::size_t initial_block_size = 4096 ) noexcept :
+			t_blocks( nullptr )
+			, t_iter( nullptr )
+			, t_end( nullptr )
+			, t_next_block_size( initial_block_size ? initial_block_size : 1 )
+			, t_bytes_used( 0 )
+		{}
+		arena( const arena& ) = delete;
+		arena& operator=( const arena& ) = delete;
+
+		//! Destructor (releases all memory)
+		~arena() noexcept { release(); }
+
+
+		/**
+		 * Allocates memory from the arena
+		 *
+		 * @param	size		The number of bytes to allocate
+		 * @param	alignment	The alignment of the memory (must be a power of two)
+		 * @return	A pointer to the allocated memory (nullptr, if it could not be allocated and exceptions are disabled)
+		 */
+		void* allocate( std::size_t size , std::size_t alignment = alignof(std::max_align_t) ) noexcept(TINY_UTF8_NOEXCEPT) {
+			std::size_t padding = ( alignment - reinterpret_cast<std::uintptr_t>( t_iter ) ) & ( alignment - 1 );
+			if( !t_iter || std::size_t( t_end - t_iter ) < padding + size ){
+				if( !add_block( size , alignment ) )
+					return nullptr;
+				padding = ( alignment - reinterpret_cast<std::uintptr_t>( t_iter ) ) & ( alignment - 1 );
+			}
+			void* result = t_iter + padding;
+			t_iter += padding + size;
+			t_bytes_used += size;
+			return result;
+		}
+
+
+		/**
+		 * Makes all memory of the arena available again, keeping the most recent (i.e. largest) block
+		 *
+		 * @note	All memory handed out before is invalid afterwards
+		 */
+		void reset() noexcept {
+			if( !t_blocks )
+				return;
+			block* current = t_blocks;
+			t_blocks = current->next;
+			release();
+			current->next = nullptr;
+			t_blocks = current;
+			t_iter = reinterpret_cast<char*>( current + 1 );
+			t_end = t_iter + current->size;
+		}
+
+
+		/**
+		 * Returns all memory of the arena to the system
+		 *
+		 * @note	All memory handed out before is invalid afterwards
+		 */
+		void release() noexcept {
+			while( t_blocks ){
+				block* next = t_blocks->next;
+				::operator delete( t_blocks );
+				t_blocks = next;
+			}
+			t_iter = t_end = nullptr;
+			t_bytes_used = 0;
+		}
+
+
+		//! Returns the number of bytes handed out since the last release/reset
+		std::size_t bytes_used() const noexcept { return t_bytes_used; }
+
+		//! Returns the number of bytes allocated from the system (excluding bookkeeping)
+		std::size_t bytes_reserved() const noexcept {
+			std::size_t result = 0;
+			for( const block* iter = t_blocks ; iter ; iter = iter->next )
+				result += iter->size;
+			return result;
+		}
+
+		//! Returns the number of blocks allocated from the system
+		std::size_t num_blocks() const noexcept {
+			std::size_t result = 0;
+			for( const block* iter = t_blocks ; iter ; iter = iter->next )
+				++result;
+			return result;
+		}
+	};
+
+
+	/**
+	 * Allocator handing out memory of an arena. Deallocation is a no-op, the memory is returned when the arena is released.
+	 *
+	 * @note	A default-constructed arena_allocator is not bound to an arena and uses ::operator new/delete instead
+	 *			(much like a default-constructed std::pmr::polymorphic_allocator uses the default memory resource)
+	 */
+	template<typename T = char>
+	class arena_allocator
+	{
+		arena*	t_arena;
+
+	public:
+
+		using value_type = T;
+
+		template<typename U>
+		struct rebind
+		{
+			using other = arena_allocator<U>;
+		};
+
+		//! Constructors
+		arena_allocator() noexcept : t_arena( nullptr ) {}
+		arena_allocator( arena& a ) noexcept : t_arena( &a ) {}
+		template<typename U>
+		arena_allocator( const arena_allocator<U>& other ) noexcept : t_arena( other.get_arena() ) {}
+
+		//! Allocates 'n' objects of type T
+		T* allocate( std::size_t n ) noexcept(TINY_UTF8_NOEXCEPT) {
+			if( t_arena )
+				return static_cast<T*>( t_arena->allocate( n * sizeof(T) , alignof(T) ) );
+			#if TINY_UTF8_NOEXCEPT
+				return static_cast<T*>( ::operator new( n * sizeof(T) , std::nothrow ) );
+			#else
+				return static_cast<T*>( ::operator new( n * sizeof(T) ) );
+			#endif
+		}
+
+		//! Deallocates 'n' objects of type T (a no-op, if the allocator is bound to an arena)
+		void deallocate( T* ptr , std::size_t ) noexcept {
+			if( !t_arena )
+				::operator delete( ptr );
+		}
+
+		//! Returns the arena this allocator is bound to (or nullptr)
+		arena* get_arena() const noexcept { return t_arena; }
+	};
+
+	template<typename T, typename U>
+	inline bool operator==( const arena_allocator<T>& lhs , const arena_allocator<U>& rhs ) noexcept { return lhs.get_arena() == rhs.get_arena(); }
+	template<typename T, typename U>
+	inline bool operator!=( const arena_allocator<T>& lhs , const arena_allocator<U>& rhs ) noexcept { return lhs.get_arena() != rhs.get_arena(); }
+
+	//! Typedef of a string allocating from an arena
+	using arena_string = basic_string<char32_t, char, arena_allocator<char>>;
+
+	#if TINY_UTF8_HAS_PMR
+	//! Typedef of a string using a std::pmr::memory_resource (e.g. std::pmr::monotonic_buffer_resource)
+	using pmr_string = basic_string<char32_t, char, std::pmr::polymorphic_allocator<char>>;
+	#endif
+}
+
+#endif // _TINY_UTF8_ARENA_H_
@@ -0,0 +1,371 @@
+/**
+ * Copyright (c) 2015-2021 Jakob Riedle (DuffsDevice)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR 'AS IS' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _TINY_UTF8_GAP_STRING_H_
+#define _TINY_UTF8_GAP_STRING_H_
+
+// Includes
+#include <tinyutf8/tinyutf8.h> // for tiny_utf8::basic_string, TINY_UTF8_THROW
+#include <vector> // for std::vector
+#include <string> // for std::basic_string
+#include <cstring> // for std::memcpy, std::memmove
+#include <algorithm> // for std::lower_bound, std::max
+#include <iterator> // for std::bidirectional_iterator_tag
+
+//! Want global declarations?
+#ifdef TINY_UTF8_GLOBAL_NAMESPACE
+inline
+#endif
+namespace tiny_utf8
+{
+	/**
+	 * Gap buffer of utf8 data for edits that cluster around a cursor (e.g. in a text editor)
+	 * 
+	 * @note	The bytes are stored as [ <data before the gap> | <gap> | <data after the gap> ].
+	 *			Insertions and erasures at the gap take O(1) amortized, moving the gap takes O(distance).
+	 *			The lut is split around the gap: Multibytes before the gap are indexed from the start,
+	 *			multibytes after the gap from the end, so neither half has to be updated when the gap changes in size.
+	 *			Codepoint indices are resolved by binary search on the corresponding half of the lut.
+	 */
+	template<typename String>
+	class basic_gap_string
+	{
+	public:
+		
+		typedef String									string_type;
+		typedef typename String::value_type				value_type;
+		typedef typename String::data_type				data_type;
+		typedef typename String::size_type				size_type;
+		typedef typename String::width_type				width_type;
+		enum : size_type{								npos = (size_type)-1 };
+		enum : size_type{								min_gap_size = 64 }; // Number of bytes, the gap is at least enlarged to
+		
+		//! Bidirectional iterator over the codepoints of a basic_gap_string
+		class const_iterator
+		{
+			friend class basic_gap_string;
+			
+			const basic_gap_string*	t_instance;
+			size_type				t_index; // Logical byte index
+			
+			const_iterator( const basic_gap_string* instance , size_type index ) noexcept : t_instance( instance ) , t_index( index ) {}
+			
+		public:
+			
+			typedef std::bidirectional_iterator_tag		iterator_category;
+			typedef typename String::value_type			value_type;
+			typedef typename String::difference_type	difference_type;
+			typedef const value_type*					pointer;
+			typedef value_type							reference;
+			
+			const_iterator() noexcept : t_instance( nullptr ) , t_index( 0 ) {}
+			
+			value_type operator*() const noexcept { value_type cp; t_instance->decode( t_index , cp ); return cp; }
+			const_iterator& operator++() noexcept { value_type cp; t_index += t_instance->decode( t_index , cp ); return *this; }
+			const_iterator operator++( int ) noexcept { const_iterator tmp = *this; ++*this; return tmp; }
+			const_iterator& operator--() noexcept {
+				do
+					--t_index;
+				while( t_index && ( (unsigned char)t_instance->t_buffer[ t_instance->get_physical_index( t_index ) ] & 0xC0 ) == 0x80 );
+				return *this;
+			}
+			const_iterator operator--( int ) noexcept { const_iterator tmp = *this; --*this; return tmp; }
+			
+			//! Get the byte index of the codepoint the iterator points to
+			size_type get_raw_index() const noexcept { return t_index; }
+			
+			bool operator==( const const_iterator& other ) const noexcept { return t_index == other.t_index; }
+			bool operator!=( const const_iterator& other ) const noexcept { return t_index != other.t_index; }
+		};
+		typedef const_iterator							iterator;
+		
+	private:
+		
+		//! Entry of the lut (a multibyte): Indices are absolute before the gap and measured from the end after the gap
+		struct lut_entry
+		{
+			size_type	byte;
+			size_type	codepoint;
+		};
+		
+		std::vector<data_type>	t_buffer;
+		size_type				t_gap_begin; // Physical (and logical) index of the first byte of the gap
+		size_type				t_gap_end; // Physical index of the first byte after the gap
+		size_type				t_cps_before; // Number of codepoints before the gap
+		size_type				t_cps_after; // Number of codepoints after the gap
+		std::vector<lut_entry>	t_lut_before; // Multibytes before the gap (ascending, i.e. the one closest to the gap is at the back)
+		std::vector<lut_entry>	t_lut_after; // Multibytes after the gap (distance from the end, ascending, i.e. the one closest to the gap is at the back)
+		
+		static bool compare_codepoint( const lut_entry& entry , size_type codepoint ) noexcept { return entry.codepoint < codepoint; }
+		
+		size_type get_gap_size() const noexcept { return t_gap_end - t_gap_begin; }
+		size_type get_physical_index( size_type index ) const noexcept { return index < t_gap_begin ? index : index + get_gap_size(); }
+		
+		//! Decodes the codepoint at the logical byte index 'index' and returns its number of bytes
+		width_type decode( size_type index , value_type& cp ) const noexcept {
+			size_type physical = get_physical_index( index );
+			return String::decode_utf8_and_len(
+				t_buffer.data() + physical
+				, cp
+				, ( index < t_gap_begin ? t_gap_begin : t_buffer.size() ) - physical
+			);
+		}
+		
+		//! Returns the logical byte index of the codepoint at index 'pos' (pos <= length())
+		size_type get_byte_index( size_type pos ) const noexcept {
+			if( pos < t_cps_before ){
+				auto iter = std::lower_bound( t_lut_before.begin() , t_lut_before.end() , pos , &basic_gap_string::compare_codepoint );
+				if( iter != t_lut_before.end() && iter->codepoint == pos )
+					return iter->byte;
+				if( iter == t_lut_before.begin() )
+					return pos;
+				--iter;
+				return iter->byte + String::get_codepoint_bytes( t_buffer[iter->byte] , t_gap_begin - iter->byte ) + ( pos - iter->codepoint - 1 );
+			}
+			// Count from the end
+			size_type distance = length() - pos;
+			auto iter = std::lower_bound( t_lut_after.begin() , t_lut_after.end() , distance , &basic_gap_string::compare_codepoint );
+			if( iter != t_lut_after.end() && iter->codepoint == distance )
+				return size() - iter->byte;
+			if( iter == t_lut_after.begin() )
+				return size() - distance;
+			--iter;
+			return size() - iter->byte - ( distance - iter->codepoint );
+		}
+		
+		//! Makes sure, the gap can hold at least 'num_bytes' bytes
+		void reserve_gap( size_type num_bytes ) {
+			if( get_gap_size() >= num_bytes )
+				return;
+			size_type				bytes_after = t_buffer.size() - t_gap_end;
+			size_type				new_gap_size = std::max<size_type>( std::max<size_type>( num_bytes , min_gap_size ) , size() ); // Amortize growth
+			std::vector<data_type>	new_buffer( size() + new_gap_size );
+			if( !t_buffer.empty() ){
+				std::memcpy( new_buffer.data() , t_buffer.data() , t_gap_begin );
+				std::memcpy( new_buffer.data() + new_buffer.size() - bytes_after , t_buffer.data() + t_gap_end , bytes_after );
+			}
+			t_gap_end = new_buffer.size() - bytes_after;
+			t_buffer.swap( new_buffer );
+		}
+		
+	public:
+		
+		//! Constructs an empty gap string
+		basic_gap_string() noexcept :
+			t_gap_begin( 0 )
+			, t_gap_end( 0 )
+			, t_cps_before( 0 )
+			, t_cps_after( 0 )
+		{}
+		
+		//! Constructs a gap string holding the contents of the supplied basic_string (with the gap at the end)
+		basic_gap_string( const String& str ) :
+			basic_gap_string()
+		{ insert( 0 , str ); }
+		
+		
+		//! Returns the number of codepoints
+		size_type length() const noexcept { return t_cps_before + t_cps_after; }
+		
+		//! Returns the number of bytes
+		size_type size() const noexcept { return t_buffer.size() - get_gap_size(); }
+		
+		//! Checks, whether the gap string is empty
+		bool empty() const noexcept { return !size(); }
+		
+		//! Returns the codepoint index of the gap (i.e. the cursor)
+		size_type gap_position() const noexcept { return t_cps_before; }
+		
+		//! Returns the number of bytes that can be inserted at the gap without reallocation
+		size_type gap_size() const noexcept { return get_gap_size(); }
+		
+		
+		/**
+		 * Moves the gap to the supplied codepoint index
+		 * 
+		 * @note	This takes time linear in the number of bytes between the old and the new position
+		 * @param	pos		The codepoint index to move the gap to
+		 */
+		void move_gap( size_type pos ) noexcept(TINY_UTF8_NOEXCEPT) {
+			if( pos > length() ){
+				TINY_UTF8_THROW( "tiny_utf8::basic_gap_string::move_gap" , pos > length() );
+				return;
+			}
+			size_type	index = get_byte_index( pos );
+			size_type	data_len = size();
+			size_type	string_len = length();
+			if( index < t_gap_begin ){
+				size_type num_bytes = t_gap_begin - index;
+				std::memmove( t_buffer.data() + t_gap_end - num_bytes , t_buffer.data() + index , num_bytes );
+				t_gap_begin -= num_bytes;
+				t_gap_end -= num_bytes;
+				while( !t_lut_before.empty() && t_lut_before.back().byte >= index ){
+					t_lut_after.push_back( lut_entry{ data_len - t_lut_before.back().byte , string_len - t_lut_before.back().codepoint } );
+					t_lut_before.pop_back();
+				}
+			}
+			else if( index > t_gap_begin ){
+				size_type num_bytes = index - t_gap_begin;
+				std::memmove( t_buffer.data() + t_gap_begin , t_buffer.data() + t_gap_end , num_bytes );
+				t_gap_begin += num_bytes;
+				t_gap_end += num_bytes;
+				while( !t_lut_after.empty() && data_len - t_lut_after.back().byte < index ){
+					t_lut_before.push_back( lut_entry{ data_len - t_lut_after.back().byte , string_len - t_lut_after.back().codepoint } );
+					t_lut_after.pop_back();
+				}
+			}
+			t_cps_before = pos;
+			t_cps_after = string_len - pos;
+		}
+		
+		
+		/**
+		 * Inserts a basic_string resp. a codepoint at the supplied codepoint index (moving the gap there)
+		 * 
+		 * @param	pos		The codepoint index to insert at
+		 * @param	str		The basic_string to insert
+		 * @return	A reference to this gap string
+		 */
+		basic_gap_string& insert( size_type pos , const String& str ) {
+			if( pos > length() ){
+				TINY_UTF8_THROW( "tiny_utf8::basic_gap_string::insert" , pos > length() );
+				return *this;
+			}
+			size_type			data_len = str.size();
+			const data_type*	data = str.data();
+			if( !data_len )
+				return *this;
+			move_gap( pos );
+			reserve_gap( data_len );
+			std::memcpy( t_buffer.data() + t_gap_begin , data , data_len );
+			
+			// Index the multibytes of the inserted data
+			for( size_type index = 0 ; index < data_len ; ++t_cps_before ){
+				width_type bytes = String::get_codepoint_bytes( data[index] , data_len - index );
+				if( bytes > 1 )
+					t_lut_before.push_back( lut_entry{ t_gap_begin + index , t_cps_before } );
+				index += bytes;
+			}
+			t_gap_begin += data_len;
+			return *this;
+		}
+		basic_gap_string& insert( size_type pos , value_type cp ) {
+			if( pos > length() ){
+				TINY_UTF8_THROW( "tiny_utf8::basic_gap_string::insert" , pos > length() );
+				return *this;
+			}
+			move_gap( pos );
+			reserve_gap( 8 );
+			width_type bytes = String::encode_utf8( cp , t_buffer.data() + t_gap_begin );
+			if( bytes > 1 )
+				t_lut_before.push_back( lut_entry{ t_gap_begin , t_cps_before } );
+			t_gap_begin += bytes;
+			++t_cps_before;
+			return *this;
+		}
+		basic_gap_string& push_back( value_type cp ) { return insert( length() , cp ); }
+		basic_gap_string& append( const String& str ) { return insert( length() , str ); }
+		
+		
+		/**
+		 * Erases codepoints (moving the gap to 'pos')
+		 * 
+		 * @param	pos		The codepoint index of the first codepoint to erase
+		 * @param	len		The number of codepoints to erase (clamped to the end)
+		 * @return	A reference to this gap string
+		 */
+		basic_gap_string& erase( size_type pos , size_type len = 1 ) noexcept(TINY_UTF8_NOEXCEPT) {
+			if( pos > length() ){
+				TINY_UTF8_THROW( "tiny_utf8::basic_gap_string::erase" , pos > length() );
+				return *this;
+			}
+			if( len > length() - pos )
+				len = length() - pos;
+			if( !len )
+				return *this;
+			move_gap( pos );
+			size_type num_bytes = get_byte_index( pos + len ) - t_gap_begin;
+			t_gap_end += num_bytes;
+			t_cps_after -= len;
+			
+			// Remove the erased multibytes (which are the ones closest to the gap)
+			size_type bytes_after = t_buffer.size() - t_gap_end;
+			while( !t_lut_after.empty() && t_lut_after.back().byte > bytes_after )
+				t_lut_after.pop_back();
+			return *this;
+		}
+		
+		
+		//! Clears the gap string (keeping the buffer)
+		void clear() noexcept {
+			t_gap_begin = t_cps_before = t_cps_after = 0;
+			t_gap_end = t_buffer.size();
+			t_lut_before.clear();
+			t_lut_after.clear();
+		}
+		
+		
+		/**
+		 * Returns the codepoint at the supplied index
+		 * 
+		 * @param	pos		The codepoint index
+		 * @return	The codepoint at index 'pos'
+		 */
+		value_type at( size_type pos ) const noexcept(TINY_UTF8_NOEXCEPT) {
+			if( pos >= length() ){
+				TINY_UTF8_THROW( "tiny_utf8::basic_gap_string::at" , pos >= length() );
+				return 0;
+			}
+			value_type cp;
+			decode( get_byte_index( pos ) , cp );
+			return cp;
+		}
+		value_type operator[]( size_type pos ) const noexcept(TINY_UTF8_NOEXCEPT) { return at( pos ); }
+		
+		
+		//! Iterators
+		const_iterator begin() const noexcept { return const_iterator( this , 0 ); }
+		const_iterator end() const noexcept { return const_iterator( this , size() ); }
+		const_iterator cbegin() const noexcept { return begin(); }
+		const_iterator cend() const noexcept { return end(); }
+		
+		
+		//! Returns the contents as basic_string
+		String str() const {
+			std::basic_string<data_type> bytes;
+			bytes.reserve( size() );
+			bytes.append( t_buffer.data() , t_gap_begin );
+			bytes.append( t_buffer.data() + t_gap_end , t_buffer.size() - t_gap_end );
+			return String( std::move( bytes ) );
+		}
+	};
+	
+	//! Typedef of a gap string of tiny_utf8::string
+	using gap_string = basic_gap_string<string>;
+}
+
+#endif // _TINY_UTF8_GAP_STRING_H_
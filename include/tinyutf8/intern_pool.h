@@ -0,0 +1,231 @@
+/**
+ * Copyright (c) 2015-2021 Jakob Riedle (DuffsDevice)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR 'AS IS' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _TINY_UTF8_INTERN_POOL_H_
+#define _TINY_UTF8_INTERN_POOL_H_
+
+// Includes
+#include <tinyutf8/arena.h> // for tiny_utf8::arena, tiny_utf8::arena_string
+#include <mutex> // for std::mutex, std::lock_guard
+#include <unordered_map> // for std::unordered_map
+#include <memory> // for std::unique_ptr
+#include <cstring> // for std::memcmp
+#include <cstdint> // for std::uint64_t
+#include <new> // for placement new
+#include <functional> // for std::hash
+
+//! Want global declarations?
+#ifdef TINY_UTF8_GLOBAL_NAMESPACE
+inline
+#endif
+namespace tiny_utf8
+{
+	/**
+	 * Handle to a string interned by an intern_pool
+	 * 
+	 * @note	Handles of the same pool are equal, iff they refer to equal strings, which is determined by comparing pointers.
+	 *			The string is immutable and lives as long as the pool.
+	 */
+	class interned_string
+	{
+		friend class intern_pool;
+		
+		const arena_string*	t_str;
+		
+		explicit interned_string( const arena_string* str ) noexcept : t_str( str ) {}
+		
+	public:
+		
+		//! Constructs a null handle
+		interned_string() noexcept : t_str( nullptr ) {}
+		
+		//! Check, whether the handle refers to a string
+		explicit operator bool() const noexcept { return t_str != nullptr; }
+		
+		//! Access the interned string
+		const arena_string& str() const noexcept { return *t_str; }
+		const arena_string& operator*() const noexcept { return *t_str; }
+		const arena_string* operator->() const noexcept { return t_str; }
+		
+		//! Shortcuts to the most common accessors
+		const char* c_str() const noexcept { return t_str->c_str(); }
+		std::size_t size() const noexcept { return t_str->size(); }
+		std::size_t length() const noexcept { return t_str->length(); }
+		
+		//! Comparison by identity
+		bool operator==( const interned_string& other ) const noexcept { return t_str == other.t_str; }
+		bool operator!=( const interned_string& other ) const noexcept { return t_str != other.t_str; }
+		bool operator<( const interned_string& other ) const noexcept { return std::less<const arena_string*>()( t_str , other.t_str ); }
+	};
+	
+	
+	/**
+	 * Thread-safe pool that deduplicates utf8 strings into arenas and returns compact handles to them
+	 * 
+	 * @note	The pool is split into shards (selected by the hash of a string), each of which has its own lock, table and arena.
+	 *			Interned strings are never freed before the pool is destructed.
+	 */
+	class intern_pool
+	{
+		//! Key of the table of a shard (referring to the data of an interned string resp. the string being looked up)
+		struct key
+		{
+			const char*	data;
+			std::size_t	size;
+			std::size_t	hash;
+			
+			bool operator==( const key& other ) const noexcept {
+				return size == other.size && !std::memcmp( data , other.data , size );
+			}
+		};
+		struct key_hash
+		{
+			std::size_t operator()( const key& k ) const noexcept { return k.hash; }
+		};
+		
+		struct shard
+		{
+			std::mutex												mutex;
+			arena													memory;
+			std::unordered_map<key, const arena_string*, key_hash>	table;
+		};
+		
+		std::unique_ptr<shard[]>	t_shards;
+		std::size_t					t_shard_mask;
+		
+		//! 64-bit FNV-1a hash of the given bytes
+		static std::size_t hash_bytes( const char* data , std::size_t size ) noexcept {
+			std::uint64_t hash = 14695981039346656037ull;
+			while( size-- )
+				hash = ( hash ^ (unsigned char)*data++ ) * 1099511628211ull;
+			return std::size_t( hash ^ ( hash >> 32 ) );
+		}
+		
+		shard& get_shard( std::size_t hash ) const noexcept { return t_shards[ ( hash >> 7 ) & t_shard_mask ]; }
+		
+	public:
+		
+		/**
+		 * Constructor
+		 * 
+		 * @param	num_shards	The number of shards (rounded up to the next power of two). More shards reduce lock contention.
+		 */
+		explicit intern_pool( std::size_t num_shards = 16 ) :
+			t_shard_mask( 0 )
+		{
+			while( t_shard_mask + 1 < num_shards )
+				t_shard_mask = t_shard_mask * 2 + 1;
+			t_shards.reset( new shard[t_shard_mask + 1] );
+		}
+		intern_pool( const intern_pool& ) = delete;
+		intern_pool& operator=( const intern_pool& ) = delete;
+		
+		
+		/**
+		 * Returns the handle to the interned copy of the given utf8 data (interning it, if this is its first occurrence)
+		 * 
+		 * @param	data	The utf8 data to intern
+		 * @param	size	The number of bytes of 'data'
+		 */
+		interned_string intern( const char* data , std::size_t size ) {
+			std::size_t	hash = hash_bytes( data , size );
+			shard&		s = get_shard( hash );
+			std::lock_guard<std::mutex> lock( s.mutex );
+			
+			auto iter = s.table.find( key{ data , size , hash } );
+			if( iter != s.table.end() )
+				return interned_string( iter->second );
+			
+			// Create the string (and its buffer) inside the arena of the shard
+			void* memory = s.memory.allocate( sizeof(arena_string) , alignof(arena_string) );
+		#if TINY_UTF8_NOEXCEPT
+			if( !memory )
+				return interned_string();
+		#endif
+			arena_string* str = new( memory ) arena_string( arena_string::from_bytes( data , arena_string::size_type( size ) , arena_allocator<char>( s.memory ) ) );
+			s.table.emplace( key{ str->data() , size , hash } , str );
+			return interned_string( str );
+		}
+		template<typename V, typename A, std::size_t S, bool C>
+		interned_string intern( const basic_string<V, char, A, S, C>& str ) { return intern( str.data() , str.size() ); }
+		
+		
+		/**
+		 * Returns the handle to the interned copy of the given utf8 data or a null handle, if it has not been interned
+		 * 
+		 * @param	data	The utf8 data to look up
+		 * @param	size	The number of bytes of 'data'
+		 */
+		interned_string find( const char* data , std::size_t size ) const {
+			std::size_t	hash = hash_bytes( data , size );
+			shard&		s = get_shard( hash );
+			std::lock_guard<std::mutex> lock( s.mutex );
+			
+			auto iter = s.table.find( key{ data , size , hash } );
+			return interned_string( iter != s.table.end() ? iter->second : nullptr );
+		}
+		template<typename V, typename A, std::size_t S, bool C>
+		interned_string find( const basic_string<V, char, A, S, C>& str ) const { return find( str.data() , str.size() ); }
+		
+		
+		//! Returns the number of interned strings
+		std::size_t size() const {
+			std::size_t result = 0;
+			for( std::size_t i = 0 ; i <= t_shard_mask ; ++i ){
+				std::lock_guard<std::mutex> lock( t_shards[i].mutex );
+				result += t_shards[i].table.size();
+			}
+			return result;
+		}
+		
+		//! Returns the number of bytes the interned strings occupy in the arenas (excluding the tables)
+		std::size_t bytes_used() const {
+			std::size_t result = 0;
+			for( std::size_t i = 0 ; i <= t_shard_mask ; ++i ){
+				std::lock_guard<std::mutex> lock( t_shards[i].mutex );
+				result += t_shards[i].memory.bytes_used();
+			}
+			return result;
+		}
+		
+		//! Returns the number of shards
+		std::size_t num_shards() const noexcept { return t_shard_mask + 1; }
+	};
+}
+
+namespace std
+{
+	template<>
+	struct hash<tiny_utf8::interned_string>
+	{
+		std::size_t operator()( const tiny_utf8::interned_string& str ) const noexcept {
+			return std::hash<const tiny_utf8::arena_string*>()( str ? &str.str() : nullptr );
+		}
+	};
+}
+
+#endif // _TINY_UTF8_INTERN_POOL_H_
@@ -0,0 +1,459 @@
+/**
+ * Copyright (c) 2015-2021 Jakob Riedle (DuffsDevice)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR 'AS IS' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _TINY_UTF8_ROPE_H_
+#define _TINY_UTF8_ROPE_H_
+
+// Includes
+#include <tinyutf8/tinyutf8.h> // for tiny_utf8::basic_string, TINY_UTF8_THROW
+#include <memory> // for std::unique_ptr
+#include <utility> // for std::move, std::pair
+#include <vector> // for std::vector
+#include <ostream> // for std::ostream
+#include <string> // for std::basic_string
+
+//! Want global declarations?
+#ifdef TINY_UTF8_GLOBAL_NAMESPACE
+inline
+#endif
+namespace tiny_utf8
+{
+	/**
+	 * Balanced (AVL) rope of utf8 strings for large documents that are edited frequently
+	 * 
+	 * @note	The leaves are basic_strings of at most 'max_leaf_size' bytes (each with its own lut),
+	 *			the inner nodes store the number of bytes and codepoints of their subtree.
+	 *			Indexing, insertion and erasure by codepoint take O(log n), concatenation takes O(log n) as well.
+	 *			Edits that fit into the affected leaf are performed in place.
+	 */
+	template<typename String>
+	class basic_rope
+	{
+	public:
+		
+		typedef String									string_type;
+		typedef typename String::value_type				value_type;
+		typedef typename String::data_type				data_type;
+		typedef typename String::size_type				size_type;
+		enum : size_type{								npos = (size_type)-1 };
+		enum : size_type{								max_leaf_size = 1024 }; // The maximum number of bytes per leaf (except for leaves holding a single long codepoint)
+		
+	private:
+		
+		struct node;
+		typedef std::unique_ptr<node>	node_ptr;
+		
+		struct node
+		{
+			node_ptr		left; // Both children are nullptr for leaves
+			node_ptr		right;
+			String			leaf;
+			size_type		num_bytes;
+			size_type		num_codepoints;
+			unsigned int	height; // 1 for leaves
+			
+			explicit node( String str ) :
+				leaf( std::move( str ) )
+				, num_bytes( leaf.size() )
+				, num_codepoints( leaf.length() )
+				, height( 1 )
+			{}
+			node( node_ptr l , node_ptr r ) :
+				left( std::move( l ) )
+				, right( std::move( r ) )
+			{ update(); }
+			
+			bool is_leaf() const noexcept { return !left; }
+			
+			//! Recompute the metrics of an inner node from its children
+			void update() noexcept {
+				num_bytes = left->num_bytes + right->num_bytes;
+				num_codepoints = left->num_codepoints + right->num_codepoints;
+				height = 1 + ( left->height > right->height ? left->height : right->height );
+			}
+		};
+		
+		node_ptr	t_root;
+		
+		static unsigned int get_height( const node_ptr& n ) noexcept { return n ? n->height : 0; }
+		
+		static node_ptr rotate_left( node_ptr n ) {
+			node_ptr r = std::move( n->right );
+			n->right = std::move( r->left );
+			n->update();
+			r->left = std::move( n );
+			r->update();
+			return r;
+		}
+		static node_ptr rotate_right( node_ptr n ) {
+			node_ptr l = std::move( n->left );
+			n->left = std::move( l->right );
+			n->update();
+			l->right = std::move( n );
+			l->update();
+			return l;
+		}
+		
+		//! Restores the AVL property of an inner node, whose children differ in height by at most 2
+		static node_ptr rebalance( node_ptr n ) {
+			n->update();
+			if( n->left->height > n->right->height + 1 ){
+				if( get_height( n->left->left ) < get_height( n->left->right ) )
+					n->left = rotate_left( std::move( n->left ) );
+				return rotate_right( std::move( n ) );
+			}
+			if( n->right->height > n->left->height + 1 ){
+				if( get_height( n->right->right ) < get_height( n->right->left ) )
+					n->right = rotate_right( std::move( n->right ) );
+				return rotate_left( std::move( n ) );
+			}
+			return n;
+		}
+		
+		//! Concatenates two ropes in O(|height(l) - height(r)|), merging adjacent small leaves
+		static node_ptr join( node_ptr l , node_ptr r ) {
+			if( !l )
+				return r;
+			if( !r )
+				return l;
+			if( l->is_leaf() && r->is_leaf() && l->num_bytes + r->num_bytes <= max_leaf_size ){
+				l->leaf.append( r->leaf );
+				l->num_bytes += r->num_bytes;
+				l->num_codepoints += r->num_codepoints;
+				return l;
+			}
+			if( l->height > r->height + 1 ){
+				l->right = join( std::move( l->right ) , std::move( r ) );
+				return rebalance( std::move( l ) );
+			}
+			if( r->height > l->height + 1 ){
+				r->left = join( std::move( l ) , std::move( r->left ) );
+				return rebalance( std::move( r ) );
+			}
+			return node_ptr( new node( std::move( l ) , std::move( r ) ) );
+		}
+		
+		//! Splits a rope into the first 'pos' codepoints and the rest
+		static std::pair<node_ptr, node_ptr> split( node_ptr n , size_type pos ) {
+			if( !n || pos == 0 )
+				return { nullptr , std::move( n ) };
+			if( pos >= n->num_codepoints )
+				return { std::move( n ) , nullptr };
+			if( n->is_leaf() ){
+				node_ptr tail( new node( n->leaf.substr( pos ) ) );
+				n->num_bytes -= tail->num_bytes;
+				n->leaf.raw_erase( n->num_bytes , String::npos );
+				n->num_codepoints = pos;
+				return { std::move( n ) , std::move( tail ) };
+			}
+			size_type left_codepoints = n->left->num_codepoints;
+			if( pos < left_codepoints ){
+				std::pair<node_ptr, node_ptr> parts = split( std::move( n->left ) , pos );
+				return { std::move( parts.first ) , join( std::move( parts.second ) , std::move( n->right ) ) };
+			}
+			std::pair<node_ptr, node_ptr> parts = split( std::move( n->right ) , pos - left_codepoints );
+			return { join( std::move( n->left ) , std::move( parts.first ) ) , std::move( parts.second ) };
+		}
+		
+		//! Builds a balanced rope from the leaves [first,last)
+		static node_ptr build( node_ptr* first , node_ptr* last ) {
+			if( last - first == 1 )
+				return std::move( *first );
+			node_ptr* middle = first + ( last - first ) / 2;
+			node_ptr l = build( first , middle );
+			return node_ptr( new node( std::move( l ) , build( middle , last ) ) );
+		}
+		
+		//! Builds a balanced rope from a string (cut into leaves at codepoint boundaries)
+		static node_ptr build( const String& str ) {
+			size_type	data_len = str.size();
+			if( !data_len )
+				return nullptr;
+			if( data_len <= max_leaf_size )
+				return node_ptr( new node( str ) );
+			const data_type*		data = str.data();
+			std::vector<node_ptr>	leaves;
+			leaves.reserve( data_len / ( max_leaf_size / 2 ) + 1 );
+			for( size_type start = 0 , end ; start < data_len ; start = end ){
+				end = start + max_leaf_size / 2; // Leave room for edits
+				if( end >= data_len )
+					end = data_len;
+				else
+					while( end > start + 1 && ( (unsigned char)data[end] & 0xC0 ) == 0x80 ) // Don't cut inside of a codepoint
+						--end;
+				leaves.emplace_back( new node( str.raw_substr( start , end - start ) ) );
+			}
+			return build( leaves.data() , leaves.data() + leaves.size() );
+		}
+		
+		//! Tries to insert 'str' into the leaf containing 'pos' in place
+		static bool insert_into_leaf( node* n , size_type pos , const String& str , size_type str_len ) {
+			if( n->is_leaf() ){
+				if( n->num_bytes + str.size() > max_leaf_size )
+					return false;
+				n->leaf.insert( pos , str );
+			}
+			else if( pos <= n->left->num_codepoints ? !insert_into_leaf( n->left.get() , pos , str , str_len ) : !insert_into_leaf( n->right.get() , pos - n->left->num_codepoints , str , str_len ) )
+				return false;
+			n->num_bytes += str.size();
+			n->num_codepoints += str_len;
+			return true;
+		}
+		
+		//! Tries to erase [pos,pos+len) from the leaf containing it in place (without emptying the leaf)
+		static bool erase_from_leaf( node* n , size_type pos , size_type len , size_type& num_bytes ) {
+			if( n->is_leaf() ){
+				if( pos == 0 && len == n->num_codepoints )
+					return false;
+				size_type old_bytes = n->leaf.size();
+				n->leaf.erase( pos , len );
+				num_bytes = old_bytes - n->leaf.size();
+			}
+			else if( pos + len <= n->left->num_codepoints ){
+				if( !erase_from_leaf( n->left.get() , pos , len , num_bytes ) )
+					return false;
+			}
+			else if( pos < n->left->num_codepoints || !erase_from_leaf( n->right.get() , pos - n->left->num_codepoints , len , num_bytes ) )
+				return false;
+			n->num_bytes -= num_bytes;
+			n->num_codepoints -= len;
+			return true;
+		}
+		
+		static node_ptr clone( const node_ptr& n ) {
+			if( !n )
+				return nullptr;
+			if( n->is_leaf() )
+				return node_ptr( new node( n->leaf ) );
+			return node_ptr( new node( clone( n->left ) , clone( n->right ) ) );
+		}
+		
+		template<typename Func>
+		static void visit_leaves( const node* n , Func& func ) {
+			if( n->is_leaf() )
+				func( n->leaf );
+			else{
+				visit_leaves( n->left.get() , func );
+				visit_leaves( n->right.get() , func );
+			}
+		}
+		
+	public:
+		
+		//! Constructs an empty rope
+		basic_rope() noexcept = default;
+		
+		//! Constructs a rope holding the contents of the supplied basic_string
+		basic_rope( const String& str ) : t_root( build( str ) ) {}
+		
+		//! Copy/Move Constructors and Assignment
+		basic_rope( const basic_rope& other ) : t_root( clone( other.t_root ) ) {}
+		basic_rope( basic_rope&& other ) noexcept = default;
+		basic_rope& operator=( const basic_rope& other ) { if( this != &other ) t_root = clone( other.t_root ); return *this; }
+		basic_rope& operator=( basic_rope&& other ) noexcept = default;
+		
+		
+		//! Returns the number of codepoints in the rope
+		size_type length() const noexcept { return t_root ? t_root->num_codepoints : 0; }
+		
+		//! Returns the number of bytes in the rope
+		size_type size() const noexcept { return t_root ? t_root->num_bytes : 0; }
+		
+		//! Checks, whether the rope is empty
+		bool empty() const noexcept { return !t_root; }
+		
+		//! Returns the height of the tree (0 for an empty rope, 1 for a single leaf)
+		unsigned int height() const noexcept { return get_height( t_root ); }
+		
+		//! Clears the rope
+		void clear() noexcept { t_root.reset(); }
+		
+		
+		/**
+		 * Returns the codepoint at the supplied index
+		 * 
+		 * @param	pos		The codepoint index
+		 * @return	The codepoint at index 'pos'
+		 */
+		value_type at( size_type pos ) const noexcept(TINY_UTF8_NOEXCEPT) {
+			if( pos >= length() ){
+				TINY_UTF8_THROW( "tiny_utf8::basic_rope::at" , pos >= length() );
+				return 0;
+			}
+			const node* n = t_root.get();
+			while( !n->is_leaf() ){
+				if( pos < n->left->num_codepoints )
+					n = n->left.get();
+				else{
+					pos -= n->left->num_codepoints;
+					n = n->right.get();
+				}
+			}
+			return n->leaf[pos];
+		}
+		value_type operator[]( size_type pos ) const noexcept(TINY_UTF8_NOEXCEPT) { return at( pos ); }
+		
+		
+		/**
+		 * Inserts a basic_string at the supplied codepoint index
+		 * 
+		 * @param	pos		The codepoint index to insert at
+		 * @param	str		The basic_string to insert
+		 * @return	A reference to this rope
+		 */
+		basic_rope& insert( size_type pos , const String& str ) {
+			if( pos > length() ){
+				TINY_UTF8_THROW( "tiny_utf8::basic_rope::insert" , pos > length() );
+				return *this;
+			}
+			if( str.empty() )
+				return *this;
+			if( !t_root || !insert_into_leaf( t_root.get() , pos , str , str.length() ) ){
+				std::pair<node_ptr, node_ptr> parts = split( std::move( t_root ) , pos );
+				t_root = join( join( std::move( parts.first ) , build( str ) ) , std::move( parts.second ) );
+			}
+			return *this;
+		}
+		basic_rope& insert( size_type pos , value_type cp ) { return insert( pos , String( cp ) ); }
+		
+		
+		/**
+		 * Erases codepoints from the rope
+		 * 
+		 * @param	pos		The codepoint index of the first codepoint to erase
+		 * @param	len		The number of codepoints to erase (clamped to the end of the rope)
+		 * @return	A reference to this rope
+		 */
+		basic_rope& erase( size_type pos , size_type len = 1 ) {
+			size_type my_length = length();
+			if( pos > my_length ){
+				TINY_UTF8_THROW( "tiny_utf8::basic_rope::erase" , pos > my_length );
+				return *this;
+			}
+			if( len > my_length - pos )
+				len = my_length - pos;
+			if( !len )
+				return *this;
+			size_type num_bytes;
+			if( !erase_from_leaf( t_root.get() , pos , len , num_bytes ) ){
+				std::pair<node_ptr, node_ptr> head = split( std::move( t_root ) , pos );
+				std::pair<node_ptr, node_ptr> tail = split( std::move( head.second ) , len );
+				t_root = join( std::move( head.first ) , std::move( tail.second ) );
+			}
+			return *this;
+		}
+		
+		
+		//! Replaces 'len' codepoints starting at 'pos' with the supplied basic_string
+		basic_rope& replace( size_type pos , size_type len , const String& str ) {
+			if( pos > length() ){
+				TINY_UTF8_THROW( "tiny_utf8::basic_rope::replace" , pos > length() );
+				return *this;
+			}
+			return erase( pos , len ).insert( pos , str );
+		}
+		
+		
+		//! Appends a basic_string resp. a codepoint resp. another rope (the latter in O(log n))
+		basic_rope& append( const String& str ) { t_root = join( std::move( t_root ) , build( str ) ); return *this; }
+		basic_rope& append( basic_rope other ) { t_root = join( std::move( t_root ) , std::move( other.t_root ) ); return *this; }
+		basic_rope& push_back( value_type cp ) { return insert( length() , cp ); }
+		basic_rope& operator+=( const String& str ) { return append( str ); }
+		basic_rope& operator+=( basic_rope other ) { return append( std::move( other ) ); }
+		
+		
+		/**
+		 * Splits the rope at the supplied codepoint index in O(log n)
+		 * 
+		 * @param	pos		The codepoint index to split at
+		 * @return	A rope holding the codepoints starting at 'pos' (which are removed from this rope)
+		 */
+		basic_rope split( size_type pos ) {
+			basic_rope result;
+			std::pair<node_ptr, node_ptr> parts = split( std::move( t_root ) , pos );
+			t_root = std::move( parts.first );
+			result.t_root = std::move( parts.second );
+			return result;
+		}
+		
+		
+		//! Returns 'len' codepoints starting at 'pos' as basic_string
+		String substr( size_type pos , size_type len = npos ) const {
+			std::basic_string<data_type>	bytes;
+			size_type						my_length = length();
+			if( pos > my_length ){
+				TINY_UTF8_THROW( "tiny_utf8::basic_rope::substr" , pos > my_length );
+				return String();
+			}
+			if( len > my_length - pos )
+				len = my_length - pos;
+			for_each_leaf( [&bytes,&pos,&len]( const String& leaf ){
+				size_type leaf_length = leaf.length();
+				if( pos >= leaf_length ){
+					pos -= leaf_length;
+					return;
+				}
+				if( len ){
+					size_type count = leaf_length - pos < len ? leaf_length - pos : len;
+					size_type start = leaf.get_num_bytes_from_start( pos );
+					bytes.append( leaf.data() + start , leaf.get_num_bytes( start , count ) );
+					len -= count;
+					pos = 0;
+				}
+			} );
+			return String( std::move( bytes ) );
+		}
+		
+		//! Returns the contents of the rope as basic_string (concatenating the bytes of all leaves, before the lut is built once)
+		String str() const {
+			std::basic_string<data_type> bytes;
+			bytes.reserve( size() );
+			for_each_leaf( [&bytes]( const String& leaf ){ bytes.append( leaf.data() , leaf.size() ); } );
+			return String( std::move( bytes ) );
+		}
+		
+		
+		//! Calls 'func' with every leaf (i.e. basic_string) of the rope in order
+		template<typename Func>
+		void for_each_leaf( Func func ) const {
+			if( t_root )
+				basic_rope::visit_leaves( t_root.get() , func );
+		}
+		
+		
+		//! Write the rope to an output stream
+		friend std::ostream& operator<<( std::ostream& stream , const basic_rope& rope ) {
+			rope.for_each_leaf( [&stream]( const String& leaf ){ stream << leaf; } );
+			return stream;
+		}
+	};
+	
+	//! Typedef of a rope of tiny_utf8::string
+	using rope = basic_rope<string>;
+}
+
+#endif // _TINY_UTF8_ROPE_H_
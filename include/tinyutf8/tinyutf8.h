@@ -39,7 +39,14 @@
 #include <cstddef> // for std::size_t and offsetof
 #include <cstdint> // for std::uint8_t, std::uint16_t, std::uint32_t, std::uint_least16_t, std::uint_fast32_t
 #include <initializer_list> // for std::initializer_list
-#include <iosfwd> // for std::ostream and std::istream forward declarations
+#include <istream> // for std::istream
+#include <ostream> // for std::ostream
+#include <cstdio> // for std::FILE, std::fopen, std::fread
+#include <exception> // for std::exception_ptr, std::current_exception, std::rethrow_exception
+#include <atomic> // for std::atomic
+#include <cstdlib> // for std::getenv
+#include <new> // for placement new, std::nothrow
+#include <iterator> // for std::begin, std::end
 #ifdef _MSC_VER
 #include <intrin.h> // for _BitScanReverse, _BitScanReverse64
 #endif
@@ -85,6 +92,58 @@
 	#pragma warning(disable:4702) // Unreachable code after call to TINY_UTF8_THROW()
 	#pragma warning(disable:4703) // Maybe unitialized
 	#pragma warning(disable:26819) // Implicit Fallthrough
+	#pragma warning(disable:4996) // std::getenv is not deprecated
+#endif
+
+//! Determine, whether the parallel algorithms may start threads (#define TINY_UTF8_NO_THREADS to run them on the calling thread, which needs no thread library)
+#if !defined(TINY_UTF8_NO_THREADS)
+	#include <thread> // for std::thread
+	#define TINY_UTF8_HAS_THREADS true
+#else
+	#define TINY_UTF8_HAS_THREADS false
+#endif
+
+//! Determine, whether files can be read from POSIX file descriptors
+#if defined(__unix__) || defined(__APPLE__)
+	#include <cerrno> // for errno, EINTR
+	#include <sys/stat.h> // for fstat, S_ISREG
+	#include <unistd.h> // for read, lseek
+	#define TINY_UTF8_HAS_POSIX_IO true
+#else
+	#define TINY_UTF8_HAS_POSIX_IO false
+#endif
+
+//! Determine, whether kernels using x86 vector extensions can be selected at runtime (#define TINY_UTF8_NO_DISPATCH to disable them)
+#if !defined(TINY_UTF8_NO_DISPATCH) && ( defined(__x86_64__) || defined(_M_X64) ) && ( defined(__GNUC__) || defined(_MSC_VER) )
+	#include <immintrin.h> // for _mm_*, _mm256_*
+	#define TINY_UTF8_HAS_DISPATCH true
+	#if defined(__GNUC__)
+		#define TINY_UTF8_TARGET_AVX2 __attribute__((target("avx2")))
+	#else
+		#define TINY_UTF8_TARGET_AVX2
+	#endif
+#else
+	#define TINY_UTF8_HAS_DISPATCH false
+#endif
+
+//! Restrict utf8 to sequences of at most 4 bytes (as specified by RFC 3629), which allows branch-reduced encoding and decoding.
+//! Note: Codepoints above 0x1FFFFF cannot be represented in this mode, lead bytes 0xF8 to 0xFF are treated as 4-byte sequences.
+#if defined(TINY_UTF8_STRICT_4BYTE)
+	#undef TINY_UTF8_STRICT_4BYTE
+	#define TINY_UTF8_STRICT_4BYTE true
+#else
+	#define TINY_UTF8_STRICT_4BYTE false
+#endif
+
+//! Collect thread-local counters of hot-path behavior (allocations, lut builds, linear scans etc.), see tiny_utf8::get_stats().
+//! Without TINY_UTF8_STATS, the counting compiles to nothing.
+#if defined(TINY_UTF8_STATS)
+	#undef TINY_UTF8_STATS
+	#define TINY_UTF8_STATS true
+	#define TINY_UTF8_COUNT( COUNTER , AMOUNT ) void( tiny_utf8::tiny_utf8_detail::thread_stats().COUNTER += (AMOUNT) )
+#else
+	#define TINY_UTF8_STATS false
+	#define TINY_UTF8_COUNT( COUNTER , AMOUNT ) void()
 #endif
 
 //! Create macro that yields its arguments, if C++17 or later is present (used for "if constexpr")
@@ -116,12 +175,22 @@ namespace tiny_utf8
 		typename ValueType = char32_t
 		, typename DataType = char
 		, typename Allocator = std::allocator<DataType>
+		, std::size_t SSOCapacity = 0 // Number of bytes stored in-place (0 = as many as fit into the heap layout, i.e. 31 bytes on 64-bit)
+		, bool CopyOnWrite = false // Whether copies share their heap buffer (reference counted) until one of them is modified
 	>
 	class basic_string;
+	template<typename String>
+	class basic_stream_decoder;
+	template<typename String>
+	class basic_gap_string;
+	template<typename T>
+	class compact_allocator;
 	
 	//! Typedef of string (data type: char)
 	using string = basic_string<char32_t, char>;
 	using utf8_string = basic_string<char32_t, char>; // For backwards compatibility
+	using cow_string = basic_string<char32_t, char, std::allocator<char>, 0, true>; // Copies share their heap buffer until modified
+	using compact_string = basic_string<char32_t, char, compact_allocator<char>>; // 32-bit sizes: 24 bytes on 64-bit (23 of them in-place), at most 4 GiB
 	
 	//! Typedef of u8string (data type char8_t)
 	#if defined(__cpp_char8_t)
@@ -130,6 +199,286 @@ namespace tiny_utf8
 		using u8string = utf8_string;
 	#endif
 	
+	//! Typedef of stream_decoder (decodes into a tiny_utf8::string)
+	using stream_decoder = basic_stream_decoder<string>;
+	
+	/**
+	 * Tag type requesting multithreaded construction of a basic_string (see the respective constructor)
+	 * 
+	 * @note	If TINY_UTF8_NO_THREADS is defined, all work is done on the calling thread.
+	 * @param	num_threads			The maximum number of threads to use (0 = std::thread::hardware_concurrency())
+	 * @param	min_bytes_per_thread	The minimum number of bytes a thread has to process to be worth starting it
+	 */
+	struct parallel_t
+	{
+		unsigned int	num_threads;
+		std::size_t		min_bytes_per_thread;
+		
+		constexpr explicit parallel_t( unsigned int num_threads = 0 , std::size_t min_bytes_per_thread = 1 << 20 ) noexcept :
+			num_threads( num_threads )
+			, min_bytes_per_thread( min_bytes_per_thread )
+		{}
+		
+		//! Returns the number of tasks to split the processing of 'num_bytes' bytes into
+		unsigned int num_tasks( std::size_t num_bytes ) const noexcept {
+		#if TINY_UTF8_HAS_THREADS
+			std::size_t result = num_threads ? num_threads : std::thread::hardware_concurrency();
+		#else
+			std::size_t result = 1;
+		#endif
+			result = std::min<std::size_t>( result , num_bytes / ( min_bytes_per_thread ? min_bytes_per_thread : 1 ) );
+			return result ? (unsigned int)result : 1;
+		}
+	};
+	constexpr parallel_t parallel{};
+	
+	/**
+	 * Tag type requesting the validation of utf8 data according to RFC 3629 during construction
+	 * 
+	 * @param	valid	(Optional) Receives, whether the data was valid
+	 */
+	struct strict_t
+	{
+		bool*	valid;
+		
+		constexpr explicit strict_t( bool* valid = nullptr ) noexcept : valid( valid ) {}
+	};
+	constexpr strict_t strict{};
+	
+	/**
+	 * Tag type requesting the repair of utf8 data during construction: Every maximal subpart of an ill-formed
+	 * sequence (according to RFC 3629) is replaced by U+FFFD, as recommended by the Unicode Standard
+	 * 
+	 * @param	num_replacements	(Optional) Receives the number of inserted replacement characters
+	 */
+	struct repair_t
+	{
+		std::size_t*	num_replacements;
+		
+		constexpr explicit repair_t( std::size_t* num_replacements = nullptr ) noexcept : num_replacements( num_replacements ) {}
+	};
+	constexpr repair_t repair{};
+	
+	//! Tag types requesting the conversion of single-byte encoded data (ISO-8859-1 resp. Windows-1252) during construction
+	struct latin1_t { constexpr explicit latin1_t() noexcept {} };
+	constexpr latin1_t latin1{};
+	struct cp1252_t { constexpr explicit cp1252_t() noexcept {} };
+	constexpr cp1252_t cp1252{};
+	
+	/**
+	 * Allocator with a 32-bit size_type, which basic_string uses for all of its lengths and indices (see compact_string).
+	 * This shrinks the heap layout of a basic_string from a pointer and three 64-bit sizes to a pointer and three 32-bit sizes,
+	 * i.e. from 32 to 24 bytes on 64-bit platforms, and the SSO capacity proportionally from 31 to 23 bytes.
+	 * 
+	 * @note	Strings are limited to 4 GiB including the lut (see basic_string::max_size). Exceeding that throws (or fails, if TINY_UTF8_NOEXCEPT is defined). Memory is obtained from ::operator new.
+	 */
+	template<typename T>
+	class compact_allocator
+	{
+	public:
+		
+		using value_type = T;
+		using size_type = std::uint32_t;
+		using difference_type = std::int32_t;
+		
+		template<typename U>
+		struct rebind
+		{
+			using other = compact_allocator<U>;
+		};
+		
+		//! Constructors
+		compact_allocator() noexcept {}
+		template<typename U>
+		compact_allocator( const compact_allocator<U>& ) noexcept {}
+		
+		//! Allocates 'n' objects of type T
+		T* allocate( size_type n ) noexcept(TINY_UTF8_NOEXCEPT) {
+			#if TINY_UTF8_NOEXCEPT
+				return static_cast<T*>( ::operator new( std::size_t( n ) * sizeof(T) , std::nothrow ) );
+			#else
+				return static_cast<T*>( ::operator new( std::size_t( n ) * sizeof(T) ) );
+			#endif
+		}
+		
+		//! Deallocates 'n' objects of type T
+		void deallocate( T* ptr , size_type ) noexcept { ::operator delete( ptr ); }
+	};
+	
+	template<typename T, typename U>
+	inline bool operator==( const compact_allocator<T>& , const compact_allocator<U>& ) noexcept { return true; }
+	template<typename T, typename U>
+	inline bool operator!=( const compact_allocator<T>& , const compact_allocator<U>& ) noexcept { return false; }
+	
+	/**
+	 * Breakdown of the memory used by one basic_string (see basic_string::memory_usage) or, summed up, by many of them (see total_memory_usage)
+	 * 
+	 * @note	All sizes are in bytes. heap_bytes = data_bytes + terminator_bytes + lut_bytes + indicator_bytes + ref_count_bytes + unused_bytes,
+	 *			if the data is stored on the heap. Otherwise, heap_bytes is 0 and the data lives within the object itself
+	 */
+	struct memory_usage_info
+	{
+		std::size_t	num_strings		= 0;	// Number of basic_strings accounted for
+		std::size_t	num_heap_strings	= 0;	// ...of which store their data on the heap
+		std::size_t	num_luts		= 0;	// ...of which have an active lut
+		std::size_t	num_compressed_luts	= 0;	// ...of which is compressed (only luts of large strings are)
+		std::size_t	object_bytes	= 0;	// sizeof() the basic_string objects themselves
+		std::size_t	heap_bytes		= 0;	// Bytes requested from the allocator
+		std::size_t	data_bytes		= 0;	// UTF-8 payload (i.e. size())
+		std::size_t	terminator_bytes	= 0;	// Trailing '\0' of heap buffers
+		std::size_t	lut_entries		= 0;	// Number of multibyte indices in the lut
+		std::size_t	lut_bytes		= 0;	// lut_entries times the respective lut width (less, if compressed)
+		std::size_t	indicator_bytes	= 0;	// Lut indicators trailing heap buffers
+		std::size_t	ref_count_bytes	= 0;	// Reference counts preceding heap buffers (only present, if copy-on-write is enabled)
+		std::size_t	unused_bytes	= 0;	// Slack: Heap bytes reserved for future growth
+		
+		//! Adds the memory usage of 'other' to this one
+		memory_usage_info& operator+=( const memory_usage_info& other ) noexcept {
+			num_strings += other.num_strings;
+			num_heap_strings += other.num_heap_strings;
+			num_luts += other.num_luts;
+			num_compressed_luts += other.num_compressed_luts;
+			object_bytes += other.object_bytes;
+			heap_bytes += other.heap_bytes;
+			data_bytes += other.data_bytes;
+			terminator_bytes += other.terminator_bytes;
+			lut_entries += other.lut_entries;
+			lut_bytes += other.lut_bytes;
+			indicator_bytes += other.indicator_bytes;
+			ref_count_bytes += other.ref_count_bytes;
+			unused_bytes += other.unused_bytes;
+			return *this;
+		}
+		friend memory_usage_info operator+( memory_usage_info lhs , const memory_usage_info& rhs ) noexcept { return lhs += rhs; }
+	};
+	
+	/**
+	 * Sums up the memory usage of a range of basic_strings
+	 * 
+	 * @param	first	Iterator to the first basic_string
+	 * @param	last	Iterator past the last basic_string
+	 * @return	The accumulated memory usage
+	 */
+	template<typename InputIt>
+	memory_usage_info total_memory_usage( InputIt first , InputIt last ) noexcept {
+		memory_usage_info result;
+		for( ; first != last ; ++first )
+			result += first->memory_usage();
+		return result;
+	}
+	//! Sums up the memory usage of all basic_strings within a container (e.g. std::vector<tiny_utf8::string>)
+	template<typename Container>
+	memory_usage_info total_memory_usage( const Container& container ) noexcept {
+		return total_memory_usage( std::begin( container ) , std::end( container ) );
+	}
+	
+	/**
+	 * Counters of hot-path behavior, collected per thread if TINY_UTF8_STATS is defined (see get_stats)
+	 * 
+	 * @note	Linear scans are the O(n) fallbacks of get_num_codepoints, get_num_bytes and get_num_bytes_from_start,
+	 *			taken for strings without an active lut
+	 */
+	struct stats
+	{
+		std::uint64_t	allocations			= 0;	// Heap buffers allocated
+		std::uint64_t	deallocations		= 0;	// Heap buffers returned to the allocator
+		std::uint64_t	bytes_allocated		= 0;	// Total size of all allocated heap buffers
+		std::uint64_t	lut_builds			= 0;	// Luts built by scanning utf8 data
+		std::uint64_t	lut_rebuilds		= 0;	// Luts copied into a reallocated buffer
+		std::uint64_t	lut_width_changes	= 0;	// ...of which had to be widened or narrowed index by index
+		std::uint64_t	lut_compressions	= 0;	// Luts stored compressed (built from scratch or compressed by shrink_to_fit)
+		std::uint64_t	lut_decompressions	= 0;	// Compressed luts expanded again before a modification
+		std::uint64_t	sso_to_heap			= 0;	// Small strings that outgrew the sso buffer
+		std::uint64_t	linear_scans		= 0;	// Codepoint/byte index conversions without a lut
+		std::uint64_t	bytes_scanned		= 0;	// Bytes traversed by these linear scans
+		
+		//! Calls 'visitor( name , value )' for every counter (e.g. to export them to a metrics system)
+		template<typename Visitor>
+		void visit( Visitor&& visitor ) const {
+			visitor( "allocations" , allocations );
+			visitor( "deallocations" , deallocations );
+			visitor( "bytes_allocated" , bytes_allocated );
+			visitor( "lut_builds" , lut_builds );
+			visitor( "lut_rebuilds" , lut_rebuilds );
+			visitor( "lut_width_changes" , lut_width_changes );
+			visitor( "lut_compressions" , lut_compressions );
+			visitor( "lut_decompressions" , lut_decompressions );
+			visitor( "sso_to_heap" , sso_to_heap );
+			visitor( "linear_scans" , linear_scans );
+			visitor( "bytes_scanned" , bytes_scanned );
+		}
+	};
+	
+	//! Returns a snapshot of the counters of the calling thread (all zero, if TINY_UTF8_STATS is not defined)
+	inline stats get_stats() noexcept ;
+	
+	//! Resets the counters of the calling thread and returns their values before
+	inline stats reset_stats() noexcept ;
+	
+	/**
+	 * Instruction set levels of the kernels used for counting, searching, validation and transcoding
+	 * 
+	 * @note	The level is determined once at runtime (using cpuid), lowered to the value of the environment variable
+	 *			TINY_UTF8_SIMD_LEVEL ("scalar", "sse2" or "avx2") resp. the macro TINY_UTF8_FORCE_SIMD_LEVEL (0, 1 or 2), if present.
+	 */
+	enum class simd_level : unsigned char
+	{
+		scalar = 0
+		, sse2 = 1
+		, avx2 = 2
+	};
+	
+	//! Returns the level of the kernels currently in use
+	inline simd_level get_simd_level() noexcept ;
+	
+	//! Returns the highest level supported by the executing cpu (and the build)
+	inline simd_level get_max_simd_level() noexcept ;
+	
+	/**
+	 * Selects the kernels of the given level (e.g. for benchmarking)
+	 * 
+	 * @note	Levels above the supported one are lowered to get_max_simd_level()
+	 * @return	The level now in use
+	 */
+	inline simd_level set_simd_level( simd_level level ) noexcept ;
+	
+	/**
+	 * Reads a whole UTF-8 file (resp. the rest of it) into a basic_string
+	 * 
+	 * @note	The size of the file is determined upfront, so that its contents can be read directly into the final buffer,
+	 *			which also has room for the LUT. The LUT is then built in a single pass over the data. A leading UTF-8 BOM is stripped.
+	 *			If the size cannot be determined (e.g. for pipes), the file is read chunk by chunk.
+	 * @param	path	The path of the file to read
+	 * @param	file	An open file to read from (which is not closed afterwards)
+	 * @param	fd		An open POSIX file descriptor to read from (which is not closed afterwards)
+	 * @param	success	(Optional) Pointer to a bool, that receives whether the file could be read
+	 * @return	The contents of the file (empty, if the file could not be read)
+	 */
+	template<typename String = string>
+	String load_file( const char* path , bool* success = nullptr ) noexcept(TINY_UTF8_NOEXCEPT) ;
+	template<typename String = string>
+	String load_file( std::FILE* file , bool* success = nullptr ) noexcept(TINY_UTF8_NOEXCEPT) ;
+	#if TINY_UTF8_HAS_POSIX_IO
+	template<typename String = string>
+	String load_file( int fd , bool* success = nullptr ) noexcept(TINY_UTF8_NOEXCEPT) ;
+	#endif
+	
+	/**
+	 * Converts a range of records (e.g. std::u32string, std::string or tiny_utf8::string) into basic_strings using multiple threads
+	 * 
+	 * @note	The sizes of all records are summed up front to split the range into tasks of about the same number of code units.
+	 *			Records of type std::basic_string<value_type> are decoded as codepoints, all others (that provide data() and size())
+	 *			as UTF-8 bytes. Each task constructs its strings in place, so short records never touch the heap.
+	 *			Longer records get one allocation each through 'alloc'. An exception thrown by a task is rethrown on the calling thread.
+	 * @param	first	Random access iterator to the first record
+	 * @param	last	Random access iterator after the last record
+	 * @param	out		Random access iterator to the first of (last - first) strings to assign the results to
+	 * @param	par		(Optional) The parallelization settings
+	 * @param	alloc	(Optional) The allocator instance used for all strings (must be usable from multiple threads)
+	 */
+	template<typename String = string, typename RandomIt, typename OutputIt>
+	void make_strings( RandomIt first , RandomIt last , OutputIt out , parallel_t par = parallel_t() , const typename String::allocator_type& alloc = typename String::allocator_type() ) noexcept(TINY_UTF8_NOEXCEPT) ;
+	
 	//! Implementation Detail
 	namespace tiny_utf8_detail
 	{
@@ -137,6 +486,14 @@ namespace tiny_utf8
 		struct read_codepoints_tag{};
 		struct read_bytes_tag{};
 		
+		#if TINY_UTF8_STATS
+		//! Get the counters of the calling thread
+		inline stats& thread_stats() noexcept {
+			static thread_local stats counters;
+			return counters;
+		}
+		#endif
+		
 		//! Count leading zeros utility
 		#if defined(__GNUC__)
 			#define TINY_UTF8_HAS_CLZ true
@@ -200,6 +557,1472 @@ namespace tiny_utf8
 		template<typename T>
 		inline std::size_t strlen( const T* str ){ std::size_t len = 0u; while( *str++ ) ++len; return len; }
 		template<> inline std::size_t strlen<char>( const char* str ){ return std::strlen( str ); }
+		
+		//! Version of the binary format written by basic_string::serialize
+		enum : unsigned char{ serialization_version = 1 };
+		
+		//! Writes an unsigned integer as LEB128 varint and returns the end of the written bytes
+		template<typename T>
+		inline unsigned char* write_varint( unsigned char* dest , T value ) noexcept {
+			for( ; value >= 0x80 ; value >>= 7 )
+				*dest++ = (unsigned char)( value | 0x80 );
+			*dest++ = (unsigned char)value;
+			return dest;
+		}
+		
+		//! Reads an LEB128 varint from a stream buffer (recording the read bytes in 'record'). Returns false on a premature end or overflow
+		template<typename T>
+		inline bool read_varint( std::streambuf* buf , T& value , unsigned char*& record ) noexcept {
+			value = 0;
+			for( unsigned int shift = 0 ; shift < sizeof(T) * 8 ; shift += 7 ){
+				std::streambuf::int_type ch = buf->sbumpc();
+				if( std::streambuf::traits_type::eq_int_type( ch , std::streambuf::traits_type::eof() ) )
+					return false;
+				*record++ = (unsigned char)ch;
+				value |= T( ch & 0x7F ) << shift;
+				if( !( ch & 0x80 ) )
+					return true;
+			}
+			return false;
+		}
+		
+		//! Returns the number of bytes >= 0x80 within 'word'
+		inline unsigned int count_high_bytes( std::uint64_t word ) noexcept {
+			return unsigned( ( ( ( word >> 7 ) & 0x0101010101010101ull ) * 0x0101010101010101ull ) >> 56 );
+		}
+		
+		//! Maps a byte of Windows-1252 to its codepoint (the five undefined bytes are mapped to the respective C1 controls, like browsers do)
+		inline char32_t cp1252_to_codepoint( unsigned char ch ) noexcept {
+			static const char16_t table[32] = {
+				0x20AC , 0x0081 , 0x201A , 0x0192 , 0x201E , 0x2026 , 0x2020 , 0x2021 , 0x02C6 , 0x2030 , 0x0160 , 0x2039 , 0x0152 , 0x008D , 0x017D , 0x008F
+				, 0x0090 , 0x2018 , 0x2019 , 0x201C , 0x201D , 0x2022 , 0x2013 , 0x2014 , 0x02DC , 0x2122 , 0x0161 , 0x203A , 0x0153 , 0x009D , 0x017E , 0x0178
+			};
+			return ch >= 0x80 && ch < 0xA0 ? table[ch - 0x80] : ch;
+		}
+		
+		//! Maps a codepoint to its byte in Windows-1252 or returns -1, if there is none
+		inline int codepoint_to_cp1252( char32_t cp ) noexcept {
+			if( cp < 0x80 || ( cp >= 0xA0 && cp < 0x100 ) )
+				return int( cp );
+			for( unsigned int ch = 0x80 ; ch < 0xA0 ; ++ch )
+				if( cp1252_to_codepoint( (unsigned char)ch ) == cp )
+					return int( ch );
+			return -1;
+		}
+		
+		/**
+		 * Checks the utf8 sequence at 'data' according to RFC 3629 (i.e. Table 3-7 of the Unicode Standard)
+		 * 
+		 * @param	data_left		The number of bytes available at 'data' (must be at least 1)
+		 * @param	invalid_len		Receives the length of the maximal subpart of an ill-formed sequence (i.e. the bytes
+		 *							that are replaced by a single U+FFFD according to Unicode's recommended practice)
+		 * @return	The length of the sequence, if it is well-formed, 0 otherwise
+		 */
+		inline unsigned int check_utf8( const unsigned char* data , std::size_t data_left , unsigned int& invalid_len ) noexcept {
+			unsigned char	lead = data[0];
+			unsigned char	lower = 0x80;	// Bounds of the second byte
+			unsigned char	upper = 0xBF;
+			unsigned int	len;
+			invalid_len = 1;
+			if( lead < 0x80 )
+				return 1;
+			else if( lead < 0xC2 ) // Continuation bytes and overlong 2-byte forms
+				return 0;
+			else if( lead < 0xE0 )
+				len = 2;
+			else if( lead < 0xF0 ){
+				len = 3;
+				if( lead == 0xE0 ) lower = 0xA0; // Overlong
+				else if( lead == 0xED ) upper = 0x9F; // Surrogates
+			}
+			else if( lead < 0xF5 ){
+				len = 4;
+				if( lead == 0xF0 ) lower = 0x90; // Overlong
+				else if( lead == 0xF4 ) upper = 0x8F; // Above U+10FFFF
+			}
+			else
+				return 0;
+			if( data_left < 2 || data[1] < lower || data[1] > upper )
+				return 0;
+			for( invalid_len = 2 ; invalid_len < len ; ++invalid_len )
+				if( invalid_len >= data_left || ( data[invalid_len] & 0xC0 ) != 0x80 )
+					return 0;
+			return len;
+		}
+		
+		//! Returns the first non-ascii byte in [iter,end) or end (ascii runs are skipped a word at a time)
+		inline const unsigned char* skip_ascii_scalar( const unsigned char* iter , const unsigned char* end ) noexcept {
+			constexpr std::size_t mask = std::size_t( 0x8080808080808080ull );
+			std::size_t word;
+			while( std::size_t( end - iter ) >= sizeof(std::size_t) ){
+				std::memcpy( &word , iter , sizeof(std::size_t) );
+				if( word & mask )
+					break;
+				iter += sizeof(std::size_t);
+			}
+			while( iter < end && *iter < 0x80 )
+				++iter;
+			return iter;
+		}
+		
+		//! Returns the first p in [begin,end-1) with p[0] == first and p[1] == second or nullptr
+		inline const unsigned char* find_pair_scalar( const unsigned char* begin , const unsigned char* end , unsigned char first , unsigned char second ) noexcept {
+			while( end - begin >= 2 ){
+				begin = static_cast<const unsigned char*>( std::memchr( begin , first , end - begin - 1 ) );
+				if( !begin )
+					return nullptr;
+				if( begin[1] == second )
+					return begin;
+				++begin;
+			}
+			return nullptr;
+		}
+		
+		//! Widens the ascii bytes at the start of [src,src+len) to 'dest' and returns their number
+		template<typename T>
+		inline std::size_t widen_ascii_scalar( const unsigned char* src , std::size_t len , T* dest ) noexcept {
+			std::size_t i = 0;
+			for( std::uint64_t word ; len - i >= 8 ; i += 8 ){
+				std::memcpy( &word , src + i , 8 );
+				if( word & 0x8080808080808080ull )
+					break;
+				for( int j = 0 ; j < 8 ; ++j )
+					dest[i + j] = src[i + j];
+			}
+			for( ; i < len && src[i] < 0x80 ; ++i )
+				dest[i] = src[i];
+			return i;
+		}
+		
+		/**
+		 * Skips well-formed utf8 starting at 'iter' (which must start a sequence)
+		 * 
+		 * @param	num_codepoints	Incremented by the number of codepoints skipped
+		 * @param	num_multibytes	Incremented by the number of multibyte codepoints skipped
+		 * @return	A sequence boundary in [iter,end], behind which the data is well-formed. Vector kernels may stop
+		 *			in front of the block containing the first ill-formed sequence, the scalar kernel stops right at it.
+		 */
+		inline const unsigned char* skip_valid_scalar( const unsigned char* iter , const unsigned char* end , std::size_t& num_codepoints , std::size_t& num_multibytes ) noexcept {
+			unsigned int invalid_len;
+			while( true ){
+				const unsigned char* ascii_end = skip_ascii_scalar( iter , end );
+				num_codepoints += ascii_end - iter;
+				if( ( iter = ascii_end ) == end )
+					return end;
+				unsigned int bytes = check_utf8( iter , end - iter , invalid_len );
+				if( !bytes )
+					return iter;
+				iter += bytes;
+				++num_codepoints;
+				++num_multibytes;
+			}
+		}
+		
+		/**
+		 * Counts the utf8 bytes and multibytes of the codepoints (or utf16 code units) at the start of [src,src+len) and returns their number.
+		 * The scalar kernel only counts blocks of 8 ascii codepoints, the vector kernels count all codepoints up to U+1FFFFF
+		 * (or all code units, that are no surrogates).
+		 */
+		template<typename T>
+		inline std::size_t count_ascii_scalar( const T* src , std::size_t len , std::size_t& num_bytes , std::size_t& ) noexcept {
+			std::size_t i = 0;
+			while( len - i >= 8 && ( src[i] | src[i+1] | src[i+2] | src[i+3] | src[i+4] | src[i+5] | src[i+6] | src[i+7] ) < 0x80 )
+				i += 8;
+			num_bytes += i;
+			return i;
+		}
+		
+		/**
+		 * Encodes the codepoints (or utf16 code units) at the start of [src,src+len) to utf8 at 'dest' and returns their number ('dest_len'
+		 * receives the number of bytes written). The scalar kernel only narrows blocks of 8 ascii codepoints, the vector kernels narrow all
+		 * codepoints up to U+FFFF (or code units, that are no surrogates). These may write garbage behind 'dest + dest_len', as long as it
+		 * is within the utf8 of [src,src+len).
+		 */
+		template<typename T>
+		inline std::size_t narrow_ascii_scalar( const T* src , std::size_t len , unsigned char* dest , std::size_t& dest_len ) noexcept {
+			std::size_t i = 0;
+			for( ; len - i >= 8 && ( src[i] | src[i+1] | src[i+2] | src[i+3] | src[i+4] | src[i+5] | src[i+6] | src[i+7] ) < 0x80 ; i += 8 )
+				for( int j = 0 ; j < 8 ; ++j )
+					dest[i + j] = (unsigned char)src[i + j];
+			dest_len = i;
+			return i;
+		}
+		
+		//! Counts the utf16 code units of the utf8 at 'iter', that the kernel handles (see widen_bmp_scalar)
+		inline const unsigned char* count_bmp_scalar( const unsigned char* iter , const unsigned char* end , std::size_t& num_units ) noexcept {
+			const unsigned char* ascii_end = skip_ascii_scalar( iter , end );
+			num_units = ascii_end - iter;
+			return ascii_end;
+		}
+		
+		/**
+		 * Decodes the utf8 at 'iter' (which must start a sequence) to utf16 at 'dest'. The scalar kernel only widens ascii, the vector kernels
+		 * also decode structurally sound 2- and 3-byte sequences (i.e. followed by the right number of continuation bytes) by their bits, like
+		 * basic_string::decode_utf8 does, without checking for overlong forms or surrogates.
+		 * 
+		 * @param	num_units	Receives the number of code units written. The vector kernels may write garbage behind them,
+		 *						as long as it is within the utf16 of [iter,end).
+		 * @return	The sequence boundary in [iter,end], at which the decoding stopped
+		 */
+		inline const unsigned char* widen_bmp_scalar( const unsigned char* iter , const unsigned char* end , char16_t* dest , std::size_t& num_units ) noexcept {
+			num_units = widen_ascii_scalar( iter , end - iter , dest );
+			return iter + num_units;
+		}
+		
+		/**
+		 * Expands the latin1 at the start of [src,src+len) to utf8 at 'dest' and returns the number of bytes expanded ('dest_len' receives the
+		 * number of bytes written). The scalar kernel only copies ascii, the vector kernels expand all bytes. These may write garbage behind
+		 * 'dest + dest_len', as long as it is within the utf8 of [src,src+len).
+		 */
+		inline std::size_t expand_latin1_scalar( const unsigned char* src , std::size_t len , unsigned char* dest , std::size_t& dest_len ) noexcept {
+			dest_len = skip_ascii_scalar( src , src + len ) - src;
+			std::memcpy( dest , src , dest_len );
+			return dest_len;
+		}
+		
+		#if TINY_UTF8_HAS_DISPATCH
+		//! Count trailing zeros of a non-zero value
+		inline unsigned int ctz( unsigned int value ) noexcept {
+			#if defined(__GNUC__)
+				return (unsigned int)__builtin_ctz( value );
+			#else
+				unsigned long index;
+				_BitScanForward( &index , value );
+				return (unsigned int)index;
+			#endif
+		}
+		
+		//! Number of set bits (without relying on the popcnt instruction, which is not part of SSE2)
+		inline unsigned int popcount( unsigned int value ) noexcept {
+			value -= value >> 1 & 0x55555555u;
+			value = ( value & 0x33333333u ) + ( value >> 2 & 0x33333333u );
+			return ( ( value + ( value >> 4 ) ) & 0x0F0F0F0Fu ) * 0x01010101u >> 24;
+		}
+		
+		//! Sums the bytes of 'counters'
+		inline std::size_t sum_bytes_sse2( __m128i counters ) noexcept {
+			__m128i sums = _mm_sad_epu8( counters , _mm_setzero_si128() );
+			return (std::size_t)_mm_cvtsi128_si32( sums ) + (std::size_t)_mm_cvtsi128_si32( _mm_srli_si128( sums , 8 ) );
+		}
+		
+		//! Applies the byte counters of continuation and lead bytes (that the validation kernels keep for up to 255 blocks) and resets them
+		inline void flush_counters_sse2( __m128i& num_conts , __m128i& num_leads , std::size_t& num_codepoints , std::size_t& num_multibytes ) noexcept {
+			num_codepoints -= sum_bytes_sse2( num_conts );
+			num_multibytes += sum_bytes_sse2( num_leads );
+			num_conts = num_leads = _mm_setzero_si128();
+		}
+		
+		/**
+		 * Moves 'iter' (the end of a run of blocks, that a vector kernel found valid) back to the start
+		 * of a sequence, that might continue behind it, and uncounts that sequence
+		 */
+		inline const unsigned char* rewind_to_lead( const unsigned char* begin , const unsigned char* iter , std::size_t& num_codepoints , std::size_t& num_multibytes ) noexcept {
+			for( int i = 1 ; i <= 3 && iter - i >= begin && iter[-i] >= 0x80 ; ++i )
+				if( iter[-i] >= 0xC0 ){
+					--num_codepoints;
+					--num_multibytes;
+					return iter - i;
+				}
+			return iter;
+		}
+		
+		inline const unsigned char* skip_ascii_sse2( const unsigned char* iter , const unsigned char* end ) noexcept {
+			for( ; end - iter >= 16 ; iter += 16 )
+				if( unsigned int mask = (unsigned int)_mm_movemask_epi8( _mm_loadu_si128( reinterpret_cast<const __m128i*>( iter ) ) ) )
+					return iter + ctz( mask );
+			return skip_ascii_scalar( iter , end );
+		}
+		
+		inline const unsigned char* find_pair_sse2( const unsigned char* begin , const unsigned char* end , unsigned char first , unsigned char second ) noexcept {
+			const __m128i first_v = _mm_set1_epi8( (char)first );
+			const __m128i second_v = _mm_set1_epi8( (char)second );
+			for( ; end - begin >= 17 ; begin += 16 ){
+				__m128i match = _mm_and_si128(
+					_mm_cmpeq_epi8( _mm_loadu_si128( reinterpret_cast<const __m128i*>( begin ) ) , first_v )
+					, _mm_cmpeq_epi8( _mm_loadu_si128( reinterpret_cast<const __m128i*>( begin + 1 ) ) , second_v )
+				);
+				if( unsigned int mask = (unsigned int)_mm_movemask_epi8( match ) )
+					return begin + ctz( mask );
+			}
+			return find_pair_scalar( begin , end , first , second );
+		}
+		
+		inline std::size_t widen_ascii_sse2( const unsigned char* src , std::size_t len , char32_t* dest ) noexcept {
+			const __m128i zero = _mm_setzero_si128();
+			std::size_t i = 0;
+			for( ; len - i >= 16 ; i += 16 ){
+				__m128i bytes = _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + i ) );
+				if( _mm_movemask_epi8( bytes ) )
+					break;
+				__m128i lo = _mm_unpacklo_epi8( bytes , zero );
+				__m128i hi = _mm_unpackhi_epi8( bytes , zero );
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( dest + i ) , _mm_unpacklo_epi16( lo , zero ) );
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( dest + i + 4 ) , _mm_unpackhi_epi16( lo , zero ) );
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( dest + i + 8 ) , _mm_unpacklo_epi16( hi , zero ) );
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( dest + i + 12 ) , _mm_unpackhi_epi16( hi , zero ) );
+			}
+			return i + widen_ascii_scalar( src + i , len - i , dest + i );
+		}
+		
+		//! SSE2 has no byte shuffle, hence the rules of RFC 3629 are checked with range comparisons of each byte and its 3 predecessors
+		inline const unsigned char* skip_valid_sse2( const unsigned char* iter , const unsigned char* end , std::size_t& num_codepoints , std::size_t& num_multibytes ) noexcept {
+			const unsigned char*	begin = iter;
+			__m128i					prev = _mm_setzero_si128();
+			unsigned int			prev_mask = 0;
+			__m128i					num_conts = _mm_setzero_si128();
+			__m128i					num_leads = _mm_setzero_si128();
+			unsigned int			num_pending = 0;
+			auto ge = []( __m128i value , unsigned char bound ){ // Unsigned value >= bound
+				return _mm_cmpeq_epi8( _mm_max_epu8( value , _mm_set1_epi8( (char)bound ) ) , value );
+			};
+			auto eq = []( __m128i value , unsigned char byte ){ return _mm_cmpeq_epi8( value , _mm_set1_epi8( (char)byte ) ); };
+			for( ; end - iter >= 16 ; iter += 16 ){
+				__m128i			cur = _mm_loadu_si128( reinterpret_cast<const __m128i*>( iter ) );
+				unsigned int	mask = (unsigned int)_mm_movemask_epi8( cur );
+				if( !( mask | prev_mask ) ){ // Ascii, that does not end a sequence
+					num_codepoints += 16;
+					prev = cur;
+					continue;
+				}
+				__m128i prev1 = _mm_or_si128( _mm_slli_si128( cur , 1 ) , _mm_srli_si128( prev , 15 ) );
+				__m128i prev2 = _mm_or_si128( _mm_slli_si128( cur , 2 ) , _mm_srli_si128( prev , 14 ) );
+				__m128i prev3 = _mm_or_si128( _mm_slli_si128( cur , 3 ) , _mm_srli_si128( prev , 13 ) );
+				__m128i is_cont = _mm_cmplt_epi8( cur , _mm_set1_epi8( (char)0xC0 ) ); // Signed: 0x80 to 0xBF
+				__m128i must_cont = _mm_or_si128( _mm_or_si128( ge( prev1 , 0xC0 ) , ge( prev2 , 0xE0 ) ) , ge( prev3 , 0xF0 ) );
+				__m128i error = _mm_xor_si128( is_cont , must_cont );
+				error = _mm_or_si128( error , _mm_or_si128( _mm_or_si128( eq( cur , 0xC0 ) , eq( cur , 0xC1 ) ) , ge( cur , 0xF5 ) ) );
+				error = _mm_or_si128( error , _mm_andnot_si128( ge( cur , 0xA0 ) , eq( prev1 , 0xE0 ) ) );	// Overlong
+				error = _mm_or_si128( error , _mm_and_si128( ge( cur , 0xA0 ) , eq( prev1 , 0xED ) ) );		// Surrogates
+				error = _mm_or_si128( error , _mm_andnot_si128( ge( cur , 0x90 ) , eq( prev1 , 0xF0 ) ) );	// Overlong
+				error = _mm_or_si128( error , _mm_and_si128( ge( cur , 0x90 ) , eq( prev1 , 0xF4 ) ) );		// Above U+10FFFF
+				if( _mm_movemask_epi8( error ) )
+					break;
+				num_codepoints += 16;
+				num_conts = _mm_sub_epi8( num_conts , is_cont );
+				num_leads = _mm_sub_epi8( num_leads , _mm_andnot_si128( is_cont , _mm_cmplt_epi8( cur , _mm_setzero_si128() ) ) );
+				if( ++num_pending % 255 == 0 )
+					flush_counters_sse2( num_conts , num_leads , num_codepoints , num_multibytes );
+				prev = cur;
+				prev_mask = mask;
+			}
+			flush_counters_sse2( num_conts , num_leads , num_codepoints , num_multibytes );
+			return rewind_to_lead( begin , iter , num_codepoints , num_multibytes );
+		}
+		
+		//! Sums the 32-bit lanes of 'counters'
+		inline std::size_t sum_epi32_sse2( __m128i counters ) noexcept {
+			std::uint32_t lanes[4];
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( lanes ) , counters );
+			return std::size_t( lanes[0] ) + lanes[1] + lanes[2] + lanes[3];
+		}
+		
+		//! Checks, whether none of the codepoints in 'cps' has a bit of 'mask' set
+		inline bool none_of_sse2( __m128i cps , int mask ) noexcept {
+			return _mm_movemask_epi8( _mm_cmpeq_epi32( _mm_and_si128( cps , _mm_set1_epi32( mask ) ) , _mm_setzero_si128() ) ) == 0xFFFF;
+		}
+		
+		inline std::size_t count_utf32_sse2( const char32_t* src , std::size_t len , std::size_t& num_bytes , std::size_t& num_multibytes ) noexcept {
+			__m128i			num_extra = _mm_setzero_si128(); // Lane counters of the bytes beyond the first one
+			__m128i			num_multi = _mm_setzero_si128();
+			std::size_t		i = 0;
+			unsigned int	num_pending = 0;
+			for( ; len - i >= 4 ; i += 4 ){
+				__m128i cps = _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + i ) );
+				if( !none_of_sse2( cps , int( 0xFFE00000 ) ) ) // Above U+1FFFFF
+					break;
+				__m128i multi = _mm_cmpgt_epi32( cps , _mm_set1_epi32( 0x7F ) );
+				num_multi = _mm_sub_epi32( num_multi , multi );
+				num_extra = _mm_sub_epi32( num_extra , _mm_add_epi32( _mm_add_epi32( multi
+					, _mm_cmpgt_epi32( cps , _mm_set1_epi32( 0x7FF ) ) )
+					, _mm_cmpgt_epi32( cps , _mm_set1_epi32( 0xFFFF ) ) )
+				);
+				if( ++num_pending % ( 1u << 28 ) == 0 ){ // Keep the lanes from overflowing
+					num_bytes += sum_epi32_sse2( num_extra );
+					num_multibytes += sum_epi32_sse2( num_multi );
+					num_extra = num_multi = _mm_setzero_si128();
+				}
+			}
+			num_bytes += i + sum_epi32_sse2( num_extra );
+			num_multibytes += sum_epi32_sse2( num_multi );
+			return i + count_ascii_scalar( src + i , len - i , num_bytes , num_multibytes );
+		}
+		
+		//! Narrows 16 codepoints to 'dest', if they are ascii
+		inline bool narrow_ascii_sse2( const char32_t* src , unsigned char* dest ) noexcept {
+			__m128i a = _mm_loadu_si128( reinterpret_cast<const __m128i*>( src ) );
+			__m128i b = _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + 4 ) );
+			__m128i c = _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + 8 ) );
+			__m128i d = _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + 12 ) );
+			if( !none_of_sse2( _mm_or_si128( _mm_or_si128( a , b ) , _mm_or_si128( c , d ) ) , ~0x7F ) )
+				return false;
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( dest ) , _mm_packus_epi16( _mm_packs_epi32( a , b ) , _mm_packs_epi32( c , d ) ) );
+			return true;
+		}
+		
+		/**
+		 * Encodes each of the codepoints (up to U+FFFF) in 'cps' to utf8 in the low bytes of its lane
+		 * 
+		 * @param	is_multi	Lanes with codepoints above U+7F
+		 * @param	is_3byte	Lanes with codepoints above U+7FF
+		 */
+		inline __m128i encode_utf8_sse2( __m128i cps , __m128i is_multi , __m128i is_3byte ) noexcept {
+			const __m128i	low6 = _mm_set1_epi32( 0x3F );
+			__m128i			last = _mm_or_si128( _mm_and_si128( cps , low6 ) , _mm_set1_epi32( 0x80 ) );
+			__m128i			middle = _mm_or_si128( _mm_and_si128( _mm_srli_epi32( cps , 6 ) , low6 ) , _mm_set1_epi32( 0x80 ) );
+			__m128i			two = _mm_or_si128( _mm_or_si128( _mm_srli_epi32( cps , 6 ) , _mm_set1_epi32( 0xC0 ) ) , _mm_slli_epi32( last , 8 ) );
+			__m128i			three = _mm_or_si128(
+				_mm_or_si128( _mm_srli_epi32( cps , 12 ) , _mm_set1_epi32( 0xE0 ) )
+				, _mm_or_si128( _mm_slli_epi32( middle , 8 ) , _mm_slli_epi32( last , 16 ) )
+			);
+			__m128i			multi = _mm_or_si128( _mm_andnot_si128( is_3byte , two ) , _mm_and_si128( is_3byte , three ) );
+			return _mm_or_si128( _mm_andnot_si128( is_multi , cps ) , _mm_and_si128( is_multi , multi ) );
+		}
+		
+		/**
+		 * Stores the utf8 of the 4 codepoints (up to U+FFFF) in 'cps' to 'dest' and returns its length. SSE2 has no byte
+		 * shuffle, hence each codepoint is stored with an overlapping 4-byte store (overhanging by up to 3 bytes).
+		 */
+		inline std::size_t store_utf8_sse2( __m128i cps , __m128i is_multi , unsigned char* dest ) noexcept {
+			__m128i			is_3byte = _mm_cmpgt_epi32( cps , _mm_set1_epi32( 0x7FF ) );
+			__m128i			words = encode_utf8_sse2( cps , is_multi , is_3byte );
+			unsigned int	multi_mask = (unsigned int)_mm_movemask_ps( _mm_castsi128_ps( is_multi ) );
+			unsigned int	three_mask = (unsigned int)_mm_movemask_ps( _mm_castsi128_ps( is_3byte ) );
+			std::size_t		n = 0;
+			for( int j = 0 ; j < 4 ; ++j , words = _mm_srli_si128( words , 4 ) ){
+				std::uint32_t word = (std::uint32_t)_mm_cvtsi128_si32( words );
+				std::memcpy( dest + n , &word , 4 );
+				n += 1 + ( multi_mask >> j & 1 ) + ( three_mask >> j & 1 );
+			}
+			return n;
+		}
+		
+		inline std::size_t narrow_utf32_sse2( const char32_t* src , std::size_t len , unsigned char* dest , std::size_t& dest_len ) noexcept {
+			std::size_t i = 0 , n = 0;
+			while( len - i >= 16 ) // The last store of a block overhangs by up to 3 bytes, which are within the utf8 of the 12 codepoints ahead
+			{
+				__m128i cps = _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + i ) );
+				if( !none_of_sse2( cps , int( 0xFFFF0000 ) ) ) // Above U+FFFF
+					break;
+				__m128i is_multi = _mm_cmpgt_epi32( cps , _mm_set1_epi32( 0x7F ) );
+				if( !_mm_movemask_epi8( is_multi ) && narrow_ascii_sse2( src + i , dest + n ) ){
+					i += 16;
+					n += 16;
+					continue;
+				}
+				n += store_utf8_sse2( cps , is_multi , dest + n );
+				i += 4;
+			}
+			i += narrow_ascii_scalar( src + i , len - i , dest + n , dest_len );
+			dest_len += n;
+			return i;
+		}
+		
+		//! Checks, whether the 8 utf16 code units in 'units' contain a surrogate
+		inline bool has_surrogate_sse2( __m128i units ) noexcept {
+			return _mm_movemask_epi8( _mm_cmpeq_epi16( _mm_and_si128( units , _mm_set1_epi16( (short)0xF800 ) ) , _mm_set1_epi16( (short)0xD800 ) ) ) != 0;
+		}
+		
+		//! Checks, whether the 8 utf16 code units in 'units' are ascii
+		inline bool is_ascii_epi16_sse2( __m128i units ) noexcept {
+			return _mm_movemask_epi8( _mm_cmpeq_epi16( _mm_and_si128( units , _mm_set1_epi16( (short)0xFF80 ) ) , _mm_setzero_si128() ) ) == 0xFFFF;
+		}
+		
+		//! Sums the 16-bit lanes of 'counters' (each below 0x8000)
+		inline std::size_t sum_epi16_sse2( __m128i counters ) noexcept {
+			return sum_epi32_sse2( _mm_madd_epi16( counters , _mm_set1_epi16( 1 ) ) );
+		}
+		
+		//! Counts blocks of 8 code units without surrogates: Those below U+80 take 1 byte, those below U+800 take 2 and all others 3
+		inline std::size_t count_utf16_sse2( const char16_t* src , std::size_t len , std::size_t& num_bytes , std::size_t& num_multibytes ) noexcept {
+			__m128i			num_ascii = _mm_setzero_si128(); // Lane counters of the code units below U+80 and U+800
+			__m128i			num_small = _mm_setzero_si128();
+			std::size_t		ascii = 0 , small = 0 , i = 0;
+			unsigned int	num_pending = 0;
+			for( ; len - i >= 8 ; i += 8 ){
+				__m128i units = _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + i ) );
+				if( has_surrogate_sse2( units ) )
+					break;
+				num_ascii = _mm_sub_epi16( num_ascii , _mm_cmpeq_epi16( _mm_and_si128( units , _mm_set1_epi16( (short)0xFF80 ) ) , _mm_setzero_si128() ) );
+				num_small = _mm_sub_epi16( num_small , _mm_cmpeq_epi16( _mm_and_si128( units , _mm_set1_epi16( (short)0xF800 ) ) , _mm_setzero_si128() ) );
+				if( ++num_pending % 0x7FFF == 0 ){ // Keep the lanes from overflowing
+					ascii += sum_epi16_sse2( num_ascii );
+					small += sum_epi16_sse2( num_small );
+					num_ascii = num_small = _mm_setzero_si128();
+				}
+			}
+			ascii += sum_epi16_sse2( num_ascii );
+			small += sum_epi16_sse2( num_small );
+			num_bytes += 3 * i - ascii - small;
+			num_multibytes += i - ascii;
+			return i + count_ascii_scalar( src + i , len - i , num_bytes , num_multibytes );
+		}
+		
+		//! Narrows blocks of 8 code units without surrogates, zero-extended to codepoints (see narrow_utf32_sse2)
+		inline std::size_t narrow_utf16_sse2( const char16_t* src , std::size_t len , unsigned char* dest , std::size_t& dest_len ) noexcept {
+			const __m128i	zero = _mm_setzero_si128();
+			std::size_t		i = 0 , n = 0;
+			for( ; len - i >= 16 ; i += 8 ){ // The last store of a block overhangs by up to 3 bytes, which are within the utf8 of the 8 code units ahead
+				__m128i units = _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + i ) );
+				if( has_surrogate_sse2( units ) )
+					break;
+				if( is_ascii_epi16_sse2( units ) ){
+					_mm_storel_epi64( reinterpret_cast<__m128i*>( dest + n ) , _mm_packus_epi16( units , units ) );
+					n += 8;
+					continue;
+				}
+				__m128i lower = _mm_unpacklo_epi16( units , zero );
+				__m128i upper = _mm_unpackhi_epi16( units , zero );
+				n += store_utf8_sse2( lower , _mm_cmpgt_epi32( lower , _mm_set1_epi32( 0x7F ) ) , dest + n );
+				n += store_utf8_sse2( upper , _mm_cmpgt_epi32( upper , _mm_set1_epi32( 0x7F ) ) , dest + n );
+			}
+			i += narrow_ascii_scalar( src + i , len - i , dest + n , dest_len );
+			dest_len += n;
+			return i;
+		}
+		
+		//! Unsigned 'value' >= 'bound' for each byte
+		inline __m128i ge_epu8_sse2( __m128i value , unsigned char bound ) noexcept {
+			return _mm_cmpeq_epi8( _mm_max_epu8( value , _mm_set1_epi8( (char)bound ) ) , value );
+		}
+		
+		/**
+		 * Checks, that the 16 bytes in 'cur' (following those in 'prev') consist of ascii and 2- and 3-byte sequences, each
+		 * followed by the right number of continuation bytes. Returns the mask of the bytes that are not.
+		 */
+		inline unsigned int check_bmp_sse2( __m128i cur , __m128i prev , __m128i& is_cont ) noexcept {
+			__m128i prev1 = _mm_or_si128( _mm_slli_si128( cur , 1 ) , _mm_srli_si128( prev , 15 ) );
+			__m128i prev2 = _mm_or_si128( _mm_slli_si128( cur , 2 ) , _mm_srli_si128( prev , 14 ) );
+			__m128i must_cont = _mm_or_si128( ge_epu8_sse2( prev1 , 0xC0 ) , ge_epu8_sse2( prev2 , 0xE0 ) );
+			is_cont = _mm_cmplt_epi8( cur , _mm_set1_epi8( (char)0xC0 ) ); // Signed: 0x80 to 0xBF
+			return (unsigned int)_mm_movemask_epi8( _mm_or_si128( _mm_xor_si128( is_cont , must_cont ) , ge_epu8_sse2( cur , 0xF0 ) ) );
+		}
+		
+		inline const unsigned char* count_bmp_sse2( const unsigned char* iter , const unsigned char* end , std::size_t& num_units ) noexcept {
+			const unsigned char*	begin = iter;
+			__m128i					prev = _mm_setzero_si128();
+			unsigned int			prev_mask = 0;
+			__m128i					num_conts = _mm_setzero_si128();
+			unsigned int			num_pending = 0;
+			std::size_t				n = 0 , unused = 0;
+			for( ; end - iter >= 16 ; iter += 16 ){
+				__m128i			cur = _mm_loadu_si128( reinterpret_cast<const __m128i*>( iter ) );
+				unsigned int	mask = (unsigned int)_mm_movemask_epi8( cur );
+				if( !( mask | prev_mask ) ){ // Ascii, that does not end a sequence
+					n += 16;
+					prev = cur;
+					continue;
+				}
+				__m128i is_cont;
+				if( unsigned int errors = check_bmp_sse2( cur , prev , is_cont ) ){ // Count the code units in front of the first error
+					unsigned int len = ctz( errors );
+					n += len - popcount( (unsigned int)_mm_movemask_epi8( is_cont ) & ( ( 1u << len ) - 1 ) );
+					iter += len;
+					break;
+				}
+				n += 16;
+				num_conts = _mm_sub_epi8( num_conts , is_cont );
+				if( ++num_pending % 255 == 0 ){
+					n -= sum_bytes_sse2( num_conts );
+					num_conts = _mm_setzero_si128();
+				}
+				prev = cur;
+				prev_mask = mask;
+			}
+			n -= sum_bytes_sse2( num_conts );
+			iter = rewind_to_lead( begin , iter , n , unused );
+			num_units = n;
+			return iter;
+		}
+		
+		//! Decodes the utf8 sequences (of up to 3 bytes), that would start at each of the 8 bytes at 'src', to 16-bit lanes
+		inline __m128i decode_bmp_sse2( const unsigned char* src ) noexcept {
+			const __m128i	zero = _mm_setzero_si128();
+			const __m128i	low6 = _mm_set1_epi16( 0x3F );
+			__m128i			byte0 = _mm_unpacklo_epi8( _mm_loadl_epi64( reinterpret_cast<const __m128i*>( src ) ) , zero );
+			__m128i			byte1 = _mm_and_si128( _mm_unpacklo_epi8( _mm_loadl_epi64( reinterpret_cast<const __m128i*>( src + 1 ) ) , zero ) , low6 );
+			__m128i			byte2 = _mm_and_si128( _mm_unpacklo_epi8( _mm_loadl_epi64( reinterpret_cast<const __m128i*>( src + 2 ) ) , zero ) , low6 );
+			__m128i			two = _mm_or_si128( _mm_slli_epi16( _mm_and_si128( byte0 , _mm_set1_epi16( 0x1F ) ) , 6 ) , byte1 );
+			__m128i			three = _mm_or_si128( _mm_or_si128( _mm_slli_epi16( byte0 , 12 ) , _mm_slli_epi16( byte1 , 6 ) ) , byte2 );
+			__m128i			is_multi = _mm_cmpgt_epi16( byte0 , _mm_set1_epi16( 0xBF ) );
+			__m128i			is_3byte = _mm_cmpgt_epi16( byte0 , _mm_set1_epi16( 0xDF ) );
+			__m128i			multi = _mm_or_si128( _mm_andnot_si128( is_3byte , two ) , _mm_and_si128( is_3byte , three ) );
+			return _mm_or_si128( _mm_andnot_si128( is_multi , byte0 ) , _mm_and_si128( is_multi , multi ) );
+		}
+		
+		//! Stores the lanes of 'units' selected by 'keep' to 'dest' (overhanging by a code unit) and returns their number
+		inline std::size_t compact_units_sse2( __m128i units , unsigned int keep , char16_t* dest ) noexcept {
+			char16_t	lanes[8];
+			std::size_t	n = 0;
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( lanes ) , units );
+			for( int j = 0 ; j < 8 ; ++j ){
+				dest[n] = lanes[j];
+				n += keep >> j & 1;
+			}
+			return n;
+		}
+		
+		//! SSE2 has no byte shuffle, hence the decoded lanes are compacted by conditionally advancing stores
+		inline const unsigned char* widen_bmp_sse2( const unsigned char* iter , const unsigned char* end , char16_t* dest , std::size_t& num_units ) noexcept {
+			const unsigned char*	begin = iter;
+			const __m128i			zero = _mm_setzero_si128();
+			__m128i					prev = zero;
+			unsigned int			prev_mask = 0;
+			std::size_t				n = 0 , unused = 0;
+			for( ; end - iter >= 80 ; iter += 16 ){ // Decoding reads 2 bytes ahead and the stores overhang, but stay within the utf16 of the 64 bytes ahead
+				__m128i			cur = _mm_loadu_si128( reinterpret_cast<const __m128i*>( iter ) );
+				unsigned int	mask = (unsigned int)_mm_movemask_epi8( cur );
+				if( !( mask | prev_mask ) ){ // Ascii, that does not end a sequence
+					_mm_storeu_si128( reinterpret_cast<__m128i*>( dest + n ) , _mm_unpacklo_epi8( cur , zero ) );
+					_mm_storeu_si128( reinterpret_cast<__m128i*>( dest + n + 8 ) , _mm_unpackhi_epi8( cur , zero ) );
+					n += 16;
+					prev = cur;
+					continue;
+				}
+				__m128i			is_cont;
+				unsigned int	errors = check_bmp_sse2( cur , prev , is_cont );
+				unsigned int	len = errors ? ctz( errors ) : 16; // Decode the sequences in front of the first error
+				unsigned int	keep = ~(unsigned int)_mm_movemask_epi8( is_cont ) & ( ( 1u << len ) - 1 );
+				n += compact_units_sse2( decode_bmp_sse2( iter ) , keep & 0xFF , dest + n );
+				n += compact_units_sse2( decode_bmp_sse2( iter + 8 ) , keep >> 8 , dest + n );
+				if( errors ){
+					iter += len;
+					break;
+				}
+				prev = cur;
+				prev_mask = mask;
+			}
+			iter = rewind_to_lead( begin , iter , n , unused ); // The last lead was decoded with bytes, that were not checked
+			num_units = n;
+			return iter;
+		}
+		
+		//! Computes the first byte of the utf8 of each byte of latin1 in 'bytes' ('conts' receives the second byte of the high ones)
+		inline __m128i latin1_leads_sse2( __m128i bytes , __m128i& conts ) noexcept {
+			__m128i is_high = _mm_cmplt_epi8( bytes , _mm_setzero_si128() );
+			__m128i leads = _mm_or_si128( _mm_and_si128( _mm_srli_epi16( bytes , 6 ) , _mm_set1_epi8( 1 ) ) , _mm_set1_epi8( (char)0xC2 ) );
+			conts = _mm_and_si128( bytes , _mm_set1_epi8( (char)0xBF ) );
+			return _mm_or_si128( _mm_andnot_si128( is_high , bytes ) , _mm_and_si128( is_high , leads ) );
+		}
+		
+		//! SSE2 has no byte shuffle, hence blocks mixing ascii and high bytes are expanded one byte (or one high byte, if there are few) at a time
+		inline std::size_t expand_latin1_sse2( const unsigned char* src , std::size_t len , unsigned char* dest , std::size_t& dest_len ) noexcept {
+			std::size_t i = 0 , n = 0;
+			for( ; len - i >= 32 ; i += 16 ){ // The stores of a block overhang by up to 16 bytes, which are within the utf8 of the 16 bytes ahead
+				__m128i			bytes = _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + i ) );
+				unsigned int	mask = (unsigned int)_mm_movemask_epi8( bytes );
+				if( !mask ){
+					_mm_storeu_si128( reinterpret_cast<__m128i*>( dest + n ) , bytes );
+					n += 16;
+					continue;
+				}
+				if( mask == 0xFFFF ){
+					__m128i conts;
+					__m128i leads = latin1_leads_sse2( bytes , conts );
+					_mm_storeu_si128( reinterpret_cast<__m128i*>( dest + n ) , _mm_unpacklo_epi8( leads , conts ) );
+					_mm_storeu_si128( reinterpret_cast<__m128i*>( dest + n + 16 ) , _mm_unpackhi_epi8( leads , conts ) );
+					n += 32;
+					continue;
+				}
+				if( popcount( mask ) > 4 ){ // Store each byte as a 2-byte word, advancing by its length
+					__m128i			conts;
+					__m128i			leads = latin1_leads_sse2( bytes , conts );
+					std::uint16_t	words[16];
+					_mm_storeu_si128( reinterpret_cast<__m128i*>( words ) , _mm_unpacklo_epi8( leads , conts ) );
+					_mm_storeu_si128( reinterpret_cast<__m128i*>( words + 8 ) , _mm_unpackhi_epi8( leads , conts ) );
+					for( int j = 0 ; j < 16 ; ++j ){
+						std::memcpy( dest + n , words + j , 2 );
+						n += 1 + ( mask >> j & 1 );
+					}
+					continue;
+				}
+				for( unsigned int pos = 0 ; ; mask &= mask - 1 ){ // Copy the ascii in front of each high byte with a 16-byte store
+					unsigned int high = mask ? ctz( mask ) : 16;
+					_mm_storeu_si128( reinterpret_cast<__m128i*>( dest + n ) , _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + i + pos ) ) );
+					n += high - pos;
+					if( high == 16 )
+						break;
+					dest[n++] = (unsigned char)( 0xC0 | src[i + high] >> 6 );
+					dest[n++] = (unsigned char)( src[i + high] & 0xBF );
+					pos = high + 1;
+				}
+			}
+			for( ; i < len ; ++i ){
+				if( src[i] < 0x80 )
+					dest[n++] = src[i];
+				else{
+					dest[n++] = (unsigned char)( 0xC0 | src[i] >> 6 );
+					dest[n++] = (unsigned char)( src[i] & 0xBF );
+				}
+			}
+			dest_len = n;
+			return len;
+		}
+		
+		//! Shuffles compacting the elements of 16 bytes and the number of elements kept (see get_utf8_compaction_table, get_utf16_compaction_table and get_latin1_expansion_table)
+		struct compaction_table
+		{
+			unsigned char	shuffle[256][16];
+			unsigned char	length[256];
+		};
+		
+		//! Compacts the utf8 of 4 codepoints (see encode_utf8_sse2), indexed by the lanes with multibytes (bits 0 to 3) and 3-byte sequences (bits 4 to 7)
+		inline const compaction_table& get_utf8_compaction_table() noexcept {
+			static const compaction_table table = []{
+				compaction_table result;
+				for( unsigned int index = 0 ; index < 256 ; ++index ){
+					unsigned int len = 0;
+					for( unsigned int lane = 0 ; lane < 4 ; ++lane )
+						for( unsigned int byte = 0 ; byte < 1 + ( index >> lane & 1 ) + ( index >> ( lane + 4 ) & 1 ) ; ++byte )
+							result.shuffle[index][len++] = (unsigned char)( lane * 4 + byte );
+					result.length[index] = (unsigned char)len;
+					while( len < 16 )
+						result.shuffle[index][len++] = 0x80; // Zero
+				}
+				return result;
+			}();
+			return table;
+		}
+		
+		//! Compacts 8 code units, indexed by the lanes to keep
+		inline const compaction_table& get_utf16_compaction_table() noexcept {
+			static const compaction_table table = []{
+				compaction_table result;
+				for( unsigned int index = 0 ; index < 256 ; ++index ){
+					unsigned int len = 0;
+					for( unsigned int lane = 0 ; lane < 8 ; ++lane )
+						if( index >> lane & 1 ){
+							result.shuffle[index][len++] = (unsigned char)( lane * 2 );
+							result.shuffle[index][len++] = (unsigned char)( lane * 2 + 1 );
+						}
+					result.length[index] = (unsigned char)( len / 2 );
+					while( len < 16 )
+						result.shuffle[index][len++] = 0x80; // Zero
+				}
+				return result;
+			}();
+			return table;
+		}
+		
+		//! Expands 8 bytes of latin1 interleaved with their continuation bytes (see latin1_leads_sse2) by dropping those of ascii, indexed by the high bytes
+		inline const compaction_table& get_latin1_expansion_table() noexcept {
+			static const compaction_table table = []{
+				compaction_table result;
+				for( unsigned int index = 0 ; index < 256 ; ++index ){
+					unsigned int len = 0;
+					for( unsigned int lane = 0 ; lane < 8 ; ++lane ){
+						result.shuffle[index][len++] = (unsigned char)( lane * 2 );
+						if( index >> lane & 1 )
+							result.shuffle[index][len++] = (unsigned char)( lane * 2 + 1 );
+					}
+					result.length[index] = (unsigned char)len;
+					while( len < 16 )
+						result.shuffle[index][len++] = 0x80; // Zero
+				}
+				return result;
+			}();
+			return table;
+		}
+		
+		TINY_UTF8_TARGET_AVX2 inline const unsigned char* skip_ascii_avx2( const unsigned char* iter , const unsigned char* end ) noexcept {
+			for( ; end - iter >= 32 ; iter += 32 )
+				if( unsigned int mask = (unsigned int)_mm256_movemask_epi8( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( iter ) ) ) )
+					return iter + ctz( mask );
+			return skip_ascii_sse2( iter , end );
+		}
+		
+		TINY_UTF8_TARGET_AVX2 inline const unsigned char* find_pair_avx2( const unsigned char* begin , const unsigned char* end , unsigned char first , unsigned char second ) noexcept {
+			const __m256i first_v = _mm256_set1_epi8( (char)first );
+			const __m256i second_v = _mm256_set1_epi8( (char)second );
+			for( ; end - begin >= 33 ; begin += 32 ){
+				__m256i match = _mm256_and_si256(
+					_mm256_cmpeq_epi8( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( begin ) ) , first_v )
+					, _mm256_cmpeq_epi8( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( begin + 1 ) ) , second_v )
+				);
+				if( unsigned int mask = (unsigned int)_mm256_movemask_epi8( match ) )
+					return begin + ctz( mask );
+			}
+			return find_pair_sse2( begin , end , first , second );
+		}
+		
+		TINY_UTF8_TARGET_AVX2 inline std::size_t widen_ascii_avx2( const unsigned char* src , std::size_t len , char32_t* dest ) noexcept {
+			std::size_t i = 0;
+			for( ; len - i >= 32 ; i += 32 ){
+				__m256i bytes = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( src + i ) );
+				if( _mm256_movemask_epi8( bytes ) )
+					break;
+				for( int j = 0 ; j < 32 ; j += 8 )
+					_mm256_storeu_si256( reinterpret_cast<__m256i*>( dest + i + j ) , _mm256_cvtepu8_epi32( _mm_loadl_epi64( reinterpret_cast<const __m128i*>( src + i + j ) ) ) );
+			}
+			return i + widen_ascii_sse2( src + i , len - i , dest + i );
+		}
+		
+		TINY_UTF8_TARGET_AVX2 inline void flush_counters_avx2( __m256i& num_conts , __m256i& num_leads , std::size_t& num_codepoints , std::size_t& num_multibytes ) noexcept {
+			__m256i conts = _mm256_sad_epu8( num_conts , _mm256_setzero_si256() );
+			__m256i leads = _mm256_sad_epu8( num_leads , _mm256_setzero_si256() );
+			__m128i sums = _mm_add_epi64( _mm_unpacklo_epi64( _mm256_castsi256_si128( conts ) , _mm256_castsi256_si128( leads ) ) , _mm_unpackhi_epi64( _mm256_castsi256_si128( conts ) , _mm256_castsi256_si128( leads ) ) );
+			sums = _mm_add_epi64( sums , _mm_add_epi64(
+				_mm_unpacklo_epi64( _mm256_extracti128_si256( conts , 1 ) , _mm256_extracti128_si256( leads , 1 ) )
+				, _mm_unpackhi_epi64( _mm256_extracti128_si256( conts , 1 ) , _mm256_extracti128_si256( leads , 1 ) )
+			) );
+			num_codepoints -= (std::size_t)_mm_cvtsi128_si32( sums );
+			num_multibytes += (std::size_t)_mm_cvtsi128_si32( _mm_srli_si128( sums , 8 ) );
+			num_conts = num_leads = _mm256_setzero_si256();
+		}
+		
+		/**
+		 * Lookup validation (Keiser & Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte"): The high and low nibble of
+		 * each byte's predecessor and its own high nibble each look up a set of error classes, which are and-ed together. Missing
+		 * or excess third and fourth bytes are found by comparing the second and third predecessors.
+		 */
+		TINY_UTF8_TARGET_AVX2 inline const unsigned char* skip_valid_avx2( const unsigned char* iter , const unsigned char* end , std::size_t& num_codepoints , std::size_t& num_multibytes ) noexcept {
+			enum : unsigned char {
+				too_short = 1 << 0 , too_long = 1 << 1 , overlong_3 = 1 << 2 , too_large = 1 << 3 , surrogate = 1 << 4
+				, overlong_2 = 1 << 5 , too_large_1000 = 1 << 6 , overlong_4 = 1 << 6 , two_conts = 1 << 7
+				, carry = too_short | too_long | two_conts
+			};
+			const __m256i byte_1_high = _mm256_broadcastsi128_si256( _mm_setr_epi8(
+				too_long , too_long , too_long , too_long , too_long , too_long , too_long , too_long
+				, (char)two_conts , (char)two_conts , (char)two_conts , (char)two_conts
+				, too_short | overlong_2 , too_short , too_short | overlong_3 | surrogate , too_short | too_large | too_large_1000 | overlong_4
+			) );
+			const __m256i byte_1_low = _mm256_broadcastsi128_si256( _mm_setr_epi8(
+				(char)( carry | overlong_3 | overlong_2 | overlong_4 ) , (char)( carry | overlong_2 ) , (char)carry , (char)carry
+				, (char)( carry | too_large ) , (char)( carry | too_large | too_large_1000 ) , (char)( carry | too_large | too_large_1000 ) , (char)( carry | too_large | too_large_1000 )
+				, (char)( carry | too_large | too_large_1000 ) , (char)( carry | too_large | too_large_1000 ) , (char)( carry | too_large | too_large_1000 ) , (char)( carry | too_large | too_large_1000 )
+				, (char)( carry | too_large | too_large_1000 ) , (char)( carry | too_large | too_large_1000 | surrogate ) , (char)( carry | too_large | too_large_1000 ) , (char)( carry | too_large | too_large_1000 )
+			) );
+			const __m256i byte_2_high = _mm256_broadcastsi128_si256( _mm_setr_epi8(
+				too_short , too_short , too_short , too_short , too_short , too_short , too_short , too_short
+				, (char)( too_long | overlong_2 | two_conts | overlong_3 | too_large_1000 | overlong_4 )
+				, (char)( too_long | overlong_2 | two_conts | overlong_3 | too_large )
+				, (char)( too_long | overlong_2 | two_conts | surrogate | too_large )
+				, (char)( too_long | overlong_2 | two_conts | surrogate | too_large )
+				, too_short , too_short , too_short , too_short
+			) );
+			const __m256i			nibble = _mm256_set1_epi8( 0x0F );
+			const unsigned char*	begin = iter;
+			__m256i					prev = _mm256_setzero_si256();
+			unsigned int			prev_mask = 0;
+			__m256i					num_conts = _mm256_setzero_si256();
+			__m256i					num_leads = _mm256_setzero_si256();
+			unsigned int			num_pending = 0;
+			for( ; end - iter >= 32 ; iter += 32 ){
+				__m256i			cur = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( iter ) );
+				unsigned int	mask = (unsigned int)_mm256_movemask_epi8( cur );
+				if( !( mask | prev_mask ) ){ // Ascii, that does not end a sequence
+					num_codepoints += 32;
+					prev = cur;
+					continue;
+				}
+				__m256i shifted = _mm256_permute2x128_si256( prev , cur , 0x21 ); // The upper half of 'prev' and the lower half of 'cur'
+				__m256i prev1 = _mm256_alignr_epi8( cur , shifted , 15 );
+				__m256i prev2 = _mm256_alignr_epi8( cur , shifted , 14 );
+				__m256i prev3 = _mm256_alignr_epi8( cur , shifted , 13 );
+				__m256i special_cases = _mm256_and_si256(
+					_mm256_and_si256(
+						_mm256_shuffle_epi8( byte_1_high , _mm256_and_si256( _mm256_srli_epi16( prev1 , 4 ) , nibble ) )
+						, _mm256_shuffle_epi8( byte_1_low , _mm256_and_si256( prev1 , nibble ) )
+					)
+					, _mm256_shuffle_epi8( byte_2_high , _mm256_and_si256( _mm256_srli_epi16( cur , 4 ) , nibble ) )
+				);
+				__m256i must_be_3rd_or_4th = _mm256_or_si256( // Bit 7 set, if the second or third predecessor is a 3- or 4-byte lead
+					_mm256_subs_epu8( prev2 , _mm256_set1_epi8( (char)( 0xE0 - 0x80 ) ) )
+					, _mm256_subs_epu8( prev3 , _mm256_set1_epi8( (char)( 0xF0 - 0x80 ) ) )
+				);
+				__m256i error = _mm256_xor_si256( _mm256_and_si256( must_be_3rd_or_4th , _mm256_set1_epi8( (char)0x80 ) ) , special_cases );
+				if( !_mm256_testz_si256( error , error ) )
+					break;
+				__m256i is_cont = _mm256_cmpgt_epi8( _mm256_set1_epi8( (char)0xC0 ) , cur ); // Signed: 0x80 to 0xBF
+				num_codepoints += 32;
+				num_conts = _mm256_sub_epi8( num_conts , is_cont );
+				num_leads = _mm256_sub_epi8( num_leads , _mm256_andnot_si256( is_cont , _mm256_cmpgt_epi8( _mm256_setzero_si256() , cur ) ) );
+				if( ++num_pending % 255 == 0 )
+					flush_counters_avx2( num_conts , num_leads , num_codepoints , num_multibytes );
+				prev = cur;
+				prev_mask = mask;
+			}
+			flush_counters_avx2( num_conts , num_leads , num_codepoints , num_multibytes );
+			return rewind_to_lead( begin , iter , num_codepoints , num_multibytes );
+		}
+		
+		TINY_UTF8_TARGET_AVX2 inline std::size_t count_utf32_avx2( const char32_t* src , std::size_t len , std::size_t& num_bytes , std::size_t& num_multibytes ) noexcept {
+			__m256i			num_extra = _mm256_setzero_si256(); // Lane counters of the bytes beyond the first one
+			__m256i			num_multi = _mm256_setzero_si256();
+			std::size_t		i = 0;
+			unsigned int	num_pending = 0;
+			for( ; len - i >= 8 ; i += 8 ){
+				__m256i cps = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( src + i ) );
+				if( !_mm256_testz_si256( cps , _mm256_set1_epi32( int( 0xFFE00000 ) ) ) ) // Above U+1FFFFF
+					break;
+				__m256i multi = _mm256_cmpgt_epi32( cps , _mm256_set1_epi32( 0x7F ) );
+				num_multi = _mm256_sub_epi32( num_multi , multi );
+				num_extra = _mm256_sub_epi32( num_extra , _mm256_add_epi32( _mm256_add_epi32( multi
+					, _mm256_cmpgt_epi32( cps , _mm256_set1_epi32( 0x7FF ) ) )
+					, _mm256_cmpgt_epi32( cps , _mm256_set1_epi32( 0xFFFF ) ) )
+				);
+				if( ++num_pending % ( 1u << 28 ) == 0 ){ // Keep the lanes from overflowing
+					num_bytes += sum_epi32_sse2( _mm256_castsi256_si128( num_extra ) ) + sum_epi32_sse2( _mm256_extracti128_si256( num_extra , 1 ) );
+					num_multibytes += sum_epi32_sse2( _mm256_castsi256_si128( num_multi ) ) + sum_epi32_sse2( _mm256_extracti128_si256( num_multi , 1 ) );
+					num_extra = num_multi = _mm256_setzero_si256();
+				}
+			}
+			num_bytes += i + sum_epi32_sse2( _mm256_castsi256_si128( num_extra ) ) + sum_epi32_sse2( _mm256_extracti128_si256( num_extra , 1 ) );
+			num_multibytes += sum_epi32_sse2( _mm256_castsi256_si128( num_multi ) ) + sum_epi32_sse2( _mm256_extracti128_si256( num_multi , 1 ) );
+			return i + count_utf32_sse2( src + i , len - i , num_bytes , num_multibytes );
+		}
+		
+		/**
+		 * Stores the utf8 of the 8 codepoints (up to U+FFFF) in 'cps' to 'dest' and returns its length: They are
+		 * encoded to 32-bit lanes (see encode_utf8_sse2) and each half is compacted with a shuffle (overhanging by up to 12 bytes).
+		 */
+		TINY_UTF8_TARGET_AVX2 inline std::size_t store_utf8_avx2( __m256i cps , __m256i is_multi , const compaction_table& table , unsigned char* dest ) noexcept {
+			const __m256i	low6 = _mm256_set1_epi32( 0x3F );
+			const __m256i	cont = _mm256_set1_epi32( 0x80 );
+			__m256i			is_3byte = _mm256_cmpgt_epi32( cps , _mm256_set1_epi32( 0x7FF ) );
+			__m256i			last = _mm256_or_si256( _mm256_and_si256( cps , low6 ) , cont );
+			__m256i			middle = _mm256_or_si256( _mm256_and_si256( _mm256_srli_epi32( cps , 6 ) , low6 ) , cont );
+			__m256i			two = _mm256_or_si256( _mm256_or_si256( _mm256_srli_epi32( cps , 6 ) , _mm256_set1_epi32( 0xC0 ) ) , _mm256_slli_epi32( last , 8 ) );
+			__m256i			three = _mm256_or_si256(
+				_mm256_or_si256( _mm256_srli_epi32( cps , 12 ) , _mm256_set1_epi32( 0xE0 ) )
+				, _mm256_or_si256( _mm256_slli_epi32( middle , 8 ) , _mm256_slli_epi32( last , 16 ) )
+			);
+			__m256i			words = _mm256_blendv_epi8( cps , _mm256_blendv_epi8( two , three , is_3byte ) , is_multi );
+			unsigned int	multi_mask = (unsigned int)_mm256_movemask_ps( _mm256_castsi256_ps( is_multi ) );
+			unsigned int	three_mask = (unsigned int)_mm256_movemask_ps( _mm256_castsi256_ps( is_3byte ) );
+			unsigned int	lower = ( multi_mask & 0xF ) | ( three_mask & 0xF ) << 4;
+			unsigned int	upper = multi_mask >> 4 | ( three_mask >> 4 ) << 4;
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( dest ) , _mm_shuffle_epi8( _mm256_castsi256_si128( words ) , _mm_loadu_si128( reinterpret_cast<const __m128i*>( table.shuffle[lower] ) ) ) );
+			dest += table.length[lower];
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( dest ) , _mm_shuffle_epi8( _mm256_extracti128_si256( words , 1 ) , _mm_loadu_si128( reinterpret_cast<const __m128i*>( table.shuffle[upper] ) ) ) );
+			return table.length[lower] + table.length[upper];
+		}
+		
+		TINY_UTF8_TARGET_AVX2 inline std::size_t narrow_utf32_avx2( const char32_t* src , std::size_t len , unsigned char* dest , std::size_t& dest_len ) noexcept {
+			const compaction_table&	table = get_utf8_compaction_table();
+			std::size_t				i = 0 , n = 0;
+			while( len - i >= 20 ) // The stores of a block overhang, but stay within the utf8 of the 12 codepoints ahead
+			{
+				__m256i cps = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( src + i ) );
+				if( !_mm256_testz_si256( cps , _mm256_set1_epi32( int( 0xFFFF0000 ) ) ) ) // Above U+FFFF
+					break;
+				__m256i is_multi = _mm256_cmpgt_epi32( cps , _mm256_set1_epi32( 0x7F ) );
+				if( _mm256_testz_si256( is_multi , is_multi ) && narrow_ascii_sse2( src + i , dest + n ) ){
+					i += 16;
+					n += 16;
+					continue;
+				}
+				n += store_utf8_avx2( cps , is_multi , table , dest + n );
+				i += 8;
+			}
+			i += narrow_utf32_sse2( src + i , len - i , dest + n , dest_len );
+			dest_len += n;
+			return i;
+		}
+		
+		//! Sums the 16-bit lanes of 'counters' (each below 0x4000)
+		TINY_UTF8_TARGET_AVX2 inline std::size_t sum_epi16_avx2( __m256i counters ) noexcept {
+			return sum_epi16_sse2( _mm_add_epi16( _mm256_castsi256_si128( counters ) , _mm256_extracti128_si256( counters , 1 ) ) );
+		}
+		
+		//! Sums the bytes of 'counters'
+		TINY_UTF8_TARGET_AVX2 inline std::size_t sum_bytes_avx2( __m256i counters ) noexcept {
+			return sum_bytes_sse2( _mm256_castsi256_si128( counters ) ) + sum_bytes_sse2( _mm256_extracti128_si256( counters , 1 ) );
+		}
+		
+		TINY_UTF8_TARGET_AVX2 inline std::size_t count_utf16_avx2( const char16_t* src , std::size_t len , std::size_t& num_bytes , std::size_t& num_multibytes ) noexcept {
+			__m256i			num_ascii = _mm256_setzero_si256(); // Lane counters of the code units below U+80 and U+800
+			__m256i			num_small = _mm256_setzero_si256();
+			std::size_t		ascii = 0 , small = 0 , i = 0;
+			unsigned int	num_pending = 0;
+			for( ; len - i >= 16 ; i += 16 ){
+				__m256i units = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( src + i ) );
+				if( !_mm256_testz_si256( _mm256_cmpeq_epi16( _mm256_and_si256( units , _mm256_set1_epi16( (short)0xF800 ) ) , _mm256_set1_epi16( (short)0xD800 ) ) , _mm256_set1_epi16( -1 ) ) ) // Surrogates
+					break;
+				num_ascii = _mm256_sub_epi16( num_ascii , _mm256_cmpeq_epi16( _mm256_and_si256( units , _mm256_set1_epi16( (short)0xFF80 ) ) , _mm256_setzero_si256() ) );
+				num_small = _mm256_sub_epi16( num_small , _mm256_cmpeq_epi16( _mm256_and_si256( units , _mm256_set1_epi16( (short)0xF800 ) ) , _mm256_setzero_si256() ) );
+				if( ++num_pending % 0x3FFF == 0 ){ // Keep the lanes (and the sums of both halves) from overflowing
+					ascii += sum_epi16_avx2( num_ascii );
+					small += sum_epi16_avx2( num_small );
+					num_ascii = num_small = _mm256_setzero_si256();
+				}
+			}
+			ascii += sum_epi16_avx2( num_ascii );
+			small += sum_epi16_avx2( num_small );
+			num_bytes += 3 * i - ascii - small;
+			num_multibytes += i - ascii;
+			return i + count_utf16_sse2( src + i , len - i , num_bytes , num_multibytes );
+		}
+		
+		//! Narrows blocks of 8 code units without surrogates, zero-extended to codepoints (see narrow_utf32_avx2)
+		TINY_UTF8_TARGET_AVX2 inline std::size_t narrow_utf16_avx2( const char16_t* src , std::size_t len , unsigned char* dest , std::size_t& dest_len ) noexcept {
+			const compaction_table&	table = get_utf8_compaction_table();
+			std::size_t				i = 0 , n = 0;
+			for( ; len - i >= 20 ; i += 8 ){ // The stores of a block overhang, but stay within the utf8 of the 12 code units ahead
+				__m128i units = _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + i ) );
+				if( has_surrogate_sse2( units ) )
+					break;
+				if( is_ascii_epi16_sse2( units ) ){
+					_mm_storel_epi64( reinterpret_cast<__m128i*>( dest + n ) , _mm_packus_epi16( units , units ) );
+					n += 8;
+					continue;
+				}
+				__m256i cps = _mm256_cvtepu16_epi32( units );
+				n += store_utf8_avx2( cps , _mm256_cmpgt_epi32( cps , _mm256_set1_epi32( 0x7F ) ) , table , dest + n );
+			}
+			i += narrow_utf16_sse2( src + i , len - i , dest + n , dest_len );
+			dest_len += n;
+			return i;
+		}
+		
+		//! See check_bmp_sse2
+		TINY_UTF8_TARGET_AVX2 inline unsigned int check_bmp_avx2( __m256i cur , __m256i prev , __m256i& is_cont ) noexcept {
+			__m256i shifted = _mm256_permute2x128_si256( prev , cur , 0x21 ); // The upper half of 'prev' and the lower half of 'cur'
+			__m256i prev1 = _mm256_alignr_epi8( cur , shifted , 15 );
+			__m256i prev2 = _mm256_alignr_epi8( cur , shifted , 14 );
+			__m256i must_cont = _mm256_or_si256( // Bit 7 set, if the predecessor is a lead or the second predecessor a 3-byte lead (or longer)
+				_mm256_subs_epu8( prev1 , _mm256_set1_epi8( (char)( 0xC0 - 0x80 ) ) )
+				, _mm256_subs_epu8( prev2 , _mm256_set1_epi8( (char)( 0xE0 - 0x80 ) ) )
+			);
+			is_cont = _mm256_cmpgt_epi8( _mm256_set1_epi8( (char)0xC0 ) , cur ); // Signed: 0x80 to 0xBF
+			__m256i error = _mm256_xor_si256( is_cont , _mm256_cmpgt_epi8( _mm256_setzero_si256() , must_cont ) );
+			error = _mm256_or_si256( error , _mm256_cmpeq_epi8( _mm256_max_epu8( cur , _mm256_set1_epi8( (char)0xF0 ) ) , cur ) );
+			return (unsigned int)_mm256_movemask_epi8( error );
+		}
+		
+		TINY_UTF8_TARGET_AVX2 inline const unsigned char* count_bmp_avx2( const unsigned char* iter , const unsigned char* end , std::size_t& num_units ) noexcept {
+			const unsigned char*	begin = iter;
+			__m256i					prev = _mm256_setzero_si256();
+			unsigned int			prev_mask = 0;
+			__m256i					num_conts = _mm256_setzero_si256();
+			unsigned int			num_pending = 0;
+			std::size_t				n = 0 , unused = 0;
+			for( ; end - iter >= 32 ; iter += 32 ){
+				__m256i			cur = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( iter ) );
+				unsigned int	mask = (unsigned int)_mm256_movemask_epi8( cur );
+				if( !( mask | prev_mask ) ){ // Ascii, that does not end a sequence
+					n += 32;
+					prev = cur;
+					continue;
+				}
+				__m256i is_cont;
+				if( unsigned int errors = check_bmp_avx2( cur , prev , is_cont ) ){ // Count the code units in front of the first error
+					unsigned int len = ctz( errors );
+					n += len - popcount( (unsigned int)_mm256_movemask_epi8( is_cont ) & ( ( 1u << len ) - 1 ) );
+					iter += len;
+					break;
+				}
+				n += 32;
+				num_conts = _mm256_sub_epi8( num_conts , is_cont );
+				if( ++num_pending % 255 == 0 ){
+					n -= sum_bytes_avx2( num_conts );
+					num_conts = _mm256_setzero_si256();
+				}
+				prev = cur;
+				prev_mask = mask;
+			}
+			n -= sum_bytes_avx2( num_conts );
+			iter = rewind_to_lead( begin , iter , n , unused );
+			num_units = n;
+			return iter;
+		}
+		
+		//! See decode_bmp_sse2 (for 16 bytes)
+		TINY_UTF8_TARGET_AVX2 inline __m256i decode_bmp_avx2( const unsigned char* src ) noexcept {
+			const __m256i	low6 = _mm256_set1_epi16( 0x3F );
+			__m256i			byte0 = _mm256_cvtepu8_epi16( _mm_loadu_si128( reinterpret_cast<const __m128i*>( src ) ) );
+			__m256i			byte1 = _mm256_and_si256( _mm256_cvtepu8_epi16( _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + 1 ) ) ) , low6 );
+			__m256i			byte2 = _mm256_and_si256( _mm256_cvtepu8_epi16( _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + 2 ) ) ) , low6 );
+			__m256i			two = _mm256_or_si256( _mm256_slli_epi16( _mm256_and_si256( byte0 , _mm256_set1_epi16( 0x1F ) ) , 6 ) , byte1 );
+			__m256i			three = _mm256_or_si256( _mm256_or_si256( _mm256_slli_epi16( byte0 , 12 ) , _mm256_slli_epi16( byte1 , 6 ) ) , byte2 );
+			__m256i			is_multi = _mm256_cmpgt_epi16( byte0 , _mm256_set1_epi16( 0xBF ) );
+			__m256i			is_3byte = _mm256_cmpgt_epi16( byte0 , _mm256_set1_epi16( 0xDF ) );
+			return _mm256_blendv_epi8( byte0 , _mm256_blendv_epi8( two , three , is_3byte ) , is_multi );
+		}
+		
+		//! Stores the lanes of 'units' selected by 'keep' to 'dest' (overhanging by up to 8 code units) and returns their number
+		TINY_UTF8_TARGET_AVX2 inline std::size_t compact_units_avx2( __m256i units , unsigned int keep , const compaction_table& table , char16_t* dest ) noexcept {
+			unsigned int lower = keep & 0xFF , upper = keep >> 8 & 0xFF;
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( dest ) , _mm_shuffle_epi8( _mm256_castsi256_si128( units ) , _mm_loadu_si128( reinterpret_cast<const __m128i*>( table.shuffle[lower] ) ) ) );
+			dest += table.length[lower];
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( dest ) , _mm_shuffle_epi8( _mm256_extracti128_si256( units , 1 ) , _mm_loadu_si128( reinterpret_cast<const __m128i*>( table.shuffle[upper] ) ) ) );
+			return table.length[lower] + table.length[upper];
+		}
+		
+		//! Decodes 32 bytes to 16-bit lanes at once and compacts each group of 8 lanes with a shuffle
+		TINY_UTF8_TARGET_AVX2 inline const unsigned char* widen_bmp_avx2( const unsigned char* iter , const unsigned char* end , char16_t* dest , std::size_t& num_units ) noexcept {
+			const compaction_table&	table = get_utf16_compaction_table();
+			const unsigned char*	begin = iter;
+			__m256i					prev = _mm256_setzero_si256();
+			unsigned int			prev_mask = 0;
+			std::size_t				n = 0 , unused = 0;
+			for( ; end - iter >= 96 ; iter += 32 ){ // Decoding reads 2 bytes ahead and the stores overhang, but stay within the utf16 of the 64 bytes ahead
+				__m256i			cur = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( iter ) );
+				unsigned int	mask = (unsigned int)_mm256_movemask_epi8( cur );
+				if( !( mask | prev_mask ) ){ // Ascii, that does not end a sequence
+					_mm256_storeu_si256( reinterpret_cast<__m256i*>( dest + n ) , _mm256_cvtepu8_epi16( _mm256_castsi256_si128( cur ) ) );
+					_mm256_storeu_si256( reinterpret_cast<__m256i*>( dest + n + 16 ) , _mm256_cvtepu8_epi16( _mm256_extracti128_si256( cur , 1 ) ) );
+					n += 32;
+					prev = cur;
+					continue;
+				}
+				__m256i			is_cont;
+				unsigned int	errors = check_bmp_avx2( cur , prev , is_cont );
+				unsigned int	len = errors ? ctz( errors ) : 32; // Decode the sequences in front of the first error
+				unsigned int	keep = ~(unsigned int)_mm256_movemask_epi8( is_cont ) & ( len < 32 ? ( 1u << len ) - 1 : ~0u );
+				n += compact_units_avx2( decode_bmp_avx2( iter ) , keep & 0xFFFF , table , dest + n );
+				n += compact_units_avx2( decode_bmp_avx2( iter + 16 ) , keep >> 16 , table , dest + n );
+				if( errors ){
+					iter += len;
+					break;
+				}
+				prev = cur;
+				prev_mask = mask;
+			}
+			iter = rewind_to_lead( begin , iter , n , unused ); // The last lead was decoded with bytes, that were not checked
+			num_units = n;
+			return iter;
+		}
+		//! Expands blocks of 16 bytes by interleaving them with their continuation bytes and compacting each half with a shuffle
+		TINY_UTF8_TARGET_AVX2 inline std::size_t expand_latin1_avx2( const unsigned char* src , std::size_t len , unsigned char* dest , std::size_t& dest_len ) noexcept {
+			const compaction_table&	table = get_latin1_expansion_table();
+			std::size_t				i = 0 , n = 0;
+			while( len - i >= 48 ) // The stores of a block overhang by up to 8 bytes, which are within the utf8 of the 32 bytes ahead
+			{
+				__m256i block = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( src + i ) );
+				if( !_mm256_movemask_epi8( block ) ){
+					_mm256_storeu_si256( reinterpret_cast<__m256i*>( dest + n ) , block );
+					i += 32;
+					n += 32;
+					continue;
+				}
+				__m128i			bytes = _mm256_castsi256_si128( block );
+				unsigned int	mask = (unsigned int)_mm_movemask_epi8( bytes );
+				unsigned int	lower = mask & 0xFF , upper = mask >> 8;
+				__m128i			conts;
+				__m128i			leads = latin1_leads_sse2( bytes , conts );
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( dest + n ) , _mm_shuffle_epi8( _mm_unpacklo_epi8( leads , conts ) , _mm_loadu_si128( reinterpret_cast<const __m128i*>( table.shuffle[lower] ) ) ) );
+				n += table.length[lower];
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( dest + n ) , _mm_shuffle_epi8( _mm_unpackhi_epi8( leads , conts ) , _mm_loadu_si128( reinterpret_cast<const __m128i*>( table.shuffle[upper] ) ) ) );
+				n += table.length[upper];
+				i += 16;
+			}
+			i += expand_latin1_sse2( src + i , len - i , dest + n , dest_len );
+			dest_len += n;
+			return i;
+		}
+		#endif // TINY_UTF8_HAS_DISPATCH
+		
+		//! Table of the kernels of one simd level
+		struct kernel_table
+		{
+			const unsigned char*	(*skip_ascii)( const unsigned char* iter , const unsigned char* end );
+			const unsigned char*	(*find_pair)( const unsigned char* begin , const unsigned char* end , unsigned char first , unsigned char second );
+			std::size_t				(*widen_ascii)( const unsigned char* src , std::size_t len , char32_t* dest );
+			const unsigned char*	(*skip_valid)( const unsigned char* iter , const unsigned char* end , std::size_t& num_codepoints , std::size_t& num_multibytes );
+			std::size_t				(*count_utf32)( const char32_t* src , std::size_t len , std::size_t& num_bytes , std::size_t& num_multibytes );
+			std::size_t				(*narrow_utf32)( const char32_t* src , std::size_t len , unsigned char* dest , std::size_t& dest_len );
+			std::size_t				(*count_utf16)( const char16_t* src , std::size_t len , std::size_t& num_bytes , std::size_t& num_multibytes );
+			std::size_t				(*narrow_utf16)( const char16_t* src , std::size_t len , unsigned char* dest , std::size_t& dest_len );
+			const unsigned char*	(*count_bmp)( const unsigned char* iter , const unsigned char* end , std::size_t& num_units );
+			const unsigned char*	(*widen_bmp)( const unsigned char* iter , const unsigned char* end , char16_t* dest , std::size_t& num_units );
+			std::size_t				(*expand_latin1)( const unsigned char* src , std::size_t len , unsigned char* dest , std::size_t& dest_len );
+		};
+		
+		inline const kernel_table& get_kernel_table( simd_level level ) noexcept {
+			static const kernel_table tables[] = {
+				{ &skip_ascii_scalar , &find_pair_scalar , &widen_ascii_scalar<char32_t> , &skip_valid_scalar , &count_ascii_scalar<char32_t> , &narrow_ascii_scalar<char32_t>
+					, &count_ascii_scalar<char16_t> , &narrow_ascii_scalar<char16_t> , &count_bmp_scalar , &widen_bmp_scalar , &expand_latin1_scalar }
+			#if TINY_UTF8_HAS_DISPATCH
+				, { &skip_ascii_sse2 , &find_pair_sse2 , &widen_ascii_sse2 , &skip_valid_sse2 , &count_utf32_sse2 , &narrow_utf32_sse2
+					, &count_utf16_sse2 , &narrow_utf16_sse2 , &count_bmp_sse2 , &widen_bmp_sse2 , &expand_latin1_sse2 }
+				, { &skip_ascii_avx2 , &find_pair_avx2 , &widen_ascii_avx2 , &skip_valid_avx2 , &count_utf32_avx2 , &narrow_utf32_avx2
+					, &count_utf16_avx2 , &narrow_utf16_avx2 , &count_bmp_avx2 , &widen_bmp_avx2 , &expand_latin1_avx2 }
+			#endif
+			};
+			return tables[ (unsigned int)level ];
+		}
+		
+		//! Determines the highest simd level supported by the executing cpu
+		inline simd_level detect_simd_level() noexcept {
+			#if !TINY_UTF8_HAS_DISPATCH
+				return simd_level::scalar;
+			#elif defined(__GNUC__)
+				__builtin_cpu_init();
+				return __builtin_cpu_supports( "avx2" ) ? simd_level::avx2 : simd_level::sse2;
+			#else
+				int info[4];
+				__cpuid( info , 0 );
+				if( info[0] < 7 )
+					return simd_level::sse2;
+				__cpuidex( info , 7 , 0 );
+				bool avx2 = info[1] & ( 1 << 5 );
+				__cpuid( info , 1 );
+				bool osxsave = info[2] & ( 1 << 27 ); // The OS saves the ymm registers?
+				return avx2 && osxsave && ( _xgetbv( 0 ) & 6 ) == 6 ? simd_level::avx2 : simd_level::sse2;
+			#endif
+		}
+		
+		//! Determines the simd level to start with (applying TINY_UTF8_FORCE_SIMD_LEVEL and the environment variable TINY_UTF8_SIMD_LEVEL)
+		inline simd_level initial_simd_level() noexcept {
+			unsigned int level = (unsigned int)detect_simd_level();
+			#if defined(TINY_UTF8_FORCE_SIMD_LEVEL)
+				level = std::min<unsigned int>( level , TINY_UTF8_FORCE_SIMD_LEVEL );
+			#endif
+			if( const char* env = std::getenv( "TINY_UTF8_SIMD_LEVEL" ) ){
+				static const char* const names[] = { "scalar" , "sse2" , "avx2" };
+				for( unsigned int i = 0 ; i < 3 ; ++i )
+					if( !std::strcmp( env , names[i] ) || ( env[0] == char( '0' + i ) && !env[1] ) )
+						level = std::min( level , i );
+			}
+			return simd_level( level );
+		}
+		
+		//! Returns the kernel table in use (initialized on first use)
+		inline std::atomic<const kernel_table*>& active_kernel_table() noexcept {
+			static std::atomic<const kernel_table*> table{ &get_kernel_table( initial_simd_level() ) };
+			return table;
+		}
+		
+		inline const kernel_table& kernels() noexcept { return *active_kernel_table().load( std::memory_order_relaxed ); }
+		
+		//! Checks, whether the 16 bytes at 'iter' are ascii (in which case a kernel is worth its indirect call)
+		inline bool is_ascii_16( const unsigned char* iter ) noexcept {
+			std::uint64_t words[2];
+			std::memcpy( words , iter , 16 );
+			return !( ( words[0] | words[1] ) & 0x8080808080808080ull );
+		}
+		
+		//! Returns the first non-ascii byte in [iter,end) or end (using the kernel of the current simd level for long ascii runs)
+		inline const unsigned char* skip_ascii( const unsigned char* iter , const unsigned char* end ) noexcept {
+			if( end - iter < 32 || !is_ascii_16( iter ) )
+				return skip_ascii_scalar( iter , end );
+			return kernels().skip_ascii( iter + 16 , end );
+		}
+		
+		//! Returns the first p in [begin,end-1) with p[0] == first and p[1] == second or nullptr
+		inline const unsigned char* find_pair( const unsigned char* begin , const unsigned char* end , unsigned char first , unsigned char second ) noexcept {
+			return kernels().find_pair( begin , end , first , second );
+		}
+		
+		//! Widens the ascii bytes at the start of [src,src+len) to 'dest' and returns their number
+		template<typename T>
+		inline std::size_t widen_ascii( const unsigned char* src , std::size_t len , T* dest ) noexcept {
+			return widen_ascii_scalar( src , len , dest );
+		}
+		inline std::size_t widen_ascii( const unsigned char* src , std::size_t len , char32_t* dest ) noexcept {
+			if( len < 32 || !is_ascii_16( src ) )
+				return widen_ascii_scalar( src , len , dest );
+			return kernels().widen_ascii( src , len , dest );
+		}
+		
+		/**
+		 * Skips well-formed utf8 starting at 'iter' (which must start a sequence) using the kernel of the current simd level
+		 * 
+		 * @param	num_codepoints	Incremented by the number of codepoints skipped
+		 * @param	num_multibytes	Incremented by the number of multibyte codepoints skipped
+		 * @return	The start of the first ill-formed sequence or end
+		 */
+		inline const unsigned char* skip_valid( const unsigned char* iter , const unsigned char* end , std::size_t& num_codepoints , std::size_t& num_multibytes ) noexcept {
+			unsigned int invalid_len;
+			while( true ){
+				if( end - iter >= 64 )
+					iter = kernels().skip_valid( iter , end , num_codepoints , num_multibytes );
+				
+				// The vector kernels stop in front of the block with an ill-formed sequence (or the last incomplete block)
+				const unsigned char* limit = end - iter > 64 ? iter + 64 : end;
+				if( ( iter = skip_valid_scalar( iter , limit , num_codepoints , num_multibytes ) ) == end )
+					return end;
+				if( iter == limit )
+					continue;
+				
+				// The sequence at 'iter' may just cross 'limit'
+				unsigned int bytes = check_utf8( iter , end - iter , invalid_len );
+				if( !bytes )
+					return iter;
+				iter += bytes;
+				++num_codepoints;
+				++num_multibytes;
+			}
+		}
+		
+		//! Counts the utf8 bytes and multibytes of the codepoints at the start of [src,src+len), that the kernel of the current simd level handles, and returns their number
+		template<typename T>
+		inline std::size_t count_utf32( const T* src , std::size_t len , std::size_t& num_bytes , std::size_t& num_multibytes ) noexcept {
+			return count_ascii_scalar( src , len , num_bytes , num_multibytes );
+		}
+		inline std::size_t count_utf32( const char32_t* src , std::size_t len , std::size_t& num_bytes , std::size_t& num_multibytes ) noexcept {
+			#if TINY_UTF8_HAS_DISPATCH
+				if( len >= 32 )
+					return kernels().count_utf32( src , len , num_bytes , num_multibytes );
+			#endif
+			return count_ascii_scalar( src , len , num_bytes , num_multibytes );
+		}
+		
+		//! Encodes the codepoints at the start of [src,src+len), that the kernel of the current simd level handles, to 'dest' and returns their number (see narrow_ascii_scalar)
+		template<typename T>
+		inline std::size_t narrow_utf32( const T* src , std::size_t len , unsigned char* dest , std::size_t& dest_len ) noexcept {
+			return narrow_ascii_scalar( src , len , dest , dest_len );
+		}
+		inline std::size_t narrow_utf32( const char32_t* src , std::size_t len , unsigned char* dest , std::size_t& dest_len ) noexcept {
+			#if TINY_UTF8_HAS_DISPATCH
+				if( len >= 32 )
+					return kernels().narrow_utf32( src , len , dest , dest_len );
+			#endif
+			return narrow_ascii_scalar( src , len , dest , dest_len );
+		}
+		
+		//! Counts the utf8 bytes and multibytes of the utf16 code units at the start of [src,src+len), that the kernel of the current simd level handles, and returns their number
+		inline std::size_t count_utf16( const char16_t* src , std::size_t len , std::size_t& num_bytes , std::size_t& num_multibytes ) noexcept {
+			#if TINY_UTF8_HAS_DISPATCH
+				if( len >= 32 )
+					return kernels().count_utf16( src , len , num_bytes , num_multibytes );
+			#endif
+			return count_ascii_scalar( src , len , num_bytes , num_multibytes );
+		}
+		
+		//! Encodes the utf16 code units at the start of [src,src+len), that the kernel of the current simd level handles, to 'dest' and returns their number (see narrow_ascii_scalar)
+		inline std::size_t narrow_utf16( const char16_t* src , std::size_t len , unsigned char* dest , std::size_t& dest_len ) noexcept {
+			#if TINY_UTF8_HAS_DISPATCH
+				if( len >= 32 )
+					return kernels().narrow_utf16( src , len , dest , dest_len );
+			#endif
+			return narrow_ascii_scalar( src , len , dest , dest_len );
+		}
+		
+		//! Counts the utf16 code units of the utf8 at 'iter', that the kernel of the current simd level handles (see widen_bmp_scalar)
+		inline const unsigned char* count_bmp( const unsigned char* iter , const unsigned char* end , std::size_t& num_units ) noexcept {
+			#if TINY_UTF8_HAS_DISPATCH
+				if( end - iter >= 32 )
+					return kernels().count_bmp( iter , end , num_units );
+			#endif
+			return count_bmp_scalar( iter , end , num_units );
+		}
+		
+		//! Decodes the utf8 at 'iter', that the kernel of the current simd level handles, to utf16 at 'dest' (see widen_bmp_scalar)
+		inline const unsigned char* widen_bmp( const unsigned char* iter , const unsigned char* end , char16_t* dest , std::size_t& num_units ) noexcept {
+			#if TINY_UTF8_HAS_DISPATCH
+				if( end - iter >= 96 )
+					return kernels().widen_bmp( iter , end , dest , num_units );
+			#endif
+			return widen_bmp_scalar( iter , end , dest , num_units );
+		}
+		
+		//! Expands the latin1 at the start of [src,src+len), that the kernel of the current simd level handles, to utf8 at 'dest' and returns its length (see expand_latin1_scalar)
+		inline std::size_t expand_latin1( const unsigned char* src , std::size_t len , unsigned char* dest , std::size_t& dest_len ) noexcept {
+			#if TINY_UTF8_HAS_DISPATCH
+				if( len >= 32 )
+					return kernels().expand_latin1( src , len , dest , dest_len );
+			#endif
+			return expand_latin1_scalar( src , len , dest , dest_len );
+		}
+		
+		/**
+		 * Calls 'func( task )' for every task in [0,num_tasks) concurrently (task 0 runs on the calling thread)
+		 * 
+		 * @note	Exceptions leaving a std::thread would call std::terminate. Hence, the exception of each task is captured
+		 *			and the one of the lowest task is rethrown on the calling thread, once all tasks have finished.
+		 */
+		template<typename Func>
+		inline void parallel_for( unsigned int num_tasks , Func func ){
+			if( num_tasks <= 1 ){
+				func( 0u );
+				return;
+			}
+		#if !TINY_UTF8_HAS_THREADS
+			for( unsigned int task = 0 ; task < num_tasks ; ++task )
+				func( task );
+		#else
+		#if defined(__cpp_exceptions)
+			std::unique_ptr<std::exception_ptr[]> errors( new std::exception_ptr[num_tasks] );
+			auto task_func = [&func,&errors]( unsigned int task ){
+				try{ func( task ); }
+				catch( ... ){ errors[task] = std::current_exception(); }
+			};
+		#else
+			Func& task_func = func;
+		#endif
+			{
+				struct joiner{
+					std::unique_ptr<std::thread[]>	threads;
+					unsigned int					num_threads = 0;
+					~joiner(){ while( num_threads ) threads[--num_threads].join(); }
+				} workers;
+				workers.threads.reset( new std::thread[num_tasks - 1] );
+				for( unsigned int task = 1 ; task < num_tasks ; ++task , ++workers.num_threads )
+					workers.threads[task - 1] = std::thread( task_func , task );
+				task_func( 0u );
+			}
+		#if defined(__cpp_exceptions)
+			for( unsigned int task = 0 ; task < num_tasks ; ++task )
+				if( errors[task] )
+					std::rethrow_exception( errors[task] );
+		#endif
+		#endif
+		}
+		
+		//! 32-bit FNV-1a checksum (used to check the integrity of a serialized header)
+		inline std::uint32_t fnv1a( const unsigned char* data , std::size_t len ) noexcept {
+			std::uint32_t hash = 2166136261u;
+			while( len-- )
+				hash = ( hash ^ *data++ ) * 16777619u;
+			return hash;
+		}
+	}
+	
+	/**
+	 * Checks, whether the supplied data is well-formed UTF-8 according to RFC 3629
+	 * 
+	 * @note	Overlong forms, surrogates, codepoints above U+10FFFF and truncated sequences are considered invalid.
+	 *			Long inputs are validated by the vector kernel of the current simd level.
+	 * @param	str				The data to validate
+	 * @param	len				The number of bytes to validate
+	 * @param	error_offset	(Optional) Receives the offset of the first invalid sequence (or 'len' if the data is valid)
+	 * @return	True, if the data is valid, false otherwise
+	 */
+	inline bool validate( const char* str , std::size_t len , std::size_t* error_offset = nullptr ) noexcept
+	{
+		const unsigned char*	begin = reinterpret_cast<const unsigned char*>( str );
+		const unsigned char*	end = begin + len;
+		std::size_t				num_codepoints = 0;
+		std::size_t				num_multibytes = 0;
+		const unsigned char*	iter = tiny_utf8_detail::skip_valid( begin , end , num_codepoints , num_multibytes );
+		if( error_offset )
+			*error_offset = iter - begin;
+		return iter == end;
+	}
+	
+	inline simd_level get_simd_level() noexcept {
+		const tiny_utf8_detail::kernel_table* table = tiny_utf8_detail::active_kernel_table().load( std::memory_order_relaxed );
+		return simd_level( table - &tiny_utf8_detail::get_kernel_table( simd_level::scalar ) );
+	}
+	
+	inline simd_level get_max_simd_level() noexcept {
+		static const simd_level level = tiny_utf8_detail::detect_simd_level();
+		return level;
+	}
+	
+	inline simd_level set_simd_level( simd_level level ) noexcept {
+		level = std::min( level , get_max_simd_level() );
+		tiny_utf8_detail::active_kernel_table().store( &tiny_utf8_detail::get_kernel_table( level ) , std::memory_order_relaxed );
+		return level;
+	}
+	
+	inline stats get_stats() noexcept {
+		#if TINY_UTF8_STATS
+			return tiny_utf8_detail::thread_stats();
+		#else
+			return stats();
+		#endif
+	}
+	
+	inline stats reset_stats() noexcept {
+		#if TINY_UTF8_STATS
+			stats result = tiny_utf8_detail::thread_stats();
+			tiny_utf8_detail::thread_stats() = stats();
+			return result;
+		#else
+			return stats();
+		#endif
 	}
 
 
@@ -282,7 +2105,7 @@ namespace tiny_utf8
 	template<typename Container, bool Raw>
 	struct iterator_base
 	{
-		template<typename, typename, typename>
+		template<typename, typename, typename, std::size_t, bool>
 		friend class basic_string;
 
 	public:
@@ -343,7 +2166,7 @@ namespace tiny_utf8
 	template<typename Container>
 	struct iterator_base<Container, true>
 	{
-		template<typename, typename, typename>
+		template<typename, typename, typename, std::size_t, bool>
 		friend class basic_string;
 		
 	public:	
@@ -698,9 +2521,14 @@ namespace tiny_utf8
 		typename ValueType
 		, typename DataType
 		, typename Allocator
+		, std::size_t SSOCapacity
+		, bool CopyOnWrite
 	>
 	class basic_string : private Allocator
 	{
+		static_assert( SSOCapacity <= 127 , "tiny_utf8::basic_string: The SSO capacity must not exceed 127 bytes" );
+		static_assert( !CopyOnWrite || sizeof(std::atomic<typename std::allocator_traits<Allocator>::size_type>) == sizeof(typename std::allocator_traits<Allocator>::size_type) , "tiny_utf8::basic_string: The reference count must fit into one size_type" );
+		
 	public:
 		
 		typedef DataType													data_type;
@@ -725,12 +2553,26 @@ namespace tiny_utf8
 		typedef size_type													indicator_type; // Typedef for the lut indicator. Note: Don't change this, because else the buffer will not be a multiple of sizeof(size_type)
 		enum : size_type{													npos = (size_type)-1 };
 		
+		template<typename>
+		friend class basic_stream_decoder;
+		template<typename>
+		friend class basic_gap_string;
+		template<typename String>
+		friend String load_file( std::FILE* , bool* ) noexcept(TINY_UTF8_NOEXCEPT) ;
+		#if TINY_UTF8_HAS_POSIX_IO
+		template<typename String>
+		friend String load_file( int , bool* ) noexcept(TINY_UTF8_NOEXCEPT) ;
+		#endif
+		
 	protected: //! Layout specifications
 		
 		/*
 		 * To determine, which layout is active, read either t_sso.data_len, or the last byte of t_non_sso.buffer_size:
 		 * LSB == 0  =>  SSO
 		 * LSB == 1  =>  NON-SSO
+		 * 
+		 * If the SSO capacity exceeds sizeof(NON_SSO)-1, t_sso.data_len lies behind NON_SSO and is flagged manually (see set_non_sso_string_len).
+		 * Smaller capacities than sizeof(NON_SSO)-1 are rounded up, since the object cannot become smaller than NON_SSO anyway.
 		 */
 		
 		// Layout used, if sso is inactive
@@ -745,7 +2587,7 @@ namespace tiny_utf8
 		// Layout used, if sso is active
 		struct SSO
 		{
-			enum : size_type{	size = sizeof(NON_SSO)-1 };
+			enum : size_type{	size = SSOCapacity > sizeof(NON_SSO)-1 ? SSOCapacity : sizeof(NON_SSO)-1 };
 			data_type			data[size];
 			unsigned char		data_len; // This field holds ( size - num_characters ) << 1
 			
@@ -771,6 +2613,10 @@ namespace tiny_utf8
 		//! Get the maximum number of bytes (excluding the trailing '\0') that can be stored within a basic_string object
 		static constexpr inline size_type	get_sso_capacity() noexcept { return SSO::size; }
 		
+		//! Get the reference count of a heap buffer (only present, if copy-on-write is enabled)
+		typedef std::atomic<size_type>		ref_count_type;
+		static inline ref_count_type&		get_ref_count( const data_type* buffer ) noexcept { return const_cast<ref_count_type*>( reinterpret_cast<const ref_count_type*>( buffer ) )[-1]; }
+		
 		//! SFINAE helpers for constructors
 		template<size_type L>
 		using enable_if_small_string = typename std::enable_if<( L <= SSO::size ), bool>::type;
@@ -805,9 +2651,12 @@ namespace tiny_utf8
 		static inline data_type*			get_lut_base_ptr( data_type* buffer , size_type buffer_size ) noexcept { return buffer + buffer_size; }
 		static inline const data_type*		get_lut_base_ptr( const data_type* buffer , size_type buffer_size ) noexcept { return buffer + buffer_size; }
 		
-		//! Construct the lut mode indicator
+		//! Construct the lut mode indicator: Bit 0 is set, if the lut is active, bit 1, if it is compressed (and bit 2, if it uses 2-byte deltas), the remaining bits hold the lut length
 		static inline void					set_lut_indiciator( data_type* lut_base_ptr , bool active , size_type lut_len = 0 ) noexcept {
-			*(indicator_type*)lut_base_ptr = active ? ( lut_len << 1 ) | 0x1 : 0;
+			*(indicator_type*)lut_base_ptr = active ? ( lut_len << 3 ) | 0x1 : 0;
+		}
+		static inline void					set_compressed_lut_indicator( data_type* lut_base_ptr , size_type lut_len , width_type delta_width ) noexcept {
+			*(indicator_type*)lut_base_ptr = ( lut_len << 3 ) | ( delta_width == sizeof(std::uint16_t) ? 0x4 : 0x0 ) | 0x3;
 		}
 		//! Copy lut indicator
 		static inline void					copy_lut_indicator( data_type* dest , const data_type* source ) noexcept {
@@ -816,12 +2665,13 @@ namespace tiny_utf8
 		
 		//! Determine, whether we will use a 'std::uint8_t', 'std::uint16_t', 'std::uint32_t' or 'std::uint64_t'-based index table.
 		//! Returns the number of bytes of the destination data type
+		//! Note: Computes in 64 bits, since 'max() + 1' would overflow a 32-bit size_type
 		static inline width_type			get_lut_width( size_type buffer_size ) noexcept {
-			return buffer_size <= (size_type)std::numeric_limits<std::uint8_t>::max() + 1
+			return (std::uint64_t)buffer_size <= (std::uint64_t)std::numeric_limits<std::uint8_t>::max() + 1
 				? sizeof(std::uint8_t)
-				: buffer_size <= (size_type)std::numeric_limits<std::uint16_t>::max() + 1
+				: (std::uint64_t)buffer_size <= (std::uint64_t)std::numeric_limits<std::uint16_t>::max() + 1
 					? sizeof(std::uint16_t)
-					: buffer_size <= (size_type)std::numeric_limits<std::uint32_t>::max() + 1
+					: (std::uint64_t)buffer_size <= (std::uint64_t)std::numeric_limits<std::uint32_t>::max() + 1
 						? sizeof(std::uint32_t)
 						: sizeof(std::uint64_t)
 			;
@@ -834,27 +2684,63 @@ namespace tiny_utf8
 			return size_type( pot_lut_len - 1 ) < threshold;
 		}
 		
+		//! Get the largest buffer size (excluding the trailling LUT indicator), whose total buffer size still fits into size_type
+		static constexpr size_type			get_max_buffer_size() noexcept {
+			return ( std::numeric_limits<size_type>::max() - sizeof(indicator_type) ) / sizeof(size_type) * sizeof(size_type);
+		}
+		
 		//! Determine the needed buffer size and the needed lut width (excluding the trailling LUT indicator)
+		//! Buffer sizes exceeding get_max_buffer_size() are reported as std::numeric_limits<size_type>::max() (see allocate)
 		static inline size_type				determine_main_buffer_size( size_type data_len , size_type lut_len , width_type* lut_width ) noexcept {
+			*lut_width = sizeof(size_type);
+			if( data_len >= get_max_buffer_size() )
+				return std::numeric_limits<size_type>::max();
 			size_type width_guess	= get_lut_width( ++data_len ); // Don't forget, we need a terminating '\0', distinct from the lut indicator
+			if( lut_len > ( get_max_buffer_size() - data_len ) / width_guess )
+				return std::numeric_limits<size_type>::max();
 			data_len += lut_len * width_guess; // Add the estimated number of bytes from the lut
-			data_len += lut_len * ( ( *lut_width = get_lut_width( data_len ) ) - width_guess ); // Adjust the added bytes from the lut
+			width_type width = *lut_width = get_lut_width( data_len );
+			if( width > width_guess && lut_len > ( get_max_buffer_size() - data_len ) / ( width - width_guess ) )
+				return std::numeric_limits<size_type>::max();
+			data_len += lut_len * ( width - width_guess ); // Adjust the added bytes from the lut
 			return round_up_to_align( data_len ); // Make the buffer size_type-aligned
 		}
 		//! Determine the needed buffer size if the lut width is known (excluding the trailling LUT indicator)
 		static inline size_type				determine_main_buffer_size( size_type data_len , size_type lut_len , width_type lut_width ) noexcept {
+			if( data_len >= get_max_buffer_size() || lut_len > ( get_max_buffer_size() - data_len - 1 ) / lut_width )
+				return std::numeric_limits<size_type>::max();
 			return round_up_to_align( data_len + 1 + lut_len * lut_width ); // Compute the size_type-aligned buffer size
 		}
 		//! Determine the needed buffer size if the lut is empty (excluding the trailling LUT indicator)
 		static inline size_type				determine_main_buffer_size( size_type data_len ) noexcept {
+			if( data_len >= get_max_buffer_size() )
+				return std::numeric_limits<size_type>::max();
 			return round_up_to_align( data_len + 1 ); // Make the buffer size_type-aligned
 		}
 		
 		//! Same as above but this time including the LUT indicator
 		static inline size_type				determine_total_buffer_size( size_type main_buffer_size ) noexcept {
+			if( main_buffer_size > get_max_buffer_size() )
+				return std::numeric_limits<size_type>::max(); // Too large
 			return main_buffer_size + sizeof(indicator_type); // Add the lut indicator
 		}
 		
+		//! Doubles the supplied buffer size in order to amortize allocations (keeping in mind alignment and get_max_buffer_size())
+		static inline size_type				grow_buffer_size( size_type main_buffer_size ) noexcept {
+			if( main_buffer_size > get_max_buffer_size() )
+				return main_buffer_size; // Too large already
+			return main_buffer_size <= get_max_buffer_size() / 2 ? main_buffer_size << 1 : get_max_buffer_size();
+		}
+		
+		//! Narrows the size of foreign data to size_type (fails, if it exceeds max_size())
+		static inline size_type				narrow_data_len( std::size_t data_len ) noexcept(TINY_UTF8_NOEXCEPT) {
+			if( (std::uint64_t)data_len > (std::uint64_t)( get_max_buffer_size() - 1 ) ){
+				TINY_UTF8_THROW( "tiny_utf8::basic_string" , data_len > max_size() );
+				return 0;
+			}
+			return size_type( data_len );
+		}
+		
 		//! Get the nth index within a multibyte index table
 		static inline size_type				get_lut( const data_type* iter , width_type lut_width ) noexcept {
 			switch( lut_width ){
@@ -873,16 +2759,219 @@ namespace tiny_utf8
 			}
 		}
 		
+		//! Pushes the positions of the multibytes in the utf8 [run,run_end) (that a kernel wrote at once) to the lut at 'lut_iter'
+		static inline void					set_lut_of_run( const data_type* buffer , const data_type* run , const data_type* run_end , data_type*& lut_iter , width_type lut_width ) noexcept {
+			const unsigned char* iter = reinterpret_cast<const unsigned char*>( run );
+			const unsigned char* end = reinterpret_cast<const unsigned char*>( run_end );
+			while( ( iter = tiny_utf8_detail::skip_ascii( iter , end ) ) < end ){
+				basic_string::set_lut( lut_iter -= lut_width , lut_width , reinterpret_cast<const data_type*>( iter ) - buffer );
+				iter += get_codepoint_bytes( data_type( *iter ) , end - iter );
+			}
+		}
+		
 		//! Get the LUT size (given the lut is active!)
 		static inline size_type				get_lut_len( const data_type* lut_base_ptr ) noexcept {
-			return *(indicator_type*)lut_base_ptr >> 1;
+			return *(indicator_type*)lut_base_ptr >> 3;
+		}
+		
+		/*
+		 * Compressed luts replace the lut of large strings, where indices would be 4 or 8 bytes wide. They are picked, whenever a buffer of exact size is built
+		 * (i.e. on construction from utf8 data, deserialize and shrink_to_fit) and the compressed lut is smaller than a plain one.
+		 * The data is split into blocks of 256 (resp. 65536) bytes, so an index consists of its block and a 1-byte (resp. 2-byte) delta:
+		 * [ <data::char>... | '0'::char | <delta::1 or 2 bytes>... | <number of indices up to the end of a block::lut_width>... | <lut_indicator::size_type> ]
+		 * The block table is stored next to the indicator (keeping it aligned) and is used to find the indices of a byte range in O(log n).
+		 * Appending extends the last block (see raw_append), all other modifications decompress the lut first (see make_writable).
+		 */
+		
+		//! Check, whether an active lut is compressed
+		static inline bool					is_lut_compressed( const data_type* lut_base_ptr ) noexcept { return *(const indicator_type*)lut_base_ptr & 0x2; }
+		
+		//! Get the number of bytes per delta of a compressed lut
+		static inline width_type			get_lut_delta_width( const data_type* lut_base_ptr ) noexcept {
+			return *(const indicator_type*)lut_base_ptr & 0x4 ? sizeof(std::uint16_t) : sizeof(std::uint8_t);
+		}
+		
+		//! Get the number of blocks of a compressed lut
+		static inline size_type				get_num_lut_blocks( size_type data_len , width_type delta_width ) noexcept {
+			return ( data_len >> ( 8 * delta_width ) ) + 1;
+		}
+		
+		//! Get the number of bytes occupied by a lut (excluding the lut indicator)
+		static inline size_type				get_lut_size( const data_type* lut_base_ptr , size_type data_len , width_type lut_width ) noexcept {
+			size_type lut_len = basic_string::get_lut_len( lut_base_ptr );
+			if( !basic_string::is_lut_compressed( lut_base_ptr ) )
+				return lut_len * lut_width;
+			width_type delta_width = basic_string::get_lut_delta_width( lut_base_ptr );
+			return basic_string::get_num_lut_blocks( data_len , delta_width ) * lut_width + lut_len * delta_width;
+		}
+		
+		//! Determine the needed buffer size, lut width and delta width of a compressed lut (returns 0, if compressing the lut does not pay off)
+		static size_type					determine_compressed_buffer_size( size_type data_len , size_type lut_len , width_type* lut_width , width_type* delta_width ) noexcept ;
+		
+		//! Determine the needed buffer size and lut width of a compressed lut with the supplied delta width
+		static size_type					determine_compressed_buffer_size( size_type data_len , size_type lut_len , width_type delta_width , width_type* lut_width ) noexcept ;
+		
+		//! Reads the indices of a compressed lut in ascending order
+		class compressed_lut_reader
+		{
+			const data_type*	t_lut_base_ptr;
+			const data_type*	t_delta_base_ptr;
+			const data_type*	t_delta_iter; // Points behind the delta of the next index
+			size_type			t_num_blocks;
+			size_type			t_block; // Block of the next index
+			size_type			t_block_end; // Number of indices up to the end of 't_block'
+			size_type			t_index; // Number of the next index
+			width_type			t_lut_width;
+			width_type			t_delta_width;
+			
+			//! Get the number of indices up to the end of the supplied block
+			size_type get_block_end( size_type block ) const noexcept { return basic_string::get_lut( t_lut_base_ptr - ( block + 1 ) * t_lut_width , t_lut_width ); }
+			
+		public:
+			
+			//! Constructor (positions the reader at the first index)
+			compressed_lut_reader( const data_type* lut_base_ptr , size_type data_len , width_type lut_width ) noexcept :
+				t_lut_base_ptr( lut_base_ptr )
+				, t_num_blocks( basic_string::get_num_lut_blocks( data_len , basic_string::get_lut_delta_width( lut_base_ptr ) ) )
+				, t_block( 0 )
+				, t_index( 0 )
+				, t_lut_width( lut_width )
+				, t_delta_width( basic_string::get_lut_delta_width( lut_base_ptr ) )
+			{
+				t_delta_base_ptr = t_delta_iter = lut_base_ptr - t_num_blocks * lut_width;
+				t_block_end = get_block_end( 0 );
+			}
+			
+			//! Get the number of the next index
+			size_type index() const noexcept { return t_index; }
+			
+			//! Positions the reader at the first index not below 'byte_index'
+			void seek( size_type byte_index ) noexcept {
+				size_type block = byte_index >> ( 8 * t_delta_width );
+				if( block >= t_num_blocks ){
+					t_block = t_num_blocks - 1;
+					t_index = t_block_end = get_block_end( t_block );
+				}
+				else{
+					size_type	delta = byte_index & ( ( size_type(1) << ( 8 * t_delta_width ) ) - 1 );
+					size_type	first = block ? get_block_end( block - 1 ) : 0;
+					size_type	last = get_block_end( block );
+					t_block = block;
+					t_block_end = last;
+					while( first < last ){ // Binary search for the first delta not below 'delta'
+						size_type mid = first + ( last - first ) / 2;
+						if( basic_string::get_lut( t_delta_base_ptr - ( mid + 1 ) * t_delta_width , t_delta_width ) < delta )
+							first = mid + 1;
+						else
+							last = mid;
+					}
+					t_index = first;
+				}
+				t_delta_iter = t_delta_base_ptr - t_index * t_delta_width;
+			}
+			
+			//! Positions the reader at the index with the supplied number
+			void seek_index( size_type index ) noexcept {
+				size_type first = 0;
+				size_type last = t_num_blocks - 1;
+				while( first < last ){ // Binary search for the first block ending behind 'index'
+					size_type mid = first + ( last - first ) / 2;
+					if( get_block_end( mid ) <= index )
+						first = mid + 1;
+					else
+						last = mid;
+				}
+				t_block = first;
+				t_block_end = get_block_end( first );
+				t_index = index;
+				t_delta_iter = t_delta_base_ptr - index * t_delta_width;
+			}
+			
+			//! Returns the next index (make sure, there is one!)
+			size_type next() noexcept {
+				while( t_index >= t_block_end )
+					t_block_end = get_block_end( ++t_block );
+				++t_index;
+				return ( t_block << ( 8 * t_delta_width ) ) | basic_string::get_lut( t_delta_iter -= t_delta_width , t_delta_width );
+			}
+		};
+		
+		//! Returns the indices of the multibytes within utf8 data in ascending order
+		class multibyte_scanner
+		{
+			const data_type*	t_begin;
+			const data_type*	t_iter;
+			const data_type*	t_end;
+		
+		public:
+			
+			//! Constructor (positions the scanner at byte 'index')
+			multibyte_scanner( const data_type* data , size_type data_len , size_type index = 0 ) noexcept :
+				t_begin( data )
+				, t_iter( data + index )
+				, t_end( data + data_len )
+			{}
+			
+			//! Returns the next index (make sure, there is one!)
+			size_type operator()() noexcept {
+				for( ;; ){
+					t_iter = reinterpret_cast<const data_type*>( tiny_utf8_detail::skip_ascii( reinterpret_cast<const unsigned char*>( t_iter ) , reinterpret_cast<const unsigned char*>( t_end ) ) );
+					if( t_iter == t_end ) // Only reached, if a truncated codepoint at the end was counted as multibyte
+						return t_end - t_begin;
+					width_type bytes = basic_string::get_codepoint_bytes( *t_iter , t_end - t_iter );
+					t_iter += bytes;
+					if( bytes > 1 )
+						return t_iter - bytes - t_begin;
+				}
+			}
+		};
+		
+		/**
+		 * Writes indices into a compressed lut (the indicator is left untouched)
+		 * 
+		 * @param	lut_base_ptr	The lut base ptr of the buffer
+		 * @param	num_blocks		The number of blocks of the lut (see get_num_lut_blocks)
+		 * @param	first_index		The number of indices preceding the written ones
+		 * @param	num_indices		The number of indices to write, each of which is obtained by calling 'next_index()' (in ascending order)
+		 * @param	block			The first block, whose entry in the block table is written (the ones before must already be set)
+		 * @param	end_block		The block behind the last written entry of the block table
+		 */
+		template<typename NextIndex>
+		static inline void					write_compressed_lut( data_type* lut_base_ptr , width_type lut_width , width_type delta_width , size_type num_blocks , size_type first_index , size_type num_indices , NextIndex&& next_index , size_type block , size_type end_block ) noexcept {
+			width_type	shift = 8 * delta_width;
+			data_type*	delta_iter = lut_base_ptr - num_blocks * lut_width - first_index * delta_width;
+			size_type	index = first_index;
+			for( size_type end_index = first_index + num_indices ; index < end_index ; ++index ){
+				size_type multibyte_index = next_index();
+				for( ; block < ( multibyte_index >> shift ) ; ++block )
+					basic_string::set_lut( lut_base_ptr - ( block + 1 ) * lut_width , lut_width , index );
+				basic_string::set_lut( delta_iter -= delta_width , delta_width , multibyte_index & ( ( size_type(1) << shift ) - 1 ) );
+			}
+			for( ; block < end_block ; ++block )
+				basic_string::set_lut( lut_base_ptr - ( block + 1 ) * lut_width , lut_width , index );
 		}
 		
 		/**
 		 * Returns the number of code units (bytes) using the supplied first byte of a utf8 codepoint
 		 */
 		// Data left is the number of bytes left in the buffer INCLUDING this one
-		#if TINY_UTF8_HAS_CLZ
+		#if TINY_UTF8_STRICT_4BYTE
+		static inline width_type			get_codepoint_bytes( data_type first_byte , size_type data_left ) noexcept 
+		{
+			#if TINY_UTF8_HAS_CLZ
+				// Count the leading ones (see below) and treat lead bytes of 5 or more bytes as 4-byte sequences
+				size_type codepoint_bytes = tiny_utf8_detail::clz( ~((unsigned int)first_byte << (sizeof(unsigned int)-1)*8 ) );
+				codepoint_bytes = codepoint_bytes < 4 ? codepoint_bytes : 4;
+			#else
+				unsigned char byte = (unsigned char)first_byte;
+				size_type codepoint_bytes = ( byte >= 0xC0 ) + ( byte >= 0xC0 ) + ( byte >= 0xE0 ) + ( byte >= 0xF0 );
+			#endif
+			// Zero (ascii) and one (continuation byte) wrap around, so that they yield 1 as well
+			if( size_type( codepoint_bytes - 1 ) < size_type(data_left) )
+				return (width_type)codepoint_bytes;
+			return 1;
+		}
+		#elif TINY_UTF8_HAS_CLZ
 		static inline width_type			get_codepoint_bytes( data_type first_byte , size_type data_left ) noexcept 
 		{
 			if( first_byte ){
@@ -905,7 +2994,9 @@ namespace tiny_utf8
 		 */
 		static inline width_type			get_codepoint_bytes( value_type cp ) noexcept
 		{
-			#if TINY_UTF8_HAS_CLZ
+			#if TINY_UTF8_STRICT_4BYTE
+				return 1 + ( cp > 0x7F ) + ( cp > 0x7FF ) + ( cp > 0xFFFF );
+			#elif TINY_UTF8_HAS_CLZ
 				if( !cp )
 					return 1;
 				static const width_type lut[32] = {
@@ -934,8 +3025,60 @@ namespace tiny_utf8
 		//! Returns the number of bytes to expect before this one (including this one) that belong to this utf8 char
 		static width_type					get_num_bytes_of_utf8_char_before( const data_type* data_start , size_type index ) noexcept ;
 		
+		/**
+		 * Counts the codepoints and multibytes of the supplied utf8 data (ascii runs are skipped a word at a time).
+		 * If 'stop_at_incomplete' is true, counting stops before a trailing codepoint that exceeds the data.
+		 * 
+		 * @return	The number of bytes, the counted codepoints span
+		 */
+		static size_type					count_codepoints( const data_type* data , size_type data_len , size_type& string_len , size_type& num_multibytes , bool stop_at_incomplete = false ) noexcept ;
+		
+		//! Range of codepoints within a chunk of utf8 data (see scan_chunks)
+		struct chunk_info
+		{
+			size_type	begin;			// Index of the first codepoint in the chunk
+			size_type	end;			// Index after the last codepoint in the chunk
+			size_type	string_len;		// Number of codepoints in the chunk
+			size_type	num_multibytes;	// Number of multibytes in the chunk
+		};
+		
+		//! Returns the nominal start of the chunk 'index', when splitting 'data_len' bytes into 'num_chunks' chunks
+		static inline size_type				get_chunk_start( size_type data_len , unsigned int index , unsigned int num_chunks ) noexcept {
+			return index < num_chunks ? size_type( (unsigned long long)data_len * index / num_chunks ) : data_len;
+		}
+		
+		//! Counts the codepoints and multibytes that start within [begin,stop) (the last one might exceed 'stop')
+		static void							scan_chunk( const data_type* data , size_type data_len , chunk_info& chunk , size_type begin , size_type stop ) noexcept ;
+		
+		/**
+		 * Splits utf8 data into chunks and counts the codepoints and multibytes of all chunks concurrently.
+		 * After a chunk has been counted, 'func( index )' is called from within the same thread.
+		 * 
+		 * @note	Chunks start at the first non-continuation byte after their nominal start (see get_chunk_start).
+		 *			Chunks that do not continue where their predecessor ended (only possible for malformed utf8) are rescanned
+		 *			afterwards, so that the chunks always partition the data exactly like a serial decoding would.
+		 */
+		template<typename Func>
+		static void							scan_chunks( const data_type* data , size_type data_len , chunk_info* chunks , unsigned int num_chunks , Func func ) noexcept(TINY_UTF8_NOEXCEPT) ;
+		
+		//! Returns the first occurrence of 'pattern' in [begin,end) or nullptr
+		static const data_type*				find_bytes( const data_type* begin , const data_type* end , const data_type* pattern , size_type pattern_len ) noexcept ;
+		
+		//! Byte-based implementations of parallel_find and parallel_count
+		size_type							parallel_find( const data_type* pattern , size_type pattern_len , size_type start_codepoint , parallel_t par ) const noexcept(TINY_UTF8_NOEXCEPT) ;
+		size_type							parallel_count( const data_type* pattern , size_type pattern_len , parallel_t par ) const noexcept(TINY_UTF8_NOEXCEPT) ;
+		
 		//! Decodes a given input of rle utf8 data to a unicode codepoint, given the number of bytes it's made of
 		static inline value_type			decode_utf8( const data_type* data , width_type num_bytes ) noexcept {
+			#if TINY_UTF8_STRICT_4BYTE
+			const unsigned char* bytes = reinterpret_cast<const unsigned char*>( data );
+			switch( num_bytes ){
+				case 4:	return ( value_type( bytes[0] & 0x07 ) << 18 ) | ( value_type( bytes[1] & 0x3F ) << 12 ) | ( value_type( bytes[2] & 0x3F ) << 6 ) | ( bytes[3] & 0x3F );
+				case 3:	return ( value_type( bytes[0] & 0x0F ) << 12 ) | ( value_type( bytes[1] & 0x3F ) << 6 ) | ( bytes[2] & 0x3F );
+				case 2:	return ( value_type( bytes[0] & 0x1F ) << 6 ) | ( bytes[1] & 0x3F );
+				default: return bytes[0];
+			}
+			#else
 			value_type cp = (unsigned char)*data;
 			if( num_bytes > 1 ){
 				cp &= 0x7F >> num_bytes; // Mask out the header bits
@@ -943,6 +3086,7 @@ namespace tiny_utf8
 					cp = ( cp << 6 ) | ( (unsigned char)data[i] & 0x3F );
 			}
 			return cp;
+			#endif
 		}
 		
 		/**
@@ -961,6 +3105,28 @@ namespace tiny_utf8
 		 * buffer capable of holding that many bytes.
 		 */
 		inline static void					encode_utf8( value_type cp , data_type* dest , width_type cp_bytes ) noexcept {
+			#if TINY_UTF8_STRICT_4BYTE
+			switch( cp_bytes ){
+				case 4:
+					dest[0] = data_type( 0xF0 | ( ( cp >> 18 ) & 0x07 ) );
+					dest[1] = data_type( 0x80 | ( ( cp >> 12 ) & 0x3F ) );
+					dest[2] = data_type( 0x80 | ( ( cp >> 6 ) & 0x3F ) );
+					dest[3] = data_type( 0x80 | ( cp & 0x3F ) );
+					return;
+				case 3:
+					dest[0] = data_type( 0xE0 | ( cp >> 12 ) );
+					dest[1] = data_type( 0x80 | ( ( cp >> 6 ) & 0x3F ) );
+					dest[2] = data_type( 0x80 | ( cp & 0x3F ) );
+					return;
+				case 2:
+					dest[0] = data_type( 0xC0 | ( cp >> 6 ) );
+					dest[1] = data_type( 0x80 | ( cp & 0x3F ) );
+					return;
+				default:
+					dest[0] = data_type( cp );
+					return;
+			}
+			#else
 			switch( cp_bytes ){
 				case 7: dest[cp_bytes-6] = 0x80 | ((cp >> 30) & 0x3F); TINY_UTF8_FALLTHROUGH
 				case 6: dest[cp_bytes-5] = 0x80 | ((cp >> 24) & 0x3F); TINY_UTF8_FALLTHROUGH
@@ -974,6 +3140,7 @@ namespace tiny_utf8
 					dest[0] = (unsigned char)cp;
 					break;
 			}
+			#endif
 		}
 		
 		/**
@@ -986,6 +3153,40 @@ namespace tiny_utf8
 			return width;
 		}
 		
+		/**
+		 * Encodes 'len' codepoints to utf8 (narrowing runs of codepoints up to U+FFFF with the kernel of the current simd level) and returns the end of the written data.
+		 * If 'lut_width' is non-zero, the position of every multibyte is written to the lut below 'lut_iter'.
+		 */
+		static data_type*					encode_utf8( const value_type* str , size_type len , data_type* dest , data_type* lut_iter , width_type lut_width ) noexcept ;
+		
+		//! Computes the number of bytes and multibytes, 'len' codepoints will translate to in utf8
+		static void							count_utf8_bytes( const value_type* str , size_type len , size_type& data_len , size_type& num_multibytes ) noexcept ;
+		
+		/**
+		 * Decodes at most 'max_codepoints' codepoints of the utf8 data [data,data+data_len) to 'dest' (widening ascii runs at once)
+		 * and returns the number of codepoints written
+		 */
+		static size_type					decode_utf8( const data_type* data , size_type data_len , value_type* dest , size_type max_codepoints ) noexcept ;
+		
+		/**
+		 * Decodes the utf16 sequence at 'str' (which must be before 'end') to a codepoint and returns the number of code units it used.
+		 * Unpaired surrogates are decoded as they are (as the utf32 constructor would encode them).
+		 */
+		static inline width_type			decode_utf16( const char16_t* str , const char16_t* end , value_type& cp ) noexcept {
+			cp = *str;
+			if( ( cp & 0xFC00 ) == 0xD800 && end - str > 1 && ( str[1] & 0xFC00 ) == 0xDC00 ){
+				cp = 0x10000 + ( ( cp & 0x3FF ) << 10 ) + ( str[1] & 0x3FF );
+				return 2;
+			}
+			return 1;
+		}
+		
+		//! Computes the number of bytes, codepoints and multibytes, 'len' utf16 code units will translate to in utf8
+		static void							count_utf8_bytes( const char16_t* str , size_type len , size_type& data_len , size_type& string_len , size_type& num_multibytes ) noexcept ;
+		
+		//! Encodes 'len' utf16 code units to utf8 (see encode_utf8 for utf32 input)
+		static data_type*					encode_utf8( const char16_t* str , size_type len , data_type* dest , data_type* lut_iter , width_type lut_width ) noexcept ;
+		
 	protected: //! Non-static helper methods
 		
 		//! Set the main buffer size (also disables SSO)
@@ -1056,28 +3257,127 @@ namespace tiny_utf8
 		std::basic_string<data_type> cpp_str_bom() const noexcept ;
 		
 		//! Allocates size_type-aligned storage (make sure, total_buffer_size is a multiple of sizeof(size_type)!)
-		inline data_type*		allocate( size_type total_buffer_size ) const noexcept {
+		//! If copy-on-write is enabled, the buffer is preceded by its reference count (initialized to 1)
+		//! Fails, if the buffer size exceeds the range of size_type (see determine_main_buffer_size)
+		inline data_type*		allocate( size_type total_buffer_size ) const noexcept(TINY_UTF8_NOEXCEPT) {
+			if( total_buffer_size > basic_string::determine_total_buffer_size( basic_string::get_max_buffer_size() ) ){
+				TINY_UTF8_THROW( "tiny_utf8::basic_string::allocate" , total_buffer_size > max_size() );
+				return nullptr;
+			}
 			using appropriate_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<size_type>;
 			appropriate_allocator	casted_allocator = (const Allocator&)*this;
-			return reinterpret_cast<data_type*>(
-				std::allocator_traits<appropriate_allocator>::allocate(
-					casted_allocator
-					, total_buffer_size / sizeof(size_type) * sizeof(data_type)
-				)
+			size_type*				buffer = std::allocator_traits<appropriate_allocator>::allocate(
+				casted_allocator
+				, total_buffer_size / sizeof(size_type) * sizeof(data_type) + CopyOnWrite
 			);
+			if( CopyOnWrite && buffer )
+				new( buffer++ ) ref_count_type( 1 );
+			TINY_UTF8_COUNT( allocations , 1 );
+			TINY_UTF8_COUNT( bytes_allocated , total_buffer_size );
+			return reinterpret_cast<data_type*>( buffer );
 		}
 		
 		//! Allocates size_type-aligned storage (make sure, buffer_size is a multiple of sizeof(size_type)!)
+		//! If copy-on-write is enabled, this only releases one reference to the buffer
 		inline void			deallocate( data_type* buffer , size_type buffer_size ) const noexcept {
 			using appropriate_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<size_type>;
 			appropriate_allocator	casted_allocator = (const Allocator&)*this;
+			if( CopyOnWrite && basic_string::get_ref_count( buffer ).fetch_sub( 1 , std::memory_order_acq_rel ) != 1 )
+				return;
+			TINY_UTF8_COUNT( deallocations , 1 );
 			std::allocator_traits<appropriate_allocator>::deallocate(
 				casted_allocator
-				, reinterpret_cast<size_type*>( buffer )
-				, basic_string::determine_total_buffer_size( buffer_size ) / sizeof(size_type) * sizeof(data_type)
+				, reinterpret_cast<size_type*>( buffer ) - CopyOnWrite
+				, basic_string::determine_total_buffer_size( buffer_size ) / sizeof(size_type) * sizeof(data_type) + CopyOnWrite
 			);
 		}
 		
+		//! Shares the heap buffer of 'str' (whose layout was copied to this basic_string already), if copy-on-write is enabled and the allocators are equal
+		inline bool				share_buffer( const basic_string& str ) const noexcept {
+			if( !CopyOnWrite || !( (const Allocator&)*this == (const Allocator&)str ) )
+				return false;
+			basic_string::get_ref_count( str.t_non_sso.data ).fetch_add( 1 , std::memory_order_relaxed );
+			return true;
+		}
+		
+		//! Makes sure, the heap buffer is not shared with other basic_strings, before it is modified in place
+		inline bool				unshare() noexcept(TINY_UTF8_NOEXCEPT) {
+			return !CopyOnWrite
+				|| sso_active()
+				|| basic_string::get_ref_count( t_non_sso.data ).load( std::memory_order_acquire ) == 1
+				|| unshare_buffer();
+		}
+		
+		//! Replaces the (shared) heap buffer with a copy of it
+		bool					unshare_buffer() noexcept(TINY_UTF8_NOEXCEPT) ;
+		
+		//! Check, whether the data is stored on the heap along with a compressed lut
+		inline bool				has_compressed_lut() const noexcept {
+			return sso_inactive() && basic_string::is_lut_compressed( basic_string::get_lut_base_ptr( t_non_sso.data , t_non_sso.buffer_size ) );
+		}
+		
+		//! Makes sure, the heap buffer may be modified in place, i.e. it is not shared and its lut is not compressed
+		inline bool				make_writable() noexcept(TINY_UTF8_NOEXCEPT) {
+			if( has_compressed_lut() )
+				return decompress_lut(); // This also replaces a shared buffer
+			return unshare();
+		}
+		
+		//! Replaces the heap buffer with one holding the decompressed lut
+		bool					decompress_lut() noexcept(TINY_UTF8_NOEXCEPT) ;
+		
+		/**
+		 * Replaces the contents of this basic_string with bytes extracted from the supplied stream buffer.
+		 * Extraction stops before the first byte, for which 'is_delimiter' returns true, after 'max_bytes'
+		 * bytes or at the end of the stream (in which case 'reached_eof' is set).
+		 * 
+		 * @note	The bytes are written straight into the buffer of this basic_string, while the LUT is built alongside.
+		 * @return	The number of extracted bytes
+		 */
+		template<typename Delimiter>
+		size_type				extract( std::streambuf* buf , size_type max_bytes , Delimiter is_delimiter , bool& reached_eof ) noexcept(TINY_UTF8_NOEXCEPT) ;
+		
+		/**
+		 * Replaces the contents of this basic_string with data obtained through 'read( dest , count )', which returns the number of
+		 * bytes written to 'dest' (0 at the end of the input and npos on error). A leading UTF-8 BOM is stripped.
+		 * 
+		 * @note	If 'data_len' is known, the buffer is allocated upfront (with room for a lut of one entry per 64 bytes),
+		 *			the data is read directly into it and the lut is filled by the same pass that counts the codepoints.
+		 *			Only if a lut is worth it, but does not fit, the data is copied once into a buffer of the exact size.
+		 *			If the input turns out to be longer than 'data_len', reading fails.
+		 * @return	True on success, false if 'read' reported an error (or more than 'data_len' bytes)
+		 */
+		template<typename Reader>
+		bool					read_file( size_type data_len , Reader read ) noexcept(TINY_UTF8_NOEXCEPT) ;
+		
+		//! Appends utf8 data with known number of codepoints and multibytes. If supplied, the (active) lut of the appendix is used to locate its multibytes
+		basic_string&			raw_append( const data_type* app_buffer , size_type app_data_len , size_type app_string_len , size_type app_lut_len , const data_type* app_lut_base_ptr = nullptr , width_type app_lut_width = 0 ) noexcept(TINY_UTF8_NOEXCEPT) ;
+		
+		//! Same as raw_append, for a heap buffer with a compressed lut: The indices of the appendix extend the last block of the lut, which is kept compressed
+		basic_string&			raw_append_compressed( const data_type* app_buffer , size_type app_data_len , size_type app_string_len , size_type app_lut_len , const data_type* app_lut_base_ptr , width_type app_lut_width ) noexcept(TINY_UTF8_NOEXCEPT) ;
+		
+		/**
+		 * Sets up the buffer of an empty basic_string for 'data_len' bytes of utf8 data of known metrics that are about to be encoded into it
+		 * 
+		 * @note	If the lut is worth it, it is activated and 'lut_iter'/'lut_width' receive its base pointer and width (otherwise 'lut_width' is 0)
+		 * @return	The buffer to encode into (the trailing '\0' is not yet set) or nullptr, if the allocation failed
+		 */
+		data_type*				prepare_encoding( size_type data_len , size_type string_len , size_type num_multibytes , data_type*& lut_iter , width_type& lut_width ) noexcept(TINY_UTF8_NOEXCEPT) ;
+		
+		//! Copies resp. moves the allocator of 'str' to this basic_string, if it propagates on copy resp. move assignment
+		void					propagate_allocator( const basic_string& str , std::true_type ) noexcept(TINY_UTF8_NOEXCEPT) { (allocator_type&)*this = (const allocator_type&)str; }
+		void					propagate_allocator( basic_string&& str , std::true_type ) noexcept(TINY_UTF8_NOEXCEPT) { (allocator_type&)*this = (allocator_type&&)str; }
+		void					propagate_allocator( const basic_string& , std::false_type ) noexcept {}
+		
+		//! Fills an empty basic_string with the conversion of ISO-8859-1 (resp. Windows-1252, if 'cp1252' is true) encoded data
+		void					assign_single_byte( const char* str , size_type len , bool cp1252 ) noexcept(TINY_UTF8_NOEXCEPT) ;
+		
+		//! Converts this basic_string to ISO-8859-1 (resp. Windows-1252, if 'cp1252' is true)
+		std::string				to_single_byte( char replacement , bool cp1252 ) const noexcept(TINY_UTF8_NOEXCEPT) ;
+		
+		//! Fills an empty basic_string with utf8 data of known metrics (setting up the lut, if worth it)
+		void					assign_counted( const data_type* str , size_type data_len , size_type string_len , size_type num_multibytes ) noexcept(TINY_UTF8_NOEXCEPT) ;
+		
 		//! Constructs an basic_string from a character literal
 		basic_string( const data_type* str , size_type pos , size_type count , size_type data_left , const allocator_type& alloc , tiny_utf8_detail::read_codepoints_tag ) noexcept(TINY_UTF8_NOEXCEPT) ;
 		basic_string( const data_type* str , size_type count , const allocator_type& alloc , tiny_utf8_detail::read_bytes_tag ) noexcept(TINY_UTF8_NOEXCEPT) ;
@@ -1207,7 +3507,7 @@ namespace tiny_utf8
 		template<typename C, typename A>
 		inline basic_string( std::basic_string<data_type, C, A> str , const allocator_type& alloc = allocator_type() )
 			noexcept(TINY_UTF8_NOEXCEPT)
-			: basic_string( str.data() , str.size() , alloc , tiny_utf8_detail::read_bytes_tag() )
+			: basic_string( str.data() , basic_string::narrow_data_len( str.size() ) , alloc , tiny_utf8_detail::read_bytes_tag() )
 		{}
 		/**
 		 * Constructor taking an std::string
@@ -1220,13 +3520,65 @@ namespace tiny_utf8
 		template<typename C, typename A>
 		inline basic_string( std::basic_string<data_type, C, A> str , size_type len , const allocator_type& alloc = allocator_type() )
 			noexcept(TINY_UTF8_NOEXCEPT)
-			: basic_string( str.data() , 0 , len , str.size() , alloc , tiny_utf8_detail::read_codepoints_tag() )
+			: basic_string( str.data() , 0 , len , basic_string::narrow_data_len( str.size() ) , alloc , tiny_utf8_detail::read_codepoints_tag() )
 		{}
 		template<typename C, typename A>
 		inline basic_string( std::basic_string<data_type, C, A> str , size_type pos , size_type len , const allocator_type& alloc = allocator_type() )
 			noexcept(TINY_UTF8_NOEXCEPT)
-			: basic_string( str.data() , pos , len , str.size() , alloc , tiny_utf8_detail::read_codepoints_tag() )
+			: basic_string( str.data() , pos , len , basic_string::narrow_data_len( str.size() ) , alloc , tiny_utf8_detail::read_codepoints_tag() )
 		{}
+		/**
+		 * Constructor taking utf8 data of known size, that is validated according to RFC 3629
+		 * 
+		 * @note	The data is validated in the same pass that counts its codepoints and multibytes.
+		 *			Overlong forms, surrogates, codepoints above U+10FFFF and truncated sequences are rejected,
+		 *			in which case the constructed string is empty.
+		 * @param	str		The UTF-8 sequence to fill the basic_string with
+		 * @param	count	The number of bytes to read from 'str'
+		 * @param	policy	The validation policy (e.g. tiny_utf8::strict or tiny_utf8::strict_t( &valid ))
+		 * @param	alloc	(Optional) The allocator instance to use
+		 */
+		basic_string( const data_type* str , size_type count , strict_t policy , const allocator_type& alloc = allocator_type() ) noexcept(TINY_UTF8_NOEXCEPT) ;
+		/**
+		 * Constructor taking utf8 data of known size, that is repaired according to RFC 3629
+		 * 
+		 * @note	Every maximal subpart of an ill-formed sequence is replaced by U+FFFD. The size of the output, its codepoints
+		 *			and multibytes are determined in a single pass, after which the data is written (and the lut filled)
+		 *			directly into the final buffer.
+		 * @param	str		The UTF-8 sequence to fill the basic_string with
+		 * @param	count	The number of bytes to read from 'str'
+		 * @param	policy	The repair policy (e.g. tiny_utf8::repair or tiny_utf8::repair_t( &num_replacements ))
+		 * @param	alloc	(Optional) The allocator instance to use
+		 */
+		basic_string( const data_type* str , size_type count , repair_t policy , const allocator_type& alloc = allocator_type() ) noexcept(TINY_UTF8_NOEXCEPT) ;
+		/**
+		 * Constructor taking single-byte encoded data (ISO-8859-1 resp. Windows-1252) of known size
+		 * 
+		 * @note	The size of the output is computed upfront (counting the high bytes a word at a time),
+		 *			after which the data is converted (and the lut filled) directly into the final buffer.
+		 * @param	str		The ISO-8859-1 resp. Windows-1252 sequence to fill the basic_string with
+		 * @param	count	The number of bytes to read from 'str'
+		 * @param	alloc	(Optional) The allocator instance to use
+		 */
+		basic_string( const char* str , size_type count , latin1_t , const allocator_type& alloc = allocator_type() ) noexcept(TINY_UTF8_NOEXCEPT)
+			: basic_string( alloc )
+		{ assign_single_byte( str , count , false ); }
+		basic_string( const char* str , size_type count , cp1252_t , const allocator_type& alloc = allocator_type() ) noexcept(TINY_UTF8_NOEXCEPT)
+			: basic_string( alloc )
+		{ assign_single_byte( str , count , true ); }
+		/**
+		 * Constructor taking utf8 data of known size, that is processed by multiple threads
+		 * 
+		 * @note	The data is split into chunks at codepoint boundaries. The codepoints and multibytes of all chunks are counted
+		 *			concurrently, after which each thread copies its chunk into the final buffer and fills its part of the lut
+		 *			(the position of which is determined by the number of multibytes in all previous chunks).
+		 *			Small inputs (as determined by 'par') are processed by the calling thread alone.
+		 * @param	str		The UTF-8 sequence to fill the basic_string with
+		 * @param	count	The number of bytes to read from 'str'
+		 * @param	par		The parallelization settings (e.g. tiny_utf8::parallel)
+		 * @param	alloc	(Optional) The allocator instance to use
+		 */
+		basic_string( const data_type* str , size_type count , parallel_t par , const allocator_type& alloc = allocator_type() ) noexcept(TINY_UTF8_NOEXCEPT) ;
 		/**
 		 * Constructor that fills the string with a certain amount of codepoints
 		 * 
@@ -1285,8 +3637,8 @@ namespace tiny_utf8
 		{
 			std::memcpy( (void*)&this->t_sso , (void*)&str.t_sso , sizeof(SSO) ); // Copy data
 			
-			// Create a new buffer, if sso is not active
-			if( str.sso_inactive() ){
+			// Create a new buffer, if sso is not active (and the buffer can't be shared)
+			if( str.sso_inactive() && !share_buffer( str ) ){
 				size_type total_buffer_size = basic_string::determine_total_buffer_size( t_non_sso.buffer_size );
 				t_non_sso.data = this->allocate( total_buffer_size );
 				std::memcpy( t_non_sso.data , str.t_non_sso.data , total_buffer_size );
@@ -1305,8 +3657,8 @@ namespace tiny_utf8
 		{
 			std::memcpy( (void*)&this->t_sso , (void*)&str.t_sso , sizeof(SSO) ); // Copy data
 			
-			// Create a new buffer, if sso is not active
-			if( str.sso_inactive() ){
+			// Create a new buffer, if sso is not active (and the buffer can't be shared)
+			if( str.sso_inactive() && !share_buffer( str ) ){
 				size_type total_buffer_size = basic_string::determine_total_buffer_size( t_non_sso.buffer_size );
 				t_non_sso.data = this->allocate( total_buffer_size );
 				std::memcpy( t_non_sso.data , str.t_non_sso.data , total_buffer_size );
@@ -1321,6 +3673,14 @@ namespace tiny_utf8
 		 * @param	len		(Optional) The maximum number of codepoints to read from the sequence
 		 */
 		basic_string( const value_type* str , size_type len , const allocator_type& alloc = allocator_type() ) noexcept(TINY_UTF8_NOEXCEPT) ;
+		/**
+		 * Constructor taking an utf-16 sequence that will be converted to construct this basic_string
+		 * 
+		 * @note	Surrogate pairs are combined to a single codepoint, unpaired surrogates are kept as they are
+		 * @param	str		The utf-16 sequence to fill the basic_string with
+		 * @param	len		The number of code units to read from the sequence (npos, if 'str' is null-terminated)
+		 */
+		basic_string( const char16_t* str , size_type len , const allocator_type& alloc = allocator_type() ) noexcept(TINY_UTF8_NOEXCEPT) ;
 		template<typename T>
 		basic_string( T&& str , const allocator_type& alloc = allocator_type() , enable_if_ptr<T, value_type>* = {} )
 			noexcept(TINY_UTF8_NOEXCEPT)
@@ -1394,6 +3754,18 @@ namespace tiny_utf8
 			str.set_sso_data_len( 0u ); // Reset old string and enable its SSO-mode (which makes it not care about the buffer anymore)
 		}
 		
+		/**
+		 * Creates a basic_string from utf8 data of known size (without validating it)
+		 * 
+		 * @note	Unlike basic_string( str , len ), which reads 'len' codepoints, this reads exactly 'count' bytes
+		 * @param	str		The UTF-8 sequence to fill the basic_string with
+		 * @param	count	The number of bytes to read from 'str'
+		 * @param	alloc	(Optional) The allocator instance to use
+		 */
+		static inline basic_string from_bytes( const data_type* str , size_type count , const allocator_type& alloc = allocator_type() ) noexcept(TINY_UTF8_NOEXCEPT) {
+			return basic_string( str , count , alloc , tiny_utf8_detail::read_bytes_tag() );
+		}
+		
 		
 		/**
 		 * Destructor
@@ -1415,14 +3787,18 @@ namespace tiny_utf8
 		 * Move Assignment operator that moves all data out of the supplied and into this basic_string
 		 * 
 		 * @note	Moves all data from 'str' into this basic_string deleting all data that previously was in there
-		 *			The supplied basic_string is invalid afterwards and may not be used anymore
+		 *			The supplied basic_string is invalid afterwards and may not be used anymore.
+		 *			If the allocator does not propagate on move assignment (e.g. arena_allocator or std::pmr::polymorphic_allocator)
+		 *			and differs from the one of 'str', the data is copied instead.
 		 * @param	str		The basic_string to move from
 		 * @return	A reference to the string now holding the data (*this)
 		 */
 		inline basic_string& operator=( basic_string&& str ) noexcept(TINY_UTF8_NOEXCEPT && std::is_nothrow_move_assignable<Allocator>()) {
 			if( &str != this ){
+				if( !std::allocator_traits<Allocator>::propagate_on_container_move_assignment::value && (const allocator_type&)*this != (const allocator_type&)str )
+					return *this = (const basic_string&)str;
 				clear(); // Reset old data
-				(allocator_type&)*this = (allocator_type&&)str; // Move allocator
+				propagate_allocator( std::move(str) , typename std::allocator_traits<Allocator>::propagate_on_container_move_assignment() ); // Move allocator (if it propagates)
 				std::memcpy( (void*)&this->t_sso , (void*)&str.t_sso , sizeof(SSO) ); // Copy data
 				str.set_sso_data_len(0); // Reset old string and enable its SSO-mode (which makes it not care about the buffer anymore)
 			}
@@ -1453,6 +3829,9 @@ namespace tiny_utf8
 		
 		/**
 		 * Requests the removal of unused capacity.
+		 * 
+		 * @note	Large strings (more than 64 KiB) additionally get their lut compressed, if that pays off.
+		 *			Appending keeps the lut compressed, other modifications of the string decompress it again
 		 */
 		void shrink_to_fit() noexcept(TINY_UTF8_NOEXCEPT) ;
 		
@@ -1484,6 +3863,17 @@ namespace tiny_utf8
 		}
 		
 		
+		/**
+		 * Returns the maximum number of bytes a string can hold, limited by the range of size_type
+		 * 
+		 * @note	Strings with a lut can hold less than that. Exceeding the limit throws (or fails with TINY_UTF8_NOEXCEPT)
+		 * @return	The maximum number of data bytes
+		 */
+		static constexpr size_type max_size() noexcept {
+			return basic_string::get_max_buffer_size() - 1;
+		}
+		
+		
 		/**
 		 * Returns the codepoint at the supplied index
 		 * 
@@ -1591,7 +3981,7 @@ namespace tiny_utf8
 		 */
 		inline const data_type* c_str() const noexcept { return get_buffer(); }
 		inline const data_type* data() const noexcept { return get_buffer(); }
-		inline data_type* data() noexcept { return get_buffer(); }
+		inline data_type* data() noexcept(TINY_UTF8_NOEXCEPT || !CopyOnWrite) { unshare(); return get_buffer(); }
 		
 		
 		/**
@@ -1832,6 +4222,17 @@ namespace tiny_utf8
 		basic_string& append( const basic_string& appendix ) noexcept(TINY_UTF8_NOEXCEPT) ;
 		inline basic_string& operator+=( const basic_string& appendix ) noexcept(TINY_UTF8_NOEXCEPT) { return append( appendix ); }
 		
+		/**
+		 * Appends the supplied UTF-8 data to the end of this basic_string
+		 * 
+		 * @note	As this function is raw, 'byte_count' is a number of bytes (not codepoints)
+		 *			and no temporary basic_string is constructed from the appendix
+		 * @param	str			The UTF-8 data to be appended
+		 * @param	byte_count	The number of bytes to append
+		 * @return	A reference to this basic_string, which now has the supplied data appended
+		 */
+		basic_string& raw_append( const data_type* str , size_type byte_count ) noexcept(TINY_UTF8_NOEXCEPT) ;
+		
 		
 		/**
 		 * Appends the supplied codepoint to the end of this basic_string
@@ -1878,7 +4279,7 @@ namespace tiny_utf8
 		 * @return	A reference to this basic_string, updated to the new string
 		 */
 		inline basic_string& assign( size_type count , value_type cp ) noexcept(TINY_UTF8_NOEXCEPT) {
-			return *this = basic_string( count , cp );
+			return *this = basic_string( count , cp , get_allocator() );
 		}
 		/**
 		 * Sets the contents of this string to a copy of the supplied basic_string
@@ -1898,7 +4299,7 @@ namespace tiny_utf8
 		 * @return	A reference to this basic_string, updated to the new string
 		 */
 		inline basic_string& assign( const basic_string& str , size_type pos , size_type count ) noexcept(TINY_UTF8_NOEXCEPT) {
-			return *this = basic_string( str , pos , count );
+			return *this = basic_string( str , pos , count , get_allocator() );
 		}
 		/**
 		 * Moves the contents out of the supplied string into this one
@@ -1917,10 +4318,35 @@ namespace tiny_utf8
 		 */
 		template<typename T>
 		inline basic_string& assign( T&& str , enable_if_ptr<T, data_type>* = {} ) noexcept(TINY_UTF8_NOEXCEPT) {
-			return *this = basic_string( str );
+			return *this = basic_string( str , get_allocator() );
 		}
 		inline basic_string& assign( const data_type* str , size_type len ) noexcept(TINY_UTF8_NOEXCEPT) {
-			return *this = basic_string( str , len );
+			return *this = basic_string( str , len , get_allocator() );
+		}
+		/**
+		 * Assigns utf8 data of known size to this string, validating resp. repairing it according to RFC 3629
+		 * 
+		 * @param	str		The UTF-8 sequence to fill the this basic_string with
+		 * @param	count	The number of bytes to read from 'str'
+		 * @param	policy	The validation resp. repair policy (see the respective constructors)
+		 */
+		inline basic_string& assign( const data_type* str , size_type count , strict_t policy ) noexcept(TINY_UTF8_NOEXCEPT) {
+			return *this = basic_string( str , count , policy , get_allocator() );
+		}
+		inline basic_string& assign( const data_type* str , size_type count , repair_t policy ) noexcept(TINY_UTF8_NOEXCEPT) {
+			return *this = basic_string( str , count , policy , get_allocator() );
+		}
+		/**
+		 * Assigns single-byte encoded data (ISO-8859-1 resp. Windows-1252) of known size to this string
+		 * 
+		 * @param	str		The ISO-8859-1 resp. Windows-1252 sequence to fill the basic_string with
+		 * @param	count	The number of bytes to read from 'str'
+		 */
+		inline basic_string& assign( const char* str , size_type count , latin1_t charset ) noexcept(TINY_UTF8_NOEXCEPT) {
+			return *this = basic_string( str , count , charset , get_allocator() );
+		}
+		inline basic_string& assign( const char* str , size_type count , cp1252_t charset ) noexcept(TINY_UTF8_NOEXCEPT) {
+			return *this = basic_string( str , count , charset , get_allocator() );
 		}
 		/**
 		 * Assigns an utf8 char literal to this string (with possibly embedded '\0's)
@@ -1929,7 +4355,7 @@ namespace tiny_utf8
 		 */
 		template<size_type LITLEN>
 		inline basic_string& assign( const data_type (&str)[LITLEN] ) noexcept(TINY_UTF8_NOEXCEPT) {
-			return *this = basic_string( str );
+			return *this = basic_string( str , get_allocator() );
 		}
 		/**
 		 * Assigns an utf-32 sequence and the maximum length to read from it (in number of codepoints) to this string
@@ -1939,10 +4365,19 @@ namespace tiny_utf8
 		 */
 		template<typename T>
 		inline basic_string& assign( T&& str , enable_if_ptr<T, value_type>* = {} ) noexcept(TINY_UTF8_NOEXCEPT) {
-			return *this = basic_string( str );
+			return *this = basic_string( str , get_allocator() );
 		}
 		inline basic_string& assign( const value_type* str , size_type len ) noexcept(TINY_UTF8_NOEXCEPT) {
-			return *this = basic_string( str , len );
+			return *this = basic_string( str , len , get_allocator() );
+		}
+		/**
+		 * Assigns an utf-16 sequence to this string
+		 * 
+		 * @param	str		The utf-16 sequence to fill the basic_string with
+		 * @param	len		The number of code units to read from the sequence (npos, if 'str' is null-terminated)
+		 */
+		inline basic_string& assign( const char16_t* str , size_type len ) noexcept(TINY_UTF8_NOEXCEPT) {
+			return *this = basic_string( str , len , get_allocator() );
 		}
 		/**
 		 * Assigns an utf-32 char literal to this string (with possibly embedded '\0's)
@@ -1951,7 +4386,7 @@ namespace tiny_utf8
 		 */
 		template<size_type LITLEN>
 		inline basic_string& assign( const value_type (&str)[LITLEN] ) noexcept(TINY_UTF8_NOEXCEPT) {
-			return *this = basic_string( str );
+			return *this = basic_string( str , get_allocator() );
 		}
 		/**
 		 * Assigns the range of codepoints supplied to this string. The resulting string will equal [first,last)
@@ -1962,7 +4397,7 @@ namespace tiny_utf8
 		 */
 		template<typename InputIt>
 		inline basic_string& assign( InputIt first , InputIt last ) noexcept(TINY_UTF8_NOEXCEPT) {
-			return *this = basic_string( first , last );
+			return *this = basic_string( first , last , get_allocator() );
 		}
 		/**
 		 * Assigns the supplied initializer list of codepoints to this string.
@@ -1971,7 +4406,7 @@ namespace tiny_utf8
 		 * @param	ilist	The initializer list with the contents to be applied to this string
 		 */
 		inline basic_string& assign( std::initializer_list<value_type> ilist ) noexcept(TINY_UTF8_NOEXCEPT) {
-			return *this = basic_string( std::move(ilist) );
+			return *this = basic_string( std::move(ilist) , get_allocator() );
 		}
 		
 		
@@ -2229,6 +4664,57 @@ namespace tiny_utf8
 			return result - buffer;
 		}
 		
+		/**
+		 * Finds a specific codepoint inside the basic_string starting at the supplied codepoint index using multiple threads
+		 * 
+		 * @note	The data is split into chunks, which are searched concurrently. At the same time, the codepoints of each
+		 *			chunk are counted, which allows the byte position of the first match to be converted into a codepoint index
+		 *			by only counting the codepoints within the chunk that contains the match.
+		 * @param	cp				The codepoint to look for
+		 * @param	start_codepoint	The index of the first codepoint to start looking from
+		 * @param	par				(Optional) The parallelization settings
+		 * @return	The codepoint index where and if the codepoint was found or basic_string::npos
+		 */
+		size_type parallel_find( value_type cp , size_type start_codepoint = 0 , parallel_t par = parallel_t() ) const noexcept(TINY_UTF8_NOEXCEPT) {
+			data_type	pattern[8];
+			width_type	pattern_len = basic_string::encode_utf8( cp , pattern );
+			return parallel_find( pattern , pattern_len , start_codepoint , par );
+		}
+		/**
+		 * Finds a specific pattern within the basic_string starting at the supplied codepoint index using multiple threads
+		 * 
+		 * @note	Chunks overlap by the length of the pattern minus one byte, so matches spanning two chunks are found as well
+		 * @param	pattern			The pattern to look for
+		 * @param	start_codepoint	The index of the first codepoint to start looking from
+		 * @param	par				(Optional) The parallelization settings
+		 * @return	The codepoint index where and if the pattern was found or basic_string::npos
+		 */
+		size_type parallel_find( const basic_string& pattern , size_type start_codepoint = 0 , parallel_t par = parallel_t() ) const noexcept(TINY_UTF8_NOEXCEPT) {
+			return parallel_find( pattern.data() , pattern.size() , start_codepoint , par );
+		}
+		/**
+		 * Counts the occurrences of a specific codepoint inside the basic_string using multiple threads
+		 * 
+		 * @param	cp		The codepoint to count
+		 * @param	par		(Optional) The parallelization settings
+		 * @return	The number of occurrences of 'cp'
+		 */
+		size_type parallel_count( value_type cp , parallel_t par = parallel_t() ) const noexcept(TINY_UTF8_NOEXCEPT) {
+			data_type	pattern[8];
+			width_type	pattern_len = basic_string::encode_utf8( cp , pattern );
+			return parallel_count( pattern , pattern_len , par );
+		}
+		/**
+		 * Counts the non-overlapping occurrences of a specific pattern within the basic_string using multiple threads
+		 * 
+		 * @param	pattern	The pattern to count (if empty, 0 is returned)
+		 * @param	par		(Optional) The parallelization settings
+		 * @return	The number of non-overlapping occurrences of 'pattern'
+		 */
+		size_type parallel_count( const basic_string& pattern , parallel_t par = parallel_t() ) const noexcept(TINY_UTF8_NOEXCEPT) {
+			return parallel_count( pattern.data() , pattern.size() , par );
+		}
+		
 		/**
 		 * Finds the last occourence of a specific codepoint inside the
 		 * basic_string starting backwards at the supplied codepoint index
@@ -2665,33 +5151,267 @@ namespace tiny_utf8
 		
 		
 		/**
-		 * Determine, if small string optimization is active
-		 * @return	True, if the utf8 data is stored within the basic_string object itself
-		 *			false, otherwise
+		 * Determine, if small string optimization is active
+		 * @return	True, if the utf8 data is stored within the basic_string object itself
+		 *			false, otherwise
+		 */
+		inline bool lut_active() const noexcept { return sso_inactive() && basic_string::is_lut_active( basic_string::get_lut_base_ptr( t_non_sso.data , t_non_sso.buffer_size ) ); }
+		
+		
+		/**
+		 * Determine, how much memory this basic_string occupies and what it is used for
+		 * 
+		 * @note	If copy-on-write is enabled, a shared heap buffer is accounted for by every basic_string sharing it
+		 * @return	The memory usage of this basic_string
+		 */
+		memory_usage_info memory_usage() const noexcept ;
+		
+		
+		/**
+		 * Receive a (null-terminated) wide string literal from this UTF-8 string
+		 * 
+		 * @param	dest	A buffer capable of holding at least 'length()+1' elements of type 'value_type'
+		 * @return	void
+		 */
+		void to_wide_literal( value_type* dest ) const noexcept {
+			dest[ basic_string::decode_utf8( get_buffer() , size() , dest , basic_string::npos ) ] = 0;
+		}
+		
+		
+		/**
+		 * Get the codepoints of this basic_string as an std::basic_string<value_type> (e.g. std::u32string)
+		 * 
+		 * @note	The result is allocated exactly once, using the stored number of codepoints
+		 * @return	The utf32 representation of this basic_string
+		 */
+		std::basic_string<value_type> to_u32string() const noexcept(TINY_UTF8_NOEXCEPT) {
+			std::basic_string<value_type> result( length() , value_type() );
+			if( !result.empty() )
+				basic_string::decode_utf8( get_buffer() , size() , &result[0] , result.size() );
+			return result;
+		}
+		
+		
+		/**
+		 * Copy a number of codepoints of this basic_string into a buffer (analogous to std::basic_string::copy)
+		 * 
+		 * @note	The buffer is not null-terminated
+		 * @param	dest	A buffer capable of holding at least 'count' elements of type 'value_type'
+		 * @param	count	The maximum number of codepoints to copy
+		 * @param	pos		The codepoint index of the first codepoint to copy
+		 * @return	The number of codepoints copied
+		 */
+		size_type copy_codepoints( value_type* dest , size_type count , size_type pos = 0 ) const noexcept(TINY_UTF8_NOEXCEPT) {
+			size_type data_len		= size();
+			size_type start_byte	= get_num_bytes_from_start( pos );
+			if( start_byte > data_len ){
+				TINY_UTF8_THROW( "tiny_utf8::basic_string::copy_codepoints" , start_byte > data_len );
+				return 0;
+			}
+			return basic_string::decode_utf8( get_buffer() + start_byte , data_len - start_byte , dest , count );
+		}
+		
+		
+		/**
+		 * Get the contents of this basic_string as utf-16
+		 * 
+		 * @note	Codepoints beyond U+10FFFF (only encodable by the 5 to 7 byte extension) are replaced by U+FFFD
+		 * @return	The utf-16 representation of this basic_string
+		 */
+		std::basic_string<char16_t> to_u16string() const noexcept(TINY_UTF8_NOEXCEPT) ;
+		
+		
+		/**
+		 * Get the contents of this basic_string encoded in ISO-8859-1 resp. Windows-1252
+		 * 
+		 * @param	replacement		The byte to use for codepoints that are not representable in the target encoding
+		 * @return	The single-byte encoded representation of this basic_string (with 'length()' bytes)
+		 */
+		std::string to_latin1( char replacement = '?' ) const noexcept(TINY_UTF8_NOEXCEPT) { return to_single_byte( replacement , false ); }
+		std::string to_cp1252( char replacement = '?' ) const noexcept(TINY_UTF8_NOEXCEPT) { return to_single_byte( replacement , true ); }
+		
+		
+		/**
+		 * Get the raw data contained in this basic_string wrapped by an std::string
+		 * 
+		 * @note	Returns the UTF-8 formatted content of this basic_string
+		 * @return	UTF-8 formatted data, wrapped inside an std::string
+		 */
+		inline std::basic_string<data_type> cpp_str( bool prepend_bom = false ) const noexcept(TINY_UTF8_NOEXCEPT) { return prepend_bom ? cpp_str_bom() : std::basic_string<DataType>( c_str() , size() ); }
+		
+		
+		/**
+		 * Writes this basic_string to a stream in a compact, versioned binary format that includes the LUT
+		 * 
+		 * @note	The format starts with a header holding the format version, the LUT mode and width, the data length,
+		 *			the number of codepoints, the LUT length (each as LEB128 varint) and a checksum of the header.
+		 *			The UTF-8 data and the LUT entries (little endian) follow.
+		 * @param	out		The stream to write to
+		 * @return	True, if the stream is still good after writing, false otherwise
+		 */
+		bool serialize( std::ostream& out ) const noexcept(TINY_UTF8_NOEXCEPT) ;
+		
+		
+		/**
+		 * Replaces the contents of this basic_string with a basic_string read from a stream (as written by 'serialize')
+		 * 
+		 * @note	Neither the codepoints need to be counted nor the LUT needs to be built: The buffer is allocated once and the
+		 *			data as well as the LUT are read into it directly. Instead of rescanning, integrity is checked in O(1)
+		 *			by means of the header checksum and the plausibility of the first and last entry of the LUT.
+		 * @param	in		The stream to read from
+		 * @return	True on success. Otherwise, false is returned, the failbit of the stream is set and this basic_string is empty
+		 */
+		bool deserialize( std::istream& in ) noexcept(TINY_UTF8_NOEXCEPT) ;
+		
+		
+	public: //! Stream operations
+		
+		
+		/**
+		 * Writes the UTF-8 data of the supplied basic_string to an output stream
+		 * 
+		 * @note	Unless padding is requested by the stream's width, the data is written as is (without any temporary copy)
+		 * @param	stream	The stream to write to
+		 * @param	str		The basic_string to output
+		 * @return	A reference to the supplied stream
+		 */
+		friend std::ostream& operator<<( std::ostream& stream , const basic_string& str ) noexcept(TINY_UTF8_NOEXCEPT) {
+			if( stream.width() > std::streamsize( str.size() ) )
+				return stream << str.cpp_str(); // Let std::string take care of the padding
+			stream.write( reinterpret_cast<const char*>( str.data() ) , str.size() );
+			stream.width( 0 );
+			return stream;
+		}
+		
+		
+		/**
+		 * Reads the next whitespace-delimited word of an input stream into the supplied basic_string
+		 * 
+		 * @note	Behaves like operator>> of std::string, but reads directly into the buffer of the supplied basic_string.
+		 * @param	stream	The stream to read from
+		 * @param	str		The basic_string to store the word in
+		 * @return	A reference to the supplied stream
+		 */
+		friend std::istream& operator>>( std::istream& stream , basic_string& str ) noexcept(TINY_UTF8_NOEXCEPT) {
+			std::istream::sentry sentry( stream );
+			if( sentry ){
+				const std::ctype<char>&	ctype = std::use_facet<std::ctype<char>>( stream.getloc() );
+				std::streamsize			width = stream.width();
+				bool					reached_eof;
+				size_type				num_extracted = str.extract(
+					stream.rdbuf()
+					, width > 0 ? size_type( width ) : basic_string::npos
+					, [&ctype]( data_type byte ){ return ctype.is( std::ctype_base::space , (char)byte ); }
+					, reached_eof
+				);
+				stream.width( 0 );
+				stream.setstate(
+					( reached_eof ? std::ios_base::eofbit : std::ios_base::goodbit )
+					| ( num_extracted ? std::ios_base::goodbit : std::ios_base::failbit )
+				);
+			}
+			return stream;
+		}
+		
+		
+		/**
+		 * Reads characters from an input stream into the supplied basic_string, until the delimiter is found
+		 * 
+		 * @note	Behaves like std::getline, but reads directly into the buffer of the supplied basic_string.
+		 * @param	stream	The stream to read from
+		 * @param	str		The basic_string to store the line in
+		 * @param	delim	The delimiter, which will be extracted but not stored
+		 * @return	A reference to the supplied stream
+		 */
+		friend std::istream& getline( std::istream& stream , basic_string& str , data_type delim ) noexcept(TINY_UTF8_NOEXCEPT) {
+			std::istream::sentry sentry( stream , true );
+			if( sentry ){
+				bool		reached_eof;
+				size_type	num_extracted = str.extract(
+					stream.rdbuf()
+					, basic_string::npos
+					, [delim]( data_type byte ){ return byte == delim; }
+					, reached_eof
+				);
+				if( reached_eof )
+					stream.setstate( num_extracted ? std::ios_base::eofbit : std::ios_base::eofbit | std::ios_base::failbit );
+				else
+					stream.rdbuf()->sbumpc(); // Extract the delimiter
+			}
+			return stream;
+		}
+		friend inline std::istream& getline( std::istream& stream , basic_string& str ) noexcept(TINY_UTF8_NOEXCEPT) { return getline( stream , str , '\n' ); }
+	};
+	
+	
+	/**
+	 * Decodes UTF-8 data that arrives in chunks of arbitrary size (e.g. from sockets or pipes) into a basic_string.
+	 * A codepoint that is split between two chunks is kept back until it is complete,
+	 * so the target basic_string never ends with a partial codepoint.
+	 */
+	template<typename String>
+	class basic_stream_decoder
+	{
+	public:
+		
+		typedef typename String::data_type		data_type;
+		typedef typename String::size_type		size_type;
+		typedef typename String::width_type		width_type;
+		
+	private:
+		
+		String*			t_target;
+		data_type		t_pending[8]; // The bytes of the pending codepoint (the first byte announces at most 8 bytes)
+		unsigned char	t_num_pending; // The number of bytes that are pending
+		unsigned char	t_pending_len; // The number of bytes, the pending codepoint is made of
+		bool			t_invalid;
+		
+	public:
+		
+		/**
+		 * Ctor
+		 * 
+		 * @param	target	The basic_string, complete codepoints will be appended to
 		 */
-		inline bool lut_active() const noexcept { return sso_inactive() && basic_string::is_lut_active( basic_string::get_lut_base_ptr( t_non_sso.data , t_non_sso.buffer_size ) ); }
+		basic_stream_decoder( String& target ) noexcept :
+			t_target( &target )
+			, t_num_pending( 0 )
+			, t_pending_len( 0 )
+			, t_invalid( false )
+		{}
 		
 		
 		/**
-		 * Receive a (null-terminated) wide string literal from this UTF-8 string
+		 * Appends all complete codepoints of the supplied chunk to the target
 		 * 
-		 * @param	dest	A buffer capable of holding at least 'length()+1' elements of type 'value_type'
-		 * @return	void
+		 * @note	The bytes of a trailing codepoint that exceeds the chunk are kept until the next call
+		 * @param	chunk		The next chunk of UTF-8 data
+		 * @param	byte_count	The number of bytes in the chunk
+		 * @return	A reference to this basic_stream_decoder
 		 */
-		void to_wide_literal( value_type* dest ) const noexcept {
-			for( const data_type* data = get_buffer(), * data_end = data + size() ; data < data_end ; )
-				data += decode_utf8_and_len( data , *dest++ , data_end - data );
-			*dest = 0;
-		}
+		basic_stream_decoder& feed( const data_type* chunk , size_type byte_count ) noexcept(TINY_UTF8_NOEXCEPT) ;
 		
 		
 		/**
-		 * Get the raw data contained in this basic_string wrapped by an std::string
+		 * Signals the end of the input and appends the bytes of a pending codepoint as they are
 		 * 
-		 * @note	Returns the UTF-8 formatted content of this basic_string
-		 * @return	UTF-8 formatted data, wrapped inside an std::string
+		 * @note	Like within basic_string, each byte of an incomplete codepoint is treated as a codepoint of its own
+		 * @return	True, if the input ended on a codepoint boundary, false otherwise
 		 */
-		inline std::basic_string<data_type> cpp_str( bool prepend_bom = false ) const noexcept(TINY_UTF8_NOEXCEPT) { return prepend_bom ? cpp_str_bom() : std::basic_string<DataType>( c_str() , size() ); }
+		bool finish() noexcept(TINY_UTF8_NOEXCEPT) ;
+		
+		
+		//! Check, whether all bytes fed so far have been appended to the target
+		inline bool at_boundary() const noexcept { return !t_num_pending; }
+		
+		//! Get the number of bytes that are kept back, because the codepoint they belong to is not complete yet
+		inline size_type pending() const noexcept { return t_num_pending; }
+		
+		//! Check, whether malformed data was detected, i.e. a split codepoint that was continued by anything but continuation bytes or was never completed
+		inline bool invalid() const noexcept { return t_invalid; }
+		
+		//! Get the basic_string that decoded codepoints are appended to
+		inline String& target() const noexcept { return *t_target; }
 	};
 } // Namespace 'tiny_utf8'
 
@@ -2699,11 +5419,11 @@ namespace tiny_utf8
 //! std::hash specialization
 namespace std
 {
-	template<typename V, typename D, typename A>
-	struct hash<tiny_utf8::basic_string<V, D, A> >
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	struct hash<tiny_utf8::basic_string<V, D, A, S, C> >
 	{
-		std::size_t operator()( const tiny_utf8::basic_string<V, D, A>& string ) const noexcept {
-			using data_type = typename tiny_utf8::basic_string<V, D, A>::data_type;
+		std::size_t operator()( const tiny_utf8::basic_string<V, D, A, S, C>& string ) const noexcept {
+			using data_type = typename tiny_utf8::basic_string<V, D, A, S, C>::data_type;
 			std::hash<data_type>	hasher;
 			std::size_t				size = string.size();
 			std::size_t				result = 0;
@@ -2715,25 +5435,11 @@ namespace std
 	};
 }
 
-//! Stream Operations
-template<typename V, typename D, typename A>
-std::ostream& operator<<( std::ostream& stream , const tiny_utf8::basic_string<V, D, A>& str ) noexcept(TINY_UTF8_NOEXCEPT) {
-	return stream << str.cpp_str();
-}
-template<typename V, typename D, typename A>
-std::istream& operator>>( std::istream& stream , tiny_utf8::basic_string<V, D, A>& str ) noexcept(TINY_UTF8_NOEXCEPT) {
-	std::string tmp;
-	stream >> tmp;
-	str = move(tmp);
-	return stream;
-}
-
-
 // Implementation
 namespace tiny_utf8
 {
-	template<typename V, typename D, typename A>
-	basic_string<V, D, A>::basic_string( basic_string<V, D, A>::size_type count , basic_string<V, D, A>::value_type cp , const typename basic_string<V, D, A>::allocator_type& alloc )
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	basic_string<V, D, A, S, C>::basic_string( basic_string<V, D, A, S, C>::size_type count , basic_string<V, D, A, S, C>::value_type cp , const typename basic_string<V, D, A, S, C>::allocator_type& alloc )
 		noexcept(TINY_UTF8_NOEXCEPT)
 		: A( alloc )
 		, t_sso()
@@ -2742,6 +5448,10 @@ namespace tiny_utf8
 			return;
 		
 		width_type	num_bytes_per_cp = get_codepoint_bytes( cp );
+		if( count > basic_string::max_size() / num_bytes_per_cp ){
+			TINY_UTF8_THROW( "tiny_utf8::basic_string" , count * num_bytes_per_cp > max_size() );
+			return;
+		}
 		size_type	data_len = num_bytes_per_cp * count;
 		data_type*	buffer;
 		
@@ -2783,8 +5493,8 @@ namespace tiny_utf8
 		buffer[data_len] = 0;
 	}
 
-	template<typename V, typename D, typename A>
-	basic_string<V, D, A>::basic_string( basic_string<V, D, A>::size_type count , data_type cp , const typename basic_string<V, D, A>::allocator_type& alloc )
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	basic_string<V, D, A, S, C>::basic_string( basic_string<V, D, A, S, C>::size_type count , data_type cp , const typename basic_string<V, D, A, S, C>::allocator_type& alloc )
 		noexcept(TINY_UTF8_NOEXCEPT)
 		: A( alloc )
 		, t_sso()
@@ -2823,8 +5533,8 @@ namespace tiny_utf8
 		buffer[count] = 0;
 	}
 
-	template<typename V, typename D, typename A>
-	basic_string<V, D, A>::basic_string( const data_type* str , size_type pos , size_type count , size_type data_left , const typename basic_string<V, D, A>::allocator_type& alloc , tiny_utf8_detail::read_codepoints_tag )
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	basic_string<V, D, A, S, C>::basic_string( const data_type* str , size_type pos , size_type count , size_type data_left , const typename basic_string<V, D, A, S, C>::allocator_type& alloc , tiny_utf8_detail::read_codepoints_tag )
 		noexcept(TINY_UTF8_NOEXCEPT)
 		: basic_string( alloc )
 	{
@@ -2863,7 +5573,38 @@ namespace tiny_utf8
 			{
 				// Determine the buffer size (excluding the lut indicator) and the lut width
 				width_type	lut_width;
-				size_type	buffer_size	= determine_main_buffer_size( data_len , num_multibytes , &lut_width );
+				width_type	delta_width;
+				size_type	buffer_size	= determine_compressed_buffer_size( data_len , num_multibytes , &lut_width , &delta_width );
+				
+				// Compress the lut of a large string?
+				if( buffer_size )
+				{
+					buffer = this->allocate( determine_total_buffer_size( buffer_size ) );
+				#if defined(TINY_UTF8_NOEXCEPT)
+					if( !buffer )
+						return;
+				#endif
+					t_non_sso.data = buffer;
+					
+					// Copy bytes and fill the lut
+					std::memcpy( buffer , str , data_len );
+					buffer[data_len] = '\0'; // Set trailing '\0'
+					data_type*	lut_base_ptr = basic_string::get_lut_base_ptr( buffer , buffer_size );
+					size_type	num_blocks = basic_string::get_num_lut_blocks( data_len , delta_width );
+					basic_string::write_compressed_lut( lut_base_ptr , lut_width , delta_width , num_blocks , 0 , num_multibytes , multibyte_scanner( buffer , data_len ) , 0 , num_blocks );
+					basic_string::set_compressed_lut_indicator( lut_base_ptr , num_multibytes , delta_width );
+					TINY_UTF8_COUNT( lut_builds , 1 );
+					TINY_UTF8_COUNT( lut_compressions , 1 );
+					
+					// Set Attributes
+					t_non_sso.buffer_size = buffer_size;
+					t_non_sso.data_len = data_len;
+					set_non_sso_string_len( string_len ); // This also disables SSO
+					
+					return;
+				}
+				
+				buffer_size = determine_main_buffer_size( data_len , num_multibytes , &lut_width );
 				buffer = this->allocate( determine_total_buffer_size( buffer_size ) );
 			#if defined(TINY_UTF8_NOEXCEPT)
 				if( !buffer )
@@ -2874,6 +5615,7 @@ namespace tiny_utf8
 				// Set up LUT
 				data_type*	lut_iter = basic_string::get_lut_base_ptr( buffer , buffer_size );
 				basic_string::set_lut_indiciator( lut_iter , true , num_multibytes ); // Set the LUT indicator
+				TINY_UTF8_COUNT( lut_builds , 1 );
 				
 				// Fill the lut and copy bytes
 				data_type* buffer_iter = buffer;
@@ -2935,8 +5677,8 @@ namespace tiny_utf8
 		buffer[data_len] = '\0';
 	}
 
-	template<typename V, typename D, typename A>
-	basic_string<V, D, A>::basic_string( const data_type* str , size_type data_len , const typename basic_string<V, D, A>::allocator_type& alloc , tiny_utf8_detail::read_bytes_tag )
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	basic_string<V, D, A, S, C>::basic_string( const data_type* str , size_type data_len , const typename basic_string<V, D, A, S, C>::allocator_type& alloc , tiny_utf8_detail::read_bytes_tag )
 		noexcept(TINY_UTF8_NOEXCEPT)
 		: basic_string( alloc )
 	{
@@ -2957,6 +5699,135 @@ namespace tiny_utf8
 			num_multibytes	+= bytes > 1 ? 1 : 0;	// Increase number of occoured multibytes?
 		}
 		
+		assign_counted( str , data_len , string_len , num_multibytes );
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	basic_string<V, D, A, S, C>::basic_string( const data_type* str , size_type data_len , strict_t policy , const typename basic_string<V, D, A, S, C>::allocator_type& alloc )
+		noexcept(TINY_UTF8_NOEXCEPT)
+		: basic_string( alloc )
+	{
+		const unsigned char*	iter = reinterpret_cast<const unsigned char*>( str );
+		const unsigned char*	end = iter + data_len;
+		std::size_t				num_multibytes = 0;
+		std::size_t				string_len = 0;
+		
+		// Validate the data while counting codepoints and multibytes
+		if( tiny_utf8_detail::skip_valid( iter , end , string_len , num_multibytes ) != end ){
+			if( policy.valid )
+				*policy.valid = false;
+			return;
+		}
+		
+		if( policy.valid )
+			*policy.valid = true;
+		if( data_len )
+			assign_counted( str , data_len , string_len , num_multibytes );
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	basic_string<V, D, A, S, C>::basic_string( const data_type* str , size_type data_len , repair_t policy , const typename basic_string<V, D, A, S, C>::allocator_type& alloc )
+		noexcept(TINY_UTF8_NOEXCEPT)
+		: basic_string( alloc )
+	{
+		const unsigned char*	begin = reinterpret_cast<const unsigned char*>( str );
+		const unsigned char*	end = begin + data_len;
+		const unsigned char*	iter = begin;
+		std::size_t				num_multibytes = 0;
+		size_type				num_replacements = 0;
+		std::size_t				string_len = 0;
+		size_type				new_data_len = data_len;
+		unsigned int			invalid_len;
+		
+		// Count codepoints, multibytes and replacements
+		while( ( iter = tiny_utf8_detail::skip_valid( iter , end , string_len , num_multibytes ) ) != end )
+		{
+			tiny_utf8_detail::check_utf8( iter , end - iter , invalid_len );
+			new_data_len += 3 - invalid_len; // U+FFFD takes 3 bytes
+			num_replacements += 1;
+			iter			+= invalid_len;
+			string_len		+= 1;
+			num_multibytes	+= 1;
+		}
+		
+		if( policy.num_replacements )
+			*policy.num_replacements = num_replacements;
+		
+		// Nothing to repair?
+		if( !num_replacements ){
+			if( data_len )
+				assign_counted( str , data_len , string_len , num_multibytes );
+			return;
+		}
+		
+		data_type*	buffer;
+		data_type*	lut_iter = nullptr;
+		width_type	lut_width = 0;
+		size_type	buffer_size = 0;
+		bool		lut_active = false;
+		
+		// Need heap memory?
+		if( new_data_len > basic_string::get_sso_capacity() )
+		{
+			lut_active = basic_string::is_lut_worth( num_multibytes , string_len , false , false );
+			buffer_size = lut_active
+				? determine_main_buffer_size( new_data_len , num_multibytes , &lut_width )
+				: determine_main_buffer_size( new_data_len );
+			buffer = this->allocate( determine_total_buffer_size( buffer_size ) );
+		#if defined(TINY_UTF8_NOEXCEPT)
+			if( !buffer )
+				return;
+		#endif
+			lut_iter = basic_string::get_lut_base_ptr( buffer , buffer_size );
+			basic_string::set_lut_indiciator( lut_iter , lut_active , lut_active ? num_multibytes : 0 ); // Set the LUT indicator
+			TINY_UTF8_COUNT( lut_builds , lut_active );
+		}
+		else
+			buffer = t_sso.data;
+		
+		// Write the data and fill the lut
+		data_type* dest = buffer;
+		for( iter = begin ; ; )
+		{
+			// Copy ascii runs
+			const unsigned char* ascii_end = tiny_utf8_detail::skip_ascii( iter , end );
+			std::memcpy( dest , iter , ascii_end - iter );
+			dest += ascii_end - iter;
+			if( ( iter = ascii_end ) == end )
+				break;
+			
+			if( lut_active )
+				basic_string::set_lut( lut_iter -= lut_width , lut_width , dest - buffer );
+			
+			unsigned int bytes = tiny_utf8_detail::check_utf8( iter , end - iter , invalid_len );
+			if( bytes ){
+				std::memcpy( dest , iter , bytes );
+				dest += bytes;
+				iter += bytes;
+			}
+			else{
+				*dest++ = data_type( 0xEF ); // U+FFFD
+				*dest++ = data_type( 0xBF );
+				*dest++ = data_type( 0xBD );
+				iter += invalid_len;
+			}
+		}
+		*dest = '\0'; // Set trailing '\0'
+		
+		// Set Attributes
+		if( buffer_size ){
+			t_non_sso.data = buffer;
+			t_non_sso.buffer_size = buffer_size;
+			t_non_sso.data_len = new_data_len;
+			set_non_sso_string_len( string_len ); // This also disables SSO
+		}
+		else
+			set_sso_data_len( (unsigned char)new_data_len );
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	void basic_string<V, D, A, S, C>::assign_counted( const data_type* str , size_type data_len , size_type string_len , size_type num_multibytes ) noexcept(TINY_UTF8_NOEXCEPT)
+	{
 		data_type*	buffer;
 		
 		// Need heap memory?
@@ -2966,7 +5837,38 @@ namespace tiny_utf8
 			{
 				// Determine the buffer size (excluding the lut indicator) and the lut width
 				width_type	lut_width;
-				size_type	buffer_size	= determine_main_buffer_size( data_len , num_multibytes , &lut_width );
+				width_type	delta_width;
+				size_type	buffer_size	= determine_compressed_buffer_size( data_len , num_multibytes , &lut_width , &delta_width );
+				
+				// Compress the lut of a large string?
+				if( buffer_size )
+				{
+					buffer = this->allocate( determine_total_buffer_size( buffer_size ) );
+				#if defined(TINY_UTF8_NOEXCEPT)
+					if( !buffer )
+						return;
+				#endif
+					t_non_sso.data = buffer;
+					
+					// Copy bytes and fill the lut
+					std::memcpy( buffer , str , data_len );
+					buffer[data_len] = '\0'; // Set trailing '\0'
+					data_type*	lut_base_ptr = basic_string::get_lut_base_ptr( buffer , buffer_size );
+					size_type	num_blocks = basic_string::get_num_lut_blocks( data_len , delta_width );
+					basic_string::write_compressed_lut( lut_base_ptr , lut_width , delta_width , num_blocks , 0 , num_multibytes , multibyte_scanner( buffer , data_len ) , 0 , num_blocks );
+					basic_string::set_compressed_lut_indicator( lut_base_ptr , num_multibytes , delta_width );
+					TINY_UTF8_COUNT( lut_builds , 1 );
+					TINY_UTF8_COUNT( lut_compressions , 1 );
+					
+					// Set Attributes
+					t_non_sso.buffer_size = buffer_size;
+					t_non_sso.data_len = data_len;
+					set_non_sso_string_len( string_len ); // This also disables SSO
+					
+					return;
+				}
+				
+				buffer_size = determine_main_buffer_size( data_len , num_multibytes , &lut_width );
 				buffer = this->allocate( determine_total_buffer_size( buffer_size ) );
 			#if defined(TINY_UTF8_NOEXCEPT)
 				if( !buffer )
@@ -2977,6 +5879,7 @@ namespace tiny_utf8
 				// Set up LUT
 				data_type*	lut_iter = basic_string::get_lut_base_ptr( buffer , buffer_size );
 				basic_string::set_lut_indiciator( lut_iter , true , num_multibytes ); // Set the LUT indicator
+				TINY_UTF8_COUNT( lut_builds , 1 );
 				
 				// Fill the lut and copy bytes
 				data_type* buffer_iter = buffer;
@@ -3038,110 +5941,622 @@ namespace tiny_utf8
 		buffer[data_len] = '\0';
 	}
 
-	template<typename V, typename D, typename A>
-	basic_string<V, D, A>::basic_string( const value_type* str , size_type len , const typename basic_string<V, D, A>::allocator_type& alloc )
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	basic_string<V, D, A, S, C>::basic_string( const data_type* str , size_type data_len , parallel_t par , const typename basic_string<V, D, A, S, C>::allocator_type& alloc )
+		noexcept(TINY_UTF8_NOEXCEPT)
+		: basic_string( alloc )
+	{
+		unsigned int num_chunks = data_len > basic_string::get_sso_capacity() ? par.num_tasks( data_len ) : 1;
+		
+		// Not worth the threads?
+		if( num_chunks <= 1 ){
+			basic_string tmp( str , data_len , alloc , tiny_utf8_detail::read_bytes_tag() );
+			std::memcpy( (void*)&t_sso , (void*)&tmp.t_sso , sizeof(SSO) ); // Steal the data
+			tmp.set_sso_data_len( 0u );
+			return;
+		}
+		
+		std::unique_ptr<chunk_info[]> chunks( new chunk_info[num_chunks] );
+		
+		// Count codepoints and multibytes in each chunk
+		basic_string::scan_chunks( str , data_len , chunks.get() , num_chunks , []( unsigned int ){} );
+		
+		// Compute the number of codepoints and the number of multibytes in all previous chunks
+		size_type string_len = 0;
+		size_type num_multibytes = 0;
+		for( unsigned int index = 0 ; index < num_chunks ; ++index ){
+			string_len += chunks[index].string_len;
+			std::swap( num_multibytes , chunks[index].num_multibytes );
+			num_multibytes += chunks[index].num_multibytes;
+		}
+		
+		// Allocate the buffer
+		bool		lut_active = basic_string::is_lut_worth( num_multibytes , string_len , false , false );
+		width_type	lut_width = 0;
+		width_type	delta_width = 0;
+		size_type	buffer_size	= lut_active ? determine_compressed_buffer_size( data_len , num_multibytes , &lut_width , &delta_width ) : 0;
+		bool		lut_compressed = buffer_size != 0;
+		if( !lut_compressed )
+			buffer_size	= lut_active
+				? determine_main_buffer_size( data_len , num_multibytes , &lut_width )
+				: determine_main_buffer_size( data_len );
+		data_type*	buffer = this->allocate( determine_total_buffer_size( buffer_size ) );
+	#if defined(TINY_UTF8_NOEXCEPT)
+		if( !buffer )
+			return;
+	#endif
+		data_type*	lut_base_ptr = basic_string::get_lut_base_ptr( buffer , buffer_size );
+		size_type	num_blocks = lut_compressed ? basic_string::get_num_lut_blocks( data_len , delta_width ) : 0;
+		
+		// Copy the data and fill the lut
+		tiny_utf8_detail::parallel_for( num_chunks , [&]( unsigned int index ){
+			const chunk_info& c = chunks[index];
+			std::memcpy( buffer + c.begin , str + c.begin , c.end - c.begin );
+			if( !lut_active )
+				return;
+			if( lut_compressed ){ // Each chunk writes the entries of the blocks ending within it
+				size_type	chunk_multibytes = ( index + 1 < num_chunks ? chunks[index + 1].num_multibytes : num_multibytes ) - c.num_multibytes;
+				width_type	shift = 8 * delta_width;
+				basic_string::write_compressed_lut( lut_base_ptr , lut_width , delta_width , num_blocks , c.num_multibytes , chunk_multibytes
+					, multibyte_scanner( str , data_len , c.begin )
+					, c.begin >> shift , index + 1 < num_chunks ? c.end >> shift : num_blocks
+				);
+				return;
+			}
+			constexpr size_type	mask = get_msb_mask<size_type>();
+			data_type*			lut_iter = lut_base_ptr - c.num_multibytes * lut_width;
+			const data_type*	str_iter = str + c.begin;
+			const data_type*	str_end = str + c.end;
+			while( str_iter < str_end )
+			{
+				// Skip sizeof(size_type) ascii bytes at once
+				size_type word;
+				while( size_type( str_end - str_iter ) >= sizeof(size_type) ){
+					std::memcpy( &word , str_iter , sizeof(size_type) );
+					if( word & mask )
+						break;
+					str_iter += sizeof(size_type);
+				}
+				if( str_iter == str_end )
+					break;
+				width_type bytes = get_codepoint_bytes( *str_iter , str + data_len - str_iter );
+				if( bytes > 1 )
+					basic_string::set_lut( lut_iter -= lut_width , lut_width , str_iter - str );
+				str_iter += bytes;
+			}
+		} );
+		buffer[data_len] = '\0'; // Set trailing '\0'
+		
+		// Set up LUT
+		if( lut_compressed )
+			basic_string::set_compressed_lut_indicator( lut_base_ptr , num_multibytes , delta_width );
+		else
+			basic_string::set_lut_indiciator( lut_base_ptr , lut_active || num_multibytes == 0 , lut_active ? num_multibytes : 0 );
+		TINY_UTF8_COUNT( lut_builds , lut_active );
+		TINY_UTF8_COUNT( lut_compressions , lut_compressed );
+		
+		// Set Attributes
+		t_non_sso.data = buffer;
+		t_non_sso.buffer_size = buffer_size;
+		t_non_sso.data_len = data_len;
+		set_non_sso_string_len( string_len );
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	basic_string<V, D, A, S, C>::basic_string( const value_type* str , size_type len , const typename basic_string<V, D, A, S, C>::allocator_type& alloc )
 		noexcept(TINY_UTF8_NOEXCEPT)
 		: basic_string( alloc )
 	{
 		if( !len )
 			return;
 		
-		size_type		num_multibytes = 0;
-		size_type		data_len = 0;
-		size_type		string_len = 0;
+		size_type		string_len = len != basic_string::npos ? len : tiny_utf8_detail::strlen( str );
+		size_type		num_multibytes;
+		size_type		data_len;
+		
+		// Make sure, the number of bytes fits into size_type (only very long sequences can exceed it)
+		if( string_len > basic_string::max_size() / 4 ){
+			std::uint64_t total_data_len = 0;
+			for( size_type i = 0 ; i < string_len ; ++i )
+				total_data_len += basic_string::get_codepoint_bytes( str[i] );
+			if( total_data_len > basic_string::max_size() ){
+				TINY_UTF8_THROW( "tiny_utf8::basic_string" , data_len > max_size() );
+				return;
+			}
+		}
 		
-		// Count bytes, mutlibytes and string length
-		while( string_len < len && ( str[string_len] || len != basic_string::npos ) )
-		{
-			// Read number of bytes of current codepoint
-			width_type bytes = get_codepoint_bytes( str[string_len] );
-			
-			data_len		+= bytes;		// Increase number of bytes
-			string_len		+= 1;			// Increase number of codepoints
-			num_multibytes	+= bytes > 1 ;	// Increase number of occoured multibytes?
+		// Count bytes and mutlibytes
+		basic_string::count_utf8_bytes( str , string_len , data_len , num_multibytes );
+		
+		data_type*	lut_iter;
+		width_type	lut_width;
+		data_type*	buffer = prepare_encoding( data_len , string_len , num_multibytes , lut_iter , lut_width );
+	#if defined(TINY_UTF8_NOEXCEPT)
+		if( !buffer )
+			return;
+	#endif
+		
+		// Encode the codepoints (and fill the lut)
+		*basic_string::encode_utf8( str , string_len , buffer , lut_iter , lut_width ) = '\0'; // Set trailing '\0'
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	basic_string<V, D, A, S, C>::basic_string( const char16_t* str , size_type len , const typename basic_string<V, D, A, S, C>::allocator_type& alloc )
+		noexcept(TINY_UTF8_NOEXCEPT)
+		: basic_string( alloc )
+	{
+		if( !len )
+			return;
+		
+		if( len == basic_string::npos )
+			len = tiny_utf8_detail::strlen( str );
+		
+		size_type		data_len;
+		size_type		string_len;
+		size_type		num_multibytes;
+		
+		// Make sure, the number of bytes fits into size_type (only very long sequences can exceed it)
+		if( len > basic_string::max_size() / 3 ){
+			std::uint64_t total_data_len = 0;
+			for( size_type i = 0 ; i < len ; ){
+				value_type cp;
+				i += basic_string::decode_utf16( str + i , str + len , cp );
+				total_data_len += basic_string::get_codepoint_bytes( cp );
+			}
+			if( total_data_len > basic_string::max_size() ){
+				TINY_UTF8_THROW( "tiny_utf8::basic_string" , data_len > max_size() );
+				return;
+			}
 		}
 		
+		// Count bytes, codepoints and mutlibytes
+		basic_string::count_utf8_bytes( str , len , data_len , string_len , num_multibytes );
+		
+		data_type*	lut_iter;
+		width_type	lut_width;
+		data_type*	buffer = prepare_encoding( data_len , string_len , num_multibytes , lut_iter , lut_width );
+	#if defined(TINY_UTF8_NOEXCEPT)
+		if( !buffer )
+			return;
+	#endif
+		
+		// Encode the code units (and fill the lut)
+		*basic_string::encode_utf8( str , len , buffer , lut_iter , lut_width ) = '\0'; // Set trailing '\0'
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	typename basic_string<V, D, A, S, C>::data_type* basic_string<V, D, A, S, C>::prepare_encoding( size_type data_len , size_type string_len , size_type num_multibytes , data_type*& lut_iter , width_type& lut_width ) noexcept(TINY_UTF8_NOEXCEPT)
+	{
 		data_type*	buffer;
+		lut_iter = nullptr;
+		lut_width = 0;
 		
 		// Need heap memory?
 		if( data_len > basic_string::get_sso_capacity() )
 		{
-			if( basic_string::is_lut_worth( num_multibytes , string_len , false , false ) )
-			{	
-				// Determine the buffer size (excluding the lut indicator) and the lut width
-				width_type lut_width;
-				size_type buffer_size	= determine_main_buffer_size( data_len , num_multibytes , &lut_width );
-				buffer = this->allocate( determine_total_buffer_size( buffer_size ) );
-			#if defined(TINY_UTF8_NOEXCEPT)
-				if( !buffer )
-					return;
-			#endif
-				t_non_sso.data = buffer;
+			size_type buffer_size;
+			bool lut_active = basic_string::is_lut_worth( num_multibytes , string_len , false , false );
+			if( lut_active ) // Determine the buffer size (excluding the lut indicator) and the lut width
+				buffer_size = determine_main_buffer_size( data_len , num_multibytes , &lut_width );
+			else
+				buffer_size = determine_main_buffer_size( data_len );
+			buffer = this->allocate( determine_total_buffer_size( buffer_size ) );
+		#if defined(TINY_UTF8_NOEXCEPT)
+			if( !buffer )
+				return nullptr;
+		#endif
+			
+			// Set up LUT
+			lut_iter = basic_string::get_lut_base_ptr( buffer , buffer_size );
+			basic_string::set_lut_indiciator( lut_iter , lut_active || num_multibytes == 0 , lut_active ? num_multibytes : 0 ); // Set the LUT indicator
+			TINY_UTF8_COUNT( lut_builds , lut_active );
+			
+			// Set Attributes
+			t_non_sso.data = buffer;
+			t_non_sso.buffer_size = buffer_size;
+			t_non_sso.data_len = data_len;
+			set_non_sso_string_len( string_len );
+		}
+		else{
+			buffer = t_sso.data;
+			
+			// Set Attrbutes
+			set_sso_data_len( (unsigned char)data_len );
+			
+			// Set up LUT: Not necessary, since the LUT is automatically inactive,
+			// since SSO is active and the LUT indicator shadows 't_sso.data_len', which has the LSB = 0 (=> LUT inactive).
+		}
+		
+		return buffer;
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	void basic_string<V, D, A, S, C>::count_utf8_bytes( const value_type* str , size_type len , size_type& data_len , size_type& num_multibytes ) noexcept
+	{
+		const value_type*	end = str + len;
+		std::ptrdiff_t		block_len = 8;
+		std::size_t			num_bytes = 0;
+		std::size_t			multibytes = 0;
+		
+		while( str < end )
+		{
+			// Count runs of codepoints up to U+1FFFFF using the kernel (the scalar one only counts ascii blocks)
+			std::size_t num_counted = tiny_utf8_detail::count_utf32( str , end - str , num_bytes , multibytes );
+			str += num_counted;
+			
+			// Count the next block 8 codepoints at a time (doubling its length up to 256, while the kernel makes no progress)
+			block_len = num_counted ? 8 : std::min<std::ptrdiff_t>( block_len * 2 , 256 );
+			for( const value_type* block_end = end - str > block_len ? str + block_len : end ; block_end - str >= 8 ; str += 8 )
+			{
+				if( ( str[0] | str[1] | str[2] | str[3] | str[4] | str[5] | str[6] | str[7] ) < 0x80 ){
+					num_bytes += 8;
+					continue;
+				}
+				for( int i = 0 ; i < 8 ; ++i ){
+					width_type bytes = get_codepoint_bytes( str[i] );
+					num_bytes	+= bytes;
+					multibytes	+= bytes > 1;
+				}
+			}
+			if( end - str < 8 )
+				for( ; str < end ; ++str ){
+					width_type bytes = get_codepoint_bytes( *str );
+					num_bytes	+= bytes;
+					multibytes	+= bytes > 1;
+				}
+		}
+		data_len = num_bytes;
+		num_multibytes = multibytes;
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	typename basic_string<V, D, A, S, C>::data_type* basic_string<V, D, A, S, C>::encode_utf8( const value_type* str , size_type len , data_type* dest , data_type* lut_iter , width_type lut_width ) noexcept
+	{
+		const value_type*	end = str + len;
+		const data_type*	buffer = dest;
+		std::ptrdiff_t		block_len = 8;
+		
+		while( str < end )
+		{
+			// Narrow runs of codepoints up to U+FFFF using the kernel (the scalar one only narrows ascii blocks)
+			std::size_t num_bytes;
+			std::size_t num_narrowed = tiny_utf8_detail::narrow_utf32( str , end - str , reinterpret_cast<unsigned char*>( dest ) , num_bytes );
+			str += num_narrowed;
+			
+			// Push the positions of the multibytes it wrote to the lut
+			if( lut_width && num_bytes )
+				basic_string::set_lut_of_run( buffer , dest , dest + num_bytes , lut_iter , lut_width );
+			dest += num_bytes;
+			
+			// Encode the next block one by one (doubling its length up to 256, while the kernel makes no progress)
+			block_len = num_narrowed ? 8 : std::min<std::ptrdiff_t>( block_len * 2 , 256 );
+			for( const value_type* block_end = end - str > block_len ? str + block_len : end ; str < block_end ; )
+			{
+				// Narrow blocks of 8 ascii codepoints at once
+				while( block_end - str >= 8 && ( str[0] | str[1] | str[2] | str[3] | str[4] | str[5] | str[6] | str[7] ) < 0x80 ){
+					for( int i = 0 ; i < 8 ; ++i )
+						dest[i] = data_type( str[i] );
+					dest += 8;
+					str += 8;
+				}
+				if( str == block_end )
+					break;
 				
-				//! Fill LUT
-				data_type* lut_iter		= basic_string::get_lut_base_ptr( buffer , buffer_size );
-				data_type* buffer_iter	= buffer;
-				basic_string::set_lut_indiciator( lut_iter , true , num_multibytes ); // Set the LUT indicator
+				value_type cp = *str++;
+				if( cp < 0x80 ){
+					*dest++ = data_type( cp );
+					continue;
+				}
 				
-				// Iterate through wide char literal
-				for( size_type i = 0 ; i < string_len ; i++ )
-				{
-					// Encode wide char to utf8
-					width_type codepoint_bytes = basic_string::encode_utf8( str[i] , buffer_iter );
-					
-					// Push position of character to 'indices'
-					if( codepoint_bytes > 1 )
-						basic_string::set_lut( lut_iter -= lut_width , lut_width , buffer_iter - buffer );
-					
-					// Step forward with copying to internal utf8 buffer
-					buffer_iter += codepoint_bytes;
+				// Push position of character to the lut
+				if( lut_width )
+					basic_string::set_lut( lut_iter -= lut_width , lut_width , dest - buffer );
+				
+				// Encode wide char to utf8 and step forward the number of bytes it took
+				width_type bytes = get_codepoint_bytes( cp );
+				basic_string::encode_utf8( cp , dest , bytes );
+				dest += bytes;
+			}
+		}
+		
+		return dest;
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	void basic_string<V, D, A, S, C>::count_utf8_bytes( const char16_t* str , size_type len , size_type& data_len , size_type& string_len , size_type& num_multibytes ) noexcept
+	{
+		const char16_t*	end = str + len;
+		std::ptrdiff_t	block_len = 8;
+		std::size_t		num_bytes = 0;
+		std::size_t		num_codepoints = 0;
+		std::size_t		multibytes = 0;
+		
+		while( str < end )
+		{
+			// Count runs of code units without surrogates using the kernel (the scalar one only counts ascii blocks)
+			std::size_t num_counted = tiny_utf8_detail::count_utf16( str , end - str , num_bytes , multibytes );
+			str += num_counted;
+			num_codepoints += num_counted;
+			
+			// Count the next block one by one (doubling its length up to 256, while the kernel makes no progress)
+			block_len = num_counted ? 8 : std::min<std::ptrdiff_t>( block_len * 2 , 256 );
+			for( const char16_t* block_end = end - str > block_len ? str + block_len : end ; str < block_end ; )
+			{
+				// Skip blocks of 8 ascii code units at once
+				const char16_t* ascii_begin = str;
+				while( block_end - str >= 8 && ( str[0] | str[1] | str[2] | str[3] | str[4] | str[5] | str[6] | str[7] ) < 0x80 )
+					str += 8;
+				num_bytes		+= str - ascii_begin;
+				num_codepoints	+= str - ascii_begin;
+				if( str == block_end )
+					break;
+				
+				value_type cp;
+				str += decode_utf16( str , end , cp );
+				width_type bytes = get_codepoint_bytes( cp );
+				num_bytes		+= bytes;
+				num_codepoints	+= 1;
+				multibytes		+= bytes > 1;
+			}
+		}
+		data_len = num_bytes;
+		string_len = num_codepoints;
+		num_multibytes = multibytes;
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	typename basic_string<V, D, A, S, C>::data_type* basic_string<V, D, A, S, C>::encode_utf8( const char16_t* str , size_type len , data_type* dest , data_type* lut_iter , width_type lut_width ) noexcept
+	{
+		const char16_t*		end = str + len;
+		const data_type*	buffer = dest;
+		std::ptrdiff_t		block_len = 8;
+		
+		while( str < end )
+		{
+			// Narrow runs of code units without surrogates using the kernel (the scalar one only narrows ascii blocks)
+			std::size_t num_bytes;
+			std::size_t num_narrowed = tiny_utf8_detail::narrow_utf16( str , end - str , reinterpret_cast<unsigned char*>( dest ) , num_bytes );
+			str += num_narrowed;
+			
+			// Push the positions of the multibytes it wrote to the lut
+			if( lut_width && num_bytes )
+				basic_string::set_lut_of_run( buffer , dest , dest + num_bytes , lut_iter , lut_width );
+			dest += num_bytes;
+			
+			// Encode the next block one by one (doubling its length up to 256, while the kernel makes no progress)
+			block_len = num_narrowed ? 8 : std::min<std::ptrdiff_t>( block_len * 2 , 256 );
+			for( const char16_t* block_end = end - str > block_len ? str + block_len : end ; str < block_end ; )
+			{
+				// Narrow blocks of 8 ascii code units at once
+				while( block_end - str >= 8 && ( str[0] | str[1] | str[2] | str[3] | str[4] | str[5] | str[6] | str[7] ) < 0x80 ){
+					for( int i = 0 ; i < 8 ; ++i )
+						dest[i] = data_type( str[i] );
+					dest += 8;
+					str += 8;
 				}
-				*buffer_iter = '\0'; // Set trailing '\0'
+				if( str == block_end )
+					break;
 				
-				// Set Attributes
-				t_non_sso.buffer_size = buffer_size;
-				t_non_sso.data_len = data_len;
-				set_non_sso_string_len( string_len );
+				value_type cp;
+				str += decode_utf16( str , end , cp );
+				if( cp < 0x80 ){
+					*dest++ = data_type( cp );
+					continue;
+				}
 				
-				return; // We have already done everything!
+				// Push position of character to the lut
+				if( lut_width )
+					basic_string::set_lut( lut_iter -= lut_width , lut_width , dest - buffer );
+				
+				// Encode the codepoint to utf8 and step forward the number of bytes it took
+				width_type bytes = get_codepoint_bytes( cp );
+				basic_string::encode_utf8( cp , dest , bytes );
+				dest += bytes;
+			}
+		}
+		
+		return dest;
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	void basic_string<V, D, A, S, C>::assign_single_byte( const char* str , size_type len , bool cp1252 ) noexcept(TINY_UTF8_NOEXCEPT)
+	{
+		if( !len )
+			return;
+		
+		const unsigned char*	iter = reinterpret_cast<const unsigned char*>( str );
+		const unsigned char*	end = iter + len;
+		size_type				num_multibytes = 0;
+		size_type				data_len = len;
+		
+		// Count the high bytes (each of them becomes a multibyte)
+		if( !cp1252 ){
+			for( std::uint64_t word ; end - iter >= 8 ; iter += 8 ){
+				std::memcpy( &word , iter , 8 );
+				num_multibytes += tiny_utf8_detail::count_high_bytes( word );
+			}
+			for( ; iter < end ; ++iter )
+				num_multibytes += *iter >> 7;
+			data_len += num_multibytes;
+		}
+		else while( ( iter = tiny_utf8_detail::skip_ascii( iter , end ) ) < end ){
+			width_type bytes = get_codepoint_bytes( tiny_utf8_detail::cp1252_to_codepoint( *iter++ ) );
+			data_len		+= bytes - 1;
+			num_multibytes	+= 1;
+		}
+		
+		data_type*	lut_iter;
+		width_type	lut_width;
+		data_type*	buffer = prepare_encoding( data_len , len , num_multibytes , lut_iter , lut_width );
+	#if defined(TINY_UTF8_NOEXCEPT)
+		if( !buffer )
+			return;
+	#endif
+		
+		// Convert the bytes (and fill the lut)
+		data_type* dest = buffer;
+		iter = reinterpret_cast<const unsigned char*>( str );
+		while( true )
+		{
+			// Copy ascii at once. Without a lut (i.e. with many high bytes), the vector kernels expand all of latin1
+			std::size_t num_bytes;
+			std::size_t num_converted;
+			if( cp1252 || lut_width ){
+				num_converted = num_bytes = tiny_utf8_detail::skip_ascii( iter , end ) - iter;
+				std::memcpy( dest , iter , num_bytes );
 			}
+			else
+				num_converted = tiny_utf8_detail::expand_latin1( iter , end - iter , reinterpret_cast<unsigned char*>( dest ) , num_bytes );
+			dest += num_bytes;
+			if( ( iter += num_converted ) == end )
+				break;
 			
-			size_type buffer_size = determine_main_buffer_size( data_len );
-			buffer = t_non_sso.data = this->allocate(  determine_total_buffer_size( buffer_size ) );
-			
-			// Set up LUT
-			data_type*	lut_iter = basic_string::get_lut_base_ptr( buffer , buffer_size );
-			basic_string::set_lut_indiciator( lut_iter , num_multibytes == 0 , 0 ); // Set the LUT indicator
+			// Push position of character to the lut
+			if( lut_width )
+				basic_string::set_lut( lut_iter -= lut_width , lut_width , dest - buffer );
 			
-			// Set Attributes
-			t_non_sso.buffer_size = buffer_size;
-			t_non_sso.data_len = data_len;
-			set_non_sso_string_len( string_len );
+			value_type cp = cp1252 ? tiny_utf8_detail::cp1252_to_codepoint( *iter++ ) : *iter++;
+			width_type bytes = get_codepoint_bytes( cp );
+			basic_string::encode_utf8( cp , dest , bytes );
+			dest += bytes;
 		}
-		else{
-			buffer = t_sso.data;
+		*dest = '\0'; // Set trailing '\0'
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	std::string basic_string<V, D, A, S, C>::to_single_byte( char replacement , bool cp1252 ) const noexcept(TINY_UTF8_NOEXCEPT)
+	{
+		const unsigned char*	iter = reinterpret_cast<const unsigned char*>( get_buffer() );
+		const unsigned char*	end = iter + size();
+		size_type				num_codepoints = 0;
+		
+		// Count the codepoints the way they are decoded below, which is not necessarily length():
+		// An incomplete sequence yields one codepoint per byte (see 'get_codepoint_bytes')
+		for( const unsigned char* it = iter ; ; ++num_codepoints ){
+			const unsigned char* ascii_end = tiny_utf8_detail::skip_ascii( it , end );
+			num_codepoints += ascii_end - it;
+			if( ( it = ascii_end ) == end )
+				break;
+			it += get_codepoint_bytes( *it , end - it );
+		}
+		
+		std::string result( num_codepoints , '\0' );
+		if( result.empty() )
+			return result;
+		
+		char* dest = &result[0];
+		while( true )
+		{
+			const unsigned char* ascii_end = tiny_utf8_detail::skip_ascii( iter , end );
+			std::memcpy( dest , iter , ascii_end - iter );
+			dest += ascii_end - iter;
+			if( ( iter = ascii_end ) == end )
+				break;
 			
-			// Set Attrbutes
-			set_sso_data_len( (unsigned char)data_len );
+			value_type cp;
+			iter += decode_utf8_and_len( reinterpret_cast<const data_type*>( iter ) , cp , end - iter );
+			int ch = cp1252 ? tiny_utf8_detail::codepoint_to_cp1252( cp ) : cp < 0x100 ? int( cp ) : -1;
+			*dest++ = ch >= 0 ? char( ch ) : replacement;
+		}
+		
+		return result;
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	std::basic_string<char16_t> basic_string<V, D, A, S, C>::to_u16string() const noexcept(TINY_UTF8_NOEXCEPT)
+	{
+		const data_type*	data = get_buffer();
+		const data_type*	data_end = data + size();
+		size_type			num_units = 0;
+		
+		// Count the code units the way they are decoded below (an incomplete sequence yields one codepoint per byte, see 'get_codepoint_bytes'):
+		// Only lead bytes of 4 or more bytes are candidates for a surrogate pair
+		for( const unsigned char* iter = reinterpret_cast<const unsigned char*>( data ) , * end = reinterpret_cast<const unsigned char*>( data_end ) ; ; ++num_units )
+		{
+			// Count ascii and (using the vector kernels) 2- and 3-byte sequences at once
+			std::size_t num_counted;
+			iter = tiny_utf8_detail::count_bmp( iter , end , num_counted );
+			num_units += num_counted;
+			if( iter == end )
+				break;
+			width_type bytes = get_codepoint_bytes( *iter , end - iter );
+			if( bytes >= 4 ){
+				value_type cp = decode_utf8( reinterpret_cast<const data_type*>( iter ) , bytes );
+				num_units += cp >= 0x10000 && cp <= 0x10FFFF;
+			}
+			iter += bytes;
+		}
+		
+		std::basic_string<char16_t> result( num_units , char16_t() );
+		char16_t* dest = result.empty() ? nullptr : &result[0];
+		
+		while( data < data_end )
+		{
+			// Decode ascii and (using the vector kernels) 2- and 3-byte sequences at once
+			std::size_t num_widened;
+			data = reinterpret_cast<const data_type*>( tiny_utf8_detail::widen_bmp(
+				reinterpret_cast<const unsigned char*>( data ) , reinterpret_cast<const unsigned char*>( data_end ) , dest , num_widened
+			) );
+			dest += num_widened;
+			if( data == data_end )
+				break;
 			
-			// Set up LUT: Not necessary, since the LUT is automatically inactive,
-			// since SSO is active and the LUT indicator shadows 't_sso.data_len', which has the LSB = 0 (=> LUT inactive).
+			value_type cp;
+			data += decode_utf8_and_len( data , cp , data_end - data );
+			if( cp < 0x10000 )
+				*dest++ = char16_t( cp );
+			else if( cp <= 0x10FFFF ){
+				cp -= 0x10000;
+				*dest++ = char16_t( 0xD800 | ( cp >> 10 ) );
+				*dest++ = char16_t( 0xDC00 | ( cp & 0x3FF ) );
+			}
+			else
+				*dest++ = char16_t( 0xFFFD );
 		}
 		
-		data_type* buffer_iter = buffer;
+		return result;
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	typename basic_string<V, D, A, S, C>::size_type basic_string<V, D, A, S, C>::decode_utf8( const data_type* data , size_type data_len , value_type* dest , size_type max_codepoints ) noexcept
+	{
+		const data_type*	data_end = data + data_len;
+		value_type*			dest_begin = dest;
+		value_type*			dest_end = max_codepoints < data_len ? dest + max_codepoints : dest + data_len; // Every codepoint takes at least one byte
 		
-		// Iterate through wide char literal
-		for( size_type i = 0 ; i < string_len ; i++ )
-			// Encode wide char to utf8 and step forward the number of bytes it took
-			buffer_iter += basic_string::encode_utf8( str[i] , buffer_iter );
+		while( dest < dest_end )
+		{
+			// Widen ascii runs (see tiny_utf8_detail::kernels)
+			size_type num_ascii = tiny_utf8_detail::widen_ascii(
+				reinterpret_cast<const unsigned char*>( data )
+				, std::min<size_type>( data_end - data , dest_end - dest )
+				, dest
+			);
+			data += num_ascii;
+			dest += num_ascii;
+			if( data >= data_end || dest == dest_end )
+				break;
+			data += decode_utf8_and_len( data , *dest++ , data_end - data );
+		}
 		
-		*buffer_iter = '\0'; // Set trailing '\0'
+		return dest - dest_begin;
 	}
 
-	template<typename V, typename D, typename A>
-	typename basic_string<V, D, A>::width_type basic_string<V, D, A>::get_num_bytes_of_utf8_char_before( const data_type* data_start , size_type index ) noexcept
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	typename basic_string<V, D, A, S, C>::width_type basic_string<V, D, A, S, C>::get_num_bytes_of_utf8_char_before( const data_type* data_start , size_type index ) noexcept
 	{
 		data_start += index;
+		
+		#if TINY_UTF8_STRICT_4BYTE
+		// Only Check the possibilities, that could appear (see 'get_codepoint_bytes')
+		if( index >= 4 && ((unsigned char)data_start[-4] & 0xF0 ) == 0xF0 )		// 1111XXXX four bytes
+			return 4;
+		if( index >= 3 && ((unsigned char)data_start[-3] & 0xF0 ) == 0xE0 )		// 1110XXXX three bytes
+			return 3;
+		if( index >= 2 && ((unsigned char)data_start[-2] & 0xE0 ) == 0xC0 )		// 110XXXXX two bytes
+			return 2;
+		return 1;
+		#else
 		// Only Check the possibilities, that could appear
 		switch( index )
 		{
@@ -3173,11 +6588,12 @@ namespace tiny_utf8
 			case 0:
 				return 1;
 		}
+		#endif
 	}
 
-	#if !TINY_UTF8_HAS_CLZ
-	template<typename V, typename D, typename A>
-	typename basic_string<V, D, A>::width_type basic_string<V, D, A>::get_codepoint_bytes( typename basic_string<V, D, A>::data_type first_byte , typename basic_string<V, D, A>::size_type data_left ) noexcept
+	#if !TINY_UTF8_HAS_CLZ && !TINY_UTF8_STRICT_4BYTE
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	typename basic_string<V, D, A, S, C>::width_type basic_string<V, D, A, S, C>::get_codepoint_bytes( typename basic_string<V, D, A, S, C>::data_type first_byte , typename basic_string<V, D, A, S, C>::size_type data_left ) noexcept
 	{
 		// Only Check the possibilities, that could appear
 		switch( data_left )
@@ -3205,15 +6621,217 @@ namespace tiny_utf8
 				return 1; // one byte
 		}
 	}
-	#endif // !TINY_UTF8_HAS_CLZ
+	#endif // !TINY_UTF8_HAS_CLZ && !TINY_UTF8_STRICT_4BYTE
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	typename basic_string<V, D, A, S, C>::size_type basic_string<V, D, A, S, C>::count_codepoints( const data_type* data , size_type data_len , size_type& string_len , size_type& num_multibytes , bool stop_at_incomplete ) noexcept
+	{
+		const data_type*	iter = data;
+		const data_type*	end = data + data_len;
+		
+		while( iter < end )
+		{
+			// Skip ascii runs (see tiny_utf8_detail::kernels)
+			const data_type* ascii_end = reinterpret_cast<const data_type*>(
+				tiny_utf8_detail::skip_ascii( reinterpret_cast<const unsigned char*>( iter ) , reinterpret_cast<const unsigned char*>( end ) )
+			);
+			string_len += ascii_end - iter;
+			if( ( iter = ascii_end ) == end )
+				break;
+			
+			// Read number of bytes of current codepoint
+			size_type	data_left = end - iter;
+			width_type	bytes = get_codepoint_bytes( *iter , stop_at_incomplete ? basic_string::npos : data_left );
+			if( bytes > data_left )
+				break;
+			iter			+= bytes;				// Increase number of bytes
+			string_len		+= 1;					// Increase number of codepoints
+			num_multibytes	+= bytes > 1 ? 1 : 0;	// Increase number of occoured multibytes?
+		}
+		
+		return iter - data;
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	void basic_string<V, D, A, S, C>::scan_chunk( const data_type* data , size_type data_len , chunk_info& chunk , size_type begin , size_type stop ) noexcept
+	{
+		chunk.begin = begin;
+		chunk.string_len = chunk.num_multibytes = 0;
+		if( begin < stop )
+			begin += basic_string::count_codepoints( data + begin , stop - begin , chunk.string_len , chunk.num_multibytes , true );
+		while( begin < stop ){ // Codepoint that crosses 'stop'
+			width_type bytes = get_codepoint_bytes( data[begin] , data_len - begin );
+			begin					+= bytes;
+			chunk.string_len		+= 1;
+			chunk.num_multibytes	+= bytes > 1 ? 1 : 0;
+		}
+		chunk.end = begin;
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	template<typename Func>
+	void basic_string<V, D, A, S, C>::scan_chunks( const data_type* data , size_type data_len , chunk_info* chunks , unsigned int num_chunks , Func func ) noexcept(TINY_UTF8_NOEXCEPT)
+	{
+		tiny_utf8_detail::parallel_for( num_chunks , [=]( unsigned int index ){
+			size_type begin = get_chunk_start( data_len , index , num_chunks );
+			size_type stop = get_chunk_start( data_len , index + 1 , num_chunks );
+			while( index && begin < stop && ( data[begin] & 0xC0 ) == 0x80 ) // Skip continuation bytes
+				++begin;
+			basic_string::scan_chunk( data , data_len , chunks[index] , begin , stop );
+			func( index );
+		} );
+		
+		// Make sure, each chunk continues where the previous one ended
+		for( unsigned int index = 1 ; index < num_chunks ; ++index )
+			if( chunks[index].begin != chunks[index - 1].end )
+				basic_string::scan_chunk( data , data_len , chunks[index] , chunks[index - 1].end , get_chunk_start( data_len , index + 1 , num_chunks ) );
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	const typename basic_string<V, D, A, S, C>::data_type* basic_string<V, D, A, S, C>::find_bytes( const data_type* begin , const data_type* end , const data_type* pattern , size_type pattern_len ) noexcept
+	{
+		if( !pattern_len )
+			return begin;
+		
+		// Ascii bytes are usually rare enough to find candidates by the first byte only
+		if( pattern_len == 1 || (unsigned char)*pattern < 0x80 ){
+			while( size_type( end - begin ) >= pattern_len )
+			{
+				begin = (const data_type*)std::memchr( begin , (unsigned char)*pattern , end - begin - pattern_len + 1 );
+				if( !begin )
+					break;
+				if( !std::memcmp( begin + 1 , pattern + 1 , pattern_len - 1 ) )
+					return begin;
+				++begin;
+			}
+			return nullptr;
+		}
+		
+		// Lead bytes of multibytes are shared by many codepoints, so match the first two bytes at once
+		while( size_type( end - begin ) >= pattern_len )
+		{
+			// Find the next candidate by its first two bytes (see tiny_utf8_detail::kernels)
+			begin = (const data_type*)tiny_utf8_detail::find_pair(
+				(const unsigned char*)begin
+				, (const unsigned char*)end - pattern_len + 2
+				, (unsigned char)pattern[0]
+				, (unsigned char)pattern[1]
+			);
+			if( !begin )
+				break;
+			if( !std::memcmp( begin + 2 , pattern + 2 , pattern_len - 2 ) )
+				return begin;
+			++begin;
+		}
+		return nullptr;
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	typename basic_string<V, D, A, S, C>::size_type basic_string<V, D, A, S, C>::parallel_find( const data_type* pattern , size_type pattern_len , size_type start_codepoint , parallel_t par ) const noexcept(TINY_UTF8_NOEXCEPT)
+	{
+		if( start_codepoint && start_codepoint >= length() )
+			return basic_string::npos;
+		if( !pattern_len )
+			return start_codepoint;
+		
+		size_type			data_start = get_num_bytes_from_start( start_codepoint );
+		const data_type*	data = get_buffer() + data_start;
+		size_type			data_len = size() - data_start;
+		unsigned int		num_chunks = par.num_tasks( data_len );
+		
+		std::unique_ptr<chunk_info[]>	chunks( new chunk_info[num_chunks] );
+		std::unique_ptr<size_type[]>	matches( new size_type[num_chunks] );
+		
+		// Search all chunks (for matches starting within them) while counting their codepoints
+		basic_string::scan_chunks( data , data_len , chunks.get() , num_chunks , [&]( unsigned int index ){
+			size_type			begin = get_chunk_start( data_len , index , num_chunks );
+			size_type			stop = get_chunk_start( data_len , index + 1 , num_chunks );
+			const data_type*	match = basic_string::find_bytes( data + begin , data + std::min( stop + pattern_len - 1 , data_len ) , pattern , pattern_len );
+			matches[index] = match ? size_type( match - data ) : size_type( basic_string::npos );
+		} );
+		
+		// Determine the first match
+		size_type match = basic_string::npos;
+		for( unsigned int index = 0 ; index < num_chunks && match == basic_string::npos ; ++index )
+			match = matches[index];
+		if( match == basic_string::npos )
+			return basic_string::npos;
+		
+		// Sum up the codepoints of all chunks before the match and count the remaining ones
+		unsigned int index = 0;
+		for( ; chunks[index].end <= match ; ++index )
+			start_codepoint += chunks[index].string_len;
+		size_type num_multibytes = 0;
+		basic_string::count_codepoints( data + chunks[index].begin , match - chunks[index].begin , start_codepoint , num_multibytes );
+		
+		return start_codepoint;
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	typename basic_string<V, D, A, S, C>::size_type basic_string<V, D, A, S, C>::parallel_count( const data_type* pattern , size_type pattern_len , parallel_t par ) const noexcept(TINY_UTF8_NOEXCEPT)
+	{
+		if( !pattern_len )
+			return 0;
+		
+		const data_type*	data = get_buffer();
+		size_type			data_len = size();
+		unsigned int		num_chunks = par.num_tasks( data_len );
+		
+		struct chunk_count{
+			size_type	count;
+			size_type	last_end; // End of the last match
+		};
+		std::unique_ptr<chunk_count[]> counts( new chunk_count[num_chunks] );
+		
+		// Counts the non-overlapping matches starting in [begin,stop)
+		auto count_matches = [=]( chunk_count& result , size_type begin , size_type stop ){
+			const data_type* iter = data + begin;
+			const data_type* end = data + std::min( stop + pattern_len - 1 , data_len );
+			result.count = 0;
+			result.last_end = begin;
+			while( ( iter = basic_string::find_bytes( iter , end , pattern , pattern_len ) ) ){
+				iter += pattern_len;
+				result.count += 1;
+				result.last_end = iter - data;
+			}
+		};
+		
+		tiny_utf8_detail::parallel_for( num_chunks , [&]( unsigned int index ){
+			count_matches( counts[index] , get_chunk_start( data_len , index , num_chunks ) , get_chunk_start( data_len , index + 1 , num_chunks ) );
+		} );
+		
+		// Recount chunks that start within the last match of the previous chunks
+		size_type result = 0;
+		size_type last_end = 0;
+		for( unsigned int index = 0 ; index < num_chunks ; ++index ){
+			if( last_end > get_chunk_start( data_len , index , num_chunks ) )
+				count_matches( counts[index] , last_end , std::max( last_end , get_chunk_start( data_len , index + 1 , num_chunks ) ) );
+			result += counts[index].count;
+			last_end = std::max( last_end , counts[index].last_end );
+		}
+		
+		return result;
+	}
 
-	template<typename V, typename D, typename A>
-	basic_string<V, D, A>& basic_string<V, D, A>::operator=( const basic_string<V, D, A>& str ) noexcept(TINY_UTF8_NOEXCEPT)
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	basic_string<V, D, A, S, C>& basic_string<V, D, A, S, C>::operator=( const basic_string<V, D, A, S, C>& str ) noexcept(TINY_UTF8_NOEXCEPT)
 	{
 		// Note: Self assignment is expected to be very rare. We tolerate overhead in this situation.
 		// Therefore, we right away check for sso states in 'this' and 'str'.
 		// If they are equal, perform the check then.
 		
+		// Share the buffer of 'str', if copy-on-write is enabled and the resulting allocator equals the allocator of 'str'
+		if( C && str.sso_inactive() && &str != this
+			&& ( std::allocator_traits<A>::propagate_on_container_copy_assignment::value || (const A&)*this == (const A&)str )
+		){
+			basic_string::get_ref_count( str.t_non_sso.data ).fetch_add( 1 , std::memory_order_relaxed ); // First, in case both share the buffer already
+			if( sso_inactive() )
+				this->deallocate( t_non_sso.data , t_non_sso.buffer_size );
+			propagate_allocator( str , typename std::allocator_traits<A>::propagate_on_container_copy_assignment() ); // Copy allocator (if it propagates)
+			std::memcpy( (void*)&this->t_sso , (void*)&str.t_sso , sizeof(SSO) ); // Copy data
+			return *this;
+		}
+		
 		switch( sso_inactive() + str.sso_inactive() * 2 )
 		{
 			case 3: // [sso-inactive] = [sso-inactive]
@@ -3221,7 +6839,13 @@ namespace tiny_utf8
 				if( &str == this )
 					return *this;
 				const data_type* str_lut_base_ptr = basic_string::get_lut_base_ptr( str.t_non_sso.data , str.t_non_sso.buffer_size );
-				if( basic_string::is_lut_active( str_lut_base_ptr ) )
+				if( ( C && basic_string::get_ref_count( t_non_sso.data ).load( std::memory_order_acquire ) != 1 ) // Shared with other copies?
+					|| ( std::allocator_traits<A>::propagate_on_container_copy_assignment::value && !( (const A&)*this == (const A&)str ) ) // Allocated by another allocator than the resulting one?
+				)
+					goto lbl_replicate_whole_buffer;
+				else if( basic_string::is_lut_active( str_lut_base_ptr ) && basic_string::is_lut_compressed( str_lut_base_ptr ) )
+					goto lbl_replicate_whole_buffer; // Keep the lut compressed
+				else if( basic_string::is_lut_active( str_lut_base_ptr ) )
 				{
 					width_type	lut_width = get_lut_width( t_non_sso.buffer_size ); // Lut width, if the current buffer is used
 					size_type	str_lut_len = basic_string::get_lut_len( str_lut_base_ptr );
@@ -3265,7 +6889,7 @@ namespace tiny_utf8
 				);
 				t_non_sso.data_len = str.t_non_sso.data_len;
 				t_non_sso.string_len = str.t_non_sso.string_len; // Copy the string_len bit pattern
-				(allocator_type&)*this = (const allocator_type&)str; // Copy allocator
+				propagate_allocator( str , typename std::allocator_traits<A>::propagate_on_container_copy_assignment() ); // Copy allocator (if it propagates)
 				return *this;
 				
 			lbl_replicate_whole_buffer: // Replicate the whole buffer
@@ -3273,19 +6897,19 @@ namespace tiny_utf8
 			}
 				TINY_UTF8_FALLTHROUGH
 			case 2: // [sso-active] = [sso-inactive]
-				(allocator_type&)*this = (const allocator_type&)str; // Copy allocator
+				propagate_allocator( str , typename std::allocator_traits<A>::propagate_on_container_copy_assignment() ); // Copy allocator (if it propagates)
 				t_non_sso.data = this->allocate(  basic_string::determine_total_buffer_size( str.t_non_sso.buffer_size ) );
 				std::memcpy( t_non_sso.data , str.t_non_sso.data , str.t_non_sso.buffer_size + sizeof(indicator_type) ); // Copy data
 				t_non_sso.buffer_size = str.t_non_sso.buffer_size;
 				t_non_sso.data_len = str.t_non_sso.data_len;
-				t_non_sso.string_len = str.t_non_sso.string_len; // This also disables SSO
+				set_non_sso_string_len( str.get_non_sso_string_len() ); // This also disables SSO
 				return *this;
 			case 1: // [sso-inactive] = [sso-active]
 				this->deallocate( t_non_sso.data , t_non_sso.buffer_size );
 				TINY_UTF8_FALLTHROUGH
 			case 0: // [sso-active] = [sso-active]
 				if( &str != this ){
-					(allocator_type&)*this = (const allocator_type&)str; // Copy allocator
+					propagate_allocator( str , typename std::allocator_traits<A>::propagate_on_container_copy_assignment() ); // Copy allocator (if it propagates)
 					std::memcpy( (void*)&this->t_sso , &str.t_sso , sizeof(basic_string::SSO) ); // Copy data
 				}
 				return *this;
@@ -3293,8 +6917,91 @@ namespace tiny_utf8
 		return *this;
 	}
 
-	template<typename V, typename D, typename A>
-	void basic_string<V, D, A>::shrink_to_fit() noexcept(TINY_UTF8_NOEXCEPT)
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	bool basic_string<V, D, A, S, C>::unshare_buffer() noexcept(TINY_UTF8_NOEXCEPT)
+	{
+		size_type	total_buffer_size = basic_string::determine_total_buffer_size( t_non_sso.buffer_size );
+		data_type*	buffer = this->allocate( total_buffer_size );
+	#if defined(TINY_UTF8_NOEXCEPT)
+		if( !buffer )
+			return false;
+	#endif
+		std::memcpy( buffer , t_non_sso.data , total_buffer_size ); // Copy data, lut and lut indicator
+		this->deallocate( t_non_sso.data , t_non_sso.buffer_size ); // Release our reference to the shared buffer
+		t_non_sso.data = buffer;
+		return true;
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	bool basic_string<V, D, A, S, C>::decompress_lut() noexcept(TINY_UTF8_NOEXCEPT)
+	{
+		size_type			data_len = t_non_sso.data_len;
+		size_type			buffer_size = t_non_sso.buffer_size;
+		data_type*			buffer = t_non_sso.data;
+		const data_type*	lut_base_ptr = basic_string::get_lut_base_ptr( buffer , buffer_size );
+		size_type			lut_len = basic_string::get_lut_len( lut_base_ptr );
+		width_type			new_lut_width;
+		size_type			new_buffer_size = determine_main_buffer_size( data_len , lut_len , &new_lut_width );
+		data_type*			new_buffer = this->allocate( determine_total_buffer_size( new_buffer_size ) );
+	#if defined(TINY_UTF8_NOEXCEPT)
+		if( !new_buffer )
+			return false;
+	#endif
+		
+		// Expand the indices
+		data_type*				new_lut_iter = basic_string::get_lut_base_ptr( new_buffer , new_buffer_size );
+		compressed_lut_reader	reader( lut_base_ptr , data_len , basic_string::get_lut_width( buffer_size ) );
+		basic_string::set_lut_indiciator( new_lut_iter , true , lut_len );
+		while( lut_len-- > 0 )
+			basic_string::set_lut( new_lut_iter -= new_lut_width , new_lut_width , reader.next() );
+		
+		std::memcpy( new_buffer , buffer , data_len + 1 ); // Copy data and trailing '\0'
+		this->deallocate( buffer , buffer_size ); // Release our reference to the old buffer
+		t_non_sso.data = new_buffer;
+		t_non_sso.buffer_size = new_buffer_size;
+		TINY_UTF8_COUNT( lut_decompressions , 1 );
+		return true;
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	typename basic_string<V, D, A, S, C>::size_type basic_string<V, D, A, S, C>::determine_compressed_buffer_size( size_type data_len , size_type lut_len , width_type* lut_width , width_type* delta_width ) noexcept
+	{
+		// Only compress luts, whose indices would be at least 4 bytes wide
+		width_type width = basic_string::get_lut_width( data_len + 1 );
+		if( width < sizeof(std::uint32_t) || !lut_len )
+			return 0;
+		
+		width_type	plain_lut_width;
+		width_type	lut_width_1;
+		width_type	lut_width_2;
+		size_type	plain_buffer_size = determine_main_buffer_size( data_len , lut_len , &plain_lut_width );
+		size_type	buffer_size_1 = determine_compressed_buffer_size( data_len , lut_len , sizeof(std::uint8_t) , &lut_width_1 );
+		size_type	buffer_size_2 = determine_compressed_buffer_size( data_len , lut_len , sizeof(std::uint16_t) , &lut_width_2 );
+		
+		// Pick the smaller delta width
+		*lut_width = buffer_size_1 <= buffer_size_2 ? lut_width_1 : lut_width_2;
+		*delta_width = buffer_size_1 <= buffer_size_2 ? sizeof(std::uint8_t) : sizeof(std::uint16_t);
+		size_type buffer_size = std::min( buffer_size_1 , buffer_size_2 );
+		return buffer_size < plain_buffer_size ? buffer_size : 0;
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	typename basic_string<V, D, A, S, C>::size_type basic_string<V, D, A, S, C>::determine_compressed_buffer_size( size_type data_len , size_type lut_len , width_type delta_width , width_type* lut_width ) noexcept
+	{
+		// The width of the block table depends on the resulting buffer size, so start with the smallest possible one
+		width_type width = basic_string::get_lut_width( data_len + 1 );
+		for( ;; ){
+			size_type	buffer_size = round_up_to_align( data_len + 1 + basic_string::get_num_lut_blocks( data_len , delta_width ) * width + lut_len * delta_width );
+			if( basic_string::get_lut_width( buffer_size ) == width ){
+				*lut_width = width;
+				return buffer_size;
+			}
+			width = basic_string::get_lut_width( buffer_size );
+		}
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	void basic_string<V, D, A, S, C>::shrink_to_fit() noexcept(TINY_UTF8_NOEXCEPT)
 	{
 		if( sso_active() )
 			return;
@@ -3308,11 +7015,31 @@ namespace tiny_utf8
 		data_type*	buffer = get_buffer();
 		data_type*	lut_base_ptr = basic_string::get_lut_base_ptr( buffer , buffer_size );
 		size_type	required_buffer_size;
+		width_type	new_lut_width;
+		width_type	delta_width;
 		
-		if( is_lut_active( lut_base_ptr ) )
+		if( is_lut_active( lut_base_ptr ) && is_lut_compressed( lut_base_ptr ) )
+			return; // As small as it gets
+		else if( is_lut_active( lut_base_ptr ) && ( required_buffer_size = determine_compressed_buffer_size( data_len , get_lut_len( lut_base_ptr ) , &new_lut_width , &delta_width ) ) )
+		{
+			// Compress the lut of a large string
+			size_type	lut_len				= get_lut_len( lut_base_ptr );
+			width_type	old_lut_width		= basic_string::get_lut_width( buffer_size );
+			size_type	num_blocks			= basic_string::get_num_lut_blocks( data_len , delta_width );
+			t_non_sso.data					= this->allocate(  determine_total_buffer_size( required_buffer_size ) );
+			data_type*	new_lut_base_ptr	= basic_string::get_lut_base_ptr( t_non_sso.data , required_buffer_size );
+			TINY_UTF8_COUNT( lut_compressions , 1 );
+			
+			// Write the deltas and the number of indices up to the end of each block
+			basic_string::write_compressed_lut( new_lut_base_ptr , new_lut_width , delta_width , num_blocks , 0 , lut_len
+				, [&](){ return basic_string::get_lut( lut_base_ptr -= old_lut_width , old_lut_width ); }
+				, 0 , num_blocks
+			);
+			basic_string::set_compressed_lut_indicator( new_lut_base_ptr , lut_len , delta_width );
+		}
+		else if( is_lut_active( lut_base_ptr ) )
 		{
 			size_type	lut_len				= get_lut_len( lut_base_ptr );
-			width_type	new_lut_width;
 			required_buffer_size			= determine_main_buffer_size( data_len , lut_len , &new_lut_width );
 			
 			//! Determine the threshold above which it's profitable to reallocate (at least 10 bytes and at least a quarter of the memory)
@@ -3323,6 +7050,8 @@ namespace tiny_utf8
 			t_non_sso.data					= this->allocate(  determine_total_buffer_size( required_buffer_size ) );
 			width_type	old_lut_width		= basic_string::get_lut_width( buffer_size );
 			data_type*	new_lut_base_ptr	= basic_string::get_lut_base_ptr( t_non_sso.data , required_buffer_size );
+			TINY_UTF8_COUNT( lut_rebuilds , 1 );
+			TINY_UTF8_COUNT( lut_width_changes , old_lut_width != new_lut_width );
 			
 			// Does the data type width change?
 			if( old_lut_width != new_lut_width ){ // Copy indices one at a time
@@ -3341,86 +7070,605 @@ namespace tiny_utf8
 		}
 		else
 		{
-			required_buffer_size = determine_main_buffer_size( data_len );
+			required_buffer_size = determine_main_buffer_size( data_len );
+			
+			//! Determine the threshold above which it's profitable to reallocate (at least 10 bytes and at least a quarter of the memory)
+			if( buffer_size < std::max<size_type>( required_buffer_size + 10 , required_buffer_size >> 2 ) )
+				return;
+			
+			t_non_sso.data = this->allocate(  determine_total_buffer_size( required_buffer_size ) ); // Allocate new buffer
+			basic_string::set_lut_indiciator( basic_string::get_lut_base_ptr( t_non_sso.data , required_buffer_size ) , false );
+		}
+		
+		// Copy BUFFER
+		std::memcpy( t_non_sso.data , buffer , data_len + 1 );
+		t_non_sso.buffer_size = required_buffer_size; // Set new buffer size
+		
+		// Delete old buffer
+		this->deallocate( buffer , buffer_size );
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	typename basic_string<V, D, A, S, C>::size_type basic_string<V, D, A, S, C>::get_non_sso_capacity() const noexcept
+	{
+		size_type	data_len		= t_non_sso.data_len;
+		size_type	buffer_size		= t_non_sso.buffer_size;
+		
+		// If empty, assume an average number of bytes per codepoint of '1' (and an empty lut)
+		if( !data_len )
+			return buffer_size - 1;
+		
+		const data_type*	buffer			= t_non_sso.data;
+		size_type	string_len				= get_non_sso_string_len();
+		const data_type*	lut_base_ptr	= basic_string::get_lut_base_ptr( buffer , buffer_size );
+		
+		// If the lut is active, add the number of additional bytes to the current data length
+		if( basic_string::is_lut_active( lut_base_ptr ) )
+			data_len += basic_string::get_lut_size( lut_base_ptr , data_len , basic_string::get_lut_width( buffer_size ) );
+		
+		// Return the buffer size (excluding the potential trailing '\0') divided by the average number of bytes per codepoint
+		return ( buffer_size - 1 ) * string_len / data_len;
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	memory_usage_info basic_string<V, D, A, S, C>::memory_usage() const noexcept
+	{
+		memory_usage_info result;
+		result.num_strings	= 1;
+		result.object_bytes	= sizeof(basic_string);
+		result.data_bytes	= size();
+		
+		if( sso_active() )
+			return result;
+		
+		size_type			buffer_size		= t_non_sso.buffer_size;
+		const data_type*	lut_base_ptr	= basic_string::get_lut_base_ptr( t_non_sso.data , buffer_size );
+		
+		result.num_heap_strings	= 1;
+		result.terminator_bytes	= 1;
+		result.indicator_bytes	= sizeof(indicator_type);
+		result.ref_count_bytes	= C ? sizeof(size_type) : 0;
+		result.heap_bytes		= basic_string::determine_total_buffer_size( buffer_size ) + result.ref_count_bytes;
+		
+		if( basic_string::is_lut_active( lut_base_ptr ) ){
+			result.num_luts				= 1;
+			result.num_compressed_luts	= basic_string::is_lut_compressed( lut_base_ptr );
+			result.lut_entries			= basic_string::get_lut_len( lut_base_ptr );
+			result.lut_bytes			= basic_string::get_lut_size( lut_base_ptr , result.data_bytes , basic_string::get_lut_width( buffer_size ) );
+		}
+		
+		result.unused_bytes = buffer_size - result.data_bytes - result.terminator_bytes - result.lut_bytes;
+		return result;
+	}
+	
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	bool basic_string<V, D, A, S, C>::requires_unicode_sso() const noexcept
+	{
+		constexpr size_type mask = get_msb_mask<size_type>();
+		size_type			data_len = get_sso_data_len();
+		size_type			i = 0;
+		
+		// Search sizeof(size_type) bytes at once
+		for( ; i < data_len / sizeof(size_type) ; i++ )
+			if( ((size_type*)t_sso.data)[i] & mask )
+				return true;
+		
+		// Search byte-wise
+		i *= sizeof(size_type);
+		for( ; i < data_len ; i++ )
+			if( t_sso.data[i] & 0x80 )
+				return true;
+		
+		return false;
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	std::basic_string<typename basic_string<V, D, A, S, C>::data_type> basic_string<V, D, A, S, C>::cpp_str_bom() const noexcept
+	{
+		// Create std::string
+		std::basic_string<data_type>	result = std::basic_string<data_type>( size() + 3 , ' ' );
+		data_type*						tmp_buffer = const_cast<data_type*>( result.data() );
+		
+		// Write BOM
+		tmp_buffer[0] = static_cast<data_type>(0xEF);
+		tmp_buffer[1] = static_cast<data_type>(0xBB);
+		tmp_buffer[2] = static_cast<data_type>(0xBF);
+		
+		// Copy my data into it
+		std::memcpy( tmp_buffer + 3 , get_buffer() , size() + 1 );
+		
+		return result;
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	template<typename Delimiter>
+	typename basic_string<V, D, A, S, C>::size_type basic_string<V, D, A, S, C>::extract( std::streambuf* buf , typename basic_string<V, D, A, S, C>::size_type max_bytes , Delimiter is_delimiter , bool& reached_eof ) noexcept(TINY_UTF8_NOEXCEPT)
+	{
+		using traits_type = std::streambuf::traits_type;
+		
+		clear();
+		
+		// While SSO is active, 'lut_base_ptr' is nullptr, 'lut_width' is 0 and 'buffer_size' also accounts for the '\0' that SSO stores in 't_sso.data_len'
+		data_type*	buffer			= t_sso.data;
+		size_type	buffer_size		= basic_string::get_sso_capacity() + 1;
+		data_type*	lut_base_ptr	= nullptr;
+		width_type	lut_width		= 0;
+		size_type	data_len		= 0;
+		size_type	string_len		= 0;
+		size_type	lut_len			= 0;
+		width_type	cp_bytes_left	= 0; // Number of bytes still missing of the codepoint currently read
+		
+		reached_eof = false;
+		for( traits_type::int_type ch = buf->sgetc() ; ; ch = buf->snextc() )
+		{
+			if( traits_type::eq_int_type( ch , traits_type::eof() ) ){
+				reached_eof = true;
+				break;
+			}
+			data_type byte = (data_type)traits_type::to_char_type( ch );
+			if( data_len == max_bytes || is_delimiter( byte ) )
+				break;
+			
+			// Make sure, there is room for the byte, the trailing '\0' and another index in the lut
+			if( data_len + 2 + ( lut_len + 1 ) * lut_width > buffer_size )
+			{
+				width_type	new_lut_width;
+				size_type	new_buffer_size = grow_buffer_size( determine_main_buffer_size( data_len + 1 , lut_len + 1 , &new_lut_width ) ); // Amortize allocations
+				data_type*	new_buffer = this->allocate( determine_total_buffer_size( new_buffer_size ) );
+			#if defined(TINY_UTF8_NOEXCEPT)
+				if( !new_buffer )
+					break;
+			#endif
+				data_type*	new_lut_base_ptr = basic_string::get_lut_base_ptr( new_buffer , new_buffer_size );
+				new_lut_width = basic_string::get_lut_width( new_buffer_size );
+				
+				// Copy data
+				std::memcpy( new_buffer , buffer , data_len );
+				
+				// Copy the lut or build it from the sso data
+				if( lut_base_ptr )
+				{
+					TINY_UTF8_COUNT( lut_rebuilds , 1 );
+					TINY_UTF8_COUNT( lut_width_changes , new_lut_width != lut_width );
+					if( new_lut_width != lut_width ){
+						data_type*	lut_iter = lut_base_ptr;
+						data_type*	new_lut_iter = new_lut_base_ptr;
+						for( size_type num_indices = lut_len ; num_indices-- > 0 ; )
+							basic_string::set_lut( new_lut_iter -= new_lut_width , new_lut_width , basic_string::get_lut( lut_iter -= lut_width , lut_width ) );
+					}
+					else
+						std::memcpy( new_lut_base_ptr - lut_len * lut_width , lut_base_ptr - lut_len * lut_width , lut_len * lut_width );
+					this->deallocate( buffer , buffer_size );
+				}
+				else
+				{
+					TINY_UTF8_COUNT( lut_builds , 1 );
+					TINY_UTF8_COUNT( sso_to_heap , 1 );
+					
+					// The codepoint currently read might not be complete, so the lead bytes are read like they are
+					data_type* new_lut_iter = new_lut_base_ptr;
+					for( size_type iter = 0 ; iter < data_len ; ){
+						width_type bytes = get_codepoint_bytes( buffer[iter] , basic_string::npos );
+						if( bytes > 1 )
+							basic_string::set_lut( new_lut_iter -= new_lut_width , new_lut_width , iter );
+						iter += bytes;
+					}
+				}
+				
+				// Hand the buffer over to this string right away (the attributes are set, after we're done)
+				basic_string::set_lut_indiciator( new_lut_base_ptr , true , 0 );
+				t_non_sso.data = buffer = new_buffer;
+				t_non_sso.buffer_size = buffer_size = new_buffer_size;
+				t_non_sso.data_len = 0;
+				set_non_sso_string_len( 0 );
+				lut_base_ptr = new_lut_base_ptr;
+				lut_width = new_lut_width;
+			}
+			
+			// Start of a new codepoint?
+			if( !cp_bytes_left )
+			{
+				cp_bytes_left = get_codepoint_bytes( byte , basic_string::npos );
+				++string_len;
+				if( cp_bytes_left > 1 ){
+					if( lut_base_ptr )
+						basic_string::set_lut( lut_base_ptr - ( lut_len + 1 ) * lut_width , lut_width , data_len );
+					++lut_len;
+				}
+			}
+			--cp_bytes_left;
+			
+			buffer[data_len++] = byte;
+		}
+		
+		// Note: An incomplete last codepoint stays counted as one multibyte, just like the byte constructor counts it
+		buffer[data_len] = '\0'; // Trailing '\0'
+		
+		// Set Attributes
+		if( lut_base_ptr )
+		{
+			if( basic_string::is_lut_worth( lut_len , string_len , false , false ) )
+				basic_string::set_lut_indiciator( lut_base_ptr , true , lut_len );
+			else
+				basic_string::set_lut_indiciator( lut_base_ptr , lut_len == 0 , 0 );
+			t_non_sso.data_len = data_len;
+			set_non_sso_string_len( string_len );
+		}
+		else
+			set_sso_data_len( (unsigned char)data_len );
+		
+		return data_len;
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	template<typename Reader>
+	bool basic_string<V, D, A, S, C>::read_file( typename basic_string<V, D, A, S, C>::size_type data_len , Reader read ) noexcept(TINY_UTF8_NOEXCEPT)
+	{
+		clear();
+		
+		// Reads until 'count' bytes were read or the input ended
+		auto read_fully = [&read]( data_type* dest , size_type count ) -> size_type {
+			size_type total = 0;
+			while( total < count ){
+				size_type num_read = read( dest + total , count - total );
+				if( num_read == basic_string::npos )
+					return basic_string::npos;
+				if( !num_read )
+					break;
+				total += num_read;
+			}
+			return total;
+		};
+		
+		// Size unknown? Then decode the input chunk by chunk
+		if( !data_len || data_len == basic_string::npos )
+		{
+			data_type							chunk[4096];
+			basic_stream_decoder<basic_string>	decoder( *this );
+			size_type							num_read = read_fully( chunk , sizeof(chunk) );
+			if( num_read == basic_string::npos )
+				return false;
 			
-			//! Determine the threshold above which it's profitable to reallocate (at least 10 bytes and at least a quarter of the memory)
-			if( buffer_size < std::max<size_type>( required_buffer_size + 10 , required_buffer_size >> 2 ) )
-				return;
+			// Strip BOM
+			size_type offset = num_read >= 3
+				&& (unsigned char)chunk[0] == 0xEF && (unsigned char)chunk[1] == 0xBB && (unsigned char)chunk[2] == 0xBF ? 3 : 0;
+			decoder.feed( chunk + offset , num_read - offset );
 			
-			t_non_sso.data = this->allocate(  determine_total_buffer_size( required_buffer_size ) ); // Allocate new buffer
+			while( num_read == sizeof(chunk) ){
+				if( ( num_read = read_fully( chunk , sizeof(chunk) ) ) == basic_string::npos )
+					return false;
+				decoder.feed( chunk , num_read );
+			}
+			decoder.finish();
+			return true;
 		}
 		
-		// Copy BUFFER
-		std::memcpy( t_non_sso.data , buffer , data_len + 1 );
-		t_non_sso.buffer_size = required_buffer_size; // Set new buffer size
+		data_type*	buffer = t_sso.data;
+		size_type	buffer_size = 0;
+		width_type	lut_width = 0;
 		
-		// Delete old buffer
-		this->deallocate( buffer , buffer_size );
-	}
-
-	template<typename V, typename D, typename A>
-	typename basic_string<V, D, A>::size_type basic_string<V, D, A>::get_non_sso_capacity() const noexcept
-	{
-		size_type	data_len		= t_non_sso.data_len;
-		size_type	buffer_size		= t_non_sso.buffer_size;
+		// Need heap memory? Most files are (mostly) ascii. Hence, only reserve space for a lut of one entry per 64 bytes
+		if( data_len > basic_string::get_sso_capacity() )
+		{
+			buffer_size = determine_main_buffer_size( data_len , data_len / 64 + 1 , &lut_width );
+			buffer = this->allocate( determine_total_buffer_size( buffer_size ) );
+		#if defined(TINY_UTF8_NOEXCEPT)
+			if( !buffer )
+				return false;
+		#endif
+		}
 		
-		// If empty, assume an average number of bytes per codepoint of '1' (and an empty lut)
-		if( !data_len )
-			return buffer_size - 1;
+		// Read the first three bytes separately, in order to drop a BOM without having to move the data
+		size_type	head_len = read_fully( buffer , std::min<size_type>( data_len , 3 ) );
+		size_type	tail_len = 0;
+		bool		complete = head_len == std::min<size_type>( data_len , 3 );
+		if( head_len == 3 && (unsigned char)buffer[0] == 0xEF && (unsigned char)buffer[1] == 0xBB && (unsigned char)buffer[2] == 0xBF )
+			head_len = 0;
+		if( complete && data_len > 3 ){
+			tail_len = read_fully( buffer + head_len , data_len - 3 );
+			complete = tail_len == data_len - 3;
+		}
 		
-		const data_type*	buffer			= t_non_sso.data;
-		size_type	string_len				= get_non_sso_string_len();
-		const data_type*	lut_base_ptr	= basic_string::get_lut_base_ptr( buffer , buffer_size );
+		// If everything was read, make sure the input did not grow in the meantime (it would be truncated otherwise)
+		data_type probe;
+		if( head_len == basic_string::npos || tail_len == basic_string::npos || ( complete && read_fully( &probe , 1 ) != 0 ) ){
+			if( buffer_size )
+				this->deallocate( buffer , buffer_size );
+			return false;
+		}
+		data_len = head_len + tail_len;
 		
-		// If the lut is active, add the number of additional bytes to the current data length
-		if( basic_string::is_lut_active( lut_base_ptr ) )
-			data_len += basic_string::get_lut_width( buffer_size ) * basic_string::get_lut_len( lut_base_ptr );
+		// Fits into sso after all?
+		if( data_len <= basic_string::get_sso_capacity() )
+		{
+			if( buffer_size ){
+				std::memcpy( t_sso.data , buffer , data_len );
+				this->deallocate( buffer , buffer_size );
+			}
+			t_sso.data[data_len] = '\0';
+			set_sso_data_len( (unsigned char)data_len );
+			return true;
+		}
+		
+		// Count codepoints and fill the lut in the same pass (as long as it fits into the reserved space)
+		const unsigned char*	begin = reinterpret_cast<const unsigned char*>( buffer );
+		const unsigned char*	end = begin + data_len;
+		const unsigned char*	iter = begin;
+		data_type*				lut_base_ptr = basic_string::get_lut_base_ptr( buffer , buffer_size );
+		size_type				max_lut_len = ( buffer_size - data_len - 1 ) / lut_width;
+		size_type				string_len = 0;
+		size_type				num_multibytes = 0;
+		while( true )
+		{
+			const unsigned char* ascii_end = tiny_utf8_detail::skip_ascii( iter , end );
+			string_len += ascii_end - iter;
+			if( ( iter = ascii_end ) == end )
+				break;
+			width_type bytes = get_codepoint_bytes( *iter , end - iter );
+			if( bytes > 1 && num_multibytes++ < max_lut_len )
+				basic_string::set_lut( lut_base_ptr - num_multibytes * lut_width , lut_width , iter - begin );
+			string_len += 1;
+			iter += bytes;
+		}
+		buffer[data_len] = '\0'; // Trailing '\0'
+		
+		// Set up the lut, if it's worth it and fits
+		bool lut_worth = basic_string::is_lut_worth( num_multibytes , string_len , false , false );
+		if( lut_worth && num_multibytes <= max_lut_len ){
+			basic_string::set_lut_indiciator( lut_base_ptr , true , num_multibytes );
+			TINY_UTF8_COUNT( lut_builds , 1 );
+		}
+		else
+			basic_string::set_lut_indiciator( lut_base_ptr , num_multibytes == 0 , 0 );
 		
-		// Return the buffer size (excluding the potential trailing '\0') divided by the average number of bytes per codepoint
-		return ( buffer_size - 1 ) * string_len / data_len;
+		// Set Attributes
+		t_non_sso.data = buffer;
+		t_non_sso.buffer_size = buffer_size;
+		t_non_sso.data_len = data_len;
+		set_non_sso_string_len( string_len );
+		
+		// The lut did not fit? Then build the string anew at its exact size, which is the only case the data is copied
+		if( lut_worth && num_multibytes > max_lut_len ){
+			basic_string with_lut( (const allocator_type&)*this );
+			with_lut.assign_counted( buffer , data_len , string_len , num_multibytes );
+			if( with_lut.sso_inactive() ) // Otherwise, the allocation failed and we keep the string without lut
+				*this = std::move( with_lut );
+		}
+		
+		return true;
 	}
 
-	template<typename V, typename D, typename A>
-	bool basic_string<V, D, A>::requires_unicode_sso() const noexcept
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	bool basic_string<V, D, A, S, C>::serialize( std::ostream& out ) const noexcept(TINY_UTF8_NOEXCEPT)
 	{
-		constexpr size_type mask = get_msb_mask<size_type>();
-		size_type			data_len = get_sso_data_len();
-		size_type			i = 0;
-		
-		// Search sizeof(size_type) bytes at once
-		for( ; i < data_len / sizeof(size_type) ; i++ )
-			if( ((size_type*)t_sso.data)[i] & mask )
-				return true;
-		
-		// Search byte-wise
-		i *= sizeof(size_type);
-		for( ; i < data_len ; i++ )
-			if( t_sso.data[i] & 0x80 )
-				return true;
+		const data_type*	buffer = get_buffer();
+		size_type			data_len = size();
+		size_type			string_len;
+		bool				lut_active;
+		size_type			lut_len = 0;
+		width_type			lut_width = 0; // The width of the serialized lut, which is the one a buffer of minimal size would use
+		const data_type*	lut_base_ptr = nullptr;
+		
+		if( sso_inactive() ){
+			string_len = get_non_sso_string_len();
+			lut_base_ptr = basic_string::get_lut_base_ptr( buffer , t_non_sso.buffer_size );
+			lut_active = basic_string::is_lut_active( lut_base_ptr );
+			if( lut_active ){
+				lut_len = basic_string::get_lut_len( lut_base_ptr );
+				determine_main_buffer_size( data_len , lut_len , &lut_width );
+			}
+		}
+		else{
+			string_len = get_num_codepoints( 0 , data_len );
+			lut_active = string_len == data_len; // Only ascii strings have an active lut without setting it up
+		}
+		
+		// Write Header
+		unsigned char	header[2 + 3 * ( sizeof(size_type) * 8 / 7 + 1 ) + 4];
+		unsigned char*	header_iter = header;
+		*header_iter++ = tiny_utf8_detail::serialization_version;
+		*header_iter++ = (unsigned char)( lut_active ? ( lut_width << 1 ) | 0x1 : 0x0 );
+		header_iter = tiny_utf8_detail::write_varint( header_iter , data_len );
+		header_iter = tiny_utf8_detail::write_varint( header_iter , string_len );
+		header_iter = tiny_utf8_detail::write_varint( header_iter , lut_len );
+		std::uint32_t check = tiny_utf8_detail::fnv1a( header , header_iter - header );
+		for( int i = 0 ; i < 4 ; ++i , check >>= 8 )
+			*header_iter++ = (unsigned char)check;
+		out.write( reinterpret_cast<const char*>( header ) , header_iter - header );
+		
+		// Write Data
+		out.write( reinterpret_cast<const char*>( buffer ) , data_len );
+		
+		// Write LUT (in the same order as it resides in memory)
+		if( lut_len )
+		{
+			width_type	buffer_lut_width = basic_string::get_lut_width( t_non_sso.buffer_size );
+			if( basic_string::is_lut_compressed( lut_base_ptr ) )
+			{
+				// Decompress the entries in blocks, starting with the last one
+				unsigned char			block[512];
+				compressed_lut_reader	reader( lut_base_ptr , data_len , buffer_lut_width );
+				for( size_type num_left = lut_len ; num_left ; )
+				{
+					size_type		num_entries = std::min<size_type>( num_left , sizeof(block) / lut_width );
+					unsigned char*	block_iter = block + num_entries * lut_width;
+					reader.seek_index( num_left -= num_entries );
+					for( size_type i = 0 ; i < num_entries ; ++i ){
+						size_type entry = reader.next();
+						block_iter -= lut_width;
+						for( width_type byte = 0 ; byte < lut_width ; ++byte , entry >>= 8 )
+							block_iter[byte] = (unsigned char)entry;
+					}
+					out.write( reinterpret_cast<const char*>( block ) , num_entries * lut_width );
+				}
+			}
+			else if( buffer_lut_width == lut_width && tiny_utf8_detail::is_little_endian::value )
+				out.write( reinterpret_cast<const char*>( lut_base_ptr - lut_len * lut_width ) , lut_len * lut_width );
+			else
+			{
+				// Convert the entries in blocks
+				unsigned char		block[512];
+				const data_type*	lut_iter = lut_base_ptr - lut_len * buffer_lut_width;
+				for( size_type num_left = lut_len ; num_left ; )
+				{
+					size_type		num_entries = std::min<size_type>( num_left , sizeof(block) / lut_width );
+					unsigned char*	block_iter = block;
+					for( size_type i = 0 ; i < num_entries ; ++i , lut_iter += buffer_lut_width ){
+						size_type entry = basic_string::get_lut( lut_iter , buffer_lut_width );
+						for( width_type byte = 0 ; byte < lut_width ; ++byte , entry >>= 8 )
+							*block_iter++ = (unsigned char)entry;
+					}
+					out.write( reinterpret_cast<const char*>( block ) , block_iter - block );
+					num_left -= num_entries;
+				}
+			}
+		}
 		
-		return false;
+		return out.good();
 	}
 
-	template<typename V, typename D, typename A>
-	std::basic_string<typename basic_string<V, D, A>::data_type> basic_string<V, D, A>::cpp_str_bom() const noexcept
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	bool basic_string<V, D, A, S, C>::deserialize( std::istream& in ) noexcept(TINY_UTF8_NOEXCEPT)
 	{
-		// Create std::string
-		std::basic_string<data_type>	result = std::basic_string<data_type>( size() + 3 , ' ' );
-		data_type*						tmp_buffer = const_cast<data_type*>( result.data() );
+		clear();
+		
+		std::istream::sentry sentry( in , true );
+		if( !sentry )
+			return false;
+		
+		std::streambuf*	buf = in.rdbuf();
+		unsigned char	header[2 + 3 * ( sizeof(size_type) * 8 / 7 + 1 ) + 4];
+		unsigned char*	header_iter = header;
+		size_type		data_len;
+		size_type		string_len;
+		size_type		lut_len;
+		
+		// Read Header
+		if( buf->sgetn( reinterpret_cast<char*>( header_iter ) , 2 ) != 2
+			|| header[0] != tiny_utf8_detail::serialization_version
+			|| ( header[1] & 0xE0 )
+			|| !tiny_utf8_detail::read_varint( buf , data_len , header_iter += 2 )
+			|| !tiny_utf8_detail::read_varint( buf , string_len , header_iter )
+			|| !tiny_utf8_detail::read_varint( buf , lut_len , header_iter )
+		){
+			in.setstate( std::ios_base::failbit );
+			return false;
+		}
+		unsigned char check[4];
+		std::uint32_t expected_check = tiny_utf8_detail::fnv1a( header , header_iter - header );
+		bool			lut_active = header[1] & 0x1;
+		width_type		lut_width = header[1] >> 1;
+		width_type		required_lut_width = 0;
+		size_type		buffer_size = lut_active
+			? determine_main_buffer_size( data_len , lut_len , &required_lut_width )
+			: determine_main_buffer_size( data_len );
+		if( buf->sgetn( reinterpret_cast<char*>( check ) , 4 ) != 4
+			|| check[0] != (unsigned char)expected_check || check[1] != (unsigned char)( expected_check >> 8 )
+			|| check[2] != (unsigned char)( expected_check >> 16 ) || check[3] != (unsigned char)( expected_check >> 24 )
+			|| string_len > data_len
+			|| buffer_size > basic_string::get_max_buffer_size() // Exceeds the range of size_type
+			|| ( !lut_active && lut_len )
+			|| ( lut_active && ( data_len - string_len < lut_len || ( lut_len ? lut_width != required_lut_width : string_len != data_len ) ) )
+		){
+			in.setstate( std::ios_base::failbit );
+			return false;
+		}
+		
+		// Fits into sso?
+		if( data_len <= basic_string::get_sso_capacity() )
+		{
+			if( buf->sgetn( reinterpret_cast<char*>( t_sso.data ) , data_len ) != std::streamsize( data_len ) ){
+				in.setstate( std::ios_base::failbit | std::ios_base::eofbit );
+				return false;
+			}
+			t_sso.data[data_len] = '\0';
+			set_sso_data_len( (unsigned char)data_len );
+			return true;
+		}
 		
-		// Write BOM
-		tmp_buffer[0] = static_cast<data_type>(0xEF);
-		tmp_buffer[1] = static_cast<data_type>(0xBB);
-		tmp_buffer[2] = static_cast<data_type>(0xBF);
+		// Compress the lut of a large string?
+		width_type	compressed_lut_width = 0;
+		width_type	delta_width = 0;
+		size_type	compressed_buffer_size = lut_active ? determine_compressed_buffer_size( data_len , lut_len , &compressed_lut_width , &delta_width ) : 0;
+		if( compressed_buffer_size )
+			buffer_size = compressed_buffer_size;
 		
-		// Copy my data into it
-		std::memcpy( tmp_buffer + 3 , get_buffer() , size() + 1 );
+		data_type* buffer = this->allocate( determine_total_buffer_size( buffer_size ) );
+	#if defined(TINY_UTF8_NOEXCEPT)
+		if( !buffer ){
+			in.setstate( std::ios_base::failbit );
+			return false;
+		}
+	#endif
+		data_type*	lut_base_ptr = basic_string::get_lut_base_ptr( buffer , buffer_size );
 		
-		return result;
+		// Read Data and LUT
+		bool success = buf->sgetn( reinterpret_cast<char*>( buffer ) , data_len ) == std::streamsize( data_len );
+		
+		if( success && lut_len )
+		{
+			// A lut, that is compressed, is read into a temporary array first
+			std::unique_ptr<data_type[]>	plain_lut( compressed_buffer_size ? new data_type[lut_len * lut_width] : nullptr );
+			data_type*						lut_end = compressed_buffer_size ? plain_lut.get() + lut_len * lut_width : lut_base_ptr;
+			data_type*						lut_begin = lut_end - lut_len * lut_width;
+			success = buf->sgetn( reinterpret_cast<char*>( lut_begin ) , lut_len * lut_width ) == std::streamsize( lut_len * lut_width );
+			
+			// Convert the entries from little endian
+			if( success && !tiny_utf8_detail::is_little_endian::value && lut_width > 1 )
+				for( data_type* lut_iter = lut_begin ; lut_iter < lut_end ; lut_iter += lut_width ){
+					size_type entry = 0;
+					for( width_type byte = lut_width ; byte-- > 0 ; )
+						entry = ( entry << 8 ) | (unsigned char)lut_iter[byte];
+					basic_string::set_lut( lut_iter , lut_width , entry );
+				}
+			
+			// Check all entries: They must be in order and point to (non-overlapping) multibytes
+			size_type min_index = 0;
+			for( const data_type* lut_iter = lut_end ; success && lut_iter > lut_begin ; ){
+				size_type	multibyte_index = basic_string::get_lut( lut_iter -= lut_width , lut_width );
+				width_type	bytes = multibyte_index >= min_index && multibyte_index < data_len
+					? basic_string::get_codepoint_bytes( buffer[multibyte_index] , data_len - multibyte_index )
+					: 0;
+				success = bytes > 1;
+				min_index = multibyte_index + bytes;
+			}
+			
+			// Compress the lut
+			if( success && compressed_buffer_size ){
+				size_type num_blocks = basic_string::get_num_lut_blocks( data_len , delta_width );
+				basic_string::write_compressed_lut( lut_base_ptr , compressed_lut_width , delta_width , num_blocks , 0 , lut_len
+					, [&](){ return basic_string::get_lut( lut_end -= lut_width , lut_width ); }
+					, 0 , num_blocks
+				);
+				TINY_UTF8_COUNT( lut_compressions , 1 );
+			}
+		}
+		
+		if( !success ){
+			this->deallocate( buffer , buffer_size );
+			in.setstate( std::ios_base::failbit );
+			return false;
+		}
+		
+		buffer[data_len] = '\0'; // Trailing '\0'
+		
+		// Set up LUT
+		if( compressed_buffer_size )
+			basic_string::set_compressed_lut_indicator( lut_base_ptr , lut_len , delta_width );
+		else
+			basic_string::set_lut_indiciator( lut_base_ptr , lut_active , lut_len );
+		
+		// Set Attributes
+		t_non_sso.data = buffer;
+		t_non_sso.buffer_size = buffer_size;
+		t_non_sso.data_len = data_len;
+		set_non_sso_string_len( string_len );
+		
+		return true;
 	}
 
-	template<typename V, typename D, typename A>
-	typename basic_string<V, D, A>::size_type basic_string<V, D, A>::get_num_codepoints( typename basic_string<V, D, A>::size_type index , typename basic_string<V, D, A>::size_type byte_count ) const noexcept
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	typename basic_string<V, D, A, S, C>::size_type basic_string<V, D, A, S, C>::get_num_codepoints( typename basic_string<V, D, A, S, C>::size_type index , typename basic_string<V, D, A, S, C>::size_type byte_count ) const noexcept
 	{
 		const data_type*	buffer;
 		size_type			data_len;
@@ -3444,6 +7692,18 @@ namespace tiny_utf8
 				const data_type*	lut_begin	= lut_iter - lut_len * lut_width;
 				size_type			end_index	= index + byte_count;
 				
+				// Compressed lut: Seek to the start of the relevant part of the multibyte table
+				if( basic_string::is_lut_compressed( lut_iter ) ){
+					compressed_lut_reader reader( lut_iter , data_len , lut_width );
+					for( reader.seek( index ) ; reader.index() < lut_len ; ){
+						size_type multibyte_index = reader.next();
+						if( multibyte_index >= end_index )
+							break;
+						byte_count -= basic_string::get_codepoint_bytes( buffer[multibyte_index] , data_len - multibyte_index ) - 1; // Subtract only the utf8 data bytes
+					}
+					return byte_count;
+				}
+				
 				// Iterate to the start of the relevant part of the multibyte table
 				while( lut_iter >= lut_begin ){
 					lut_iter -= lut_width; // Move cursor to the next lut entry
@@ -3472,6 +7732,8 @@ namespace tiny_utf8
 		// Procedure: Reduce the byte count by the number of data bytes within multibytes
 		const data_type*	buffer_iter = buffer + index;
 		const data_type*	fragment_end = buffer_iter + byte_count;
+		TINY_UTF8_COUNT( linear_scans , sso_inactive() );
+		TINY_UTF8_COUNT( bytes_scanned , sso_inactive() ? byte_count : 0 );
 		
 		// Iterate the data byte by byte...
 		while( buffer_iter < fragment_end ){
@@ -3484,8 +7746,8 @@ namespace tiny_utf8
 		return byte_count;
 	}
 
-	template<typename V, typename D, typename A>
-	typename basic_string<V, D, A>::size_type basic_string<V, D, A>::get_num_bytes_from_start( typename basic_string<V, D, A>::size_type cp_count ) const noexcept
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	typename basic_string<V, D, A, S, C>::size_type basic_string<V, D, A, S, C>::get_num_bytes_from_start( typename basic_string<V, D, A, S, C>::size_type cp_count ) const noexcept
 	{
 		const data_type*	buffer;
 		size_type			data_len;
@@ -3503,6 +7765,18 @@ namespace tiny_utf8
 				// Reduce the byte count by the number of data bytes within multibytes
 				width_type lut_width = basic_string::get_lut_width( buffer_size );
 				
+				// Compressed lut: Decode the indices one by one
+				if( basic_string::is_lut_compressed( lut_iter ) ){
+					compressed_lut_reader reader( lut_iter , data_len , lut_width );
+					for( size_type lut_len = basic_string::get_lut_len( lut_iter ) ; lut_len-- > 0 ; ){
+						size_type multibyte_index = reader.next();
+						if( multibyte_index >= cp_count )
+							break;
+						cp_count += basic_string::get_codepoint_bytes( buffer[multibyte_index] , data_len - multibyte_index ) - 1; // Subtract only the utf8 data bytes
+					}
+					return cp_count;
+				}
+				
 				// Iterate over relevant multibyte indices
 				for( size_type lut_len = basic_string::get_lut_len( lut_iter ) ; lut_len-- > 0 ; )
 				{
@@ -3524,11 +7798,13 @@ namespace tiny_utf8
 		while( cp_count-- > 0 && num_bytes <= data_len )
 			num_bytes += get_codepoint_bytes( buffer[num_bytes] , data_len - num_bytes );
 		
+		TINY_UTF8_COUNT( linear_scans , sso_inactive() );
+		TINY_UTF8_COUNT( bytes_scanned , sso_inactive() ? num_bytes : 0 );
 		return num_bytes;
 	}
 
-	template<typename V, typename D, typename A>
-	typename basic_string<V, D, A>::size_type basic_string<V, D, A>::get_num_bytes( typename basic_string<V, D, A>::size_type index , typename basic_string<V, D, A>::size_type cp_count ) const noexcept
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	typename basic_string<V, D, A, S, C>::size_type basic_string<V, D, A, S, C>::get_num_bytes( typename basic_string<V, D, A, S, C>::size_type index , typename basic_string<V, D, A, S, C>::size_type cp_count ) const noexcept
 	{
 		size_type			potential_end_index = index + cp_count;
 		const data_type*	buffer;
@@ -3559,6 +7835,18 @@ namespace tiny_utf8
 				width_type			lut_width = basic_string::get_lut_width( buffer_size );
 				const data_type*	lut_begin = lut_iter - lut_len * lut_width;
 				
+				// Compressed lut: Seek to the start of the relevant part of the multibyte table
+				if( basic_string::is_lut_compressed( lut_iter ) ){
+					compressed_lut_reader reader( lut_iter , data_len , lut_width );
+					for( reader.seek( index ) , index += cp_count ; reader.index() < lut_len ; ){
+						size_type multibyte_index = reader.next();
+						if( multibyte_index >= index )
+							break;
+						index += basic_string::get_codepoint_bytes( buffer[multibyte_index] , data_len - multibyte_index ) - 1; // Subtract only the utf8 data bytes
+					}
+					return index - orig_index;
+				}
+				
 				// Iterate to the start of the relevant part of the multibyte table
 				for( lut_iter -= lut_width /* Move to first entry */ ; lut_iter >= lut_begin ; lut_iter -= lut_width )
 					if( basic_string::get_lut( lut_iter , lut_width ) >= index )
@@ -3594,11 +7882,13 @@ namespace tiny_utf8
 		while( cp_count-- > 0 && index <= data_len )
 			index += get_codepoint_bytes( buffer[index] , data_len - index );
 		
+		TINY_UTF8_COUNT( linear_scans , sso_inactive() );
+		TINY_UTF8_COUNT( bytes_scanned , sso_inactive() ? index - orig_index : 0 );
 		return index - orig_index;
 	}
 
-	template<typename V, typename D, typename A>
-	basic_string<V, D, A> basic_string<V, D, A>::raw_substr( typename basic_string<V, D, A>::size_type index , typename basic_string<V, D, A>::size_type byte_count ) const noexcept(TINY_UTF8_NOEXCEPT)
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	basic_string<V, D, A, S, C> basic_string<V, D, A, S, C>::raw_substr( typename basic_string<V, D, A, S, C>::size_type index , typename basic_string<V, D, A, S, C>::size_type byte_count ) const noexcept(TINY_UTF8_NOEXCEPT)
 	{
 		// Bound checks...
 		size_type data_len = size();
@@ -3639,7 +7929,7 @@ namespace tiny_utf8
 		size_type			buffer_size		= t_non_sso.buffer_size;
 		const data_type*	buffer			= t_non_sso.data;
 		const data_type*	lut_base_ptr	= basic_string::get_lut_base_ptr( buffer , buffer_size );
-		bool				lut_active		= basic_string::is_lut_active( lut_base_ptr );
+		bool				lut_active		= basic_string::is_lut_active( lut_base_ptr ) && !basic_string::is_lut_compressed( lut_base_ptr ); // A compressed lut is not reused (the range is scanned instead)
 		width_type			lut_width; // Ignore uninitialized warning, see [5]
 		
 		// Count the number of SUBSTRING Multibytes and codepoints
@@ -3715,13 +8005,15 @@ namespace tiny_utf8
 							, basic_string::get_lut( lut_iter -= lut_width , lut_width ) - index
 						);
 			}
-			else // Fill the lut by iterating over the substrings data
+			else{ // Fill the lut by iterating over the substrings data
+				TINY_UTF8_COUNT( lut_builds , 1 );
 				for( size_type	substr_iter = 0 ; substr_iter < byte_count ; ){
 					width_type bytes = get_codepoint_bytes( substr_buffer[substr_iter] , byte_count - substr_iter );
 					if( bytes > 1 )
 						basic_string::set_lut( substr_lut_base_ptr -= substr_lut_width , substr_lut_width , substr_iter );
 					substr_iter += bytes;
 				}
+			}
 		}
 		else // Set substring lut mode
 			basic_string::set_lut_indiciator( substr_lut_base_ptr , substr_mbs == 0 , 0 );
@@ -3736,8 +8028,8 @@ namespace tiny_utf8
 		return result;
 	}
 
-	template<typename V, typename D, typename A>
-	basic_string<V, D, A>& basic_string<V, D, A>::append( const basic_string<V, D, A>& app ) noexcept(TINY_UTF8_NOEXCEPT)
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	basic_string<V, D, A, S, C>& basic_string<V, D, A, S, C>::append( const basic_string<V, D, A, S, C>& app ) noexcept(TINY_UTF8_NOEXCEPT)
 	{
 		// Will add nothing?
 		bool app_sso_inactive = app.sso_inactive();
@@ -3748,6 +8040,10 @@ namespace tiny_utf8
 		// Compute some metrics
 		size_type old_data_len	= size();
 		size_type new_data_len	= old_data_len + app_data_len;
+		if( new_data_len < old_data_len ){ // Integer overflow in sum
+			TINY_UTF8_THROW( "tiny_utf8::basic_string::append" , new_data_len > max_size() );
+			return *this;
+		}
 		
 		// Will be sso string?
 		if( new_data_len <= basic_string::get_sso_capacity() ){
@@ -3759,6 +8055,9 @@ namespace tiny_utf8
 		
 		//! Ok, obviously no small string, we have to update the data, the lut and the number of codepoints
 		
+		// Make the buffer writable before referencing the appendix, which might be this string itself (a compressed lut is extended by raw_append instead)
+		if( !has_compressed_lut() && !make_writable() )
+			return *this;
 		
 		// Count codepoints and multibytes of insertion
 		bool				app_lut_active;
@@ -3775,7 +8074,7 @@ namespace tiny_utf8
 			
 			// Compute the number of multibytes
 			app_lut_base_ptr = basic_string::get_lut_base_ptr( app_buffer , app_buffer_size );
-			app_lut_active = basic_string::is_lut_active( app_lut_base_ptr );
+			app_lut_active = basic_string::is_lut_active( app_lut_base_ptr ) && !basic_string::is_lut_compressed( app_lut_base_ptr ); // A compressed lut is not reused
 			if( app_lut_active )
 				app_lut_len = basic_string::get_lut_len( app_lut_base_ptr );
 			else{
@@ -3799,6 +8098,150 @@ namespace tiny_utf8
 			}
 		}
 		
+		return raw_append(
+			app_buffer
+			, app_data_len
+			, app_string_len
+			, app_lut_len
+			, app_lut_active ? app_lut_base_ptr : nullptr
+			, app_lut_active ? basic_string::get_lut_width( app_buffer_size ) : 0
+		);
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	basic_string<V, D, A, S, C>& basic_string<V, D, A, S, C>::raw_append_compressed(
+		const typename basic_string<V, D, A, S, C>::data_type* app_buffer
+		, typename basic_string<V, D, A, S, C>::size_type app_data_len
+		, typename basic_string<V, D, A, S, C>::size_type app_string_len
+		, typename basic_string<V, D, A, S, C>::size_type app_lut_len
+		, const typename basic_string<V, D, A, S, C>::data_type* app_lut_base_ptr
+		, typename basic_string<V, D, A, S, C>::width_type app_lut_width
+	) noexcept(TINY_UTF8_NOEXCEPT)
+	{
+		// Compute some metrics (the delta width is kept)
+		size_type	old_data_len		= t_non_sso.data_len;
+		size_type	new_data_len		= old_data_len + app_data_len;
+		size_type	old_buffer_size		= t_non_sso.buffer_size;
+		data_type*	old_buffer			= t_non_sso.data;
+		data_type*	old_lut_base_ptr	= basic_string::get_lut_base_ptr( old_buffer , old_buffer_size );
+		width_type	old_lut_width		= basic_string::get_lut_width( old_buffer_size );
+		size_type	old_lut_len			= basic_string::get_lut_len( old_lut_base_ptr );
+		width_type	delta_width			= basic_string::get_lut_delta_width( old_lut_base_ptr );
+		size_type	old_num_blocks		= basic_string::get_num_lut_blocks( old_data_len , delta_width );
+		size_type	new_num_blocks		= basic_string::get_num_lut_blocks( new_data_len , delta_width );
+		size_type	new_lut_len			= old_lut_len + app_lut_len;
+		size_type	new_buffer_size		= old_buffer_size;
+		data_type*	new_buffer			= old_buffer;
+		width_type	new_lut_width		= old_lut_width;
+		data_type*	old_delta_begin		= old_lut_base_ptr - old_num_blocks * old_lut_width - old_lut_len * delta_width;
+		
+		// Can we reuse the old buffer? (It must not be shared with other copies)
+		if( new_data_len + 1 + new_num_blocks * old_lut_width + new_lut_len * delta_width <= old_buffer_size
+			&& ( !C || basic_string::get_ref_count( old_buffer ).load( std::memory_order_acquire ) == 1 )
+		)
+			// Move the deltas to make room for the entries of the new blocks
+			std::memmove( old_lut_base_ptr - new_num_blocks * old_lut_width - old_lut_len * delta_width , old_delta_begin , old_lut_len * delta_width );
+		else
+		{
+			// Allocate a new buffer with some room to grow
+			new_buffer_size = grow_buffer_size( determine_compressed_buffer_size( new_data_len , new_lut_len , delta_width , &new_lut_width ) );
+			new_lut_width = basic_string::get_lut_width( new_buffer_size );
+			new_buffer = this->allocate( determine_total_buffer_size( new_buffer_size ) );
+		#if defined(TINY_UTF8_NOEXCEPT)
+			if( !new_buffer )
+				return *this;
+		#endif
+			data_type*	new_lut_base_ptr = basic_string::get_lut_base_ptr( new_buffer , new_buffer_size );
+			TINY_UTF8_COUNT( lut_rebuilds , 1 );
+			TINY_UTF8_COUNT( lut_width_changes , old_lut_width != new_lut_width );
+			
+			// Copy data, block table and deltas
+			std::memcpy( new_buffer , old_buffer , old_data_len );
+			for( size_type block = 0 ; block < old_num_blocks ; ++block )
+				basic_string::set_lut( new_lut_base_ptr - ( block + 1 ) * new_lut_width , new_lut_width , basic_string::get_lut( old_lut_base_ptr - ( block + 1 ) * old_lut_width , old_lut_width ) );
+			std::memcpy( new_lut_base_ptr - new_num_blocks * new_lut_width - old_lut_len * delta_width , old_delta_begin , old_lut_len * delta_width );
+		}
+		
+		// Append new INDICES, starting within the last block
+		data_type* new_lut_base_ptr = basic_string::get_lut_base_ptr( new_buffer , new_buffer_size );
+		if( app_lut_base_ptr )
+			basic_string::write_compressed_lut( new_lut_base_ptr , new_lut_width , delta_width , new_num_blocks , old_lut_len , app_lut_len
+				, [&](){ return old_data_len + basic_string::get_lut( app_lut_base_ptr -= app_lut_width , app_lut_width ); }
+				, old_num_blocks - 1 , new_num_blocks
+			);
+		else{
+			multibyte_scanner scanner( app_buffer , app_data_len );
+			basic_string::write_compressed_lut( new_lut_base_ptr , new_lut_width , delta_width , new_num_blocks , old_lut_len , app_lut_len
+				, [&](){ return old_data_len + scanner(); }
+				, old_num_blocks - 1 , new_num_blocks
+			);
+		}
+		basic_string::set_compressed_lut_indicator( new_lut_base_ptr , new_lut_len , delta_width );
+		
+		// Copy the appendix (which might be this string itself) and release the old buffer
+		std::memcpy( new_buffer + old_data_len , app_buffer , app_data_len );
+		new_buffer[new_data_len] = '\0'; // Trailing '\0'
+		if( new_buffer != old_buffer ){
+			this->deallocate( old_buffer , old_buffer_size );
+			t_non_sso.data = new_buffer;
+			t_non_sso.buffer_size = new_buffer_size;
+		}
+		
+		// Adjust Attributes
+		t_non_sso.data_len = new_data_len;
+		set_non_sso_string_len( get_non_sso_string_len() + app_string_len );
+		
+		return *this;
+	}
+	
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	basic_string<V, D, A, S, C>& basic_string<V, D, A, S, C>::raw_append( const typename basic_string<V, D, A, S, C>::data_type* str , typename basic_string<V, D, A, S, C>::size_type byte_count ) noexcept(TINY_UTF8_NOEXCEPT)
+	{
+		size_type string_len = 0;
+		size_type num_multibytes = 0;
+		basic_string::count_codepoints( str , byte_count , string_len , num_multibytes );
+		return raw_append( str , byte_count , string_len , num_multibytes );
+	}
+
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	basic_string<V, D, A, S, C>& basic_string<V, D, A, S, C>::raw_append(
+		const typename basic_string<V, D, A, S, C>::data_type* app_buffer
+		, typename basic_string<V, D, A, S, C>::size_type app_data_len
+		, typename basic_string<V, D, A, S, C>::size_type app_string_len
+		, typename basic_string<V, D, A, S, C>::size_type app_lut_len
+		, const typename basic_string<V, D, A, S, C>::data_type* app_lut_base_ptr
+		, typename basic_string<V, D, A, S, C>::width_type app_lut_width
+	) noexcept(TINY_UTF8_NOEXCEPT)
+	{
+		// Will add nothing?
+		if( app_data_len == 0 )
+			return *this;
+		
+		// Compute some metrics
+		size_type	old_data_len	= size();
+		size_type	new_data_len	= old_data_len + app_data_len;
+		bool		app_lut_active	= app_lut_base_ptr != nullptr;
+		if( new_data_len < old_data_len ){ // Integer overflow in sum
+			TINY_UTF8_THROW( "tiny_utf8::basic_string::(raw_)append" , new_data_len > max_size() );
+			return *this;
+		}
+		
+		// Will be sso string?
+		if( new_data_len <= basic_string::get_sso_capacity() ){
+			std::memcpy( t_sso.data + old_data_len , app_buffer , app_data_len ); // Copy APPENDIX
+			t_sso.data[new_data_len] = '\0'; // Trailing '\0'
+			set_sso_data_len( (unsigned char)new_data_len ); // Adjust size
+			return *this;
+		}
+		
+		// Extend a compressed lut instead of decompressing it
+		if( has_compressed_lut() )
+			return raw_append_compressed( app_buffer , app_data_len , app_string_len , app_lut_len , app_lut_base_ptr , app_lut_width );
+		
+		// Make sure, the buffer is not shared with other copies and the lut is not compressed, since they may be modified in place
+		if( !make_writable() )
+			return *this;
+		
 		// Count codepoints and multibytes of this string
 		data_type*	old_buffer;
 		data_type*	old_lut_base_ptr; // Ignore uninitialized warning, see [3]
@@ -3873,8 +8316,7 @@ namespace tiny_utf8
 				data_type*		lut_dest_iter = old_lut_base_ptr - old_lut_len * new_lut_width; // 'old_lut_base_ptr' is initialized as 'old_sso_inactive' is true (see [3])
 				if( app_lut_active )
 				{
-					width_type	app_lut_width = basic_string::get_lut_width( app_buffer_size );
-					const data_type*	app_lut_iter = app_lut_base_ptr; // 'app_lut_base_ptr' is initialized as soon as 'app_lut_active' is set to true
+					const data_type*	app_lut_iter = app_lut_base_ptr;
 					while( app_lut_len-- > 0 )
 						basic_string::set_lut(
 							lut_dest_iter -= new_lut_width
@@ -3882,7 +8324,7 @@ namespace tiny_utf8
 							, basic_string::get_lut( app_lut_iter -= app_lut_width , app_lut_width ) + old_data_len
 						);
 				}
-				else{
+				else if( app_lut_len ){
 					size_type iter = 0;
 					while( iter < app_data_len ){
 						width_type bytes = get_codepoint_bytes( app_buffer[iter] , app_data_len - iter );
@@ -3904,7 +8346,7 @@ namespace tiny_utf8
 		}
 		else // No, apparently we have to allocate a new buffer...
 		{
-			new_buffer_size <<= 1; // Allocate twice as much, in order to amortize allocations (keeping in mind alignment)
+			new_buffer_size = grow_buffer_size( new_buffer_size ); // Allocate twice as much, in order to amortize allocations (keeping in mind alignment)
 			data_type*	new_buffer			= this->allocate(  determine_total_buffer_size( new_buffer_size ) );
 			data_type*	new_lut_base_ptr	= basic_string::get_lut_base_ptr( new_buffer , new_buffer_size );
 			
@@ -3923,6 +8365,8 @@ namespace tiny_utf8
 				if( old_lut_active )
 				{
 					width_type	old_lut_width = basic_string::get_lut_width( old_buffer_size );
+					TINY_UTF8_COUNT( lut_rebuilds , 1 );
+					TINY_UTF8_COUNT( lut_width_changes , new_lut_width != old_lut_width );
 				
 					// Copy all old INDICES
 					if( new_lut_width != old_lut_width )
@@ -3946,6 +8390,7 @@ namespace tiny_utf8
 				}
 				else // We need to fill these indices manually...
 				{
+					TINY_UTF8_COUNT( lut_builds , 1 );
 					data_type*	new_lut_iter	= new_lut_base_ptr;
 					size_type	iter			= 0;
 					while( iter < old_data_len ){ // Fill lut with indices BEFORE insertion
@@ -3960,7 +8405,6 @@ namespace tiny_utf8
 				data_type*		lut_dest_iter = new_lut_base_ptr - old_lut_len * new_lut_width;
 				if( app_lut_active )
 				{
-					width_type	app_lut_width = basic_string::get_lut_width( app_buffer_size );
 					const data_type*	app_lut_iter = app_lut_base_ptr;
 					while( app_lut_len-- > 0 )
 						basic_string::set_lut(
@@ -3969,7 +8413,7 @@ namespace tiny_utf8
 							, basic_string::get_lut( app_lut_iter -= app_lut_width , app_lut_width ) + old_data_len
 						);
 				}
-				else{
+				else if( app_lut_len ){
 					size_type app_iter = 0;
 					while( app_iter < app_data_len ){
 						width_type bytes = get_codepoint_bytes( app_buffer[app_iter] , app_data_len - app_iter );
@@ -3987,6 +8431,8 @@ namespace tiny_utf8
 			// Delete the old buffer?
 			if( old_sso_inactive )
 				this->deallocate( old_buffer , old_buffer_size );
+			else
+				TINY_UTF8_COUNT( sso_to_heap , 1 );
 			
 			// Set new Attributes
 			t_non_sso.data			= new_buffer;
@@ -4000,8 +8446,8 @@ namespace tiny_utf8
 		return *this;
 	}
 
-	template<typename V, typename D, typename A>
-	basic_string<V, D, A>& basic_string<V, D, A>::raw_insert( typename basic_string<V, D, A>::size_type index , const basic_string<V, D, A>& str ) noexcept(TINY_UTF8_NOEXCEPT)
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	basic_string<V, D, A, S, C>& basic_string<V, D, A, S, C>::raw_insert( typename basic_string<V, D, A, S, C>::size_type index , const basic_string<V, D, A, S, C>& str ) noexcept(TINY_UTF8_NOEXCEPT)
 	{
 		// Bound checks...
 		size_type old_data_len = size();
@@ -4013,6 +8459,10 @@ namespace tiny_utf8
 		// Compute the updated metrics
 		size_type str_data_len	= str.size();
 		size_type new_data_len	= old_data_len + str_data_len;
+		if( new_data_len < old_data_len ){ // Integer overflow in sum
+			TINY_UTF8_THROW( "tiny_utf8::basic_string::(raw_)insert" , new_data_len > max_size() );
+			return *this;
+		}
 		
 		// Will be empty?
 		if( str_data_len == 0 )
@@ -4036,6 +8486,9 @@ namespace tiny_utf8
 		
 		//! Ok, obviously no small string, we have to update the data, the lut and the number of codepoints
 		
+		// Make sure, the buffer is not shared with other copies and the lut is not compressed, since they may be modified in place
+		if( !make_writable() )
+			return *this;
 		
 		// Count codepoints and multibytes of insertion
 		bool				str_lut_active;
@@ -4052,7 +8505,7 @@ namespace tiny_utf8
 			
 			// Compute the number of multibytes
 			str_lut_base_ptr = basic_string::get_lut_base_ptr( str_buffer , str_buffer_size );
-			str_lut_active = basic_string::is_lut_active( str_lut_base_ptr );
+			str_lut_active = basic_string::is_lut_active( str_lut_base_ptr ) && !basic_string::is_lut_compressed( str_lut_base_ptr ); // A compressed lut is not reused
 			if( str_lut_active )
 				str_lut_len = basic_string::get_lut_len( str_lut_base_ptr );
 			else{
@@ -4180,6 +8633,7 @@ namespace tiny_utf8
 				}
 				else // We need to fill the lut manually...
 				{
+					TINY_UTF8_COUNT( lut_builds , 1 );
 					// Fill INDICES BEFORE insertion
 					size_type	iter		= 0;
 					data_type*	lut_iter	= old_lut_base_ptr;
@@ -4237,7 +8691,7 @@ namespace tiny_utf8
 		}
 		else // No, apparently we have to allocate a new buffer...
 		{
-			new_buffer_size <<= 1; // Allocate twice as much, in order to amortize allocations (keeping in mind alignment)
+			new_buffer_size = grow_buffer_size( new_buffer_size ); // Allocate twice as much, in order to amortize allocations (keeping in mind alignment)
 			data_type*	new_buffer			= this->allocate(  determine_total_buffer_size( new_buffer_size ) );
 			data_type*	new_lut_base_ptr	= basic_string::get_lut_base_ptr( new_buffer , new_buffer_size );
 			
@@ -4261,6 +8715,8 @@ namespace tiny_utf8
 				if( old_lut_active )
 				{
 					width_type	old_lut_width = basic_string::get_lut_width( old_buffer_size );
+					TINY_UTF8_COUNT( lut_rebuilds , 1 );
+					TINY_UTF8_COUNT( lut_width_changes , new_lut_width != old_lut_width );
 					
 					// Copy all INDICES BEFORE the insertion
 					if( new_lut_width != old_lut_width )
@@ -4296,6 +8752,7 @@ namespace tiny_utf8
 				}
 				else // We need to fill the lut manually...
 				{
+					TINY_UTF8_COUNT( lut_builds , 1 );
 					// Fill INDICES BEFORE insertion
 					size_type	iter		= 0;
 					data_type*		lut_iter	= new_lut_base_ptr;
@@ -4347,6 +8804,8 @@ namespace tiny_utf8
 			// Delete the old buffer?
 			if( old_sso_inactive )
 				this->deallocate( old_buffer , old_buffer_size );
+			else
+				TINY_UTF8_COUNT( sso_to_heap , 1 );
 			
 			// Set new Attributes
 			t_non_sso.data		= new_buffer;
@@ -4360,8 +8819,8 @@ namespace tiny_utf8
 		return *this;
 	}
 
-	template<typename V, typename D, typename A>
-	basic_string<V, D, A>& basic_string<V, D, A>::raw_replace( typename basic_string<V, D, A>::size_type index , typename basic_string<V, D, A>::size_type replaced_len , const basic_string<V, D, A>& repl ) noexcept(TINY_UTF8_NOEXCEPT)
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	basic_string<V, D, A, S, C>& basic_string<V, D, A, S, C>::raw_replace( typename basic_string<V, D, A, S, C>::size_type index , typename basic_string<V, D, A, S, C>::size_type replaced_len , const basic_string<V, D, A, S, C>& repl ) noexcept(TINY_UTF8_NOEXCEPT)
 	{
 		// Bound checks...
 		size_type old_data_len = size();
@@ -4379,6 +8838,10 @@ namespace tiny_utf8
 		size_type		repl_data_len	= repl.size();
 		difference_type delta_len		= repl_data_len - replaced_len;
 		size_type		new_data_len	= old_data_len + delta_len;
+		if( repl_data_len > replaced_len && new_data_len < old_data_len ){ // Integer overflow in sum
+			TINY_UTF8_THROW( "tiny_utf8::basic_string::(raw_)replace" , new_data_len > max_size() );
+			return *this;
+		}
 		
 		// Will be empty?
 		if( !new_data_len ){
@@ -4422,6 +8885,10 @@ namespace tiny_utf8
 		
 		//! Ok, obviously no small string, we have to update the data, the lut and the number of codepoints
 		
+		// Make sure, the buffer is not shared with other copies and the lut is not compressed, since they may be modified in place
+		if( !make_writable() )
+			return *this;
+		
 		// Count codepoints and multibytes of replacement
 		bool				repl_lut_active;
 		const data_type*	repl_buffer;
@@ -4437,7 +8904,7 @@ namespace tiny_utf8
 			
 			// Compute the number of multibytes
 			repl_lut_base_ptr = basic_string::get_lut_base_ptr( repl_buffer , repl_buffer_size );
-			repl_lut_active = basic_string::is_lut_active( repl_lut_base_ptr );
+			repl_lut_active = basic_string::is_lut_active( repl_lut_base_ptr ) && !basic_string::is_lut_compressed( repl_lut_base_ptr ); // A compressed lut is not reused
 			if( repl_lut_active )
 				repl_lut_len = basic_string::get_lut_len( repl_lut_base_ptr );
 			else{
@@ -4581,6 +9048,7 @@ namespace tiny_utf8
 				}
 				else // We need to fill the lut manually...
 				{
+					TINY_UTF8_COUNT( lut_builds , 1 );
 					// Fill INDICES BEFORE replacement
 					size_type	iter		= 0;
 					data_type*	lut_iter	= old_lut_base_ptr;
@@ -4642,7 +9110,7 @@ namespace tiny_utf8
 		}
 		else // No, apparently we have to allocate a new buffer...
 		{
-			new_buffer_size <<= 1; // Allocate twice as much, in order to amortize allocations (keeping in mind alignment)
+			new_buffer_size = grow_buffer_size( new_buffer_size ); // Allocate twice as much, in order to amortize allocations (keeping in mind alignment)
 			data_type*	new_buffer			= this->allocate( determine_total_buffer_size( new_buffer_size ) );
 			data_type*	new_lut_base_ptr	= basic_string::get_lut_base_ptr( new_buffer , new_buffer_size );
 			
@@ -4667,6 +9135,8 @@ namespace tiny_utf8
 				{
 					size_type	mb_end_index = mb_index + replaced_mbs;
 					width_type	old_lut_width = basic_string::get_lut_width( old_buffer_size );
+					TINY_UTF8_COUNT( lut_rebuilds , 1 );
+					TINY_UTF8_COUNT( lut_width_changes , new_lut_width != old_lut_width );
 					
 					// Copy all INDICES BEFORE the replacement
 					if( new_lut_width != old_lut_width )
@@ -4710,6 +9180,7 @@ namespace tiny_utf8
 				}
 				else // We need to fill the lut manually...
 				{
+					TINY_UTF8_COUNT( lut_builds , 1 );
 					// Fill INDICES BEFORE replacement
 					size_type	iter		= 0;
 					data_type*	lut_iter	= new_lut_base_ptr;
@@ -4762,6 +9233,8 @@ namespace tiny_utf8
 			// Delete the old buffer?
 			if( old_sso_inactive )
 				this->deallocate( old_buffer , old_buffer_size );
+			else
+				TINY_UTF8_COUNT( sso_to_heap , 1 );
 			
 			// Set new Attributes
 			t_non_sso.data		= new_buffer;
@@ -4775,8 +9248,8 @@ namespace tiny_utf8
 		return *this;
 	}
 
-	template<typename V, typename D, typename A>
-	basic_string<V, D, A>& basic_string<V, D, A>::raw_erase( typename basic_string<V, D, A>::size_type index , typename basic_string<V, D, A>::size_type len ) noexcept(TINY_UTF8_NOEXCEPT)
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	basic_string<V, D, A, S, C>& basic_string<V, D, A, S, C>::raw_erase( typename basic_string<V, D, A, S, C>::size_type index , typename basic_string<V, D, A, S, C>::size_type len ) noexcept(TINY_UTF8_NOEXCEPT)
 	{
 		// Bound checks...
 		size_type old_data_len = size();
@@ -4833,6 +9306,10 @@ namespace tiny_utf8
 		//! Ok, obviously no small string, we have to update the data, the lut and the number of codepoints.
 		//! BUT: We will keep the lut in the mode it is: inactive stay inactive, active stays active
 		
+		// Make sure, the buffer is not shared with other copies and the lut is not compressed, since they may be modified in place
+		if( !make_writable() )
+			return *this;
+		
 		// Count codepoints and multibytes of this string
 		data_type*	old_buffer = t_non_sso.data;
 		size_type	old_buffer_size = t_non_sso.buffer_size;
@@ -4904,8 +9381,8 @@ namespace tiny_utf8
 		return *this;
 	}
 
-	template<typename V, typename D, typename A>
-	typename basic_string<V, D, A>::size_type basic_string<V, D, A>::raw_rfind( typename basic_string<V, D, A>::value_type cp , typename basic_string<V, D, A>::size_type index ) const noexcept {
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	typename basic_string<V, D, A, S, C>::size_type basic_string<V, D, A, S, C>::raw_rfind( typename basic_string<V, D, A, S, C>::value_type cp , typename basic_string<V, D, A, S, C>::size_type index ) const noexcept {
 		if( index >= size() )
 			index = raw_back_index();
 		for( difference_type it = index ; it >= 0 ; it -= get_index_pre_bytes( it ) )
@@ -4914,8 +9391,8 @@ namespace tiny_utf8
 		return basic_string::npos;
 	}
 
-	template<typename V, typename D, typename A>
-	typename basic_string<V, D, A>::size_type basic_string<V, D, A>::find_first_of( const typename basic_string<V, D, A>::value_type* str , typename basic_string<V, D, A>::size_type start_pos ) const noexcept
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	typename basic_string<V, D, A, S, C>::size_type basic_string<V, D, A, S, C>::find_first_of( const typename basic_string<V, D, A, S, C>::value_type* str , typename basic_string<V, D, A, S, C>::size_type start_pos ) const noexcept
 	{
 		if( start_pos >= length() )
 			return basic_string::npos;
@@ -4933,8 +9410,8 @@ namespace tiny_utf8
 		return basic_string::npos;
 	}
 
-	template<typename V, typename D, typename A>
-	typename basic_string<V, D, A>::size_type basic_string<V, D, A>::raw_find_first_of( const typename basic_string<V, D, A>::value_type* str , typename basic_string<V, D, A>::size_type index ) const noexcept
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	typename basic_string<V, D, A, S, C>::size_type basic_string<V, D, A, S, C>::raw_find_first_of( const typename basic_string<V, D, A, S, C>::value_type* str , typename basic_string<V, D, A, S, C>::size_type index ) const noexcept
 	{
 		if( index >= size() )
 			return basic_string::npos;
@@ -4952,8 +9429,8 @@ namespace tiny_utf8
 		return basic_string::npos;
 	}
 
-	template<typename V, typename D, typename A>
-	typename basic_string<V, D, A>::size_type basic_string<V, D, A>::find_last_of( const typename basic_string<V, D, A>::value_type* str , typename basic_string<V, D, A>::size_type start_pos ) const noexcept
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	typename basic_string<V, D, A, S, C>::size_type basic_string<V, D, A, S, C>::find_last_of( const typename basic_string<V, D, A, S, C>::value_type* str , typename basic_string<V, D, A, S, C>::size_type start_pos ) const noexcept
 	{
 		const_reverse_iterator  it;
 		size_type               string_len = length();
@@ -4976,8 +9453,8 @@ namespace tiny_utf8
 		return basic_string::npos;
 	}
 
-	template<typename V, typename D, typename A>
-	typename basic_string<V, D, A>::size_type basic_string<V, D, A>::raw_find_last_of( const typename basic_string<V, D, A>::value_type* str , typename basic_string<V, D, A>::size_type index ) const noexcept
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	typename basic_string<V, D, A, S, C>::size_type basic_string<V, D, A, S, C>::raw_find_last_of( const typename basic_string<V, D, A, S, C>::value_type* str , typename basic_string<V, D, A, S, C>::size_type index ) const noexcept
 	{
 		if( empty() )
 			return basic_string::npos;
@@ -4997,8 +9474,8 @@ namespace tiny_utf8
 		return basic_string::npos;
 	}
 
-	template<typename V, typename D, typename A>
-	typename basic_string<V, D, A>::size_type basic_string<V, D, A>::find_first_not_of( const typename basic_string<V, D, A>::value_type* str , typename basic_string<V, D, A>::size_type start_pos ) const noexcept
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	typename basic_string<V, D, A, S, C>::size_type basic_string<V, D, A, S, C>::find_first_not_of( const typename basic_string<V, D, A, S, C>::value_type* str , typename basic_string<V, D, A, S, C>::size_type start_pos ) const noexcept
 	{
 		if( start_pos >= length() )
 			return basic_string::npos;
@@ -5017,8 +9494,8 @@ namespace tiny_utf8
 		return basic_string::npos;
 	}
 
-	template<typename V, typename D, typename A>
-	typename basic_string<V, D, A>::size_type basic_string<V, D, A>::raw_find_first_not_of( const typename basic_string<V, D, A>::value_type* str , typename basic_string<V, D, A>::size_type index ) const noexcept
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	typename basic_string<V, D, A, S, C>::size_type basic_string<V, D, A, S, C>::raw_find_first_not_of( const typename basic_string<V, D, A, S, C>::value_type* str , typename basic_string<V, D, A, S, C>::size_type index ) const noexcept
 	{
 		if( index >= size() )
 			return basic_string::npos;
@@ -5038,8 +9515,8 @@ namespace tiny_utf8
 		return basic_string::npos;
 	}
 
-	template<typename V, typename D, typename A>
-	typename basic_string<V, D, A>::size_type basic_string<V, D, A>::find_last_not_of( const typename basic_string<V, D, A>::value_type* str , typename basic_string<V, D, A>::size_type start_pos ) const noexcept
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	typename basic_string<V, D, A, S, C>::size_type basic_string<V, D, A, S, C>::find_last_not_of( const typename basic_string<V, D, A, S, C>::value_type* str , typename basic_string<V, D, A, S, C>::size_type start_pos ) const noexcept
 	{
 		if( empty() )
 			return basic_string::npos;
@@ -5067,8 +9544,8 @@ namespace tiny_utf8
 		return basic_string::npos;
 	}
 
-	template<typename V, typename D, typename A>
-	typename basic_string<V, D, A>::size_type basic_string<V, D, A>::raw_find_last_not_of( const typename basic_string<V, D, A>::value_type* str , typename basic_string<V, D, A>::size_type index ) const noexcept
+	template<typename V, typename D, typename A, std::size_t S, bool C>
+	typename basic_string<V, D, A, S, C>::size_type basic_string<V, D, A, S, C>::raw_find_last_not_of( const typename basic_string<V, D, A, S, C>::value_type* str , typename basic_string<V, D, A, S, C>::size_type index ) const noexcept
 	{
 		if( empty() )
 			return basic_string::npos;
@@ -5094,6 +9571,170 @@ namespace tiny_utf8
 		return basic_string::npos;
 	}
 
+	template<typename String>
+	basic_stream_decoder<String>& basic_stream_decoder<String>::feed( const typename basic_stream_decoder<String>::data_type* chunk , typename basic_stream_decoder<String>::size_type byte_count ) noexcept(TINY_UTF8_NOEXCEPT)
+	{
+		// Complete the pending codepoint first
+		if( t_num_pending )
+		{
+			while( t_num_pending < t_pending_len && byte_count ){
+				t_invalid |= ( (unsigned char)*chunk & 0xC0 ) != 0x80; // Not a continuation byte?
+				t_pending[t_num_pending++] = *chunk++;
+				--byte_count;
+			}
+			if( t_num_pending < t_pending_len )
+				return *this;
+			t_target->raw_append( t_pending , t_pending_len , 1 , 1 );
+			t_num_pending = 0;
+		}
+		
+		// Append all complete codepoints of the chunk
+		size_type	string_len = 0;
+		size_type	num_multibytes = 0;
+		size_type	complete_len = String::count_codepoints( chunk , byte_count , string_len , num_multibytes , true );
+		t_target->raw_append( chunk , complete_len , string_len , num_multibytes );
+		
+		// Keep the bytes of a trailing incomplete codepoint
+		if( complete_len < byte_count ){
+			t_pending_len = (unsigned char)String::get_codepoint_bytes( chunk[complete_len] , String::npos );
+			while( complete_len < byte_count )
+				t_pending[t_num_pending++] = chunk[complete_len++];
+		}
+		
+		return *this;
+	}
+
+	template<typename String>
+	bool basic_stream_decoder<String>::finish() noexcept(TINY_UTF8_NOEXCEPT)
+	{
+		if( !t_num_pending )
+			return true;
+		t_target->raw_append( t_pending , t_num_pending );
+		t_num_pending = 0;
+		t_invalid = true;
+		return false;
+	}
+
+	template<typename String>
+	String load_file( std::FILE* file , bool* success ) noexcept(TINY_UTF8_NOEXCEPT)
+	{
+		using size_type = typename String::size_type;
+		using data_type = typename String::data_type;
+		
+		String result;
+		bool result_success = false;
+		if( file )
+		{
+			// Determine the number of remaining bytes (if the file is seekable)
+			size_type	data_len = String::npos;
+			long		pos = std::ftell( file );
+			if( pos >= 0 && !std::fseek( file , 0 , SEEK_END ) ){
+				long end = std::ftell( file );
+				if( !std::fseek( file , pos , SEEK_SET ) && end >= pos && std::uintmax_t( end - pos ) <= String::max_size() )
+					data_len = size_type( end - pos );
+			}
+			
+			result_success = result.read_file(
+				data_len
+				, [file]( data_type* dest , size_type count ) -> size_type {
+					size_type num_read = std::fread( dest , 1 , count , file );
+					return num_read || !std::ferror( file ) ? num_read : String::npos;
+				}
+			);
+		}
+		if( success )
+			*success = result_success;
+		return result;
+	}
+
+	template<typename String>
+	String load_file( const char* path , bool* success ) noexcept(TINY_UTF8_NOEXCEPT)
+	{
+		std::FILE* file = std::fopen( path , "rb" );
+		String result = load_file<String>( file , success );
+		if( file )
+			std::fclose( file );
+		return result;
+	}
+
+	#if TINY_UTF8_HAS_POSIX_IO
+	template<typename String>
+	String load_file( int fd , bool* success ) noexcept(TINY_UTF8_NOEXCEPT)
+	{
+		using size_type = typename String::size_type;
+		using data_type = typename String::data_type;
+		
+		String result;
+		bool result_success = false;
+		if( fd >= 0 )
+		{
+			// Determine the number of remaining bytes (if the descriptor refers to a regular file)
+			size_type	data_len = String::npos;
+			struct stat	file_stat;
+			if( !::fstat( fd , &file_stat ) && S_ISREG( file_stat.st_mode ) ){
+				off_t pos = ::lseek( fd , 0 , SEEK_CUR );
+				if( pos >= 0 && file_stat.st_size >= pos && std::uintmax_t( file_stat.st_size - pos ) <= String::max_size() )
+					data_len = size_type( file_stat.st_size - pos );
+			}
+			
+			result_success = result.read_file(
+				data_len
+				, [fd]( data_type* dest , size_type count ) -> size_type {
+					ssize_t num_read;
+					do
+						num_read = ::read( fd , dest , count );
+					while( num_read < 0 && errno == EINTR );
+					return num_read >= 0 ? size_type( num_read ) : String::npos;
+				}
+			);
+		}
+		if( success )
+			*success = result_success;
+		return result;
+	}
+	#endif
+
+	namespace tiny_utf8_detail
+	{
+		//! Converts a single record for make_strings
+		template<typename String>
+		inline String make_string( const typename String::value_type* data , std::size_t len , const typename String::allocator_type& alloc ) noexcept(TINY_UTF8_NOEXCEPT) {
+			return String( data , len , alloc );
+		}
+		template<typename String>
+		inline String make_string( const typename String::data_type* data , std::size_t len , const typename String::allocator_type& alloc ) noexcept(TINY_UTF8_NOEXCEPT) {
+			return String::from_bytes( data , typename String::size_type( len ) , alloc );
+		}
+	}
+
+	template<typename String, typename RandomIt, typename OutputIt>
+	void make_strings( RandomIt first , RandomIt last , OutputIt out , parallel_t par , const typename String::allocator_type& alloc ) noexcept(TINY_UTF8_NOEXCEPT)
+	{
+		std::size_t num_records = last - first;
+		if( !num_records )
+			return;
+		
+		// Compute the total number of code units before each record
+		std::unique_ptr<std::size_t[]> offsets( new std::size_t[num_records + 1] );
+		offsets[0] = 0;
+		for( std::size_t i = 0 ; i < num_records ; ++i )
+			offsets[i + 1] = offsets[i] + first[i].size();
+		
+		// Split the records into tasks of about the same number of code units
+		unsigned int num_tasks = (unsigned int)std::min<std::size_t>( par.num_tasks( offsets[num_records] ) , num_records );
+		tiny_utf8_detail::parallel_for( num_tasks , [&]( unsigned int task ){
+			auto task_begin = [&]( unsigned int index ) -> std::size_t {
+				if( index >= num_tasks )
+					return num_records;
+				std::size_t units = std::size_t( (unsigned long long)offsets[num_records] * index / num_tasks );
+				return std::lower_bound( offsets.get() , offsets.get() + num_records , units ) - offsets.get();
+			};
+			for( std::size_t i = task_begin( task ) , end = task_begin( task + 1 ) ; i < end ; ++i )
+				out[i] = tiny_utf8_detail::make_string<String>( first[i].data() , first[i].size() , alloc );
+		} );
+	}
+
+
 } // Namespace 'tiny_utf8'
 
 #if defined (__clang__)
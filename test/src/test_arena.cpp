@@ -0,0 +1,115 @@
+﻿#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <tinyutf8/arena.h>
+
+TEST(TinyUTF8, Arena_Allocate)
+{
+	tiny_utf8::arena arena(64);
+	EXPECT_EQ(arena.num_blocks(), 0);
+
+	void* a = arena.allocate(10, 1);
+	void* b = arena.allocate(8, 8);
+	EXPECT_EQ(reinterpret_cast<std::uintptr_t>(b) % 8, 0);
+	EXPECT_GE(static_cast<char*>(b), static_cast<char*>(a) + 10);
+	EXPECT_EQ(arena.num_blocks(), 1);
+	EXPECT_EQ(arena.bytes_used(), 18);
+
+	// Oversized allocations get a block of their own, blocks grow geometrically
+	arena.allocate(1000);
+	EXPECT_EQ(arena.num_blocks(), 2);
+	EXPECT_GE(arena.bytes_reserved(), 1064);
+
+	// Reset keeps the most recent block only
+	std::size_t last_block_size = arena.bytes_reserved() - 64;
+	arena.reset();
+	EXPECT_EQ(arena.num_blocks(), 1);
+	EXPECT_EQ(arena.bytes_reserved(), last_block_size);
+	EXPECT_EQ(arena.bytes_used(), 0);
+	arena.allocate(500);
+	EXPECT_EQ(arena.num_blocks(), 1);
+
+	arena.release();
+	EXPECT_EQ(arena.num_blocks(), 0);
+	EXPECT_EQ(arena.bytes_reserved(), 0);
+}
+
+TEST(TinyUTF8, Arena_Strings)
+{
+	tiny_utf8::arena arena;
+	tiny_utf8::arena_allocator<char> alloc(arena);
+
+	std::vector<tiny_utf8::arena_string> strings;
+	for (int i = 0; i < 100; ++i) {
+		strings.emplace_back(U"Löwen, Bären, Vögel und Käfer sind Tiere. ツ♫", alloc);
+		strings.back() += tiny_utf8::arena_string(std::to_string(i), alloc);
+	}
+	EXPECT_GT(arena.bytes_used(), 100 * 50);
+	EXPECT_EQ(arena.num_blocks() < 10, true);
+	EXPECT_EQ(strings[42].back(), U'2');
+	EXPECT_EQ(strings[42][43], U'♫');
+	EXPECT_TRUE(strings[42].get_allocator() == alloc);
+
+	// Assigning keeps the allocator
+	strings[0].assign(U"Nashörner sind auch Tiere und sehr groß, sogar größer als Käfer");
+	strings[1].assign(std::string("ascii text that does not fit into the small string buffer"));
+	strings[2].assign(100, U'ä');
+	EXPECT_EQ(strings[0].get_allocator().get_arena(), &arena);
+	EXPECT_EQ(strings[1].get_allocator().get_arena(), &arena);
+	EXPECT_EQ(strings[2].get_allocator().get_arena(), &arena);
+	EXPECT_EQ(strings[2].length(), 100);
+
+	// Copies use the same arena
+	tiny_utf8::arena_string copy = strings[3];
+	EXPECT_EQ(copy, strings[3]);
+	EXPECT_EQ(copy.get_allocator().get_arena(), &arena);
+	strings.clear();
+
+	// Without arena, the heap is used
+	tiny_utf8::arena_string heap(U"Löwen, Bären, Vögel und Käfer sind Tiere. ツ♫");
+	EXPECT_EQ(heap.get_allocator().get_arena(), nullptr);
+	EXPECT_EQ(heap.length(), 44);
+}
+
+TEST(TinyUTF8, Arena_CopyOnWriteAssign)
+{
+	using cow_arena_string = tiny_utf8::basic_string<char32_t, char, tiny_utf8::arena_allocator<char>, 0, true>;
+	tiny_utf8::arena arena1;
+	tiny_utf8::arena arena2;
+
+	// Assigning a string of another arena must not overwrite the buffer that the target shares with 'a'
+	cow_arena_string a(std::string(100, 'a'), tiny_utf8::arena_allocator<char>(arena1));
+	cow_arena_string d(a);
+	cow_arena_string c(std::string(50, 'c'), tiny_utf8::arena_allocator<char>(arena2));
+	d = c;
+	EXPECT_EQ(a.cpp_str(), std::string(100, 'a'));
+	EXPECT_EQ(d.cpp_str(), std::string(50, 'c'));
+	EXPECT_EQ(d.get_allocator().get_arena(), &arena1);
+	d += 'x';
+	EXPECT_EQ(a.cpp_str(), std::string(100, 'a'));
+	EXPECT_EQ(c.cpp_str(), std::string(50, 'c'));
+}
+
+#if TINY_UTF8_HAS_PMR
+TEST(TinyUTF8, Arena_Pmr)
+{
+	char buffer[1024];
+	std::pmr::monotonic_buffer_resource resource(buffer, sizeof(buffer));
+	tiny_utf8::pmr_string str(U"Löwen, Bären, Vögel und Käfer sind Tiere. ツ♫", &resource);
+	EXPECT_EQ(str.length(), 44);
+	EXPECT_GE(static_cast<const void*>(str.data()), static_cast<const void*>(buffer));
+	EXPECT_LT(static_cast<const void*>(str.data()), static_cast<const void*>(buffer + sizeof(buffer)));
+
+	// Assigning strings of other resources copies their data into this one
+	str = tiny_utf8::pmr_string(U"Nashörner sind auch Tiere und sehr groß, sogar größer als Käfer");
+	EXPECT_EQ(str.get_allocator().resource(), &resource);
+	EXPECT_GE(static_cast<const void*>(str.data()), static_cast<const void*>(buffer));
+	EXPECT_LT(static_cast<const void*>(str.data()), static_cast<const void*>(buffer + sizeof(buffer)));
+	tiny_utf8::pmr_string other(U"Elefanten sind die größten Landtiere, größer als Nashörner");
+	str = other;
+	EXPECT_EQ(str, other);
+	EXPECT_EQ(str.get_allocator().resource(), &resource);
+}
+#endif
@@ -1,7 +1,9 @@
 ﻿#include <gtest/gtest.h>
 
 #include <cstdint>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
 #include <tinyutf8/tinyutf8.h>
 
@@ -86,3 +88,331 @@ TEST(TinyUTF8, CopyCTor)
 	EXPECT_FALSE(str.lut_active());
 	EXPECT_EQ(static_cast<uint64_t>(str[8]), 32);
 }
+
+TEST(TinyUTF8, CTor_Parallel)
+{
+	auto expect_same = [](const std::string& data, unsigned int num_threads) {
+		tiny_utf8::string serial(data);
+		tiny_utf8::string parallel(data.data(), data.size(), tiny_utf8::parallel_t(num_threads, 16));
+
+		EXPECT_EQ(parallel.size(), serial.size());
+		EXPECT_EQ(parallel.length(), serial.length());
+		EXPECT_EQ(parallel.sso_active(), serial.sso_active());
+		EXPECT_EQ(parallel.lut_active(), serial.lut_active());
+		EXPECT_EQ(parallel.cpp_str(), serial.cpp_str());
+		for (std::size_t i = 0; i < serial.length(); ++i)
+			ASSERT_EQ(parallel[i], serial[i]);
+	};
+
+	std::string text;
+	for (int i = 0; i < 50; ++i)
+		text += u8"Löwen, Bären, Vögel und Käfer sind Tiere. ツ♫ 🌍 ";
+	for (unsigned int num_threads = 1; num_threads <= 7; ++num_threads)
+		expect_same(text, num_threads);
+
+	// Pure ascii, dense multibytes and sso
+	expect_same(std::string(1000, 'x'), 4);
+	std::string dense;
+	for (int i = 0; i < 300; ++i)
+		dense += u8"ツ";
+	expect_same(dense, 3);
+	expect_same(u8"Bär", 4);
+
+	// Malformed data (stray continuation bytes and truncated sequences)
+	std::string malformed;
+	for (int i = 0; i < 40; ++i)
+		malformed += "ab\x80\x80\x80\x80\x80\x80\x80\x80\xE2" "cd\xF0\x9F\x8C" "efgh";
+	for (unsigned int num_threads = 2; num_threads <= 9; ++num_threads)
+		expect_same(malformed, num_threads);
+}
+
+TEST(TinyUTF8, FromBytes)
+{
+	// The count is the number of bytes (including embedded '\0'), not the number of codepoints
+	tiny_utf8::string str = tiny_utf8::string::from_bytes(u8"Bär\0ツ and more", 8);
+	EXPECT_EQ(str.size(), 8);
+	EXPECT_EQ(str.length(), 5);
+	EXPECT_EQ(str[4], U'ツ');
+	EXPECT_TRUE(tiny_utf8::string::from_bytes("", 0).empty());
+}
+
+TEST(TinyUTF8, MakeStrings)
+{
+	std::vector<std::u32string> records;
+	for (int i = 0; i < 500; ++i)
+		records.push_back(std::u32string(i % 50, U'ツ') + U"Löwen" + std::u32string(1, U'\0') + std::u32string(i % 7, U'x'));
+
+	for (unsigned int num_threads = 1; num_threads <= 5; ++num_threads) {
+		std::vector<tiny_utf8::string> strings(records.size());
+		tiny_utf8::make_strings(records.begin(), records.end(), strings.begin(), tiny_utf8::parallel_t(num_threads, 64));
+		for (std::size_t i = 0; i < records.size(); ++i) {
+			ASSERT_EQ(strings[i].length(), records[i].size());
+			ASSERT_EQ(strings[i], tiny_utf8::string(records[i].data(), records[i].size()));
+		}
+	}
+
+	// Utf8 records
+	std::vector<std::string> utf8_records = {u8"Bär", "", std::string(100, 'x'), u8"Vögel und Käfer sind Tiere. ツ♫ 🌍"};
+	std::vector<tiny_utf8::string> strings(utf8_records.size());
+	tiny_utf8::make_strings(utf8_records.begin(), utf8_records.end(), strings.begin(), tiny_utf8::parallel_t(3, 1));
+	for (std::size_t i = 0; i < utf8_records.size(); ++i)
+		EXPECT_EQ(strings[i].cpp_str(), utf8_records[i]);
+	EXPECT_EQ(strings[3].length(), 32);
+	EXPECT_TRUE(strings[0].sso_active());
+}
+
+namespace
+{
+	// Record, the data of which can't be accessed
+	struct throwing_record
+	{
+		std::string value;
+		const char* data() const { if (value == "fail") throw std::runtime_error("inaccessible record"); return value.data(); }
+		std::size_t size() const { return value.size(); }
+	};
+}
+
+TEST(TinyUTF8, MakeStringsException)
+{
+	// Exceptions thrown on worker threads arrive at the caller
+	std::vector<throwing_record> records = {{"a"}, {"b"}, {"c"}, {"fail"}};
+	std::vector<tiny_utf8::string> strings(records.size());
+	EXPECT_THROW(tiny_utf8::make_strings(records.begin(), records.end(), strings.begin(), tiny_utf8::parallel_t(4, 1)), std::runtime_error);
+	EXPECT_EQ(strings[0], "a");
+}
+
+TEST(TinyUTF8, Validate)
+{
+	std::string valid = u8"Löwen, Bären, Vögel und Käfer sind Tiere. ツ♫ 🌍";
+	valid += std::string(1, '\0') + "\xF4\x8F\xBF\xBF" + "\xEF\xBF\xBD";
+	std::size_t offset = 0;
+	EXPECT_TRUE(tiny_utf8::validate(valid.data(), valid.size(), &offset));
+	EXPECT_EQ(offset, valid.size());
+	EXPECT_TRUE(tiny_utf8::validate("", 0));
+
+	const char* invalid[] = {
+		"\x80",					// Stray continuation byte
+		"\xC0\x80",				// Overlong
+		"\xC1\xBF",				// Overlong
+		"\xE0\x80\x80",			// Overlong
+		"\xED\xA0\x80",			// Surrogate
+		"\xF0\x80\x80\x80",		// Overlong
+		"\xF4\x90\x80\x80",		// Above U+10FFFF
+		"\xF5\x80\x80\x80",		// Above U+10FFFF
+		"\xF8\x88\x80\x80\x80",	// 5 bytes
+		"\xE2\x82",				// Truncated
+		"\xE2\x82" "a",			// Truncated
+	};
+	for (const char* sequence : invalid) {
+		std::string data = std::string(20, 'x') + sequence + "yz";
+		EXPECT_FALSE(tiny_utf8::validate(data.data(), data.size(), &offset)) << data;
+		EXPECT_EQ(offset, 20u);
+	}
+}
+
+TEST(TinyUTF8, CTor_Strict)
+{
+	std::string data = u8"Löwen, Bären, Vögel und Käfer sind Tiere. ツ♫ 🌍";
+	bool valid = false;
+	tiny_utf8::string str(data.data(), data.size(), tiny_utf8::strict_t(&valid));
+	EXPECT_TRUE(valid);
+	EXPECT_EQ(str.cpp_str(), data);
+	EXPECT_EQ(str.length(), tiny_utf8::string(data).length());
+	EXPECT_TRUE(str.lut_active());
+	EXPECT_EQ(str[42], U'ツ');
+
+	tiny_utf8::string small(u8"Bär", 4, tiny_utf8::strict);
+	EXPECT_EQ(small, tiny_utf8::string(U"Bär"));
+	EXPECT_TRUE(small.sso_active());
+
+	data[20] = '\xC0';
+	tiny_utf8::string rejected(data.data(), data.size(), tiny_utf8::strict_t(&valid));
+	EXPECT_FALSE(valid);
+	EXPECT_TRUE(rejected.empty());
+}
+
+TEST(TinyUTF8, CTor_Repair)
+{
+	// Example of the Unicode Standard (U+FFFD Substitution of Maximal Subparts)
+	std::string data = "\x61\xF1\x80\x80\xE1\x80\xC2\x62\x80\x63\x80\xBF\x64";
+	std::size_t num_replacements = 0;
+	tiny_utf8::string str(data.data(), data.size(), tiny_utf8::repair_t(&num_replacements));
+	EXPECT_EQ(num_replacements, 6u);
+	EXPECT_EQ(str, tiny_utf8::string(U"a���b�c��d"));
+	EXPECT_TRUE(str.sso_active());
+	EXPECT_TRUE(tiny_utf8::validate(str.data(), str.size()));
+
+	// Heap strings (with and without lut)
+	std::string text;
+	std::u32string expected;
+	for (int i = 0; i < 20; ++i) {
+		text += u8"Löwen, Bären \xED\xA0\x80 und \xF4\x90\x80\x80! ";
+		expected += U"Löwen, Bären ��� und ����! ";
+	}
+	str = tiny_utf8::string(text.data(), text.size(), tiny_utf8::repair_t(&num_replacements));
+	EXPECT_EQ(num_replacements, 140u);
+	EXPECT_EQ(str, tiny_utf8::string(expected.c_str()));
+	EXPECT_EQ(str.length(), expected.length());
+	for (std::size_t i = 0; i < expected.length(); ++i)
+		ASSERT_EQ(str[i], expected[i]);
+
+	// Valid input is taken as is
+	std::string valid = u8"Löwen, Bären, Vögel und Käfer sind Tiere.";
+	str.assign(valid.data(), valid.size(), tiny_utf8::repair_t(&num_replacements));
+	EXPECT_EQ(num_replacements, 0u);
+	EXPECT_EQ(str.cpp_str(), valid);
+	EXPECT_TRUE(str.lut_active());
+
+	// Truncated sequence at the end
+	str.assign("ab\xE2\x82", 4, tiny_utf8::repair);
+	EXPECT_EQ(str, tiny_utf8::string(U"ab�"));
+
+	bool valid_flag = true;
+	str.assign("ab\xE2\x82", 4, tiny_utf8::strict_t(&valid_flag));
+	EXPECT_FALSE(valid_flag);
+	EXPECT_TRUE(str.empty());
+}
+
+TEST(TinyUTF8, CTor_TakeAWideString_Blocks)
+{
+	// Multibytes at every position relative to the blocks of 8 codepoints processed at once
+	for (std::size_t pos = 0; pos < 17; ++pos) {
+		std::u32string codepoints(40, U'a');
+		codepoints[pos] = U'ツ';
+		codepoints[pos + 9] = U'🌍';
+		codepoints[pos + 20] = U'\0';
+		codepoints[39] = U'ä';
+
+		tiny_utf8::string str(codepoints.data(), codepoints.size());
+		EXPECT_EQ(str.length(), 40);
+		EXPECT_EQ(str.size(), 40 + 2 + 3 + 1);
+		EXPECT_TRUE(str.lut_active());
+		for (std::size_t i = 0; i < codepoints.size(); ++i)
+			ASSERT_EQ(str[i], codepoints[i]);
+
+		// Null terminated
+		tiny_utf8::string terminated(codepoints.c_str());
+		EXPECT_EQ(terminated.length(), pos + 20);
+	}
+
+	std::u32string ascii(100, U'x');
+	tiny_utf8::string str(ascii.c_str());
+	EXPECT_EQ(str.cpp_str(), std::string(100, 'x'));
+	EXPECT_TRUE(str.lut_active());
+}
+
+namespace
+{
+	template<std::size_t Capacity>
+	void test_sso_capacity(std::size_t expected_capacity)
+	{
+		using test_utf8_string = tiny_utf8::basic_string<char32_t, char, std::allocator<char>, Capacity>;
+
+		EXPECT_EQ(Helpers_SSOTestUtils::SSO_Capacity<test_utf8_string>::get_sso_capacity(), expected_capacity);
+		EXPECT_GT(sizeof(test_utf8_string), expected_capacity);
+
+		// Fill the SSO buffer exactly (with a multibyte codepoint at the end)
+		std::string data(expected_capacity - 3, 'k');
+		data += u8"ツ";
+		test_utf8_string str(data.c_str());
+		EXPECT_TRUE(str.sso_active());
+		EXPECT_EQ(str.size(), expected_capacity);
+		EXPECT_EQ(str.length(), expected_capacity - 2);
+		EXPECT_EQ(str.back(), U'ツ');
+		EXPECT_TRUE(str.requires_unicode());
+
+		// Grow beyond the SSO buffer
+		test_utf8_string grown = str;
+		grown.append(U"♫ä");
+		EXPECT_FALSE(grown.sso_active());
+		EXPECT_EQ(grown.length(), expected_capacity);
+		EXPECT_EQ(grown.cpp_str(), data + u8"♫ä");
+		EXPECT_EQ(grown[expected_capacity - 3], U'ツ');
+
+		// Copy, move and swap between both layouts
+		test_utf8_string copy;
+		copy = grown;
+		EXPECT_FALSE(copy.sso_active());
+		EXPECT_EQ(copy.length(), grown.length());
+		EXPECT_EQ(copy, grown);
+		copy = str;
+		EXPECT_TRUE(copy.sso_active());
+		EXPECT_EQ(copy, str);
+		copy.swap(grown);
+		EXPECT_FALSE(copy.sso_active());
+		EXPECT_TRUE(grown.sso_active());
+		EXPECT_EQ(grown, str);
+		test_utf8_string moved(std::move(copy));
+		EXPECT_FALSE(moved.sso_active());
+		EXPECT_TRUE(copy.empty());
+		EXPECT_EQ(moved.length(), expected_capacity);
+
+		// Shrink back into the SSO buffer
+		moved.erase(moved.length() - 2, 2);
+		EXPECT_EQ(moved, str);
+		EXPECT_EQ(moved.substr(0, 3).cpp_str(), "kkk");
+		EXPECT_TRUE(moved.substr(0, 3).sso_active());
+		moved.insert(0, U'ä');
+		EXPECT_EQ(moved.length(), expected_capacity - 1);
+		EXPECT_EQ(moved.front(), U'ä');
+		EXPECT_EQ(moved.back(), U'ツ');
+	}
+}
+
+TEST(TinyUTF8, SSOCapacity)
+{
+	constexpr std::size_t default_capacity = Helpers_SSOTestUtils::SSO_Capacity<tiny_utf8::string>::get_sso_capacity();
+
+	test_sso_capacity<0>(default_capacity);
+	test_sso_capacity<15>(default_capacity); // Rounded up to the size of the heap layout
+	test_sso_capacity<63>(63);
+	test_sso_capacity<127>(127);
+	EXPECT_EQ(sizeof(tiny_utf8::basic_string<char32_t, char, std::allocator<char>, 0>), sizeof(tiny_utf8::string));
+	EXPECT_GE(sizeof(tiny_utf8::basic_string<char32_t, char, std::allocator<char>, 63>), 64u);
+}
+
+TEST(TinyUTF8, MemoryUsage)
+{
+	// Small strings don't touch the heap
+	tiny_utf8::string small(U"äbc");
+	tiny_utf8::memory_usage_info usage = small.memory_usage();
+	EXPECT_EQ(usage.num_strings, 1u);
+	EXPECT_EQ(usage.num_heap_strings, 0u);
+	EXPECT_EQ(usage.object_bytes, sizeof(tiny_utf8::string));
+	EXPECT_EQ(usage.heap_bytes, 0u);
+	EXPECT_EQ(usage.data_bytes, 4u);
+	EXPECT_EQ(usage.lut_entries, 0u);
+
+	// A few multibytes within ascii yield a lut
+	tiny_utf8::string large(std::string(200, 'a') + "ä€𝄞");
+	usage = large.memory_usage();
+	ASSERT_TRUE(large.lut_active());
+	EXPECT_EQ(usage.num_heap_strings, 1u);
+	EXPECT_EQ(usage.num_luts, 1u);
+	EXPECT_EQ(usage.data_bytes, 209u);
+	EXPECT_EQ(usage.lut_entries, 3u);
+	EXPECT_EQ(usage.lut_bytes, 3u); // The buffer is smaller than 256 bytes, hence 8-bit indices
+	EXPECT_EQ(usage.heap_bytes,
+		usage.data_bytes + usage.terminator_bytes + usage.lut_bytes + usage.indicator_bytes + usage.ref_count_bytes + usage.unused_bytes);
+
+	// Appending amortizes, i.e. leaves slack
+	large.append(std::string(100, 'b'));
+	usage = large.memory_usage();
+	EXPECT_GT(usage.unused_bytes, 0u);
+	EXPECT_EQ(usage.heap_bytes,
+		usage.data_bytes + usage.terminator_bytes + usage.lut_bytes + usage.indicator_bytes + usage.ref_count_bytes + usage.unused_bytes);
+
+	// Copy-on-write buffers carry a reference count
+	tiny_utf8::cow_string cow(std::string(100, 'c'));
+	EXPECT_EQ(cow.memory_usage().ref_count_bytes, sizeof(std::size_t));
+
+	// Aggregate over a container
+	std::vector<tiny_utf8::string> strings = {small, large, tiny_utf8::string()};
+	tiny_utf8::memory_usage_info total = tiny_utf8::total_memory_usage(strings);
+	EXPECT_EQ(total.num_strings, 3u);
+	EXPECT_EQ(total.num_heap_strings, 1u);
+	EXPECT_EQ(total.object_bytes, 3 * sizeof(tiny_utf8::string));
+	EXPECT_EQ(total.data_bytes, small.size() + large.size());
+	EXPECT_EQ(total.heap_bytes, large.memory_usage().heap_bytes);
+	EXPECT_EQ(total.heap_bytes, (small.memory_usage() + large.memory_usage()).heap_bytes);
+}
@@ -18,3 +18,111 @@ TEST(TinyUTF8, ToWideLiteral)
 		++it_fwd;
 	}
 }
+
+TEST(TinyUTF8, ToU32String)
+{
+	std::u32string codepoints = U"Löwen, Bären, Vögel und Käfer sind Tiere. 🌍 Ascii blocks of text: abcdefghijklmnop ツ";
+	tiny_utf8::string str(codepoints.c_str());
+	EXPECT_EQ(str.to_u32string(), codepoints);
+
+	tiny_utf8::string sso(U"Käfer");
+	EXPECT_EQ(sso.to_u32string(), std::u32string(U"Käfer"));
+	EXPECT_TRUE(tiny_utf8::string().to_u32string().empty());
+}
+
+TEST(TinyUTF8, CopyCodepoints)
+{
+	std::u32string codepoints = U"Löwen, Bären, Vögel und Käfer sind Tiere. 🌍 Ascii blocks of text: abcdefghijklmnop ツ";
+	tiny_utf8::string str(codepoints.c_str());
+
+	char32_t buffer[100];
+	for (std::size_t pos = 0; pos <= codepoints.size(); ++pos) {
+		for (std::size_t count : { std::size_t(0), std::size_t(1), std::size_t(9), std::size_t(100) }) {
+			std::size_t copied = str.copy_codepoints(buffer, count, pos);
+			EXPECT_EQ(copied, std::min(count, codepoints.size() - pos));
+			EXPECT_EQ(std::u32string(buffer, copied), codepoints.substr(pos, count));
+		}
+	}
+
+#if !TINY_UTF8_NOEXCEPT
+	EXPECT_THROW(str.copy_codepoints(buffer, 1, codepoints.size() + 1), std::out_of_range);
+#endif
+}
+
+TEST(TinyUTF8, UTF16)
+{
+	std::u16string units = u"Löwen, Bären, Vögel und Käfer sind Tiere. 🌍 Ascii blocks of text: abcdefghijklmnop ツ 🎵";
+	std::u32string codepoints = U"Löwen, Bären, Vögel und Käfer sind Tiere. 🌍 Ascii blocks of text: abcdefghijklmnop ツ 🎵";
+
+	tiny_utf8::string str(units.data(), units.size());
+	EXPECT_EQ(str, tiny_utf8::string(codepoints.c_str()));
+	EXPECT_EQ(str.length(), codepoints.size());
+	EXPECT_TRUE(str.lut_active());
+	for (std::size_t i = 0; i < codepoints.size(); ++i)
+		ASSERT_EQ(str[i], codepoints[i]);
+	EXPECT_EQ(str.to_u16string(), units);
+
+	// Null terminated and small strings
+	EXPECT_EQ(tiny_utf8::string(u"Käfer \U0001F30D", tiny_utf8::string::npos), tiny_utf8::string(U"Käfer \U0001F30D"));
+	EXPECT_EQ(tiny_utf8::string(U"Käfer \U0001F30D").to_u16string(), std::u16string(u"Käfer \U0001F30D"));
+	EXPECT_TRUE(tiny_utf8::string(u"", tiny_utf8::string::npos).empty());
+	EXPECT_TRUE(tiny_utf8::string().to_u16string().empty());
+
+	// Unpaired surrogates are kept as they are
+	const char16_t unpaired[] = { u'a', char16_t(0xD83C), u'b', char16_t(0xDF0D), char16_t(0xD83C) };
+	tiny_utf8::string lenient(unpaired, 5);
+	EXPECT_EQ(lenient.length(), 5);
+	EXPECT_EQ(lenient[1], 0xD83Cu);
+	EXPECT_EQ(lenient[3], 0xDF0Du);
+	EXPECT_EQ(lenient.to_u16string(), std::u16string(unpaired, 5));
+
+	// A truncated last sequence counts as one codepoint, but is converted byte by byte
+	tiny_utf8::string truncated(std::string(40, 'a') + "\xF0\x9F\x8C");
+	EXPECT_EQ(truncated.length(), 41);
+	EXPECT_EQ(truncated.to_u16string(), std::u16string(40, u'a') + u"\xF0\x9F\x8C");
+
+	// Assign
+	tiny_utf8::string assigned;
+	assigned.assign(units.data(), units.size());
+	EXPECT_EQ(assigned, str);
+}
+
+TEST(TinyUTF8, SingleByteCharsets)
+{
+	// "Löwen, Bären, Vögel und Käfer sind Tiere." with some padding to use the heap
+	std::string latin1 = "L\xF6wen, B\xE4ren, V\xF6gel und K\xE4" "fer sind Tiere. \xA9\xFF ascii tail";
+	tiny_utf8::string str(latin1.data(), latin1.size(), tiny_utf8::latin1);
+	EXPECT_EQ(str, tiny_utf8::string(U"Löwen, Bären, Vögel und Käfer sind Tiere. ©ÿ ascii tail"));
+	EXPECT_EQ(str.length(), latin1.size());
+	EXPECT_EQ(str.size(), latin1.size() + 6);
+	EXPECT_TRUE(str.lut_active());
+	EXPECT_EQ(str[1], U'ö');
+	EXPECT_EQ(str[42], U'©');
+	EXPECT_EQ(str.to_latin1(), latin1);
+
+	// Windows-1252 maps 0x80 to 0x9F to other codepoints
+	std::string cp1252 = "\x80 \x93quoted\x94 \x85 \x81 and some more ascii to reach the heap \xE4";
+	tiny_utf8::string str2(cp1252.data(), cp1252.size(), tiny_utf8::cp1252);
+	EXPECT_EQ(str2, tiny_utf8::string(U"€ “quoted” … \u0081 and some more ascii to reach the heap ä"));
+	EXPECT_EQ(str2.to_cp1252(), cp1252);
+	EXPECT_EQ(tiny_utf8::string(cp1252.data(), cp1252.size(), tiny_utf8::latin1).to_latin1(), cp1252);
+
+	// Unrepresentable codepoints
+	tiny_utf8::string wide(U"€ツ🌍ä");
+	EXPECT_EQ(wide.to_latin1(), std::string("???\xE4"));
+	EXPECT_EQ(wide.to_cp1252('_'), std::string("\x80__\xE4"));
+	EXPECT_TRUE(tiny_utf8::string().to_latin1().empty());
+
+	// A truncated last sequence counts as one codepoint, but is converted byte by byte
+	tiny_utf8::string truncated(std::string(40, 'a') + "\xF0\x9F\x8C");
+	EXPECT_EQ(truncated.to_latin1(), std::string(40, 'a') + "\xF0\x9F\x8C");
+	EXPECT_EQ(truncated.to_cp1252(), std::string(40, 'a') + "\xF0??");
+
+	// Small strings and assign
+	tiny_utf8::string small;
+	small.assign("K\xE4" "fer", 5, tiny_utf8::latin1);
+	EXPECT_EQ(small, tiny_utf8::string(U"Käfer"));
+	small.assign("\x80", 1, tiny_utf8::cp1252);
+	EXPECT_EQ(small, tiny_utf8::string(U"€"));
+	EXPECT_TRUE(tiny_utf8::string("", 0, tiny_utf8::cp1252).empty());
+}
@@ -0,0 +1,231 @@
+﻿#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <tinyutf8/tinyutf8.h>
+
+TEST(TinyUTF8, Dispatch_SetLevel)
+{
+	tiny_utf8::simd_level initial = tiny_utf8::get_simd_level();
+	EXPECT_LE(initial, tiny_utf8::get_max_simd_level());
+
+	EXPECT_EQ(tiny_utf8::set_simd_level(tiny_utf8::simd_level::scalar), tiny_utf8::simd_level::scalar);
+	EXPECT_EQ(tiny_utf8::get_simd_level(), tiny_utf8::simd_level::scalar);
+	EXPECT_EQ(tiny_utf8::set_simd_level(tiny_utf8::simd_level::avx2), tiny_utf8::get_max_simd_level());
+	EXPECT_EQ(tiny_utf8::get_simd_level(), tiny_utf8::get_max_simd_level());
+
+	tiny_utf8::set_simd_level(initial);
+}
+
+TEST(TinyUTF8, Dispatch_KernelsAgree)
+{
+	tiny_utf8::simd_level initial = tiny_utf8::get_simd_level();
+
+	// Ascii runs of all lengths around the vector widths, followed by multibytes
+	std::u32string codepoints;
+	for (int run = 0; run < 70; ++run)
+		codepoints += std::u32string(run, U'a') + U"ä" + std::u32string(run % 5, U'b') + U"ツ🌍";
+	codepoints += std::u32string(100, U'z') + U"needle€";
+	std::string invalid = tiny_utf8::string(codepoints.c_str()).cpp_str() + std::string(40, 'x') + "\xC0\xAF";
+
+	for (int level = 0; level <= (int)tiny_utf8::get_max_simd_level(); ++level) {
+		tiny_utf8::set_simd_level(tiny_utf8::simd_level(level));
+		SCOPED_TRACE(level);
+
+		// Counting and transcoding
+		tiny_utf8::string str(codepoints.c_str());
+		std::string bytes = str.cpp_str();
+		EXPECT_EQ(tiny_utf8::string(bytes).length(), codepoints.size());
+		EXPECT_EQ(str.to_u32string(), codepoints);
+		for (std::size_t pos : { std::size_t(0), std::size_t(1), std::size_t(31), std::size_t(1000) })
+			for (std::size_t len : { std::size_t(15), std::size_t(33), std::size_t(500) }) {
+				std::u32string part(len, U'\0');
+				part.resize(str.copy_codepoints(&part[0], len, pos));
+				EXPECT_EQ(part, codepoints.substr(pos, len));
+			}
+
+		// Validation
+		std::size_t error_offset;
+		EXPECT_TRUE(tiny_utf8::validate(bytes.data(), bytes.size()));
+		EXPECT_FALSE(tiny_utf8::validate(invalid.data(), invalid.size(), &error_offset));
+		EXPECT_EQ(error_offset, invalid.size() - 2);
+
+		// Searching
+		tiny_utf8::parallel_t serial(1);
+		EXPECT_EQ(str.parallel_find(tiny_utf8::string(U"needle€"), 0, serial), codepoints.size() - 7);
+		EXPECT_EQ(str.parallel_find(tiny_utf8::string(U"ツ🌍a"), 0, serial), codepoints.find(U"ツ🌍a"));
+		EXPECT_EQ(str.parallel_find(tiny_utf8::string(U"€z"), 0, serial), tiny_utf8::string::npos);
+		EXPECT_EQ(str.parallel_count(tiny_utf8::string(U"äb"), serial), 56);
+		EXPECT_EQ(str.parallel_count(U'🌍', serial), 70);
+	}
+
+	tiny_utf8::set_simd_level(initial);
+}
+
+TEST(TinyUTF8, Dispatch_Validation)
+{
+	tiny_utf8::simd_level initial = tiny_utf8::get_simd_level();
+	
+	// Mixed text spanning several vector blocks, with every kind of ill-formed sequence inserted at every offset
+	std::string text;
+	for (int i = 0; i < 12; ++i)
+		text += "ab\xC3\xA4\xE2\x82\xAC\xF0\x9F\x8C\x8D" + std::string(i, 'c');
+	const char* const ill_formed[] = {
+		"\x80", "\xBF", "\xC0\xAF", "\xC1\xBF", "\xC3", "\xC3\xC3", "\xE2\x82", "\xE0\x9F\x80", "\xED\xA0\x80",
+		"\xF0\x8F\xBF\xBF", "\xF4\x90\x80\x80", "\xF5\x80\x80\x80", "\xF0\x9F\x8C", "\xFF", "\xE2\x82\xAC\xAC"
+	};
+	std::vector<std::size_t> boundaries;
+	for (std::size_t i = 0; i <= text.size(); ++i)
+		if (i == text.size() || (text[i] & 0xC0) != 0x80)
+			boundaries.push_back(i);
+	
+	for (int level = 0; level <= (int)tiny_utf8::get_max_simd_level(); ++level) {
+		tiny_utf8::set_simd_level(tiny_utf8::simd_level(level));
+		SCOPED_TRACE(level);
+		
+		bool valid;
+		tiny_utf8::string str(text.data(), text.size(), tiny_utf8::strict_t(&valid));
+		EXPECT_TRUE(valid);
+		EXPECT_EQ(str.length(), tiny_utf8::string(text).length());
+		
+		for (const char* sequence : ill_formed)
+			for (std::size_t pos : boundaries) {
+				SCOPED_TRACE(pos);
+				std::string data = text.substr(0, pos) + sequence + text.substr(pos);
+				std::size_t error_offset = 0;
+				EXPECT_FALSE(tiny_utf8::validate(data.data(), data.size(), &error_offset));
+				std::size_t expected = pos + (std::string(sequence) == "\xE2\x82\xAC\xAC" ? 3 : 0); // The excess continuation
+				EXPECT_EQ(error_offset, expected);
+				
+				tiny_utf8::string rejected(data.data(), data.size(), tiny_utf8::strict_t(&valid));
+				EXPECT_FALSE(valid);
+				
+				// Repairing agrees with the scalar code
+				std::size_t num_replacements = 0;
+				tiny_utf8::string repaired(data.data(), data.size(), tiny_utf8::repair_t(&num_replacements));
+				tiny_utf8::set_simd_level(tiny_utf8::simd_level::scalar);
+				std::size_t scalar_replacements = 0;
+				tiny_utf8::string scalar(data.data(), data.size(), tiny_utf8::repair_t(&scalar_replacements));
+				tiny_utf8::set_simd_level(tiny_utf8::simd_level(level));
+				EXPECT_EQ(num_replacements, scalar_replacements);
+				EXPECT_EQ(repaired, scalar);
+				EXPECT_EQ(repaired.length(), scalar.length());
+			}
+	}
+	
+	tiny_utf8::set_simd_level(initial);
+}
+
+TEST(TinyUTF8, Dispatch_EncodeUTF32)
+{
+	tiny_utf8::simd_level initial = tiny_utf8::get_simd_level();
+	
+	// Runs of 1-, 2- and 3-byte codepoints of all lengths around the block sizes, interrupted by 4-byte ones
+	std::u32string codepoints;
+	for (int run = 0; run < 45; ++run) {
+		codepoints += std::u32string(run, U'a') + std::u32string(run % 7, U'ä') + std::u32string(run % 11, U'\u20AC');
+		codepoints += run % 3 ? U"\u07FF\u0800\uFFFF\u0080" : U"\U0001F30D";
+	}
+	
+	for (int level = 0; level <= (int)tiny_utf8::get_max_simd_level(); ++level) {
+		tiny_utf8::set_simd_level(tiny_utf8::simd_level(level));
+		SCOPED_TRACE(level);
+		
+		for (std::size_t pos : { std::size_t(0), std::size_t(5), std::size_t(333) }) {
+			std::u32string part = codepoints.substr(pos);
+			std::string expected;
+			for (char32_t cp : part)
+				expected += tiny_utf8::string(1, cp).cpp_str();
+			tiny_utf8::string str(part.data(), part.size());
+			EXPECT_EQ(str.cpp_str(), expected);
+			EXPECT_EQ(str.length(), part.size());
+			EXPECT_EQ(str.to_u32string(), part);
+			for (std::size_t i = 0; i < part.size(); i += 13)
+				EXPECT_EQ(str[i], part[i]);
+		}
+	}
+	
+	tiny_utf8::set_simd_level(initial);
+}
+
+TEST(TinyUTF8, Dispatch_UTF16)
+{
+	tiny_utf8::simd_level initial = tiny_utf8::get_simd_level();
+	
+	// Runs of 1-, 2- and 3-byte code units of all lengths around the block sizes, interrupted by surrogate pairs and unpaired surrogates
+	std::u16string units;
+	std::u32string codepoints;
+	for (int run = 0; run < 60; ++run) {
+		std::u16string part = std::u16string(run, u'a') + std::u16string(run % 7, u'ä') + std::u16string(run % 11, u'€') + u"\u07FF\u0800\uFFFF";
+		units += part;
+		codepoints += std::u32string(part.begin(), part.end());
+		switch (run % 3) {
+			case 0: units += u"\U0001F30D"; codepoints += U"\U0001F30D"; break;
+			case 1: units += u'\xD800'; codepoints += char32_t(0xD800); break;
+			case 2: units += u'\xDC00'; codepoints += char32_t(0xDC00); break;
+		}
+	}
+	std::string expected = tiny_utf8::string(codepoints.data(), codepoints.size()).cpp_str();
+	
+	// Utf8 with truncated and stray bytes interrupting the runs (decoded leniently, i.e. the same on all levels)
+	std::string bytes;
+	const char* const interruptions[] = { "\xC3", "\x80", "\xE2\x82", "\xF0\x9F\x8C\x8D", "\xFF" };
+	for (int run = 0; run < 60; ++run) {
+		bytes += std::string(run, 'a');
+		for (int i = 0; i < run % 5; ++i)
+			bytes += "\xC3\xA4";
+		bytes += "\xE2\x82\xAC";
+		bytes += interruptions[run % 5];
+	}
+	tiny_utf8::string ill_formed = tiny_utf8::string::from_bytes(bytes.data(), bytes.size());
+	tiny_utf8::set_simd_level(tiny_utf8::simd_level::scalar);
+	std::u16string ill_formed_units = ill_formed.to_u16string();
+	
+	for (int level = 0; level <= (int)tiny_utf8::get_max_simd_level(); ++level) {
+		tiny_utf8::set_simd_level(tiny_utf8::simd_level(level));
+		SCOPED_TRACE(level);
+		
+		tiny_utf8::string str(units.data(), units.size());
+		EXPECT_EQ(str.cpp_str(), expected);
+		EXPECT_EQ(str.length(), codepoints.size());
+		EXPECT_EQ(str.to_u16string(), units);
+		for (std::size_t i = 0; i < codepoints.size(); i += 13)
+			EXPECT_EQ(str[i], codepoints[i]);
+		
+		EXPECT_EQ(ill_formed.to_u16string(), ill_formed_units);
+	}
+	
+	tiny_utf8::set_simd_level(initial);
+}
+
+TEST(TinyUTF8, Dispatch_Latin1)
+{
+	tiny_utf8::simd_level initial = tiny_utf8::get_simd_level();
+	
+	// Runs of high bytes (too many for a lut, which leaves their expansion to the kernel) interrupted by ascii runs of all lengths around the block sizes
+	std::string bytes;
+	for (int run = 0; run < 60; ++run)
+		for (int i = 0; i < run + 16; ++i)
+			bytes += char(i < run % 19 ? 'a' + i % 26 : 0x80 + (run * 7 + i) % 128);
+	
+	for (int level = 0; level <= (int)tiny_utf8::get_max_simd_level(); ++level) {
+		tiny_utf8::set_simd_level(tiny_utf8::simd_level(level));
+		SCOPED_TRACE(level);
+		
+		for (std::size_t pos : { std::size_t(0), std::size_t(5), std::size_t(333) }) {
+			std::string part = bytes.substr(pos);
+			std::string expected;
+			for (char ch : part)
+				expected += tiny_utf8::string(1, char32_t((unsigned char)ch)).cpp_str();
+			tiny_utf8::string str(part.data(), part.size(), tiny_utf8::latin1);
+			EXPECT_FALSE(str.lut_active());
+			EXPECT_EQ(str.cpp_str(), expected);
+			EXPECT_EQ(str.length(), part.size());
+			for (std::size_t i = 0; i < part.size(); i += 13)
+				EXPECT_EQ(str[i], char32_t((unsigned char)part[i]));
+		}
+	}
+	
+	tiny_utf8::set_simd_level(initial);
+}
@@ -0,0 +1,102 @@
+﻿#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+
+#include <tinyutf8/gap_string.h>
+
+TEST(TinyUTF8, GapString_Basics)
+{
+	tiny_utf8::gap_string str(U"Löwen, Bären, Vögel");
+	EXPECT_EQ(str.length(), 19);
+	EXPECT_EQ(str.size(), 22);
+	EXPECT_EQ(str.gap_position(), 19);
+	EXPECT_EQ(str.at(8), U'ä');
+
+	// Type at a cursor
+	str.move_gap(5);
+	for (char32_t cp : std::u32string(U" und Käfer"))
+		str.insert(str.gap_position(), cp);
+	EXPECT_EQ(str.gap_position(), 15);
+	EXPECT_EQ(str.str(), U"Löwen und Käfer, Bären, Vögel");
+
+	// Backspace
+	str.erase(str.gap_position() - 1);
+	str.erase(str.gap_position() - 1);
+	EXPECT_EQ(str.str(), U"Löwen und Käf, Bären, Vögel");
+	EXPECT_EQ(str.at(12), U'f');
+	EXPECT_EQ(str.at(13), U',');
+	EXPECT_EQ(str.at(16), U'ä');
+
+	// Iteration in both directions
+	std::u32string forward(str.begin(), str.end());
+	EXPECT_EQ(forward, U"Löwen und Käf, Bären, Vögel");
+	std::u32string backward;
+	for (auto iter = str.end(); iter != str.begin();)
+		backward += *--iter;
+	EXPECT_EQ(backward, std::u32string(forward.rbegin(), forward.rend()));
+
+	str.append(U"ツ").erase(0, 6);
+	EXPECT_EQ(str.str(), U"und Käf, Bären, Vögelツ");
+	str.clear();
+	EXPECT_TRUE(str.empty());
+	EXPECT_EQ(str.str(), U"");
+}
+
+TEST(TinyUTF8, GapString_RandomEdits)
+{
+	std::mt19937 rng(4711);
+	const char32_t alphabet[] = U"abcäöü€ツ♫🌍\n ";
+
+	std::u32string reference;
+	for (int i = 0; i < 5000; ++i)
+		reference += alphabet[rng() % 12];
+	tiny_utf8::gap_string str(tiny_utf8::string(reference.c_str()));
+	std::size_t cursor = rng() % reference.size();
+
+	for (int i = 0; i < 20000; ++i) {
+		// Mostly edit around the cursor, sometimes jump
+		if (rng() % 50 == 0)
+			cursor = rng() % (reference.size() + 1);
+		switch (rng() % 5) {
+			case 0:
+			case 1: { // Type
+				char32_t cp = alphabet[rng() % 12];
+				str.insert(cursor, cp);
+				reference.insert(cursor++, 1, cp);
+				break;
+			}
+			case 2: // Backspace
+				if (cursor) {
+					str.erase(--cursor);
+					reference.erase(cursor, 1);
+				}
+				break;
+			case 3: { // Paste or delete a word
+				std::u32string text;
+				for (std::size_t n = rng() % 10; n; --n)
+					text += alphabet[rng() % 12];
+				if (rng() % 2) {
+					str.insert(cursor, tiny_utf8::string(text.c_str()));
+					reference.insert(cursor, text);
+				}
+				else {
+					str.erase(cursor, text.size());
+					reference.erase(cursor, text.size());
+				}
+				break;
+			}
+			case 4: { // Read
+				std::size_t pos = rng() % reference.size();
+				ASSERT_EQ(str.at(pos), reference[pos]);
+				break;
+			}
+		}
+		ASSERT_EQ(str.length(), reference.size());
+	}
+
+	EXPECT_EQ(str.str().to_u32string(), reference);
+	EXPECT_EQ(std::u32string(str.begin(), str.end()), reference);
+	for (std::size_t pos = 0; pos < reference.size(); ++pos)
+		ASSERT_EQ(str[pos], reference[pos]);
+}
@@ -0,0 +1,75 @@
+﻿#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <tinyutf8/intern_pool.h>
+
+TEST(TinyUTF8, InternPool_Deduplicate)
+{
+	tiny_utf8::intern_pool pool(3);
+	EXPECT_EQ(pool.num_shards(), 4);
+
+	tiny_utf8::string label(U"Löwen, Bären, Vögel und Käfer sind Tiere. ツ♫");
+	tiny_utf8::interned_string a = pool.intern(label);
+	tiny_utf8::interned_string b = pool.intern(label.data(), label.size());
+	tiny_utf8::interned_string c = pool.intern(tiny_utf8::string(U"Käfer"));
+	EXPECT_TRUE(a);
+	EXPECT_EQ(a, b);
+	EXPECT_NE(a, c);
+	EXPECT_EQ(&a.str(), &b.str());
+	EXPECT_EQ(pool.size(), 2);
+
+	// The interned copy is a complete string
+	EXPECT_EQ(a.size(), label.size());
+	EXPECT_EQ(a.length(), label.length());
+	EXPECT_EQ(a->at(43), U'♫');
+	EXPECT_EQ(std::string(a.c_str()), label.cpp_str());
+	EXPECT_EQ(c.str().length(), 5);
+
+	// Lookup without interning
+	EXPECT_EQ(pool.find(label), a);
+	EXPECT_FALSE(pool.find(tiny_utf8::string(U"Nashörner")));
+	EXPECT_EQ(pool.size(), 2);
+
+	// Empty strings and embedded zeros
+	tiny_utf8::interned_string empty = pool.intern("", 0);
+	EXPECT_TRUE(empty);
+	EXPECT_EQ(empty.size(), 0);
+	EXPECT_NE(pool.intern("a\0b", 3), pool.intern("a\0c", 3));
+	EXPECT_EQ(pool.intern("a\0b", 3), pool.intern(std::string("a\0b", 3).data(), 3));
+
+	// Handles work as keys
+	std::unordered_set<tiny_utf8::interned_string> set{ a, b, c };
+	EXPECT_EQ(set.size(), 2);
+	EXPECT_GT(pool.bytes_used(), label.size());
+}
+
+TEST(TinyUTF8, InternPool_Concurrent)
+{
+	tiny_utf8::intern_pool pool;
+	const int num_threads = 8;
+	const int num_labels = 500;
+
+	std::vector<std::vector<tiny_utf8::interned_string>> handles(num_threads);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < num_threads; ++t)
+		threads.emplace_back([&, t] {
+			for (int i = 0; i < num_labels; ++i) {
+				std::string label = "label-Größe-" + std::to_string((i * 7 + t) % num_labels);
+				handles[t].push_back(pool.intern(label.data(), label.size()));
+			}
+		});
+	for (std::thread& thread : threads)
+		thread.join();
+
+	EXPECT_EQ(pool.size(), num_labels);
+	for (int t = 0; t < num_threads; ++t)
+		for (int i = 0; i < num_labels; ++i) {
+			std::string label = "label-Größe-" + std::to_string((i * 7 + t) % num_labels);
+			ASSERT_EQ(handles[t][i], pool.find(label.data(), label.size()));
+			ASSERT_EQ(std::string(handles[t][i].c_str()), label);
+		}
+}
@@ -1,7 +1,13 @@
 ﻿#include <gtest/gtest.h>
 
 #include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <tinyutf8/tinyutf8.h>
 
@@ -179,3 +185,223 @@ TEST(TinyUTF8, ReplaceString)
 	EXPECT_EQ(str.length(), 15);
 	EXPECT_TRUE(str.requires_unicode());
 }
+
+TEST(TinyUTF8, CopyOnWrite)
+{
+	const tiny_utf8::cow_string original(U"Löwen, Bären, Vögel und Käfer sind Tiere ♫");
+	ASSERT_FALSE(original.sso_active());
+	ASSERT_TRUE(original.lut_active());
+
+	// Copies share the buffer
+	tiny_utf8::cow_string copy = original;
+	tiny_utf8::cow_string assigned;
+	assigned = copy;
+	EXPECT_EQ(copy.c_str(), original.c_str());
+	EXPECT_EQ(assigned.c_str(), original.c_str());
+	EXPECT_EQ(assigned, original);
+
+	// Modifications unshare the buffer
+	copy.append(U" und ツ");
+	EXPECT_NE(copy.c_str(), original.c_str());
+	EXPECT_EQ(copy.length(), original.length() + 6);
+	EXPECT_EQ(copy.back(), U'ツ');
+	EXPECT_EQ(original.back(), U'♫');
+
+	copy = original;
+	copy[1] = U'o';
+	EXPECT_EQ(copy[1], U'o');
+	EXPECT_EQ(original[1], U'ö');
+
+	copy = original;
+	copy.insert(0, U"Die ");
+	copy.erase(copy.length() - 1);
+	EXPECT_EQ(copy.substr(0, 9), U"Die Löwen");
+	EXPECT_EQ(original.substr(0, 5), U"Löwen");
+	EXPECT_EQ(original.length(), 42);
+
+	copy = original;
+	copy.raw_erase(0, 8);
+	EXPECT_EQ(copy.front(), U'B');
+	EXPECT_EQ(original.front(), U'L');
+
+	copy = original;
+	copy.data()[0] = 'l';
+	EXPECT_EQ(copy.front(), U'l');
+	EXPECT_EQ(original.front(), U'L');
+
+	// Unaffected by the modifications of other copies
+	EXPECT_EQ(assigned.c_str(), original.c_str());
+	EXPECT_EQ(assigned.length(), original.length());
+
+	// Releasing copies concurrently
+	std::vector<tiny_utf8::cow_string> copies(100, original);
+	std::vector<std::thread> threads;
+	for (int i = 0; i < 4; ++i)
+		threads.emplace_back([&copies, &original, i]() {
+			for (std::size_t j = i; j < copies.size(); j += 4) {
+				tiny_utf8::cow_string local = copies[j];
+				if (j % 2)
+					local.push_back(U'!');
+				copies[j] = tiny_utf8::cow_string();
+				EXPECT_EQ(local.front(), original.front());
+			}
+		});
+	for (std::thread& thread : threads)
+		thread.join();
+	EXPECT_EQ(assigned, original);
+}
+
+TEST(TinyUTF8, CompactString)
+{
+	static_assert(std::is_same<tiny_utf8::compact_string::size_type, std::uint32_t>::value, "compact_string has to use 32-bit sizes");
+	EXPECT_LT(sizeof(tiny_utf8::compact_string), sizeof(tiny_utf8::string));
+	EXPECT_EQ(sizeof(tiny_utf8::compact_string), sizeof(void*) == 8 ? 24u : 16u);
+
+	// Small strings stay in-place
+	tiny_utf8::compact_string small(U"Löwen");
+	EXPECT_TRUE(small.sso_active());
+	EXPECT_EQ(small.capacity(), sizeof(tiny_utf8::compact_string) - 1);
+
+	// Same results as with 64-bit sizes
+	tiny_utf8::string reference(U"Löwen, Bären, Vögel und Käfer sind Tiere ♫");
+	tiny_utf8::compact_string str(U"Löwen, Bären, Vögel und Käfer sind Tiere ♫");
+	EXPECT_TRUE(str.lut_active());
+	for (int i = 0; i < 50; ++i) {
+		reference.insert(i * 3 % reference.length(), U"ä€x");
+		str.insert(i * 3 % str.length(), U"ä€x");
+		reference.erase(i * 7 % reference.length(), 2);
+		str.erase(i * 7 % str.length(), 2);
+		reference.replace(i % reference.length(), 1, U"𝄞");
+		str.replace(i % str.length(), 1, U"𝄞");
+	}
+	EXPECT_EQ(str.cpp_str(), reference.cpp_str());
+	EXPECT_EQ(str.length(), reference.length());
+	EXPECT_EQ(str.find(U'♫'), reference.find(U'♫'));
+	EXPECT_EQ(str.substr(10, 20).cpp_str(), reference.substr(10, 20).cpp_str());
+	EXPECT_EQ(std::u32string(str.begin(), str.end()), std::u32string(reference.begin(), reference.end()));
+	EXPECT_EQ(tiny_utf8::compact_string::npos, std::numeric_limits<std::uint32_t>::max());
+	EXPECT_EQ(str.find(U"not there"), tiny_utf8::compact_string::npos);
+
+	// Buffers beyond 64 KiB use 32-bit lut indices (max() + 1 must not overflow the 32-bit size_type)
+	tiny_utf8::compact_string large(std::string(70000, 'a') + "ä€");
+	large.insert(5, U'𝄞');
+	tiny_utf8::memory_usage_info usage = large.memory_usage();
+	ASSERT_TRUE(large.lut_active());
+	EXPECT_EQ(usage.lut_entries, 3u);
+	EXPECT_EQ(usage.lut_bytes, 3 * sizeof(std::uint32_t));
+	EXPECT_EQ(large.at(5), U'𝄞');
+	EXPECT_EQ(large.at(70001), U'ä');
+	EXPECT_EQ(large.back(), U'€');
+	EXPECT_EQ(large.length(), 70003u);
+
+	// Sizes beyond the 32-bit size_type are rejected instead of wrapping around
+	EXPECT_EQ(tiny_utf8::compact_string::max_size(), std::numeric_limits<std::uint32_t>::max() - 8u);
+	EXPECT_THROW(tiny_utf8::compact_string(0x60000000u, U'€'), std::out_of_range); // 3 * 0x60000000 bytes
+	EXPECT_THROW(tiny_utf8::compact_string(tiny_utf8::compact_string::max_size() + 1u, 'a'), std::out_of_range);
+}
+
+template<typename String>
+static void test_compressed_lut()
+{
+	// More than 64 KiB with every fifth codepoint being a multibyte
+	String reference;
+	for (int i = 0; i < 12000; ++i)
+		reference.append(i % 100 ? U"abcdä" : U"abc€𝄞");
+	String str = reference;
+	str.shrink_to_fit();
+
+	tiny_utf8::memory_usage_info usage = str.memory_usage();
+	tiny_utf8::memory_usage_info reference_usage = reference.memory_usage();
+	ASSERT_TRUE(str.lut_active());
+	EXPECT_EQ(usage.num_compressed_luts, 1u);
+	EXPECT_EQ(reference_usage.num_compressed_luts, 0u);
+	EXPECT_EQ(usage.lut_entries, reference_usage.lut_entries);
+	EXPECT_LT(usage.lut_bytes * 3, reference_usage.lut_bytes);
+	EXPECT_EQ(usage.heap_bytes, usage.data_bytes + usage.terminator_bytes + usage.lut_bytes + usage.indicator_bytes + usage.ref_count_bytes + usage.unused_bytes);
+
+	// Reading is unaffected
+	EXPECT_EQ(str, reference);
+	EXPECT_EQ(str.length(), reference.length());
+	for (typename String::size_type i = 0; i < reference.length(); i += 997)
+		EXPECT_EQ(str.at(i), reference.at(i));
+	EXPECT_EQ(str.back(), reference.back());
+	EXPECT_EQ(str.substr(30000, 5000), reference.substr(30000, 5000));
+	EXPECT_EQ(str.find(U'𝄞', 20000), reference.find(U'𝄞', 20000));
+	EXPECT_EQ(str.rfind(U'€'), reference.rfind(U'€'));
+	EXPECT_EQ(std::u32string(str.raw_rbegin(), str.raw_rend()), std::u32string(reference.raw_rbegin(), reference.raw_rend()));
+	EXPECT_EQ(str.get_num_bytes_from_start(40000), reference.get_num_bytes_from_start(40000));
+	EXPECT_EQ(str.get_num_codepoints(40000, 777), reference.get_num_codepoints(40000, 777));
+	EXPECT_EQ(str.get_num_bytes(40000, 777), reference.get_num_bytes(40000, 777));
+
+	// Copies keep the compressed lut
+	String copy;
+	copy = str;
+	EXPECT_EQ(copy.memory_usage().num_compressed_luts, 1u);
+	EXPECT_EQ(copy.at(50001), reference.at(50001));
+
+	// Serialization writes the decompressed lut, which is compressed again when deserialized
+	std::stringstream stream;
+	EXPECT_TRUE(str.serialize(stream));
+	String deserialized;
+	EXPECT_TRUE(deserialized.deserialize(stream));
+	EXPECT_EQ(deserialized, reference);
+	EXPECT_EQ(deserialized.memory_usage().num_compressed_luts, 1u);
+	EXPECT_EQ(deserialized.at(50001), reference.at(50001));
+
+	// Buffers of exact size built from utf8 data pick the compressed lut right away
+	String constructed(reference.c_str(), reference.size());
+	EXPECT_EQ(constructed.memory_usage().num_compressed_luts, 1u);
+	EXPECT_EQ(constructed.memory_usage().lut_bytes, usage.lut_bytes);
+	EXPECT_EQ(constructed, reference);
+	EXPECT_EQ(constructed.rfind(U'€'), reference.rfind(U'€'));
+	String parallel(reference.c_str(), reference.size(), tiny_utf8::parallel_t(4, 1000));
+	EXPECT_EQ(parallel.memory_usage().num_compressed_luts, 1u);
+	EXPECT_EQ(parallel, reference);
+	for (typename String::size_type i = 0; i < reference.length(); i += 997)
+		EXPECT_EQ(parallel.at(i), reference.at(i));
+
+	// Appending extends the compressed lut (in place, reallocated, with the lut of the appendix and from itself)
+	String appended = constructed;
+	String expected = reference;
+	for (int i = 0; i < 300; ++i) {
+		appended.append(i % 3 ? String(U"xyzö") : String(U"𝄞"));
+		expected.append(i % 3 ? String(U"xyzö") : String(U"𝄞"));
+	}
+	appended += String(200, U'ä');
+	expected += String(200, U'ä');
+	appended += appended;
+	expected += expected;
+	EXPECT_EQ(appended.memory_usage().num_compressed_luts, 1u);
+	EXPECT_EQ(constructed, reference);
+	EXPECT_EQ(appended, expected);
+	EXPECT_EQ(appended.length(), expected.length());
+	for (typename String::size_type i = 0; i < expected.length(); i += 499)
+		EXPECT_EQ(appended.at(i), expected.at(i));
+	EXPECT_EQ(appended.rfind(U'𝄞'), expected.rfind(U'𝄞'));
+	EXPECT_EQ(appended.get_num_codepoints(60000, 10000), expected.get_num_codepoints(60000, 10000));
+
+	// Modifications decompress the lut first
+	str.insert(12345, U"ö𝄞");
+	reference.insert(12345, U"ö𝄞");
+	EXPECT_EQ(str.memory_usage().num_compressed_luts, 0u);
+	EXPECT_EQ(str, reference);
+	copy.erase(100, 50000);
+	EXPECT_EQ(copy, str.substr(0, 100) + str.substr(50102));
+	copy.shrink_to_fit();
+	copy += copy;
+	EXPECT_EQ(copy.length(), 2 * (reference.length() - 50002));
+	EXPECT_EQ(copy.at(copy.length() - 1), reference.back());
+
+	// Small strings are not compressed
+	String small(U"Löwen, Bären, Vögel und Käfer");
+	small.append(String(200, U'ä'));
+	small.shrink_to_fit();
+	EXPECT_FALSE(small.lut_active());
+	EXPECT_EQ(small.memory_usage().num_compressed_luts, 0u);
+}
+
+TEST(TinyUTF8, CompressedLut)
+{
+	test_compressed_lut<tiny_utf8::string>();
+	test_compressed_lut<tiny_utf8::compact_string>();
+}
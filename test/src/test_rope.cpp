@@ -0,0 +1,99 @@
+﻿#include <gtest/gtest.h>
+
+#include <random>
+#include <sstream>
+#include <string>
+
+#include <tinyutf8/rope.h>
+
+TEST(TinyUTF8, Rope_Basics)
+{
+	tiny_utf8::rope rope(U"Löwen, Bären, Vögel");
+	EXPECT_EQ(rope.length(), 19);
+	EXPECT_EQ(rope.size(), 22);
+	EXPECT_EQ(rope.at(8), U'ä');
+	EXPECT_EQ(rope.height(), 1u);
+
+	rope.insert(19, U" und Käfer").insert(0, U'♫').erase(1, 7);
+	EXPECT_EQ(rope.str(), U"♫Bären, Vögel und Käfer");
+	rope.replace(1, 5, U"Tiere");
+	EXPECT_EQ(rope.substr(1, 5), U"Tiere");
+	rope.push_back(U'ツ');
+	EXPECT_EQ(rope[rope.length() - 1], U'ツ');
+
+	tiny_utf8::rope tail = rope.split(6);
+	EXPECT_EQ(rope.str(), U"♫Tiere");
+	EXPECT_EQ(tail.str(), U", Vögel und Käferツ");
+	rope += std::move(tail);
+	EXPECT_EQ(rope.str(), U"♫Tiere, Vögel und Käferツ");
+
+	std::ostringstream stream;
+	stream << rope;
+	EXPECT_EQ(stream.str(), rope.str().cpp_str());
+
+	rope.erase(0, tiny_utf8::rope::npos);
+	EXPECT_TRUE(rope.empty());
+	EXPECT_EQ(rope.height(), 0u);
+}
+
+TEST(TinyUTF8, Rope_RandomEdits)
+{
+	std::mt19937 rng(1337);
+	const char32_t alphabet[] = U"abcäöü€ツ♫🌍\n ";
+
+	// Build a document that spans many leaves
+	std::u32string reference;
+	for (int i = 0; i < 20000; ++i)
+		reference += alphabet[rng() % 12];
+	tiny_utf8::rope rope(tiny_utf8::string(reference.c_str()));
+	ASSERT_EQ(rope.length(), reference.size());
+	EXPECT_GT(rope.height(), 3u);
+
+	for (int i = 0; i < 2000; ++i) {
+		std::size_t pos = rng() % (reference.size() + 1);
+		switch (rng() % 4) {
+			case 0: { // Type a codepoint
+				char32_t cp = alphabet[rng() % 12];
+				rope.insert(pos, cp);
+				reference.insert(pos, 1, cp);
+				break;
+			}
+			case 1: { // Paste a text (sometimes larger than a leaf)
+				std::u32string text;
+				for (std::size_t n = rng() % 2 ? rng() % 20 : rng() % 3000; n; --n)
+					text += alphabet[rng() % 12];
+				rope.insert(pos, tiny_utf8::string(text.c_str()));
+				reference.insert(pos, text);
+				break;
+			}
+			case 2: { // Erase a range
+				std::size_t len = rng() % 2 ? rng() % 4 : rng() % 2000;
+				rope.erase(pos, len);
+				reference.erase(pos, len);
+				break;
+			}
+			case 3: // Read a codepoint
+				if (pos < reference.size()) {
+					ASSERT_EQ(rope.at(pos), reference[pos]);
+				}
+				break;
+		}
+		ASSERT_EQ(rope.length(), reference.size());
+	}
+
+	EXPECT_EQ(rope.str().to_u32string(), reference);
+	EXPECT_EQ(rope.substr(100, 1000).to_u32string(), reference.substr(100, 1000));
+	EXPECT_EQ(rope.size(), rope.str().size());
+	EXPECT_LT(rope.height(), 30u);
+
+	// Copies are independent
+	tiny_utf8::rope copy = rope;
+	copy.erase(0, 10);
+	EXPECT_EQ(copy.length() + 10, rope.length());
+	EXPECT_EQ(rope.str().to_u32string(), reference);
+
+	// Concatenation
+	copy.append(rope);
+	EXPECT_EQ(copy.length(), 2 * reference.size() - 10);
+	EXPECT_EQ(copy.str().to_u32string(), reference.substr(10) + reference);
+}
@@ -35,3 +35,39 @@ TEST(TinyUTF8, StartsEndsWith)
 	EXPECT_EQ(str.starts_with(tiny_utf8::string(starts_with_positive)), true);
 	EXPECT_EQ(str.starts_with(tiny_utf8::string(starts_with_negative)), false);
 }
+
+TEST(TinyUTF8, ParallelFindAndCount)
+{
+	tiny_utf8::string str;
+	for (int i = 0; i < 200; ++i)
+		str += U"Löwen, Bären, Vögel und Käfer sind Tiere. ツ♫ ";
+	str += U"Nashörner 🦏";
+
+	for (unsigned int num_threads = 1; num_threads <= 8; ++num_threads) {
+		tiny_utf8::parallel_t par(num_threads, 16);
+
+		EXPECT_EQ(str.parallel_find(U'🦏', 0, par), str.find(U'🦏'));
+		EXPECT_EQ(str.parallel_find(U'ä', 100, par), str.find(U'ä', 100));
+		EXPECT_EQ(str.parallel_find(U'€', 0, par), tiny_utf8::string::npos);
+		EXPECT_EQ(str.parallel_find(tiny_utf8::string(U"Nashörner"), 0, par), str.find(tiny_utf8::string(U"Nashörner")));
+		EXPECT_EQ(str.parallel_find(tiny_utf8::string(U"ツ♫ Löwen"), 500, par), str.find(tiny_utf8::string(U"ツ♫ Löwen"), 500));
+		EXPECT_EQ(str.parallel_find(tiny_utf8::string(U"Tiger"), 0, par), tiny_utf8::string::npos);
+
+		EXPECT_EQ(str.parallel_count(U'ä', par), 400);
+		EXPECT_EQ(str.parallel_count(U'🦏', par), 1);
+		EXPECT_EQ(str.parallel_count(tiny_utf8::string(U"Vögel"), par), 200);
+	}
+
+	// Non-overlapping matches
+	tiny_utf8::string repeated(std::string(101, 'a'));
+	for (unsigned int num_threads = 1; num_threads <= 8; ++num_threads) {
+		tiny_utf8::parallel_t par(num_threads, 4);
+		EXPECT_EQ(repeated.parallel_count(tiny_utf8::string(U"aa"), par), 50);
+		EXPECT_EQ(repeated.parallel_count(tiny_utf8::string(U"aaa"), par), 33);
+	}
+
+	// Beyond the end and small strings
+	EXPECT_EQ(str.parallel_find(U'L', str.length()), tiny_utf8::string::npos);
+	EXPECT_EQ(tiny_utf8::string(U"Bär").parallel_find(U'r'), 2);
+	EXPECT_EQ(tiny_utf8::string(U"Bär").parallel_count(U'ä'), 1);
+}
@@ -0,0 +1,139 @@
+﻿#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+#include <map>
+#include <thread>
+
+#include <tinyutf8/tinyutf8.h>
+
+static_assert(TINY_UTF8_STATS, "This test has to be compiled with TINY_UTF8_STATS");
+
+TEST(TinyUTF8, Stats_Allocations)
+{
+	tiny_utf8::reset_stats();
+	{
+		tiny_utf8::string small(U"äbc");
+		tiny_utf8::string large(std::string(100, 'a'));
+	}
+	tiny_utf8::stats stats = tiny_utf8::get_stats();
+	EXPECT_EQ(stats.allocations, 1u);
+	EXPECT_EQ(stats.deallocations, 1u);
+	EXPECT_GE(stats.bytes_allocated, 101u);
+
+	// Resetting returns the values before
+	tiny_utf8::stats before = tiny_utf8::reset_stats();
+	EXPECT_EQ(before.allocations, 1u);
+	EXPECT_EQ(tiny_utf8::get_stats().allocations, 0u);
+}
+
+TEST(TinyUTF8, Stats_SSOToHeapAndLut)
+{
+	tiny_utf8::string str(U"ä");
+	tiny_utf8::reset_stats();
+
+	// Growing beyond the sso capacity builds the lut from the sso data
+	str.append(std::string(100, 'a'));
+	tiny_utf8::stats stats = tiny_utf8::get_stats();
+	EXPECT_EQ(stats.sso_to_heap, 1u);
+	EXPECT_EQ(stats.lut_builds, 1u);
+	EXPECT_EQ(stats.lut_rebuilds, 0u);
+	ASSERT_TRUE(str.lut_active());
+
+	// Growing beyond 256 bytes copies the lut and widens its indices
+	tiny_utf8::string appendix(std::string(300, 'b'));
+	tiny_utf8::reset_stats();
+	str.append(appendix);
+	stats = tiny_utf8::get_stats();
+	EXPECT_EQ(stats.sso_to_heap, 0u);
+	EXPECT_EQ(stats.lut_builds, 0u);
+	EXPECT_EQ(stats.lut_rebuilds, 1u);
+	EXPECT_EQ(stats.lut_width_changes, 1u);
+	EXPECT_EQ(stats.allocations, 1u);
+	EXPECT_EQ(stats.deallocations, 1u);
+}
+
+TEST(TinyUTF8, Stats_LoadFile)
+{
+	// A mostly ascii file is read into one buffer (with little room for the lut) and never copied
+	std::string data(1 << 20, 'a');
+	data += "\xC3\xA4";
+	std::FILE* file = std::tmpfile();
+	ASSERT_TRUE(file != nullptr);
+	std::fwrite(data.data(), 1, data.size(), file);
+	std::rewind(file);
+	tiny_utf8::reset_stats();
+	tiny_utf8::string str = tiny_utf8::load_file(file);
+	tiny_utf8::stats stats = tiny_utf8::get_stats();
+	EXPECT_EQ(str.size(), data.size());
+	EXPECT_EQ(stats.allocations, 1u);
+	EXPECT_LE(stats.bytes_allocated, data.size() + data.size() / 16 + 32);
+	EXPECT_EQ(stats.lut_builds, 1u);
+	EXPECT_TRUE(str.lut_active());
+	std::fclose(file);
+}
+
+TEST(TinyUTF8, Stats_CompressedLutAppend)
+{
+	// A large string with many multibytes gets a compressed lut right away
+	std::string data;
+	for (int i = 0; i < 20000; ++i)
+		data += "abc\xC3\xA4";
+	tiny_utf8::reset_stats();
+	tiny_utf8::string str(data);
+	tiny_utf8::stats stats = tiny_utf8::get_stats();
+	EXPECT_EQ(stats.allocations, 1u);
+	EXPECT_EQ(stats.lut_compressions, 1u);
+	ASSERT_EQ(str.memory_usage().num_compressed_luts, 1u);
+
+	// Appending extends it without decompressing, while reallocations are amortized
+	tiny_utf8::reset_stats();
+	for (int i = 0; i < 1000; ++i)
+		str.append(tiny_utf8::string(U"xyzö"));
+	stats = tiny_utf8::get_stats();
+	EXPECT_EQ(stats.lut_decompressions, 0u);
+	EXPECT_EQ(stats.lut_rebuilds, 1u);
+	EXPECT_EQ(str.memory_usage().num_compressed_luts, 1u);
+	EXPECT_EQ(str.length(), 20000u * 4 + 1000 * 4);
+	EXPECT_EQ(str.at(str.length() - 1), U'ö');
+}
+
+TEST(TinyUTF8, Stats_LinearScans)
+{
+	// Too many multibytes for a lut
+	tiny_utf8::string str(std::u32string(100, U'ä').c_str());
+	ASSERT_FALSE(str.sso_active());
+	ASSERT_FALSE(str.lut_active());
+
+	tiny_utf8::reset_stats();
+	EXPECT_EQ(str.at(50), U'ä');
+	tiny_utf8::stats stats = tiny_utf8::get_stats();
+	EXPECT_EQ(stats.linear_scans, 1u);
+	EXPECT_EQ(stats.bytes_scanned, 100u);
+
+	// Ascii-only strings are O(1) and small strings are not accounted for
+	tiny_utf8::string ascii(std::string(100, 'a'));
+	tiny_utf8::string small(U"äöü");
+	tiny_utf8::reset_stats();
+	EXPECT_EQ(ascii.at(50), U'a');
+	EXPECT_EQ(small.at(2), U'ü');
+	EXPECT_EQ(tiny_utf8::get_stats().linear_scans, 0u);
+}
+
+TEST(TinyUTF8, Stats_ThreadLocal)
+{
+	tiny_utf8::reset_stats();
+	std::thread([]{
+		tiny_utf8::string str(std::string(100, 'a'));
+		EXPECT_EQ(tiny_utf8::get_stats().allocations, 1u);
+	}).join();
+	EXPECT_EQ(tiny_utf8::get_stats().allocations, 0u);
+
+	// Export by name
+	std::map<std::string, std::uint64_t> exported;
+	tiny_utf8::string str(std::string(100, 'a'));
+	tiny_utf8::get_stats().visit([&](const char* name, std::uint64_t value){ exported[name] = value; });
+	EXPECT_EQ(exported.size(), 11u);
+	EXPECT_EQ(exported["allocations"], 1u);
+	EXPECT_EQ(exported["bytes_scanned"], 0u);
+}
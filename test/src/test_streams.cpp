@@ -0,0 +1,354 @@
+﻿#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <utility>
+
+#include <tinyutf8/tinyutf8.h>
+
+TEST(TinyUTF8, StreamInsertion)
+{
+	tiny_utf8::string str(U"Löwen, Bären, Vögel und Käfer sind Tiere.");
+
+	std::ostringstream stream;
+	stream << str;
+	EXPECT_EQ(stream.str(), str.cpp_str());
+
+	stream.str("");
+	stream << std::setw(8) << std::left << tiny_utf8::string(U"Bär") << '|';
+	EXPECT_EQ(stream.str(), std::string(u8"Bär    |"));
+}
+
+TEST(TinyUTF8, StreamExtraction)
+{
+	std::u32string long_word = U"Löwen,Bären,Vögel,und,Käfer,sind,Tiere,Löwen,Bären,Vögel,und,Käfer,sind,Tiere";
+	std::istringstream stream("  Hallo\tWörld \n" + tiny_utf8::string(long_word.c_str()).cpp_str() + " x");
+
+	tiny_utf8::string str;
+	stream >> str;
+	EXPECT_EQ(str, U"Hallo");
+	EXPECT_TRUE(str.sso_active());
+	stream >> str;
+	EXPECT_EQ(str, U"Wörld");
+	stream >> str;
+	EXPECT_FALSE(str.sso_active());
+	EXPECT_TRUE(str.lut_active());
+	EXPECT_EQ(str.length(), long_word.length());
+	EXPECT_EQ(str.size(), tiny_utf8::string(long_word.c_str()).size());
+	for (std::size_t i = 0; i < long_word.length(); ++i)
+		EXPECT_EQ(str[i], long_word[i]);
+	stream >> std::setw(3) >> str;
+	EXPECT_EQ(str, U"x");
+	EXPECT_TRUE(stream.eof());
+	EXPECT_FALSE(stream.fail());
+	stream >> str;
+	EXPECT_TRUE(stream.fail());
+}
+
+TEST(TinyUTF8, StreamExtractionTruncated)
+{
+	// Input ending in a truncated multibyte (longer than the sso capacity) is counted like the byte constructor does
+	for (const char* tail : {"\xF0\xC3\xA9", "\xF0\x9F", "\xE2\x82", "\xC3"}) {
+		std::string bytes = std::string(100, 'a') + "ä" + tail;
+		tiny_utf8::string expected(bytes);
+		std::istringstream stream(bytes);
+		tiny_utf8::string str;
+		stream >> str;
+		EXPECT_FALSE(str.sso_active());
+		EXPECT_EQ(str.cpp_str(), bytes);
+		EXPECT_EQ(str.length(), expected.length());
+		EXPECT_EQ(str.lut_active(), expected.lut_active());
+		for (std::size_t i = 98; i < expected.length(); ++i)
+			EXPECT_EQ(str.at(i), expected.at(i));
+	}
+}
+
+TEST(TinyUTF8, GetLine)
+{
+	// The second line ends with an incomplete codepoint
+	std::istringstream stream(std::string(u8"Löwen\n\n") + "\xC3" + "\nTiere");
+
+	tiny_utf8::string str;
+	EXPECT_TRUE(getline(stream, str));
+	EXPECT_EQ(str, U"Löwen");
+	EXPECT_TRUE(getline(stream, str));
+	EXPECT_TRUE(str.empty());
+	EXPECT_TRUE(getline(stream, str));
+	EXPECT_EQ(str.size(), 1);
+	EXPECT_EQ(str.length(), 1);
+	EXPECT_TRUE(getline(stream, str, 'e'));
+	EXPECT_EQ(str, U"Ti");
+	EXPECT_TRUE(getline(stream, str));
+	EXPECT_EQ(str, U"re");
+	EXPECT_TRUE(stream.eof());
+	EXPECT_FALSE(getline(stream, str));
+}
+
+TEST(TinyUTF8, StreamDecoder)
+{
+	std::u32string expected;
+	for (int i = 0; i < 40; ++i)
+		expected += U"Löwen, Bären, Vögel und Käfer sind Tiere. \U0001F981 ";
+	std::string data = tiny_utf8::string(expected.c_str()).cpp_str();
+
+	for (std::size_t chunk_size : { 1, 2, 3, 7, 64, 1000 })
+	{
+		tiny_utf8::string str;
+		tiny_utf8::stream_decoder decoder(str);
+		for (std::size_t pos = 0; pos < data.size(); pos += chunk_size)
+		{
+			decoder.feed(data.data() + pos, std::min(chunk_size, data.size() - pos));
+			EXPECT_EQ(str.size() + decoder.pending(), std::min(pos + chunk_size, data.size()));
+		}
+		EXPECT_TRUE(decoder.finish());
+		EXPECT_FALSE(decoder.invalid());
+		EXPECT_EQ(str.length(), expected.length());
+		EXPECT_EQ(str.cpp_str(), data);
+		for (std::size_t i = 0; i < expected.length(); i += 13)
+			EXPECT_EQ(str[i], expected[i]);
+	}
+
+	// A split codepoint that is continued by something else than continuation bytes and an incomplete end
+	tiny_utf8::string str;
+	tiny_utf8::stream_decoder decoder(str);
+	decoder.feed("a\xC3", 2);
+	EXPECT_FALSE(decoder.at_boundary());
+	EXPECT_EQ(str, U"a");
+	decoder.feed("bc\xE2\x82", 4);
+	EXPECT_TRUE(decoder.invalid());
+	EXPECT_EQ(decoder.pending(), 2);
+	EXPECT_FALSE(decoder.finish());
+	EXPECT_EQ(str.size(), 6);
+	EXPECT_EQ(str.length(), 5);
+}
+
+TEST(TinyUTF8, LoadFile)
+{
+	std::u32string expected;
+	for (int i = 0; i < 100; ++i)
+		expected += U"Löwen, Bären, Vögel und Käfer sind Tiere. ";
+	std::string data = tiny_utf8::string(expected.c_str()).cpp_str();
+
+	std::FILE* file = std::tmpfile();
+	ASSERT_TRUE(file != nullptr);
+	std::fwrite("\xEF\xBB\xBF", 1, 3, file);
+	std::fwrite(data.data(), 1, data.size(), file);
+	std::rewind(file);
+
+	bool success = false;
+	tiny_utf8::string str = tiny_utf8::load_file(file, &success);
+	EXPECT_TRUE(success);
+	EXPECT_TRUE(str.lut_active());
+	EXPECT_EQ(str.length(), expected.length());
+	EXPECT_EQ(str.cpp_str(), data);
+	for (std::size_t i = 0; i < expected.length(); i += 7)
+		EXPECT_EQ(str[i], expected[i]);
+
+	// Read the rest of the file starting in the middle of it (no BOM there)
+	std::fseek(file, 3 + 8, SEEK_SET);
+	str = tiny_utf8::load_file(file);
+	EXPECT_EQ(str.cpp_str(), data.substr(8));
+
+	std::fclose(file);
+
+	// Empty file
+	file = std::tmpfile();
+	str = tiny_utf8::load_file(file, &success);
+	EXPECT_TRUE(success);
+	EXPECT_TRUE(str.empty());
+	std::fclose(file);
+
+#if TINY_UTF8_HAS_POSIX_IO
+	// Short file (fitting into SSO), read through its file descriptor
+	std::string small = data.substr(0, 16);
+	file = std::tmpfile();
+	std::fwrite(small.data(), 1, small.size(), file);
+	std::fflush(file);
+	lseek(fileno(file), 0, SEEK_SET);
+	str = tiny_utf8::load_file(fileno(file), &success);
+	EXPECT_TRUE(success);
+	EXPECT_TRUE(str.sso_active());
+	EXPECT_EQ(str.cpp_str(), small);
+	std::fclose(file);
+
+	// Pipe (the size of which is unknown)
+	int fds[2];
+	ASSERT_EQ(pipe(fds), 0);
+	EXPECT_EQ(write(fds[1], "\xEF\xBB\xBF", 3), 3);
+	EXPECT_EQ(write(fds[1], data.data(), data.size()), (ssize_t)data.size());
+	close(fds[1]);
+	str = tiny_utf8::load_file(fds[0], &success);
+	close(fds[0]);
+	EXPECT_TRUE(success);
+	EXPECT_EQ(str.length(), expected.length());
+	EXPECT_EQ(str.cpp_str(), data);
+#endif
+
+	str = tiny_utf8::load_file("/nonexistent/tinyutf8/file", &success);
+	EXPECT_FALSE(success);
+	EXPECT_TRUE(str.empty());
+
+	// The lut space reserved for a large ascii file is given back
+	std::string ascii(100000, 'x');
+	file = std::tmpfile();
+	std::fwrite(ascii.data(), 1, ascii.size(), file);
+	std::rewind(file);
+	str = tiny_utf8::load_file(file, &success);
+	std::fclose(file);
+	EXPECT_TRUE(success);
+	EXPECT_EQ(str.cpp_str(), ascii);
+	EXPECT_LE(str.memory_usage().unused_bytes, ascii.size() / 8);
+}
+
+namespace
+{
+	// Exposes read_file, in order to feed it inputs of a size other than announced
+	struct file_reading_string : tiny_utf8::string
+	{
+		using tiny_utf8::string::read_file;
+	};
+}
+
+TEST(TinyUTF8, LoadFileSizeMismatch)
+{
+	std::string data(1000, 'x');
+	data += "\xC3\xA4";
+	for (std::size_t announced : { data.size() - 1, std::size_t(10), data.size() + 5 }) {
+		std::size_t offset = 0;
+		file_reading_string str;
+		bool success = str.read_file(announced, [&](char* dest, std::size_t count) -> std::size_t {
+			count = std::min(count, data.size() - offset);
+			std::memcpy(dest, data.data() + offset, count);
+			offset += count;
+			return count;
+		});
+		if (announced < data.size()) { // The input grew: Fail instead of truncating it
+			EXPECT_FALSE(success);
+			EXPECT_TRUE(str.empty());
+		}
+		else { // The input shrunk: Take what is there
+			EXPECT_TRUE(success);
+			EXPECT_EQ(str.cpp_str(), data);
+			EXPECT_EQ(str.length(), 1001u);
+		}
+	}
+}
+
+TEST(TinyUTF8, Serialization)
+{
+	tiny_utf8::string sso(U"Bär");
+	tiny_utf8::string ascii(std::string(200, 'x'));
+	tiny_utf8::string lut(U"Löwen, Bären, Vögel und Käfer sind Tiere. Löwen, Bären, Vögel und Käfer sind Tiere.");
+	tiny_utf8::string multibyte(std::string(300, 'x') + std::string(100, 'x'));
+	for (std::size_t i = 0; i < multibyte.length(); i += 3)
+		multibyte[i] = U'€';
+	ASSERT_TRUE(lut.lut_active());
+	ASSERT_FALSE(multibyte.lut_active()); // Too many multibytes to be worth a lut
+
+	std::stringstream stream;
+	EXPECT_TRUE(sso.serialize(stream));
+	EXPECT_TRUE(ascii.serialize(stream));
+	EXPECT_TRUE(lut.serialize(stream));
+	EXPECT_TRUE(multibyte.serialize(stream));
+	std::string serialized = stream.str();
+
+	tiny_utf8::string str;
+	EXPECT_TRUE(str.deserialize(stream));
+	EXPECT_TRUE(str.sso_active());
+	EXPECT_EQ(str, sso);
+	EXPECT_TRUE(str.deserialize(stream));
+	EXPECT_EQ(str, ascii);
+	EXPECT_EQ(str.length(), ascii.length());
+	EXPECT_TRUE(str.deserialize(stream));
+	EXPECT_TRUE(str.lut_active());
+	EXPECT_EQ(str, lut);
+	EXPECT_EQ(str.length(), lut.length());
+	EXPECT_EQ(str[42], U'L');
+	EXPECT_EQ(str[43], U'ö');
+	EXPECT_TRUE(str.deserialize(stream));
+	EXPECT_FALSE(str.lut_active());
+	EXPECT_EQ(str, multibyte);
+	EXPECT_EQ(str.length(), multibyte.length());
+	EXPECT_EQ(str[399], U'€');
+	EXPECT_EQ(str[398], U'x');
+
+	// End of input
+	EXPECT_FALSE(str.deserialize(stream));
+	EXPECT_TRUE(str.empty());
+
+	// Corrupted header
+	std::string corrupted = serialized;
+	corrupted[2] ^= 0x1;
+	stream.clear();
+	stream.str(corrupted);
+	EXPECT_FALSE(str.deserialize(stream));
+	EXPECT_TRUE(stream.fail());
+	EXPECT_TRUE(str.empty());
+
+	// Truncated data
+	stream.clear();
+	stream.str(serialized.substr(0, serialized.size() - 1));
+	for (int i = 0; i < 3; ++i)
+		EXPECT_TRUE(str.deserialize(stream));
+	EXPECT_FALSE(str.deserialize(stream));
+	EXPECT_TRUE(str.empty());
+}
+
+static std::string forge_serialization_header(unsigned char lut_mode, std::uint64_t data_len, std::uint64_t string_len, std::uint64_t lut_len)
+{
+	unsigned char header[64];
+	unsigned char* iter = header;
+	*iter++ = tiny_utf8::tiny_utf8_detail::serialization_version;
+	*iter++ = lut_mode;
+	iter = tiny_utf8::tiny_utf8_detail::write_varint(iter, data_len);
+	iter = tiny_utf8::tiny_utf8_detail::write_varint(iter, string_len);
+	iter = tiny_utf8::tiny_utf8_detail::write_varint(iter, lut_len);
+	std::uint32_t check = tiny_utf8::tiny_utf8_detail::fnv1a(header, iter - header);
+	for (int i = 0; i < 4; ++i, check >>= 8)
+		*iter++ = (unsigned char)check;
+	return std::string(reinterpret_cast<const char*>(header), iter - header);
+}
+
+TEST(TinyUTF8, SerializationForgedInput)
+{
+	// Buffer size exceeding the 32-bit size_type (would wrap around to 131076 bytes)
+	std::stringstream stream(forge_serialization_header((4 << 1) | 0x1, (1ull << 31) + 3, 0, (1ull << 29) + (1ull << 15) - 1) + std::string(1 << 20, 'x'));
+	tiny_utf8::compact_string compact;
+	EXPECT_FALSE(compact.deserialize(stream));
+	EXPECT_TRUE(stream.fail());
+	EXPECT_TRUE(compact.empty());
+
+	// Forged lut entry in the middle (pointing to an ascii character)
+	tiny_utf8::string lut(U"Löwen, Bären, Vögel und Käfer sind Tiere. Löwen, Bären, Vögel und Käfer sind Tiere.");
+	ASSERT_TRUE(lut.lut_active());
+	std::stringstream original;
+	EXPECT_TRUE(lut.serialize(original));
+	std::string serialized = original.str();
+	std::size_t lut_len = lut.size() - lut.length();
+	ASSERT_EQ((unsigned char)serialized[1], (1 << 1) | 0x1); // 1-byte lut entries
+	serialized[serialized.size() - lut_len / 2] = 0;
+
+	tiny_utf8::string str;
+	stream.clear();
+	stream.str(serialized);
+	EXPECT_FALSE(str.deserialize(stream));
+	EXPECT_TRUE(stream.fail());
+	EXPECT_TRUE(str.empty());
+
+	// Entries out of order
+	serialized = original.str();
+	std::swap(serialized[serialized.size() - 1], serialized[serialized.size() - 2]);
+	stream.clear();
+	stream.str(serialized);
+	EXPECT_FALSE(str.deserialize(stream));
+
+	// The unmodified input still deserializes
+	stream.clear();
+	stream.str(original.str());
+	EXPECT_TRUE(str.deserialize(stream));
+	EXPECT_EQ(str, lut);
+}
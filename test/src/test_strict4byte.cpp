@@ -0,0 +1,50 @@
+﻿#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <tinyutf8/tinyutf8.h>
+
+static_assert(TINY_UTF8_STRICT_4BYTE, "This test has to be compiled with TINY_UTF8_STRICT_4BYTE");
+
+TEST(TinyUTF8, Strict4Byte_RoundTrip)
+{
+	std::u32string codepoints;
+	for (char32_t cp = 0x1; cp <= 0x10FFFF; cp += 7)
+		if (cp < 0xD800 || cp > 0xDFFF) // Surrogates are encodable, but not valid
+			codepoints.push_back(cp);
+	codepoints += U"\x7F\x80\x7FF\x800\xFFFF\x10000\x10FFFF\x1FFFFF";
+
+	tiny_utf8::string str(codepoints.c_str());
+	EXPECT_EQ(str.length(), codepoints.size());
+
+	std::u32string forward(str.raw_begin(), str.raw_end());
+	EXPECT_EQ(forward, codepoints);
+
+	std::u32string backward(str.raw_rbegin(), str.raw_rend());
+	std::reverse(backward.begin(), backward.end());
+	EXPECT_EQ(backward, codepoints);
+
+	EXPECT_TRUE(tiny_utf8::validate(str.data(), str.size() - 4)); // Without U+1FFFFF
+}
+
+TEST(TinyUTF8, Strict4Byte_CodepointBytes)
+{
+	EXPECT_EQ(tiny_utf8::string(U'\x7F').size(), 1);
+	EXPECT_EQ(tiny_utf8::string(U'\x80').size(), 2);
+	EXPECT_EQ(tiny_utf8::string(U'\x7FF').size(), 2);
+	EXPECT_EQ(tiny_utf8::string(U'\x800').size(), 3);
+	EXPECT_EQ(tiny_utf8::string(U'\xFFFF').size(), 3);
+	EXPECT_EQ(tiny_utf8::string(U'\x10000').size(), 4);
+	EXPECT_EQ(tiny_utf8::string(U'\x1FFFFF').size(), 4);
+
+	// Lead bytes beyond 0xF7 start 4-byte sequences
+	tiny_utf8::string str(std::string("a\xF8\x80\x80\x80" "b"));
+	EXPECT_EQ(str.length(), 3);
+	EXPECT_EQ(str[2], U'b');
+
+	// Truncated sequences count as single bytes
+	tiny_utf8::string truncated(std::string("a\xE2\x82"));
+	EXPECT_EQ(truncated.length(), 3);
+}